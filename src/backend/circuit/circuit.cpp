@@ -449,6 +449,18 @@ void Circuit::removeConnection(const SharedSelection& outputSelection, const Sha
 	}
 }
 
+void Circuit::beginEditTransaction() {
+	if (editTransactionDepth++ == 0) dataUpdateEventManager->sendEvent<circuit_id_t>("circuitEditTransactionBegin", circuitId);
+}
+
+void Circuit::commitEditTransaction() {
+	if (editTransactionDepth == 0) {
+		logError("No edit transaction to commit", "Circuit::commitEditTransaction");
+		return;
+	}
+	if (--editTransactionDepth == 0) dataUpdateEventManager->sendEvent<circuit_id_t>("circuitEditTransactionCommit", circuitId);
+}
+
 void Circuit::undo() {
 #ifdef TRACY_PROFILER
 	ZoneScoped;
@@ -456,6 +468,8 @@ void Circuit::undo() {
 	DifferenceSharedPtr newDifference = std::make_shared<Difference>();
 	const MinimalDifference* difference = undoSystem.undoDifference();
 	if (!difference) return;
+	// undoing a multi move sends one difference per step
+	CircuitEditTransaction editTransaction(*this);
 	startUndo();
 	MinimalDifference::block_modification_t blockModification;
 	MinimalDifference::connection_modification_t connectionModification;
@@ -506,6 +520,7 @@ void Circuit::redo() {
 	DifferenceSharedPtr newDifference = std::make_shared<Difference>();
 	const MinimalDifference* difference = undoSystem.redoDifference();
 	if (!difference) return;
+	CircuitEditTransaction editTransaction(*this);
 	startUndo();
 	MinimalDifference::block_modification_t blockModification;
 	MinimalDifference::connection_modification_t connectionModification;
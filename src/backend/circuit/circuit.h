@@ -82,6 +82,11 @@ public:
 	// Trys to remove connections.
 	bool tryRemoveConnection(const SharedSelection& outputSelection, const SharedSelection& inputSelection);
 
+	/* ----------- edit transactions ----------- */
+	// The evaluators of this circuit apply the edits made between these in one go once the outermost transaction commits.
+	void beginEditTransaction();
+	void commitEditTransaction();
+
 	/* ----------- undo ----------- */
 	void undo();
 	void redo();
@@ -130,6 +135,7 @@ private:
 
 	UndoSystem undoSystem;
 	bool midUndo = false;
+	unsigned int editTransactionDepth = 0;
 	bool editable = true;
 
 	unsigned long long editCount = 0;
@@ -137,4 +143,16 @@ private:
 
 typedef std::shared_ptr<Circuit> SharedCircuit;
 
+// Keeps an edit transaction of a circuit open while it lives
+class CircuitEditTransaction {
+public:
+	explicit CircuitEditTransaction(Circuit& circuit) : circuit(circuit) { circuit.beginEditTransaction(); }
+	CircuitEditTransaction(const CircuitEditTransaction&) = delete;
+	CircuitEditTransaction& operator=(const CircuitEditTransaction&) = delete;
+	~CircuitEditTransaction() { circuit.commitEditTransaction(); }
+
+private:
+	Circuit& circuit;
+};
+
 #endif /* circuit_h */
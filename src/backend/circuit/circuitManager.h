@@ -47,6 +47,7 @@ public:
 			// circuitBlockDataManager.removeCircuitBlockData(id);
 			UUIDToCircuits.erase(iter->second->getUUID());
 			circuits.erase(iter);
+			dataUpdateEventManager->sendEvent<circuit_id_t>("circuitDestroyed", id);
 		}
 	}
 
@@ -0,0 +1,366 @@
+#include "bitPlaneSimulator.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BIT_PLANE_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define BIT_PLANE_AVX2_TARGET
+#else
+#define BIT_PLANE_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define BIT_PLANE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+	// Reads the bits at 64 slots from both planes, lane i of the result is the bit of slots[i].
+	using GatherFunction = void (*)(const uint64_t* valuePlane, const uint64_t* unknownPlane, const uint32_t* slots, uint64_t& value, uint64_t& unknown);
+
+	void gatherBitsScalar(const uint64_t* valuePlane, const uint64_t* unknownPlane, const uint32_t* slots, uint64_t& value, uint64_t& unknown) {
+		uint64_t valueBits = 0;
+		uint64_t unknownBits = 0;
+		for (unsigned int lane = 0; lane < 64; ++lane) {
+			const uint32_t slot = slots[lane];
+			valueBits |= ((valuePlane[slot >> 6] >> (slot & 63)) & 1) << lane;
+			unknownBits |= ((unknownPlane[slot >> 6] >> (slot & 63)) & 1) << lane;
+		}
+		value = valueBits;
+		unknown = unknownBits;
+	}
+
+#ifdef BIT_PLANE_X86
+	// The planes are read as 32 bit words (little endian) so one gather fetches the word of 8 lanes,
+	// the wanted bit is then shifted into the sign bit and collected with movemask.
+	BIT_PLANE_AVX2_TARGET void gatherBitsAVX2(const uint64_t* valuePlane, const uint64_t* unknownPlane, const uint32_t* slots, uint64_t& value, uint64_t& unknown) {
+		const int* valueWords = reinterpret_cast<const int*>(valuePlane);
+		const int* unknownWords = reinterpret_cast<const int*>(unknownPlane);
+		const __m256i bitIndexMask = _mm256_set1_epi32(31);
+		uint64_t valueBits = 0;
+		uint64_t unknownBits = 0;
+		for (unsigned int lane = 0; lane < 64; lane += 8) {
+			const __m256i slot = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(slots + lane));
+			const __m256i wordIndex = _mm256_srli_epi32(slot, 5);
+			const __m256i shift = _mm256_sub_epi32(bitIndexMask, _mm256_and_si256(slot, bitIndexMask));
+			const __m256i valueWord = _mm256_sllv_epi32(_mm256_i32gather_epi32(valueWords, wordIndex, 4), shift);
+			const __m256i unknownWord = _mm256_sllv_epi32(_mm256_i32gather_epi32(unknownWords, wordIndex, 4), shift);
+			valueBits |= (uint64_t)(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(valueWord)) << lane;
+			unknownBits |= (uint64_t)(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(unknownWord)) << lane;
+		}
+		value = valueBits;
+		unknown = unknownBits;
+	}
+
+	bool cpuSupportsAVX2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return false;
+		__cpuid(info, 1);
+		// the OS has to save the ymm registers too
+		if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6) return false;
+		__cpuidex(info, 7, 0);
+		return info[1] & (1 << 5);
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+
+#ifdef BIT_PLANE_NEON
+	// NEON has no gather so the words are loaded per lane, the bit extraction and packing is done 4 lanes at a time.
+	void gatherBitsNEON(const uint64_t* valuePlane, const uint64_t* unknownPlane, const uint32_t* slots, uint64_t& value, uint64_t& unknown) {
+		const uint32_t* valueWords = reinterpret_cast<const uint32_t*>(valuePlane);
+		const uint32_t* unknownWords = reinterpret_cast<const uint32_t*>(unknownPlane);
+		static const uint32_t laneWeightData[4] = { 1, 2, 4, 8 };
+		const uint32x4_t laneWeights = vld1q_u32(laneWeightData);
+		const uint32x4_t one = vdupq_n_u32(1);
+		uint64_t valueBits = 0;
+		uint64_t unknownBits = 0;
+		for (unsigned int lane = 0; lane < 64; lane += 4) {
+			const uint32x4_t slot = vld1q_u32(slots + lane);
+			const int32x4_t shift = vnegq_s32(vreinterpretq_s32_u32(vandq_u32(slot, vdupq_n_u32(31))));
+			uint32_t wordIndex[4];
+			vst1q_u32(wordIndex, vshrq_n_u32(slot, 5));
+			const uint32_t valueWordData[4] = { valueWords[wordIndex[0]], valueWords[wordIndex[1]], valueWords[wordIndex[2]], valueWords[wordIndex[3]] };
+			const uint32_t unknownWordData[4] = { unknownWords[wordIndex[0]], unknownWords[wordIndex[1]], unknownWords[wordIndex[2]], unknownWords[wordIndex[3]] };
+			const uint32x4_t valueBit = vandq_u32(vshlq_u32(vld1q_u32(valueWordData), shift), one);
+			const uint32x4_t unknownBit = vandq_u32(vshlq_u32(vld1q_u32(unknownWordData), shift), one);
+			valueBits |= (uint64_t)vaddvq_u32(vmulq_u32(valueBit, laneWeights)) << lane;
+			unknownBits |= (uint64_t)vaddvq_u32(vmulq_u32(unknownBit, laneWeights)) << lane;
+		}
+		value = valueBits;
+		unknown = unknownBits;
+	}
+#endif
+
+	struct GatherKernel {
+		GatherFunction function;
+		const char* name;
+	};
+
+	GatherKernel selectGatherKernel() {
+#if defined(BIT_PLANE_X86)
+		if (cpuSupportsAVX2()) return { &gatherBitsAVX2, "avx2" };
+#elif defined(BIT_PLANE_NEON)
+		return { &gatherBitsNEON, "neon" };
+#endif
+		return { &gatherBitsScalar, "scalar" };
+	}
+
+	const GatherKernel gatherKernel = selectGatherKernel();
+}
+
+const char* BitPlaneSimulator::getKernelName() {
+	return gatherKernel.name;
+}
+
+void BitPlaneSimulator::clear() {
+	valueA.clear();
+	unknownA.clear();
+	valueB.clear();
+	unknownB.clear();
+	slotOfId.clear();
+	batches.clear();
+	junctionSlots.clear();
+	junctionInputOffsets.clear();
+	junctionInputSlots.clear();
+	jobInstructions.clear();
+}
+
+void BitPlaneSimulator::compile(
+	const std::vector<logic_state_t>& statesA,
+	const std::vector<logic_state_t>& statesB,
+	const std::vector<ANDLikeGate>& andGates,
+	const std::vector<XORLikeGate>& xorGates,
+	const std::vector<TristateBufferGate>& tristateBuffers,
+	const std::vector<JunctionGate>& junctions,
+	const std::vector<ConstantResetGate>& constantResetGates,
+	const std::vector<CopySelfOutputGate>& copySelfOutputGates
+) {
+	clear();
+
+	struct PendingGate {
+		simulator_id_t id;
+		const std::vector<simulator_id_t>* inputs;
+		const std::vector<simulator_id_t>* enableInputs;
+	};
+	std::map<std::tuple<int, bool, bool, bool, int, uint32_t, uint32_t>, size_t> batchIndices;
+	std::vector<std::vector<PendingGate>> batchGates;
+	auto addToBatch = [&](const Batch& batch, PendingGate gate) {
+		auto key = std::make_tuple(
+			(int)batch.kind, batch.inputsInverted, batch.outputInverted, batch.enableInverted,
+			(int)batch.constantState, batch.inputCount, batch.enableCount
+		);
+		auto [it, inserted] = batchIndices.try_emplace(key, batches.size());
+		if (inserted) {
+			batches.push_back(batch);
+			batchGates.emplace_back();
+		}
+		batchGates[it->second].push_back(gate);
+	};
+
+	for (const ANDLikeGate& gate : andGates) {
+		Batch batch;
+		batch.kind = BatchKind::AND_LIKE;
+		batch.inputsInverted = gate.inputsInverted;
+		batch.outputInverted = gate.outputInverted;
+		batch.inputCount = gate.getInputs().size();
+		addToBatch(batch, { gate.getId(), &gate.getInputs(), nullptr });
+	}
+	for (const XORLikeGate& gate : xorGates) {
+		Batch batch;
+		batch.kind = BatchKind::XOR_LIKE;
+		batch.outputInverted = gate.outputInverted;
+		batch.inputCount = gate.getInputs().size();
+		addToBatch(batch, { gate.getId(), &gate.getInputs(), nullptr });
+	}
+	for (const TristateBufferGate& gate : tristateBuffers) {
+		Batch batch;
+		batch.kind = BatchKind::TRISTATE_BUFFER;
+		batch.enableInverted = gate.enableInverted;
+		batch.inputCount = gate.inputs.size();
+		batch.enableCount = gate.enableInputs.size();
+		addToBatch(batch, { gate.getId(), &gate.inputs, &gate.enableInputs });
+	}
+	for (const ConstantResetGate& gate : constantResetGates) {
+		Batch batch;
+		batch.kind = BatchKind::CONSTANT_RESET;
+		batch.constantState = gate.outputState;
+		addToBatch(batch, { gate.getId(), nullptr, nullptr });
+	}
+	for (const CopySelfOutputGate& gate : copySelfOutputGates) {
+		Batch batch;
+		batch.kind = BatchKind::COPY_SELF_OUTPUT;
+		addToBatch(batch, { gate.getId(), nullptr, nullptr });
+	}
+
+	// every batch starts on a fresh word, the ids that are never ticked go after the batches
+	constexpr uint32_t unassignedSlot = std::numeric_limits<uint32_t>::max();
+	slotOfId.assign(statesA.size(), unassignedSlot);
+	size_t wordCount = 0;
+	for (size_t batchIndex = 0; batchIndex < batches.size(); ++batchIndex) {
+		Batch& batch = batches[batchIndex];
+		batch.gateCount = batchGates[batchIndex].size();
+		batch.firstWord = wordCount;
+		batch.wordCount = (batch.gateCount + 63) / 64;
+		wordCount += batch.wordCount;
+		for (size_t gateIndex = 0; gateIndex < batch.gateCount; ++gateIndex) {
+			slotOfId[batchGates[batchIndex][gateIndex].id] = batch.firstWord * 64 + gateIndex;
+		}
+	}
+	uint32_t nextSlot = wordCount * 64;
+	for (uint32_t& slot : slotOfId) {
+		if (slot == unassignedSlot) slot = nextSlot++;
+	}
+	// padding lanes read this slot, it is never written so it stays LOW
+	const uint32_t zeroSlot = nextSlot++;
+
+	const size_t planeWordCount = (nextSlot + 63) / 64;
+	valueA.assign(planeWordCount, 0);
+	unknownA.assign(planeWordCount, 0);
+	valueB.assign(planeWordCount, 0);
+	unknownB.assign(planeWordCount, 0);
+	for (simulator_id_t id = 0; id < statesA.size(); ++id) {
+		setSlotState(valueA, unknownA, slotOfId[id], statesA[id]);
+		setSlotState(valueB, unknownB, slotOfId[id], statesB[id]);
+	}
+
+	for (size_t batchIndex = 0; batchIndex < batches.size(); ++batchIndex) {
+		Batch& batch = batches[batchIndex];
+		const size_t laneCount = batch.wordCount * 64;
+		batch.inputSlots.assign((batch.inputCount + batch.enableCount) * laneCount, zeroSlot);
+		for (size_t gateIndex = 0; gateIndex < batch.gateCount; ++gateIndex) {
+			const PendingGate& gate = batchGates[batchIndex][gateIndex];
+			for (uint32_t input = 0; input < batch.inputCount; ++input) {
+				batch.inputSlots[input * laneCount + gateIndex] = slotOfId[(*gate.inputs)[input]];
+			}
+			for (uint32_t input = 0; input < batch.enableCount; ++input) {
+				batch.inputSlots[(batch.inputCount + input) * laneCount + gateIndex] = slotOfId[(*gate.enableInputs)[input]];
+			}
+		}
+	}
+
+	junctionInputOffsets.reserve(junctions.size() + 1);
+	junctionInputOffsets.push_back(0);
+	for (const JunctionGate& gate : junctions) {
+		junctionSlots.push_back(slotOfId[gate.getId()]);
+		for (simulator_id_t inputId : gate.inputs) {
+			junctionInputSlots.push_back(slotOfId[inputId]);
+		}
+		junctionInputOffsets.push_back(junctionInputSlots.size());
+	}
+}
+
+void BitPlaneSimulator::unpack(std::vector<logic_state_t>& statesA, std::vector<logic_state_t>& statesB) const {
+	statesA.resize(slotOfId.size());
+	statesB.resize(slotOfId.size());
+	for (simulator_id_t id = 0; id < slotOfId.size(); ++id) {
+		statesA[id] = getSlotState(valueA, unknownA, slotOfId[id]);
+		statesB[id] = getSlotState(valueB, unknownB, slotOfId[id]);
+	}
+}
+
+std::vector<ThreadPool::Job> BitPlaneSimulator::makeJobs(bool realistic, size_t wordsPerJob, std::vector<size_t>& jobCosts) {
+	jobInstructions.clear();
+	jobCosts.clear();
+	for (size_t batchIndex = 0; batchIndex < batches.size(); ++batchIndex) {
+		const Batch& batch = batches[batchIndex];
+		for (size_t word = 0; word < batch.wordCount; word += wordsPerJob) {
+			const size_t wordEnd = std::min(word + wordsPerJob, batch.wordCount);
+			jobInstructions.push_back({ this, batchIndex, word, wordEnd, realistic });
+			jobCosts.push_back((wordEnd - word) * 64 * (1 + batch.inputCount + batch.enableCount));
+		}
+	}
+	std::vector<ThreadPool::Job> jobs;
+	jobs.reserve(jobInstructions.size());
+	for (JobInstruction& jobInstruction : jobInstructions) {
+		jobs.push_back(ThreadPool::Job { &BitPlaneSimulator::execBatch, &jobInstruction });
+	}
+	return jobs;
+}
+
+void BitPlaneSimulator::execBatch(void* jobInstruction) {
+	auto* ji = static_cast<JobInstruction*>(jobInstruction);
+	ji->self->tickBatch(ji->self->batches[ji->batchIndex], ji->wordBegin, ji->wordEnd, ji->realistic);
+}
+
+void BitPlaneSimulator::tickBatch(const Batch& batch, size_t wordBegin, size_t wordEnd, bool realistic) {
+	const GatherFunction gather = gatherKernel.function;
+	const size_t laneCount = batch.wordCount * 64;
+	const uint64_t* valuePlane = valueA.data();
+	const uint64_t* unknownPlane = unknownA.data();
+
+	for (size_t word = wordBegin; word < wordEnd; ++word) {
+		const uint32_t* laneSlots = batch.inputSlots.data() + word * 64;
+		const size_t outputWord = batch.firstWord + word;
+		auto getInput = [&](uint32_t input) {
+			LogicWord inputWord;
+			gather(valuePlane, unknownPlane, laneSlots + input * laneCount, inputWord.value, inputWord.unknown);
+			return inputWord;
+		};
+		LogicWord target;
+
+		switch (batch.kind) {
+		case BatchKind::AND_LIKE:
+			target = LogicWord::andLike(batch.inputCount, batch.inputsInverted, batch.outputInverted, getInput);
+			break;
+		case BatchKind::XOR_LIKE:
+			target = LogicWord::xorLike(batch.inputCount, batch.outputInverted, getInput);
+			break;
+		case BatchKind::TRISTATE_BUFFER:
+			target = LogicWord::tristate(batch.inputCount, batch.enableCount, batch.enableInverted, getInput);
+			break;
+		case BatchKind::CONSTANT_RESET:
+			target = LogicWord::broadcast(batch.constantState);
+			break;
+		case BatchKind::COPY_SELF_OUTPUT:
+			target = { valueA[outputWord], unknownA[outputWord] };
+			break;
+		}
+
+		const bool realisticKind = batch.kind == BatchKind::AND_LIKE || batch.kind == BatchKind::XOR_LIKE || batch.kind == BatchKind::TRISTATE_BUFFER;
+		if (realistic && realisticKind) {
+			target = LogicWord::realistic(target, { valueA[outputWord], unknownA[outputWord] });
+		}
+		valueB[outputWord] = target.value;
+		unknownB[outputWord] = target.unknown;
+	}
+}
+
+logic_state_t BitPlaneSimulator::calculateJunction(size_t junctionIndex) const {
+	logic_state_t outputState = logic_state_t::FLOATING;
+	for (size_t i = junctionInputOffsets[junctionIndex]; i < junctionInputOffsets[junctionIndex + 1]; ++i) {
+		const logic_state_t state = getSlotState(valueB, unknownB, junctionInputSlots[i]);
+		if (state == logic_state_t::FLOATING) {
+			continue;
+		}
+		if (state == logic_state_t::UNDEFINED) {
+			return logic_state_t::UNDEFINED;
+		}
+		if (outputState == logic_state_t::FLOATING) {
+			outputState = state;
+		} else if (outputState != state) {
+			return logic_state_t::UNDEFINED;
+		}
+	}
+	return outputState;
+}
+
+void BitPlaneSimulator::tickJunctions() {
+	for (size_t junctionIndex = 0; junctionIndex < junctionSlots.size(); ++junctionIndex) {
+		setSlotState(valueB, unknownB, junctionSlots[junctionIndex], calculateJunction(junctionIndex));
+	}
+}
+
+void BitPlaneSimulator::doubleTickJunctions() {
+	// resolve from the current states like LogicSimulator does, the next planes still hold the gate states of the tick before
+	valueB = valueA;
+	unknownB = unknownA;
+	for (size_t junctionIndex = 0; junctionIndex < junctionSlots.size(); ++junctionIndex) {
+		const logic_state_t state = calculateJunction(junctionIndex);
+		setSlotState(valueA, unknownA, junctionSlots[junctionIndex], state);
+		setSlotState(valueB, unknownB, junctionSlots[junctionIndex], state);
+	}
+}
@@ -0,0 +1,119 @@
+#ifndef bitPlaneSimulator_h
+#define bitPlaneSimulator_h
+
+#include "logicWord.h"
+#include "simulatorGates.h"
+#include "threadPool.h"
+
+// Alternative state storage for the LogicSimulator.
+// The four valued logic_state_t is split into two bit planes: the value plane holds bit 0 and the unknown plane holds bit 1
+// (LOW = 00, HIGH = 01, FLOATING = 10, UNDEFINED = 11). Gates with the same type, flags and fan-in are grouped into batches
+// and evaluated 64 at a time with plain word operations, the input bits are gathered with AVX2/NEON when available.
+// Every id is given a "slot" in the planes so that the outputs of a batch are contiguous and every job writes whole words.
+class BitPlaneSimulator {
+public:
+	enum class BatchKind : unsigned char {
+		AND_LIKE,
+		XOR_LIKE,
+		TRISTATE_BUFFER,
+		CONSTANT_RESET,
+		COPY_SELF_OUTPUT
+	};
+
+	struct Batch {
+		BatchKind kind;
+		bool inputsInverted = false;
+		bool outputInverted = false;
+		bool enableInverted = false;
+		logic_state_t constantState = logic_state_t::LOW;
+		uint32_t inputCount = 0; // data inputs per gate
+		uint32_t enableCount = 0; // enable inputs per gate (tristate buffers only)
+		size_t gateCount = 0;
+		size_t firstWord = 0;
+		size_t wordCount = 0;
+		// input major: the slot of input k of gate g is inputSlots[k * wordCount * 64 + g]
+		std::vector<uint32_t> inputSlots;
+	};
+
+	void compile(
+		const std::vector<logic_state_t>& statesA,
+		const std::vector<logic_state_t>& statesB,
+		const std::vector<ANDLikeGate>& andGates,
+		const std::vector<XORLikeGate>& xorGates,
+		const std::vector<TristateBufferGate>& tristateBuffers,
+		const std::vector<JunctionGate>& junctions,
+		const std::vector<ConstantResetGate>& constantResetGates,
+		const std::vector<CopySelfOutputGate>& copySelfOutputGates
+	);
+	void clear();
+	// both buffers are restored, junction doubleTicks read the previous states from statesB
+	void unpack(std::vector<logic_state_t>& statesA, std::vector<logic_state_t>& statesB) const;
+
+	size_t getStateCount() const { return slotOfId.size(); }
+	logic_state_t getState(simulator_id_t id) const { return getSlotState(valueA, unknownA, slotOfId[id]); }
+	logic_state_t getNextState(simulator_id_t id) const { return getSlotState(valueB, unknownB, slotOfId[id]); }
+	// sets the state in both planes, same as LogicSimulator::setState does for statesA and statesB
+	void setState(simulator_id_t id, logic_state_t state) {
+		setSlotState(valueA, unknownA, slotOfId[id], state);
+		setSlotState(valueB, unknownB, slotOfId[id], state);
+	}
+	// for ids outside of the batches, sets the state the id gets at the end of the tick
+	void setNextState(simulator_id_t id, logic_state_t state) { setSlotState(valueB, unknownB, slotOfId[id], state); }
+
+	// jobCosts gets the number of inputs every job reads
+	std::vector<ThreadPool::Job> makeJobs(bool realistic, size_t wordsPerJob, std::vector<size_t>& jobCosts);
+	void tickJunctions();
+	void doubleTickJunctions();
+	void swapPlanes() {
+		std::swap(valueA, valueB);
+		std::swap(unknownA, unknownB);
+	}
+
+	static const char* getKernelName();
+
+	// the current planes, for copying them out without unpacking every state
+	const std::vector<uint64_t>& getValuePlane() const { return valueA; }
+	const std::vector<uint64_t>& getUnknownPlane() const { return unknownA; }
+	const std::vector<uint32_t>& getSlotOfId() const { return slotOfId; }
+	static inline logic_state_t getSlotState(const std::vector<uint64_t>& value, const std::vector<uint64_t>& unknown, uint32_t slot) {
+		const uint64_t bit = uint64_t(1) << (slot & 63);
+		return (logic_state_t)(((value[slot >> 6] & bit) ? 1 : 0) | ((unknown[slot >> 6] & bit) ? 2 : 0));
+	}
+
+private:
+	struct JobInstruction {
+		BitPlaneSimulator* self;
+		size_t batchIndex;
+		size_t wordBegin;
+		size_t wordEnd;
+		bool realistic;
+	};
+	static void execBatch(void* jobInstruction);
+	void tickBatch(const Batch& batch, size_t wordBegin, size_t wordEnd, bool realistic);
+
+	static inline void setSlotState(std::vector<uint64_t>& value, std::vector<uint64_t>& unknown, uint32_t slot, logic_state_t state) {
+		const uint64_t bit = uint64_t(1) << (slot & 63);
+		if ((unsigned char)state & 1) value[slot >> 6] |= bit;
+		else value[slot >> 6] &= ~bit;
+		if ((unsigned char)state & 2) unknown[slot >> 6] |= bit;
+		else unknown[slot >> 6] &= ~bit;
+	}
+	logic_state_t calculateJunction(size_t junctionIndex) const;
+
+	std::vector<uint64_t> valueA;
+	std::vector<uint64_t> unknownA;
+	std::vector<uint64_t> valueB;
+	std::vector<uint64_t> unknownB;
+
+	std::vector<uint32_t> slotOfId;
+	std::vector<Batch> batches;
+
+	// junctions read and write the next planes in place so they stay serial, in the order of LogicSimulator::junctions
+	std::vector<uint32_t> junctionSlots;
+	std::vector<size_t> junctionInputOffsets;
+	std::vector<uint32_t> junctionInputSlots;
+
+	std::vector<JobInstruction> jobInstructions;
+};
+
+#endif /* bitPlaneSimulator_h */
@@ -0,0 +1,289 @@
+#ifndef compiledGates_h
+#define compiledGates_h
+
+#include "simulatorGates.h"
+
+// Flattened copy of the gates that get ticked, kept up to date by LogicSimulator::regenerateJobs after edits.
+// Ids, flags and inputs live in separate arrays and the inputs of every gate share one CSR array per chunk, so ticking a
+// range of gates walks contiguous memory and never touches the gate objects (no vtable, no per gate heap vectors).
+// Gate i of a table is gate i of the matching LogicSimulator vector. The tables are cut into chunks of chunkSize gates
+// and edits mark the chunks of the gates they touch, update only rebuilds those.
+class CompiledGates {
+friend class WasmTickModule;
+public:
+	enum class Table : uint8_t {
+		AND,
+		XOR,
+		TRISTATE_BUFFER,
+		JUNCTION,
+		CONSTANT_RESET,
+		COPY_SELF_OUTPUT,
+		COUNT
+	};
+	static constexpr size_t chunkSize = 256;
+
+	void markDirty(Table table, size_t gateIndex) { getTable(table).markDirty(gateIndex / chunkSize); }
+	void markAllDirty() {
+		for (GateTable& table : tables) table.allDirty = true;
+	}
+
+	void update(
+		const std::vector<ANDLikeGate>& andGates,
+		const std::vector<XORLikeGate>& xorGates,
+		const std::vector<TristateBufferGate>& tristateBuffers,
+		const std::vector<JunctionGate>& junctions,
+		const std::vector<ConstantResetGate>& constantResetGates,
+		const std::vector<CopySelfOutputGate>& copySelfOutputGates
+	) {
+		getTable(Table::AND).update(andGates, [](const ANDLikeGate& gate, Chunk& chunk) {
+			chunk.appendInputs(gate.getInputs());
+			return (gate.inputsInverted ? INPUTS_INVERTED : 0) | (gate.outputInverted ? OUTPUT_INVERTED : 0);
+		});
+		getTable(Table::XOR).update(xorGates, [](const XORLikeGate& gate, Chunk& chunk) {
+			chunk.appendInputs(gate.getInputs());
+			return gate.outputInverted ? OUTPUT_INVERTED : 0;
+		});
+		getTable(Table::TRISTATE_BUFFER).update(tristateBuffers, [](const TristateBufferGate& gate, Chunk& chunk) {
+			chunk.appendInputs(gate.inputs);
+			chunk.enableOffsets.push_back(chunk.inputIds.size());
+			chunk.appendInputs(gate.enableInputs);
+			return gate.enableInverted ? ENABLE_INVERTED : 0;
+		});
+		if (getTable(Table::JUNCTION).update(junctions, [](const JunctionGate& gate, Chunk& chunk) {
+			chunk.appendInputs(gate.inputs);
+			return 0;
+		})) {
+			levelizeJunctions();
+		}
+		// the flags of a constant reset gate hold its state
+		getTable(Table::CONSTANT_RESET).update(constantResetGates, [](const ConstantResetGate& gate, Chunk&) {
+			return (int)gate.outputState;
+		});
+		getTable(Table::COPY_SELF_OUTPUT).update(copySelfOutputGates, [](const CopySelfOutputGate&, Chunk&) {
+			return 0;
+		});
+	}
+
+	size_t getGateCount(Table table) const { return getTable(table).ids.size(); }
+	size_t getChunkCount(Table table) const { return getTable(table).chunks.size(); }
+	size_t getChunkGateCount(Table table, size_t chunkIndex) const {
+		return std::min(chunkSize, getGateCount(table) - chunkIndex * chunkSize);
+	}
+	size_t getChunkInputCount(Table table, size_t chunkIndex) const { return getTable(table).chunks[chunkIndex].inputIds.size(); }
+
+	template <bool realistic>
+	inline void tickANDGates(size_t begin, size_t end, const logic_state_t* statesA, logic_state_t* statesB) const noexcept {
+		const GateTable& andTable = getTable(Table::AND);
+		andTable.forEach(begin, end, [&](size_t i, const Chunk& chunk, size_t gate) {
+			const uint8_t gateFlags = andTable.flags[i];
+			const logic_state_t targetState = ANDLikeGate::calculate(
+				statesA, chunk.inputsBegin(gate), chunk.inputsEnd(gate), gateFlags & INPUTS_INVERTED, gateFlags & OUTPUT_INVERTED
+			);
+			store<realistic>(andTable.ids[i], targetState, statesA, statesB);
+		});
+	}
+
+	template <bool realistic>
+	inline void tickXORGates(size_t begin, size_t end, const logic_state_t* statesA, logic_state_t* statesB) const noexcept {
+		const GateTable& xorTable = getTable(Table::XOR);
+		xorTable.forEach(begin, end, [&](size_t i, const Chunk& chunk, size_t gate) {
+			const logic_state_t targetState = XORLikeGate::calculate(
+				statesA, chunk.inputsBegin(gate), chunk.inputsEnd(gate), xorTable.flags[i] & OUTPUT_INVERTED
+			);
+			store<realistic>(xorTable.ids[i], targetState, statesA, statesB);
+		});
+	}
+
+	template <bool realistic>
+	inline void tickTristateBuffers(size_t begin, size_t end, const logic_state_t* statesA, logic_state_t* statesB) const noexcept {
+		const GateTable& tristateTable = getTable(Table::TRISTATE_BUFFER);
+		tristateTable.forEach(begin, end, [&](size_t i, const Chunk& chunk, size_t gate) {
+			const simulator_id_t* enableInputs = chunk.inputIds.data() + chunk.enableOffsets[gate];
+			const logic_state_t targetState = TristateBufferGate::calculate(
+				statesA, chunk.inputsBegin(gate), enableInputs, enableInputs, chunk.inputsEnd(gate), tristateTable.flags[i] & ENABLE_INVERTED
+			);
+			store<realistic>(tristateTable.ids[i], targetState, statesA, statesB);
+		});
+	}
+
+	inline void tickConstantResetGates(size_t begin, size_t end, logic_state_t* statesB) const noexcept {
+		const GateTable& constantResetTable = getTable(Table::CONSTANT_RESET);
+		for (size_t i = begin; i < end; ++i) {
+			statesB[constantResetTable.ids[i]] = (logic_state_t)constantResetTable.flags[i];
+		}
+	}
+
+	inline void tickCopySelfOutputGates(size_t begin, size_t end, const logic_state_t* statesA, logic_state_t* statesB) const noexcept {
+		const GateTable& copySelfOutputTable = getTable(Table::COPY_SELF_OUTPUT);
+		for (size_t i = begin; i < end; ++i) {
+			statesB[copySelfOutputTable.ids[i]] = statesA[copySelfOutputTable.ids[i]];
+		}
+	}
+
+	// junctions read and write the same buffer, same as JunctionGate::tick
+	inline void tickJunctions(size_t begin, size_t end, logic_state_t* states) const noexcept {
+		const GateTable& junctionTable = getTable(Table::JUNCTION);
+		junctionTable.forEach(begin, end, [&](size_t i, const Chunk& chunk, size_t gate) {
+			states[junctionTable.ids[i]] = JunctionGate::calculate(states, chunk.inputsBegin(gate), chunk.inputsEnd(gate));
+		});
+	}
+	inline void tickJunctions(logic_state_t* states) const noexcept {
+		tickJunctions(0, getGateCount(Table::JUNCTION), states);
+	}
+
+	// Junctions sorted into levels that give the same result as tickJunctions when the levels run in order and the
+	// junctions of one level run in any order (or in parallel). begin and end are positions in that order, not junction indices.
+	size_t getJunctionLevelCount() const { return junctionLevelOffsets.size() - 1; }
+	size_t getJunctionLevelBegin(size_t level) const { return junctionLevelOffsets[level]; }
+	inline void tickJunctionLevel(size_t begin, size_t end, logic_state_t* states) const noexcept {
+		const GateTable& junctionTable = getTable(Table::JUNCTION);
+		for (size_t position = begin; position < end; ++position) {
+			const uint32_t i = junctionOrder[position];
+			states[junctionTable.ids[i]] = JunctionGate::calculate(states, junctionTable.inputsBegin(i), junctionTable.inputsEnd(i));
+		}
+	}
+
+private:
+	enum GateFlags : uint8_t {
+		INPUTS_INVERTED = 1 << 0,
+		OUTPUT_INVERTED = 1 << 1,
+		ENABLE_INVERTED = 1 << 2
+	};
+
+	struct Chunk {
+		std::vector<uint32_t> inputOffsets { 0 }; // inputs of gate g of the chunk are inputIds[inputOffsets[g], inputOffsets[g + 1])
+		std::vector<uint32_t> enableOffsets; // tristate buffers only, where the enable inputs of gate g start
+		std::vector<simulator_id_t> inputIds;
+
+		void clear() {
+			inputOffsets.assign(1, 0);
+			enableOffsets.clear();
+			inputIds.clear();
+		}
+		// extends the inputs of the gate that is being added
+		void appendInputs(const std::vector<simulator_id_t>& inputs) {
+			inputIds.insert(inputIds.end(), inputs.begin(), inputs.end());
+		}
+		inline const simulator_id_t* inputsBegin(size_t gate) const noexcept { return inputIds.data() + inputOffsets[gate]; }
+		inline const simulator_id_t* inputsEnd(size_t gate) const noexcept { return inputIds.data() + inputOffsets[gate + 1]; }
+	};
+
+	struct GateTable {
+		std::vector<simulator_id_t> ids;
+		std::vector<uint8_t> flags;
+		std::vector<Chunk> chunks;
+		std::vector<uint8_t> dirtyChunks;
+		bool allDirty = true;
+
+		void markDirty(size_t chunkIndex) {
+			if (dirtyChunks.size() <= chunkIndex) dirtyChunks.resize(chunkIndex + 1, 0);
+			dirtyChunks[chunkIndex] = 1;
+		}
+
+		// describe(gate, chunk) appends the inputs of the gate to the chunk and returns its flags. Returns if anything changed.
+		template <class Gate, class Describe>
+		bool update(const std::vector<Gate>& gates, Describe&& describe) {
+			const size_t oldGateCount = ids.size();
+			// the chunk that held the last gate shrinks or grows with the gate count
+			if (gates.size() != oldGateCount) {
+				if (oldGateCount != 0) markDirty((oldGateCount - 1) / chunkSize);
+				if (!gates.empty()) markDirty((gates.size() - 1) / chunkSize);
+			}
+			ids.resize(gates.size());
+			flags.resize(gates.size());
+			chunks.resize((gates.size() + chunkSize - 1) / chunkSize);
+			// a table that shrinks to nothing has no chunk left to rebuild but still changed
+			bool changed = allDirty || gates.size() != oldGateCount;
+			for (size_t chunkIndex = 0; chunkIndex < chunks.size(); ++chunkIndex) {
+				if (!allDirty && (chunkIndex >= dirtyChunks.size() || !dirtyChunks[chunkIndex])) continue;
+				changed = true;
+				Chunk& chunk = chunks[chunkIndex];
+				chunk.clear();
+				const size_t end = std::min(gates.size(), (chunkIndex + 1) * chunkSize);
+				for (size_t i = chunkIndex * chunkSize; i < end; ++i) {
+					ids[i] = gates[i].getId();
+					flags[i] = describe(gates[i], chunk);
+					chunk.inputOffsets.push_back(chunk.inputIds.size());
+				}
+			}
+			dirtyChunks.clear();
+			allDirty = false;
+			return changed;
+		}
+
+		// calls visit(i, chunk, g) for every gate i in [begin, end), g is the index of gate i in its chunk
+		template <class Visit>
+		inline void forEach(size_t begin, size_t end, Visit&& visit) const noexcept {
+			for (size_t chunkIndex = begin / chunkSize; begin < end; ++chunkIndex) {
+				const Chunk& chunk = chunks[chunkIndex];
+				const size_t chunkBegin = chunkIndex * chunkSize;
+				const size_t chunkEnd = std::min(end, chunkBegin + chunkSize);
+				for (; begin < chunkEnd; ++begin) visit(begin, chunk, begin - chunkBegin);
+			}
+		}
+		inline const simulator_id_t* inputsBegin(size_t i) const noexcept { return chunks[i / chunkSize].inputsBegin(i % chunkSize); }
+		inline const simulator_id_t* inputsEnd(size_t i) const noexcept { return chunks[i / chunkSize].inputsEnd(i % chunkSize); }
+	};
+
+	GateTable& getTable(Table table) { return tables[(size_t)table]; }
+	const GateTable& getTable(Table table) const { return tables[(size_t)table]; }
+
+	template <bool realistic>
+	static inline void store(simulator_id_t id, logic_state_t targetState, const logic_state_t* statesA, logic_state_t* statesB) noexcept {
+		if constexpr (realistic) {
+			statesB[id] = SimulatorGate::realisticState(targetState, statesA[id]);
+		} else {
+			statesB[id] = targetState;
+		}
+	}
+
+	// In tickJunctions a junction sees the new state of the junctions before it and the old state of the ones after it.
+	// Both orders are kept by putting every junction a level above each junction before it that it reads or that reads it.
+	void levelizeJunctions() {
+		const GateTable& junctionTable = getTable(Table::JUNCTION);
+		const size_t junctionCount = junctionTable.ids.size();
+		constexpr uint32_t noJunction = std::numeric_limits<uint32_t>::max();
+		simulator_id_t idCount = 0;
+		for (simulator_id_t id : junctionTable.ids) idCount = std::max(idCount, id + 1);
+		std::vector<uint32_t> junctionOfId(idCount, noJunction);
+		for (size_t i = 0; i < junctionCount; ++i) junctionOfId[junctionTable.ids[i]] = i;
+
+		// earlier junctions that read a later one, by the later junction
+		std::vector<std::pair<uint32_t, uint32_t>> laterReads;
+		for (size_t i = 0; i < junctionCount; ++i) {
+			for (const simulator_id_t* input = junctionTable.inputsBegin(i); input != junctionTable.inputsEnd(i); ++input) {
+				const uint32_t other = *input < idCount ? junctionOfId[*input] : noJunction;
+				if (other != noJunction && other > i) laterReads.emplace_back(other, i);
+			}
+		}
+		std::sort(laterReads.begin(), laterReads.end());
+
+		// every constraint points from the lower index to the higher one, so one pass in index order settles them
+		std::vector<uint32_t> level(junctionCount, 0);
+		uint32_t levelCount = 0;
+		size_t nextLaterRead = 0;
+		for (size_t i = 0; i < junctionCount; ++i) {
+			for (const simulator_id_t* input = junctionTable.inputsBegin(i); input != junctionTable.inputsEnd(i); ++input) {
+				const uint32_t other = *input < idCount ? junctionOfId[*input] : noJunction;
+				if (other < i) level[i] = std::max(level[i], level[other] + 1);
+			}
+			for (; nextLaterRead < laterReads.size() && laterReads[nextLaterRead].first == i; ++nextLaterRead) {
+				level[i] = std::max(level[i], level[laterReads[nextLaterRead].second] + 1);
+			}
+			levelCount = std::max(levelCount, level[i] + 1);
+		}
+
+		junctionLevelOffsets.assign(levelCount + 1, 0);
+		for (size_t i = 0; i < junctionCount; ++i) ++junctionLevelOffsets[level[i] + 1];
+		for (size_t l = 0; l < levelCount; ++l) junctionLevelOffsets[l + 1] += junctionLevelOffsets[l];
+		junctionOrder.resize(junctionCount);
+		std::vector<size_t> cursor(junctionLevelOffsets.begin(), junctionLevelOffsets.end() - 1);
+		for (size_t i = 0; i < junctionCount; ++i) junctionOrder[cursor[level[i]]++] = i;
+	}
+
+	std::array<GateTable, (size_t)Table::COUNT> tables; // tristate buffers have their data inputs followed by the enable inputs
+	std::vector<uint32_t> junctionOrder; // junction indices sorted by level, in index order within a level
+	std::vector<size_t> junctionLevelOffsets { 0 };
+};
+
+#endif /* compiledGates_h */
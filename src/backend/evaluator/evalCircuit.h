@@ -19,16 +19,21 @@ public:
 		return circuitId;
 	}
 	void setNode(Position pos, CircuitNode node) {
+		forgetICPosition(pos);
 		circuitNodes.insert(pos, node);
+		if (node.isIC()) {
+			icPositions[node.getId()] = pos;
+		}
 	}
 	void removeNode(Position pos) {
+		forgetICPosition(pos);
 		circuitNodes.remove(pos);
 	}
 	void moveNode(Position oldPos, Position newPos) {
 		std::optional<CircuitNode> node = getNode(oldPos);
 		if (node) {
-			circuitNodes.remove(oldPos);
-			circuitNodes.insert(newPos, node.value());
+			removeNode(oldPos);
+			setNode(newPos, node.value());
 		} else {
 			logError("Node at position {} not found", "EvalCircuit::moveNode", oldPos.toString());
 		}
@@ -49,6 +54,11 @@ public:
 		return parentEvalId;
 	}
 	std::optional<Position> getPosition(CircuitNode node) const noexcept {
+		if (node.isIC()) {
+			auto iter = icPositions.find(node.getId());
+			if (iter == icPositions.end()) return std::nullopt;
+			return iter->second;
+		}
 		std::optional<Position> result = std::nullopt;
 		circuitNodes.forEach([&](Position pos, CircuitNode n) {
 			if (n == node) {
@@ -58,10 +68,19 @@ public:
 		return result;
 	}
 private:
+	void forgetICPosition(Position pos) {
+		const CircuitNode* node = circuitNodes.get(pos);
+		if (node && node->isIC()) {
+			icPositions.erase(node->getId());
+		}
+	}
+
 	eval_circuit_id_t id;
 	eval_circuit_id_t parentEvalId;
 	circuit_id_t circuitId;
 	Sparse2dArray<CircuitNode> circuitNodes;
+	// tracing out of an IC looks up where it sits in its parent for every port
+	std::unordered_map<eval_circuit_id_t, Position> icPositions;
 };
 
 #endif /* evalCircuit_h */
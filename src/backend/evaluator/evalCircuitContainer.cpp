@@ -6,6 +6,7 @@ eval_circuit_id_t EvalCircuitContainer::addCircuit(eval_circuit_id_t parentEvalI
 		circuits.resize(newCircuitId + 1, nullptr);
 	}
 	circuits[newCircuitId] = new EvalCircuit(newCircuitId, parentEvalId, circuitId);
+	circuitInstances[circuitId].insert(newCircuitId);
 	return newCircuitId;
 }
 
@@ -15,6 +16,11 @@ void EvalCircuitContainer::removeCircuit(eval_circuit_id_t evalCircuitId) {
 		return; // Invalid circuit index
 	}
 	if (circuits.at(evalCircuitId) != nullptr) {
+		auto iter = circuitInstances.find(circuits.at(evalCircuitId)->getCircuitId());
+		if (iter != circuitInstances.end()) {
+			iter->second.erase(evalCircuitId);
+			if (iter->second.empty()) circuitInstances.erase(iter);
+		}
 		delete circuits.at(evalCircuitId);
 		circuits.at(evalCircuitId) = nullptr;
 		evalCircuitIdProvider.releaseId(evalCircuitId);
@@ -53,6 +59,14 @@ std::optional<eval_circuit_id_t> EvalCircuitContainer::getCircuitId(eval_circuit
 	return circuits[evalCircuitId]->getCircuitId();
 }
 
+std::vector<eval_circuit_id_t> EvalCircuitContainer::getEvalCircuitIds(circuit_id_t circuitId) const {
+	auto iter = circuitInstances.find(circuitId);
+	if (iter == circuitInstances.end()) {
+		return {};
+	}
+	return std::vector<eval_circuit_id_t>(iter->second.begin(), iter->second.end());
+}
+
 std::optional<eval_circuit_id_t> EvalCircuitContainer::traverse(eval_circuit_id_t startingPoint, const Address& address) const {
 	eval_circuit_id_t currentCircuitId = startingPoint;
 	for (int i = 1; i < address.size(); i++) {
@@ -28,7 +28,8 @@ struct std::hash<EvalPosition> {
 	inline std::size_t operator()(const EvalPosition& ep) const noexcept {
 		std::size_t h1 = std::hash<Position>()(ep.position);
 		std::size_t h2 = std::hash<eval_circuit_id_t>()(ep.evalCircuitId);
-		return h1 ^ (h2 << 1);
+		// every instance of an IC has its blocks at the same positions, so spread the eval circuit id over all bits
+		return h1 ^ (h2 * 0x9e3779b97f4a7c15ull);
 	}
 };
 
@@ -56,9 +57,12 @@ public:
 	eval_circuit_id_t traverseToTopLevelIC(eval_circuit_id_t startingPoint, const Address& address) const;
 
 	std::optional<eval_circuit_id_t> getCircuitId(eval_circuit_id_t evalCircuitId) const noexcept;
+	// the eval circuits that simulate circuitId, lowest first
+	std::vector<eval_circuit_id_t> getEvalCircuitIds(circuit_id_t circuitId) const;
 
 private:
 	std::vector<EvalCircuit*> circuits;
+	std::unordered_map<circuit_id_t, std::set<eval_circuit_id_t>> circuitInstances;
 	IdProvider<eval_circuit_id_t> evalCircuitIdProvider;
 };
 
@@ -2,10 +2,14 @@
 #define evalConfig_h
 
 #include "backend/settings/settings.h"
+#include "tickBarrier.h"
+
+class SimulationExecutor;
 
 class EvalConfig {
 public:
-	EvalConfig() {
+	// without an executor the simulator runs on a thread of its own
+	EvalConfig(std::shared_ptr<SimulationExecutor> simulationExecutor = nullptr) : simulationExecutor(std::move(simulationExecutor)) {
 		Settings::registerListener<SettingType::UINT>("Simulation/Max Thread Count", [this](const int& newMaxThreadCount) { this->setMaxThreadCount(newMaxThreadCount); });
 	}
 
@@ -45,6 +49,87 @@ public:
 		notifySubscribers();
 	}
 
+	inline bool isEventDriven() const {
+		return eventDriven.load();
+	}
+
+	inline void setEventDriven(bool value) {
+		eventDriven.store(value);
+		notifySubscribers();
+	}
+
+	inline bool isBitPacked() const {
+		return bitPacked.load();
+	}
+
+	inline void setBitPacked(bool value) {
+		bitPacked.store(value);
+		notifySubscribers();
+	}
+
+	// logic outside of feedback loops settles within one tick, overrides the event driven and bit packed modes
+	inline bool isSettleMode() const {
+		return settleMode.load();
+	}
+
+	inline void setSettleMode(bool value) {
+		settleMode.store(value);
+		notifySubscribers();
+	}
+
+	// gates are ticked by native code that wasmtime compiles in the background, overrides the event driven and bit packed
+	// modes. The interpreted ticks go on until the code is ready and after every edit until it is compiled again.
+	inline bool isNativeCompiled() const {
+		return nativeCompiled.load();
+	}
+
+	inline void setNativeCompiled(bool value) {
+		nativeCompiled.store(value);
+		notifySubscribers();
+	}
+
+	// Gates held by constants become constants, gates that read the same outputs are merged and chains of buffers become
+	// one buffer. Folded and merged gates show their new states right away instead of on the next tick and the gates
+	// inside a chain show the state of its end, so this is off by default.
+	inline bool isGateOptimization() const {
+		return gateOptimization.load();
+	}
+
+	inline void setGateOptimization(bool value) {
+		gateOptimization.store(value);
+		notifySubscribers();
+	}
+
+	// Inverters are absorbed into the gates that read them, which read what the inverters read a tick earlier. This
+	// trades the timing of the circuit for fewer gates, so it is off by default and apart from the gate optimization.
+	inline bool isFunctionalOptimization() const {
+		return functionalOptimization.load();
+	}
+
+	inline void setFunctionalOptimization(bool value) {
+		functionalOptimization.store(value);
+		notifySubscribers();
+	}
+
+	inline WaitPolicy getWaitPolicy() const {
+		return waitPolicy.load();
+	}
+
+	inline void setWaitPolicy(WaitPolicy value) {
+		waitPolicy.store(value);
+		notifySubscribers();
+	}
+
+	// picks the thread count from measured tick times, the max thread count stays the upper limit
+	inline bool isAutoThreadCount() const {
+		return autoThreadCount.load();
+	}
+
+	inline void setAutoThreadCount(bool value) {
+		autoThreadCount.store(value);
+		notifySubscribers();
+	}
+
 	inline int getMaxThreadCount() const {
 		return maxThreadCount.load();
 	}
@@ -82,6 +167,10 @@ public:
 		return false;
 	}
 
+	inline const std::shared_ptr<SimulationExecutor>& getSimulationExecutor() const {
+		return simulationExecutor;
+	}
+
 	inline void subscribe(std::function<void()> callback) {
 		std::lock_guard<std::mutex> lock(subscribersMutex);
 		subscribers.push_back(callback);
@@ -93,10 +182,19 @@ public:
 	}
 
 private:
+	const std::shared_ptr<SimulationExecutor> simulationExecutor;
 	std::atomic<double> targetTickrate = 0.0;
 	std::atomic<bool> tickrateLimiter = true;
 	std::atomic<bool> running = false;
 	std::atomic<bool> realistic = false;
+	std::atomic<bool> eventDriven = false;
+	std::atomic<bool> bitPacked = false;
+	std::atomic<bool> settleMode = false;
+	std::atomic<bool> nativeCompiled = false;
+	std::atomic<bool> gateOptimization = false;
+	std::atomic<bool> functionalOptimization = false;
+	std::atomic<WaitPolicy> waitPolicy = WaitPolicy::SPIN_THEN_PARK;
+	std::atomic<bool> autoThreadCount = true;
 	std::atomic<int> sprintCounter = 0;
 	std::atomic<int> maxThreadCount = std::thread::hardware_concurrency() / 2;
 
@@ -15,6 +15,15 @@ public:
 	inline void endEdit(SimPauseGuard& pauseGuard) {
 		gateSubstituter.endEdit(pauseGuard);
 	}
+	inline void updateGateOptimization(SimPauseGuard& pauseGuard) {
+		gateSubstituter.updateGateOptimization(pauseGuard);
+	}
+	inline void renumberSimulatorIds(SimPauseGuard& pauseGuard) {
+		gateSubstituter.renumberSimulatorIds(pauseGuard);
+	}
+	inline void compileLanes(SimPauseGuard& pauseGuard, LaneSimulator& laneSimulator) const {
+		gateSubstituter.compileLanes(pauseGuard, laneSimulator);
+	}
 	inline void addGate(SimPauseGuard& pauseGuard, const GateType gateType, const middle_id_t gateId) {
 		gateSubstituter.addGate(pauseGuard, gateType, gateId);
 	}
@@ -45,6 +54,9 @@ public:
 	inline void setState(EvalConnectionPoint point, logic_state_t state) {
 		gateSubstituter.setState(point, state);
 	}
+	inline void setStates(const std::vector<EvalConnectionPoint>& points, const std::vector<logic_state_t>& states) {
+		gateSubstituter.setStates(points, states);
+	}
 	inline void makeConnection(SimPauseGuard& pauseGuard, EvalConnection connection) {
 		gateSubstituter.makeConnection(pauseGuard, connection);
 	}
@@ -54,6 +66,33 @@ public:
 	inline double getAverageTickrate() const {
 		return gateSubstituter.getAverageTickrate();
 	}
+	inline std::vector<ThreadPool::WorkerStats> getWorkerStats() const {
+		return gateSubstituter.getWorkerStats();
+	}
+	inline bool isNativeTickActive() const {
+		return gateSubstituter.isNativeTickActive();
+	}
+	inline bool compileNativeTicks(SimPauseGuard& pauseGuard) {
+		return gateSubstituter.compileNativeTicks(pauseGuard);
+	}
+	inline void resetWorkerStats() {
+		gateSubstituter.resetWorkerStats();
+	}
+	inline uint64_t getTickCount() const {
+		return gateSubstituter.getTickCount();
+	}
+	inline void setTickCount(SimPauseGuard& pauseGuard, uint64_t tickCount) {
+		gateSubstituter.setTickCount(pauseGuard, tickCount);
+	}
+	inline SimulationState getSimulationState(SimPauseGuard& pauseGuard, const std::vector<simulator_id_t>& simulatorIds) const {
+		return gateSubstituter.getSimulationState(pauseGuard, simulatorIds);
+	}
+	inline bool setSimulationState(SimPauseGuard& pauseGuard, const std::vector<simulator_id_t>& simulatorIds, const SimulationState& state) {
+		return gateSubstituter.setSimulationState(pauseGuard, simulatorIds, state);
+	}
+	inline uint64_t getNetlistFingerprint(SimPauseGuard& pauseGuard, const std::vector<simulator_id_t>& simulatorIds) const {
+		return gateSubstituter.getNetlistFingerprint(pauseGuard, simulatorIds);
+	}
 private:
 	EvalConfig& evalConfig;
 	IdProvider<middle_id_t>& middleIdProvider;
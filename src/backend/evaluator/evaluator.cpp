@@ -1,4 +1,5 @@
 #include "evaluator.h"
+#include "util/algorithm.h"
 
 #ifdef TRACY_PROFILER
 #include <tracy/Tracy.hpp>
@@ -10,7 +11,8 @@ Evaluator::Evaluator(
 	BlockDataManager& blockDataManager,
 	CircuitBlockDataManager& circuitBlockDataManager,
 	circuit_id_t circuitId,
-	DataUpdateEventManager* dataUpdateEventManager
+	DataUpdateEventManager* dataUpdateEventManager,
+	std::shared_ptr<SimulationExecutor> simulationExecutor
 ) : evaluatorId(evaluatorId),
 circuitManager(circuitManager),
 blockDataManager(blockDataManager),
@@ -18,7 +20,7 @@ circuitBlockDataManager(circuitBlockDataManager),
 evalCircuitContainer(),
 dataUpdateEventManager(dataUpdateEventManager),
 receiver(dataUpdateEventManager),
-evalConfig(),
+evalConfig(std::move(simulationExecutor)),
 middleIdProvider(),
 evalSimulator(evalConfig, middleIdProvider, dirtySimulatorIds) {
 	const auto circuit = circuitManager.getCircuit(circuitId);
@@ -32,6 +34,11 @@ evalSimulator(evalConfig, middleIdProvider, dirtySimulatorIds) {
 	const Difference difference = blockContainer->getCreationDifference();
 	receiver.linkFunction("circuitBlockDataConnectionPositionRemove", std::bind(&Evaluator::removeCircuitIO, this, std::placeholders::_1));
 	receiver.linkFunction("circuitBlockDataConnectionPositionSet", std::bind(&Evaluator::setCircuitIO, this, std::placeholders::_1));
+	receiver.linkFunction("circuitEditTransactionBegin", std::bind(&Evaluator::beginCircuitEditTransaction, this, std::placeholders::_1));
+	receiver.linkFunction("circuitEditTransactionCommit", std::bind(&Evaluator::commitCircuitEditTransaction, this, std::placeholders::_1));
+	receiver.linkFunction("blockDataSetConnection", std::bind(&Evaluator::blockDataConnectionsChanged, this, std::placeholders::_1));
+	receiver.linkFunction("blockDataRemoveConnection", std::bind(&Evaluator::blockDataConnectionsChanged, this, std::placeholders::_1));
+	receiver.linkFunction("circuitDestroyed", std::bind(&Evaluator::removeCircuitTemplates, this, std::placeholders::_1));
 
 	makeEdit(std::make_shared<Difference>(difference), circuitId);
 }
@@ -40,26 +47,182 @@ void Evaluator::makeEdit(DifferenceSharedPtr difference, circuit_id_t circuitId)
 #ifdef TRACY_PROFILER
 	ZoneScoped;
 #endif
-	changedICs = false;
 	// logInfo("_________________________________________________________________________________________");
 	// logInfo("Applying edit to Evaluator with ID {} for Circuit ID {}", "Evaluator::makeEdit", evaluatorId, circuitId);
+	beginEditTransaction();
 	{
-		SimPauseGuard pauseGuard = evalSimulator.beginEdit();
 		std::unique_lock lk(simMutex);
 		DiffCache diffCache(circuitManager);
-		for (eval_circuit_id_t evalCircuitId = 0; evalCircuitId < evalCircuitContainer.size(); evalCircuitId++) {
-			if (evalCircuitContainer.getCircuitId(evalCircuitId) == circuitId) {
-				makeEditInPlace(pauseGuard, evalCircuitId, difference, diffCache);
-			}
+		checkpointLayout.reset();
+		for (eval_circuit_id_t evalCircuitId : evalCircuitContainer.getEvalCircuitIds(circuitId)) {
+			makeEditInPlace(*editTransactionPauseGuard, evalCircuitId, difference, diffCache);
 		}
-		evalSimulator.endEdit(pauseGuard);
 	}
+	commitEditTransaction();
+}
+
+void Evaluator::beginEditTransaction() {
+	if (editTransactionDepth++ != 0) return;
+	changedICs = false;
+	editTransactionPauseGuard.reset(new SimPauseGuard(evalSimulator.beginEdit()));
+}
+
+void Evaluator::commitEditTransaction() {
+	if (editTransactionDepth == 0) {
+		logError("No edit transaction to commit", "Evaluator::commitEditTransaction");
+		return;
+	}
+	if (--editTransactionDepth != 0) return;
+	{
+		std::unique_lock lk(simMutex);
+		evalSimulator.endEdit(*editTransactionPauseGuard);
+		// endEdit may renumber the simulator ids
+		checkpointLayout.reset();
+	}
+	editTransactionPauseGuard.reset();
 	if (changedICs) {
 		dataUpdateEventManager->sendEvent("addressTreeMakeBranch");
 	}
 	processDirtyNodes();
 }
 
+void Evaluator::beginCircuitEditTransaction(const DataUpdateEventManager::EventData* data) {
+	const DataUpdateEventManager::EventDataWithValue<circuit_id_t>* eventData = data ? data->cast<circuit_id_t>() : nullptr;
+	if (!eventData) {
+		logError("Invalid event data type", "Evaluator::beginCircuitEditTransaction");
+		return;
+	}
+	const circuit_id_t circuitId = eventData->get();
+	if (!evalCircuitContainer.getEvalCircuitIds(circuitId).empty()) {
+		editTransactionCircuits.push_back(circuitId);
+		beginEditTransaction();
+	}
+}
+
+void Evaluator::commitCircuitEditTransaction(const DataUpdateEventManager::EventData* data) {
+	const DataUpdateEventManager::EventDataWithValue<circuit_id_t>* eventData = data ? data->cast<circuit_id_t>() : nullptr;
+	if (!eventData) {
+		logError("Invalid event data type", "Evaluator::commitCircuitEditTransaction");
+		return;
+	}
+	// the circuit may have left this evaluator during the transaction, so go by the circuits it joined
+	auto iter = std::find(editTransactionCircuits.begin(), editTransactionCircuits.end(), eventData->get());
+	if (iter == editTransactionCircuits.end()) return;
+	editTransactionCircuits.erase(iter);
+	commitEditTransaction();
+}
+
+bool Evaluator::compileNativeTicks() {
+	SimPauseGuard pauseGuard = evalSimulator.beginEdit();
+	std::unique_lock lk(simMutex);
+	return evalSimulator.compileNativeTicks(pauseGuard);
+}
+
+void Evaluator::setGateOptimization(bool gateOptimization) {
+	{
+		SimPauseGuard pauseGuard = evalSimulator.beginEdit();
+		std::unique_lock lk(simMutex);
+		evalConfig.setGateOptimization(gateOptimization);
+		evalSimulator.updateGateOptimization(pauseGuard);
+		evalSimulator.endEdit(pauseGuard);
+		checkpointLayout.reset();
+	}
+	processDirtyNodes();
+}
+
+void Evaluator::setFunctionalOptimization(bool functionalOptimization) {
+	{
+		SimPauseGuard pauseGuard = evalSimulator.beginEdit();
+		std::unique_lock lk(simMutex);
+		evalConfig.setFunctionalOptimization(functionalOptimization);
+		evalSimulator.updateGateOptimization(pauseGuard);
+		evalSimulator.endEdit(pauseGuard);
+		checkpointLayout.reset();
+	}
+	processDirtyNodes();
+}
+
+void Evaluator::renumberSimulatorIds() {
+	{
+		SimPauseGuard pauseGuard = evalSimulator.beginEdit();
+		std::unique_lock lk(simMutex);
+		evalSimulator.renumberSimulatorIds(pauseGuard);
+		evalSimulator.endEdit(pauseGuard);
+		checkpointLayout.reset();
+	}
+	processDirtyNodes();
+}
+
+std::vector<std::vector<logic_state_t>> Evaluator::simulateBatch(
+	const std::vector<connection_end_id_t>& inputPorts,
+	const std::vector<connection_end_id_t>& outputPorts,
+	const std::vector<std::vector<logic_state_t>>& inputVectors,
+	unsigned int nTicks
+) {
+	std::vector<std::vector<logic_state_t>> outputVectors;
+	const circuit_id_t circuitId = getCircuitId();
+	const CircuitBlockData* circuitBlockData = circuitBlockDataManager.getCircuitBlockData(circuitId);
+	if (!circuitBlockData) {
+		logError("CircuitBlockData for circuit {} not found", "Evaluator::simulateBatch", circuitId);
+		return outputVectors;
+	}
+
+	LaneSimulator laneSimulator;
+	std::vector<simulator_id_t> inputIds;
+	std::vector<simulator_id_t> outputIds;
+	{
+		SimPauseGuard pauseGuard = evalSimulator.beginEdit();
+		std::shared_lock lk(simMutex);
+		auto getPortSimulatorIds = [&](const std::vector<connection_end_id_t>& ports) {
+			std::vector<std::optional<EvalConnectionPoint>> connectionPoints;
+			connectionPoints.reserve(ports.size());
+			for (connection_end_id_t port : ports) {
+				const Position* position = circuitBlockData->getConnectionIdToPosition(port);
+				if (!position) {
+					logError("Port {} not found in circuit {}", "Evaluator::simulateBatch", port, circuitId);
+					connectionPoints.push_back(std::nullopt);
+					continue;
+				}
+				connectionPoints.push_back(getConnectionPoint(0, *position, Direction::OUT));
+			}
+			return evalSimulator.getBlockSimulatorIds(connectionPoints);
+		};
+		inputIds = getPortSimulatorIds(inputPorts);
+		outputIds = getPortSimulatorIds(outputPorts);
+		evalSimulator.compileLanes(pauseGuard, laneSimulator);
+	}
+
+	outputVectors.reserve(inputVectors.size());
+	for (size_t firstVector = 0; firstVector < inputVectors.size(); firstVector += LaneSimulator::laneCount) {
+		const unsigned int usedLanes = std::min<size_t>(LaneSimulator::laneCount, inputVectors.size() - firstVector);
+		if (firstVector != 0) laneSimulator.reset();
+		for (unsigned int lane = 0; lane < usedLanes; ++lane) {
+			const std::vector<logic_state_t>& inputVector = inputVectors[firstVector + lane];
+			if (inputVector.size() != inputIds.size()) {
+				logError("Input vector {} has {} states but there are {} input ports", "Evaluator::simulateBatch", firstVector + lane, inputVector.size(), inputIds.size());
+			}
+			for (size_t i = 0; i < std::min(inputVector.size(), inputIds.size()); ++i) {
+				if (inputIds[i] == 0 || inputIds[i] >= laneSimulator.getStateCount()) continue;
+				laneSimulator.setState(inputIds[i], lane, inputVector[i]);
+			}
+		}
+		laneSimulator.doubleTickJunctions();
+		laneSimulator.tick(nTicks);
+		for (unsigned int lane = 0; lane < usedLanes; ++lane) {
+			std::vector<logic_state_t>& outputVector = outputVectors.emplace_back();
+			outputVector.reserve(outputIds.size());
+			for (simulator_id_t outputId : outputIds) {
+				if (outputId == 0 || outputId >= laneSimulator.getStateCount()) {
+					outputVector.push_back(logic_state_t::UNDEFINED);
+					continue;
+				}
+				outputVector.push_back(laneSimulator.getState(outputId, lane));
+			}
+		}
+	}
+	return outputVectors;
+}
+
 void Evaluator::makeEditInPlace(SimPauseGuard& pauseGuard, eval_circuit_id_t evalCircuitId, DifferenceSharedPtr difference, DiffCache& diffCache) {
 #ifdef TRACY_PROFILER
 	ZoneScoped;
@@ -199,6 +362,7 @@ void Evaluator::edit_placeBlock(SimPauseGuard& pauseGuard, eval_circuit_id_t eva
 	}
 	CircuitNode node = CircuitNode::fromMiddle(gateId);
 	evalCircuit->setNode(position, node);
+	recordAddGate(evalCircuitId, gateId, position, gateType);
 	dirtyBlockAt(position, evalCircuitId);
 	checkToCreateExternalConnections(pauseGuard, evalCircuitId, position);
 }
@@ -212,9 +376,143 @@ void Evaluator::edit_placeIC(SimPauseGuard& pauseGuard, eval_circuit_id_t evalCi
 	}
 	eval_circuit_id_t newEvalCircuitId = evalCircuitContainer.addCircuit(evalCircuitId, circuitId);
 	evalCircuit->setNode(position, CircuitNode::fromIC(newEvalCircuitId));
+	recordAddCircuit(evalCircuitId, newEvalCircuitId, circuitId, position);
 	dirtyBlockAt(position, evalCircuitId);
+	const EvalCircuitTemplate* evalCircuitTemplate = getCircuitTemplate(circuitId);
+	if (evalCircuitTemplate) {
+		placeICFromTemplate(pauseGuard, newEvalCircuitId, *evalCircuitTemplate);
+		return;
+	}
+	SharedCircuit circuit = circuitManager.getCircuit(circuitId);
+	templateRecordings.emplace_back(circuitId, newEvalCircuitId);
+	templateRecordings.back().evalCircuitTemplate.circuitEditCounts.push_back({ circuitId, circuit ? circuit->getEditCount() : 0 });
 	DifferenceSharedPtr diff = diffCache.getDifference(circuitId);
 	makeEditInPlace(pauseGuard, newEvalCircuitId, diff, diffCache);
+	EvalCircuitTemplateRecording recording = std::move(templateRecordings.back());
+	templateRecordings.pop_back();
+	if (recording.valid) {
+		recording.evalCircuitTemplate.evalCircuitCount = recording.localEvalCircuitIds.size();
+		recording.evalCircuitTemplate.gateCount = recording.localMiddleIds.size();
+		circuitTemplates[circuitId] = std::move(recording.evalCircuitTemplate);
+	}
+}
+
+void Evaluator::blockDataConnectionsChanged(const DataUpdateEventManager::EventData* data) {
+	std::unique_lock lk(simMutex);
+	circuitTemplates.clear();
+	checkpointLayout.reset();
+}
+
+void Evaluator::removeCircuitTemplates(const DataUpdateEventManager::EventData* data) {
+	const DataUpdateEventManager::EventDataWithValue<circuit_id_t>* eventData = data ? data->cast<circuit_id_t>() : nullptr;
+	if (!eventData) {
+		logError("Invalid event data type", "Evaluator::removeCircuitTemplates");
+		return;
+	}
+	const circuit_id_t circuitId = eventData->get();
+	// the template of the circuit and the templates of the circuits it was nested in
+	std::erase_if(circuitTemplates, [circuitId](const auto& circuitTemplate) {
+		const auto& circuitEditCounts = circuitTemplate.second.circuitEditCounts;
+		return std::any_of(circuitEditCounts.begin(), circuitEditCounts.end(),
+			[circuitId](const auto& circuitEditCount) { return circuitEditCount.first == circuitId; });
+	});
+}
+
+const EvalCircuitTemplate* Evaluator::getCircuitTemplate(circuit_id_t circuitId) const {
+	auto iter = circuitTemplates.find(circuitId);
+	if (iter == circuitTemplates.end()) {
+		return nullptr;
+	}
+	for (const auto& [templateCircuitId, editCount] : iter->second.circuitEditCounts) {
+		SharedCircuit circuit = circuitManager.getCircuit(templateCircuitId);
+		if (!circuit || circuit->getEditCount() != editCount) {
+			return nullptr;
+		}
+	}
+	return &(iter->second);
+}
+
+void Evaluator::placeICFromTemplate(SimPauseGuard& pauseGuard, eval_circuit_id_t evalCircuitId, const EvalCircuitTemplate& evalCircuitTemplate) {
+	std::vector<eval_circuit_id_t> evalCircuitIds;
+	evalCircuitIds.reserve(evalCircuitTemplate.evalCircuitCount);
+	evalCircuitIds.push_back(evalCircuitId);
+	std::vector<middle_id_t> middleIds;
+	middleIds.reserve(evalCircuitTemplate.gateCount);
+	auto toConnectionPoint = [&](EvalConnectionPoint point) {
+		return EvalConnectionPoint(middleIds[point.gateId], point.portId);
+	};
+	auto toCircuitNodes = [&](const std::vector<CircuitNode>& nodes) {
+		std::set<CircuitNode> circuitNodes;
+		for (CircuitNode node : nodes) {
+			circuitNodes.insert(node.isIC() ? CircuitNode::fromIC(evalCircuitIds[node.getId()]) : CircuitNode::fromMiddle(middleIds[node.getId()]));
+		}
+		return circuitNodes;
+	};
+	for (const EvalCircuitTemplate::Step& step : evalCircuitTemplate.steps) {
+		if (const auto* addGate = std::get_if<EvalCircuitTemplate::AddGate>(&step)) {
+			middle_id_t gateId = middleIdProvider.getNewId();
+			evalSimulator.addGate(pauseGuard, addGate->gateType, gateId);
+			eval_circuit_id_t gateEvalCircuitId = evalCircuitIds[addGate->evalCircuitId];
+			evalCircuitContainer.getCircuit(gateEvalCircuitId)->setNode(addGate->position, CircuitNode::fromMiddle(gateId));
+			middleIds.push_back(gateId);
+			recordAddGate(gateEvalCircuitId, gateId, addGate->position, addGate->gateType);
+		} else if (const auto* connection = std::get_if<EvalCircuitTemplate::MakeConnection>(&step)) {
+			makeConnection(pauseGuard, EvalConnection(toConnectionPoint(connection->connection.source), toConnectionPoint(connection->connection.destination)));
+		} else if (const auto* interCircuitConnection = std::get_if<EvalCircuitTemplate::AddInterCircuitConnection>(&step)) {
+			addInterCircuitConnection({
+				EvalConnection(toConnectionPoint(interCircuitConnection->connection.source), toConnectionPoint(interCircuitConnection->connection.destination)),
+				interCircuitConnection->circuitPortDependencies,
+				toCircuitNodes(interCircuitConnection->circuitNodeDependencies)
+			});
+		} else if (const auto* dirty = std::get_if<EvalCircuitTemplate::DirtyNode>(&step)) {
+			dirtyNode(EvalPosition(dirty->evalPosition.position, evalCircuitIds[dirty->evalPosition.evalCircuitId]));
+		} else if (const auto* addCircuit = std::get_if<EvalCircuitTemplate::AddCircuit>(&step)) {
+			eval_circuit_id_t parentEvalCircuitId = evalCircuitIds[addCircuit->parentEvalCircuitId];
+			eval_circuit_id_t newEvalCircuitId = evalCircuitContainer.addCircuit(parentEvalCircuitId, addCircuit->circuitId);
+			evalCircuitContainer.getCircuit(parentEvalCircuitId)->setNode(addCircuit->position, CircuitNode::fromIC(newEvalCircuitId));
+			evalCircuitIds.push_back(newEvalCircuitId);
+			recordAddCircuit(parentEvalCircuitId, newEvalCircuitId, addCircuit->circuitId, addCircuit->position);
+		} else if (const auto* trace = std::get_if<EvalCircuitTemplate::TraceOutwards>(&step)) {
+			std::set<CircuitPortDependency> circuitPortDependencies = trace->circuitPortDependencies;
+			std::set<CircuitNode> circuitNodeDependencies = toCircuitNodes(trace->circuitNodeDependencies);
+			traceOutwardsIC(pauseGuard, evalCircuitId, trace->position, trace->direction, toConnectionPoint(trace->targetConnectionPoint), circuitPortDependencies, circuitNodeDependencies);
+		}
+	}
+}
+
+void Evaluator::recordAddCircuit(eval_circuit_id_t parentEvalCircuitId, eval_circuit_id_t evalCircuitId, circuit_id_t circuitId, Position position) {
+	if (templateRecordings.empty()) {
+		return;
+	}
+	SharedCircuit circuit = circuitManager.getCircuit(circuitId);
+	const unsigned long long editCount = circuit ? circuit->getEditCount() : 0;
+	for (EvalCircuitTemplateRecording& recording : templateRecordings) {
+		auto parentIter = recording.localEvalCircuitIds.find(parentEvalCircuitId);
+		if (parentIter == recording.localEvalCircuitIds.end()) {
+			recording.valid = false;
+			continue;
+		}
+		EvalCircuitTemplate& evalCircuitTemplate = recording.evalCircuitTemplate;
+		evalCircuitTemplate.steps.push_back(EvalCircuitTemplate::AddCircuit{ parentIter->second, circuitId, position });
+		recording.localEvalCircuitIds.emplace(evalCircuitId, recording.localEvalCircuitIds.size());
+		auto countIter = std::find_if(evalCircuitTemplate.circuitEditCounts.begin(), evalCircuitTemplate.circuitEditCounts.end(),
+			[circuitId](const auto& circuitEditCount) { return circuitEditCount.first == circuitId; });
+		if (countIter == evalCircuitTemplate.circuitEditCounts.end()) {
+			evalCircuitTemplate.circuitEditCounts.push_back({ circuitId, editCount });
+		}
+	}
+}
+
+void Evaluator::recordAddGate(eval_circuit_id_t evalCircuitId, middle_id_t gateId, Position position, GateType gateType) {
+	for (EvalCircuitTemplateRecording& recording : templateRecordings) {
+		auto iter = recording.localEvalCircuitIds.find(evalCircuitId);
+		if (iter == recording.localEvalCircuitIds.end()) {
+			recording.valid = false;
+			continue;
+		}
+		recording.evalCircuitTemplate.steps.push_back(EvalCircuitTemplate::AddGate{ iter->second, position, gateType });
+		recording.localMiddleIds.emplace(gateId, recording.localMiddleIds.size());
+	}
 }
 
 void Evaluator::edit_removeConnection(SimPauseGuard& pauseGuard, eval_circuit_id_t evalCircuitId, DiffCache& diffCache, const BlockContainer* blockContainer, Position outputBlockPosition, Position outputPosition, Position inputBlockPosition, Position inputPosition) {
@@ -253,11 +551,48 @@ void Evaluator::edit_createConnection(SimPauseGuard& pauseGuard, eval_circuit_id
 	}
 	EvalConnection connection(outputPoint.value(), inputPoint.value());
 	if (!circuitPortDependencies.empty() || !circuitNodeDependencies.empty()) {
-		interCircuitConnections.push_back({ connection, circuitPortDependencies, circuitNodeDependencies });
+		addInterCircuitConnection({ connection, circuitPortDependencies, circuitNodeDependencies });
+	}
+	makeConnection(pauseGuard, connection);
+}
+
+void Evaluator::makeConnection(SimPauseGuard& pauseGuard, const EvalConnection& connection) {
+	for (EvalCircuitTemplateRecording& recording : templateRecordings) {
+		if (recording.outsideDepth != 0) {
+			continue;
+		}
+		std::optional<EvalConnectionPoint> source = recording.toLocal(connection.source);
+		std::optional<EvalConnectionPoint> destination = recording.toLocal(connection.destination);
+		if (!source.has_value() || !destination.has_value()) {
+			recording.valid = false;
+			continue;
+		}
+		recording.evalCircuitTemplate.steps.push_back(EvalCircuitTemplate::MakeConnection{ EvalConnection(source.value(), destination.value()) });
 	}
 	evalSimulator.makeConnection(pauseGuard, connection);
 }
 
+void Evaluator::addInterCircuitConnection(InterCircuitConnection&& interCircuitConnection) {
+	for (EvalCircuitTemplateRecording& recording : templateRecordings) {
+		if (recording.outsideDepth != 0) {
+			continue;
+		}
+		std::optional<EvalConnectionPoint> source = recording.toLocal(interCircuitConnection.connection.source);
+		std::optional<EvalConnectionPoint> destination = recording.toLocal(interCircuitConnection.connection.destination);
+		std::optional<std::vector<CircuitNode>> circuitNodeDependencies = recording.toLocal(interCircuitConnection.circuitNodeDependencies);
+		if (!source.has_value() || !destination.has_value() || !circuitNodeDependencies.has_value()) {
+			recording.valid = false;
+			continue;
+		}
+		recording.evalCircuitTemplate.steps.push_back(EvalCircuitTemplate::AddInterCircuitConnection{
+			EvalConnection(source.value(), destination.value()),
+			interCircuitConnection.circuitPortDependencies,
+			std::move(circuitNodeDependencies.value())
+		});
+	}
+	interCircuitConnections.push_back(std::move(interCircuitConnection));
+}
+
 void Evaluator::removeDependentInterCircuitConnections(SimPauseGuard& pauseGuard, CircuitPortDependency circuitPortDependency) {
 	// delete any connections that have the pair {circuitId, connectionEndId} in their traceSet
 	for (auto it = interCircuitConnections.begin(); it != interCircuitConnections.end();) {
@@ -293,10 +628,10 @@ void Evaluator::removeCircuitIO(const DataUpdateEventManager::EventData* data) {
 	Position position = std::get<2>(dataValue);
 
 	circuit_id_t circuitId = circuitBlockDataManager.getCircuitId(blockType);
-	SimPauseGuard pauseGuard = evalSimulator.beginEdit();
-	removeDependentInterCircuitConnections(pauseGuard, { circuitId, connectionEndId });
-	evalSimulator.endEdit(pauseGuard);
-	processDirtyNodes();
+	circuitTemplates.clear();
+	beginEditTransaction();
+	removeDependentInterCircuitConnections(*editTransactionPauseGuard, { circuitId, connectionEndId });
+	commitEditTransaction();
 }
 
 void Evaluator::setCircuitIO(const DataUpdateEventManager::EventData* data) {
@@ -314,33 +649,24 @@ void Evaluator::setCircuitIO(const DataUpdateEventManager::EventData* data) {
 		logError("Circuit ID for BlockType {} is 0, cannot set IO", "Evaluator::setCircuitIO", blockType);
 		return;
 	}
-	SimPauseGuard pauseGuard = evalSimulator.beginEdit();
+	circuitTemplates.clear();
+	beginEditTransaction();
+	SimPauseGuard& pauseGuard = *editTransactionPauseGuard;
 	removeDependentInterCircuitConnections(pauseGuard, { circuitId, connectionEndId });
 	// get the new position
 	CircuitBlockData* circuitBlockData = circuitBlockDataManager.getCircuitBlockData(circuitId);
+	const Position* position = circuitBlockData ? circuitBlockData->getConnectionIdToPosition(connectionEndId) : nullptr;
 	if (!circuitBlockData) {
 		logError("CircuitBlockData for Circuit ID {} not found", "Evaluator::setCircuitIO", circuitId);
-		return;
-	}
-	const Position* position = circuitBlockData->getConnectionIdToPosition(connectionEndId);
-	if (!position) {
+	} else if (!position) {
 		logError("Position for connection end ID {} not found in CircuitBlockData for Circuit ID {}", "Evaluator::setCircuitIO", connectionEndId, circuitId);
-		return;
-	}
-	// use checkToCreateExternalConnections
-	// iterate over eval_circuit_id_t
-	for (eval_circuit_id_t evalCircuitId = 0; evalCircuitId < evalCircuitContainer.size(); evalCircuitId++) {
-		EvalCircuit* evalCircuit = evalCircuitContainer.getCircuit(evalCircuitId);
-		if (!evalCircuit) {
-			continue;
-		}
-		if (evalCircuit->getCircuitId() != circuitId) {
-			continue;
+	} else {
+		// use checkToCreateExternalConnections
+		for (eval_circuit_id_t evalCircuitId : evalCircuitContainer.getEvalCircuitIds(circuitId)) {
+			checkToCreateExternalConnections(pauseGuard, evalCircuitId, *position);
 		}
-		checkToCreateExternalConnections(pauseGuard, evalCircuitId, *position);
 	}
-	evalSimulator.endEdit(pauseGuard);
-	processDirtyNodes();
+	commitEditTransaction();
 }
 
 std::optional<connection_port_id_t> Evaluator::getPortId(const circuit_id_t circuitId, const Position blockPosition, const Position portPosition, Direction direction) const {
@@ -671,50 +997,296 @@ logic_state_t Evaluator::getState(const Address& address) {
 	return evalSimulator.getState(connectionPointOpt.value());
 }
 
-void Evaluator::setState(const Address& address, logic_state_t state) {
-	std::unique_lock lk(simMutex);
+std::optional<EvalConnectionPoint> Evaluator::getSettableConnectionPoint(const Address& address) {
 	std::optional<eval_circuit_id_t> evalCircuitIdOpt = evalCircuitContainer.traverseToTopLevelIC(address);
 	if (!evalCircuitIdOpt.has_value()) {
-		logError("Failed to traverse to top-level IC for address {}", "Evaluator::setState", address.toString());
-		return;
+		logError("Failed to traverse to top-level IC for address {}", "Evaluator::getSettableConnectionPoint", address.toString());
+		return std::nullopt;
 	}
 
 	eval_circuit_id_t evalCircuitId = evalCircuitIdOpt.value();
 	EvalCircuit* evalCircuit = evalCircuitContainer.getCircuit(evalCircuitId);
 	if (!evalCircuit) {
-		logError("EvalCircuit with id {} not found", "Evaluator::setState", evalCircuitId);
-		return;
+		logError("EvalCircuit with id {} not found", "Evaluator::getSettableConnectionPoint", evalCircuitId);
+		return std::nullopt;
 	}
 
 	circuit_id_t circuitId = evalCircuit->getCircuitId();
 	SharedCircuit circuit = circuitManager.getCircuit(circuitId);
 	if (!circuit) {
-		logError("Circuit with ID {} not found", "Evaluator::setState", circuitId);
-		return;
+		logError("Circuit with ID {} not found", "Evaluator::getSettableConnectionPoint", circuitId);
+		return std::nullopt;
 	}
 	const BlockContainer* blockContainer = circuit->getBlockContainer();
 	if (!blockContainer) {
-		logError("BlockContainer not found", "Evaluator::setState");
-		return;
+		logError("BlockContainer not found", "Evaluator::getSettableConnectionPoint");
+		return std::nullopt;
 	}
 
 	std::optional<EvalConnectionPoint> connectionPointOpt = getConnectionPoint(evalCircuitId, blockContainer, address.getPosition(address.size() - 1), Direction::OUT);
 	if (connectionPointOpt.has_value()) {
-		evalSimulator.setState(connectionPointOpt.value(), state);
-		return;
+		return connectionPointOpt;
 	}
 	std::optional<EvalConnectionPoint> connectionPointOptIn = getConnectionPoint(evalCircuitId, blockContainer, address.getPosition(address.size() - 1), Direction::IN);
 	if (connectionPointOptIn.has_value()) {
-		evalSimulator.setState(connectionPointOptIn.value(), state);
-		return;
+		return connectionPointOptIn;
 	}
 	std::optional<middle_id_t> middleIdOpt = getMiddleId(evalCircuitId, address, blockContainer);
 	if (middleIdOpt.has_value()) {
-		EvalConnectionPoint connectionPoint(middleIdOpt.value(), 0);
-		evalSimulator.setState(connectionPoint, state);
+		return EvalConnectionPoint(middleIdOpt.value(), 0);
+	}
+	logError("Failed to get connection point for address {}", "Evaluator::getSettableConnectionPoint", address.toString());
+	return std::nullopt;
+}
+
+void Evaluator::setState(const Address& address, logic_state_t state) {
+	std::unique_lock lk(simMutex);
+	std::optional<EvalConnectionPoint> connectionPointOpt = getSettableConnectionPoint(address);
+	if (connectionPointOpt.has_value()) {
+		evalSimulator.setState(connectionPointOpt.value(), state);
+	}
+}
+
+void Evaluator::setStates(const std::vector<Address>& addresses, const std::vector<logic_state_t>& states) {
+	std::unique_lock lk(simMutex);
+	std::vector<EvalConnectionPoint> points;
+	std::vector<logic_state_t> pointStates;
+	points.reserve(addresses.size());
+	pointStates.reserve(addresses.size());
+	for (size_t i = 0; i < addresses.size(); ++i) {
+		std::optional<EvalConnectionPoint> connectionPointOpt = getSettableConnectionPoint(addresses[i]);
+		if (!connectionPointOpt.has_value()) continue;
+		points.push_back(connectionPointOpt.value());
+		pointStates.push_back(states[i]);
+	}
+	evalSimulator.setStates(points, pointStates);
+}
+
+namespace {
+	struct CheckpointHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t fingerprint;
+		uint64_t blockCount;
+		uint64_t tickCount;
+		int64_t sprintCount;
+		uint64_t netlistFingerprint;
+		uint64_t stateCount;
+		uint64_t delayStateCount;
+	};
+	constexpr uint32_t checkpointMagic = 0x54504b43; // "CKPT"
+	constexpr uint32_t checkpointVersion = 2;
+
+	// orders like the position, y within x
+	inline uint64_t getPositionKey(Position position) {
+		return ((uint64_t)((uint32_t)position.x ^ 0x80000000u) << 32) | ((uint32_t)position.y ^ 0x80000000u);
+	}
+	inline Position getKeyPosition(uint64_t key) {
+		return Position((coordinate_t)((uint32_t)(key >> 32) ^ 0x80000000u), (coordinate_t)((uint32_t)key ^ 0x80000000u));
+	}
+
+	size_t getCheckpointSize(uint64_t blockCount, uint64_t stateCount, uint64_t delayStateCount) {
+		return sizeof(CheckpointHeader) + (blockCount + 2 * stateCount + delayStateCount) * sizeof(logic_state_t);
+	}
+}
+
+void Evaluator::getCheckpointPoints(eval_circuit_id_t evalCircuitId, std::vector<EvalConnectionPoint>& points, uint64_t& fingerprint) const {
+	EvalCircuit* evalCircuit = evalCircuitContainer.getCircuit(evalCircuitId);
+	if (!evalCircuit) {
+		logError("EvalCircuit with id {} not found", "Evaluator::getCheckpointPoints", evalCircuitId);
+		return;
+	}
+	SharedCircuit circuit = circuitManager.getCircuit(evalCircuit->getCircuitId());
+	if (!circuit) {
+		logError("Circuit with ID {} not found", "Evaluator::getCheckpointPoints", evalCircuit->getCircuitId());
 		return;
 	}
-	logError("Failed to get connection point for address {}", "Evaluator::setState", address.toString());
+	const BlockContainer* blockContainer = circuit->getBlockContainer();
+
+	// the nodes are hashed, sorted by position they are in the same order in every evaluator of the circuit
+	std::vector<std::pair<uint64_t, CircuitNode>> nodes;
+	evalCircuit->forEachNode([&nodes](Position pos, const CircuitNode& node) {
+		nodes.emplace_back(getPositionKey(pos), node);
+	});
+	std::sort(nodes.begin(), nodes.end());
+
+	mixFingerprint(fingerprint, evalCircuit->getCircuitId());
+	mixFingerprint(fingerprint, nodes.size());
+	for (const auto& [positionKey, node] : nodes) {
+		mixFingerprint(fingerprint, positionKey);
+		const Block* block = blockContainer->getBlock(getKeyPosition(positionKey));
+		if (block) {
+			// The connections by the position of the other block, block ids differ between copies of a circuit. Their sum
+			// does not depend on the order of the connections, so they do not have to be sorted.
+			uint64_t connectionCount = 0;
+			uint64_t connectionSum = 0;
+			for (const auto& [connectionId, ends] : block->getConnectionContainer().getConnections()) {
+				if (!block->isConnectionOutput(connectionId)) continue;
+				for (const ConnectionEnd& end : ends) {
+					const Block* other = blockContainer->getBlock(end.getBlockId());
+					if (!other) continue;
+					uint64_t connectionFingerprint = connectionId;
+					mixFingerprint(connectionFingerprint, getPositionKey(other->getPosition()));
+					mixFingerprint(connectionFingerprint, end.getConnectionId());
+					connectionSum += connectionFingerprint;
+					++connectionCount;
+				}
+			}
+			mixFingerprint(fingerprint, connectionCount);
+			mixFingerprint(fingerprint, connectionSum);
+		}
+		if (node.isIC()) {
+			getCheckpointPoints(node.getId(), points, fingerprint);
+			continue;
+		}
+		// lights only have their input, the state of a block without an output is on port 0
+		connection_port_id_t portId = 0;
+		if (block) {
+			const BlockType blockType = block->type();
+			mixFingerprint(fingerprint, blockType);
+			for (connection_end_id_t connectionId = 0; connectionId < blockDataManager.getConnectionCount(blockType); ++connectionId) {
+				if (blockDataManager.isConnectionOutput(blockType, connectionId)) {
+					portId = connectionId;
+					break;
+				}
+			}
+		}
+		points.emplace_back(node.getId(), portId);
+	}
+}
+
+const Evaluator::CheckpointLayout& Evaluator::getCheckpointLayout(SimPauseGuard& pauseGuard) {
+	if (checkpointLayout.has_value()) return checkpointLayout.value();
+	CheckpointLayout& layout = checkpointLayout.emplace();
+	getCheckpointPoints(0, layout.points, layout.fingerprint);
+	layout.blockSimulatorIds = evalSimulator.getBlockSimulatorIds(
+		std::vector<std::optional<EvalConnectionPoint>>(layout.points.begin(), layout.points.end())
+	);
+	// merged junctions and gates give several blocks the same id
+	layout.simulatorIds.reserve(layout.blockSimulatorIds.size());
+	std::vector<bool> seen;
+	for (simulator_id_t simulatorId : layout.blockSimulatorIds) {
+		if (simulatorId == 0) continue;
+		if (seen.size() <= simulatorId) seen.resize(std::max<size_t>(simulatorId + 1, seen.size() * 2));
+		if (seen[simulatorId]) continue;
+		seen[simulatorId] = true;
+		layout.simulatorIds.push_back(simulatorId);
+	}
+	layout.netlistFingerprint = evalSimulator.getNetlistFingerprint(pauseGuard, layout.simulatorIds);
+	return layout;
+}
+
+std::vector<uint8_t> Evaluator::getCheckpoint() {
+	SimPauseGuard pauseGuard = evalSimulator.beginEdit();
+	std::unique_lock lk(simMutex);
+	const CheckpointLayout& layout = getCheckpointLayout(pauseGuard);
+	const std::vector<logic_state_t> states = evalSimulator.getStatesFromSimulatorIds(layout.blockSimulatorIds);
+	const SimulationState simulationState = evalSimulator.getSimulationState(pauseGuard, layout.simulatorIds);
+
+	const CheckpointHeader header {
+		checkpointMagic, checkpointVersion, layout.fingerprint, layout.points.size(), simulationState.tickCount, evalConfig.getSprintCount(),
+		layout.netlistFingerprint, layout.simulatorIds.size(), simulationState.delayHistory.size()
+	};
+	std::vector<uint8_t> checkpoint(getCheckpointSize(header.blockCount, header.stateCount, header.delayStateCount));
+	uint8_t* data = checkpoint.data();
+	const auto write = [&data](const void* source, size_t size) {
+		std::memcpy(data, source, size);
+		data += size;
+	};
+	write(&header, sizeof(CheckpointHeader));
+	write(states.data(), states.size() * sizeof(logic_state_t));
+	write(simulationState.statesA.data(), simulationState.statesA.size() * sizeof(logic_state_t));
+	write(simulationState.statesB.data(), simulationState.statesB.size() * sizeof(logic_state_t));
+	write(simulationState.delayHistory.data(), simulationState.delayHistory.size() * sizeof(logic_state_t));
+	return checkpoint;
+}
+
+bool Evaluator::restoreCheckpoint(const std::vector<uint8_t>& checkpoint) {
+	CheckpointHeader header;
+	if (checkpoint.size() < sizeof(CheckpointHeader)) {
+		logError("Checkpoint is only {} bytes", "Evaluator::restoreCheckpoint", checkpoint.size());
+		return false;
+	}
+	std::memcpy(&header, checkpoint.data(), sizeof(CheckpointHeader));
+	if (header.magic != checkpointMagic || header.version != checkpointVersion) {
+		logError("Data is not a checkpoint of version {}", "Evaluator::restoreCheckpoint", checkpointVersion);
+		return false;
+	}
+
+	SimPauseGuard pauseGuard = evalSimulator.beginEdit();
+	std::unique_lock lk(simMutex);
+	const CheckpointLayout& layout = getCheckpointLayout(pauseGuard);
+	if (header.fingerprint != layout.fingerprint || header.blockCount != layout.points.size()) {
+		logError("Checkpoint is of a different circuit than {}", "Evaluator::restoreCheckpoint", getEvaluatorName());
+		return false;
+	}
+	const size_t expectedSize = getCheckpointSize(header.blockCount, header.stateCount, header.delayStateCount);
+	if (checkpoint.size() != expectedSize) {
+		logError("Checkpoint has {} bytes, expected {}", "Evaluator::restoreCheckpoint", checkpoint.size(), expectedSize);
+		return false;
+	}
+
+	const uint8_t* data = checkpoint.data() + sizeof(CheckpointHeader);
+	const auto read = [&data](std::vector<logic_state_t>& target, size_t count) {
+		target.resize(count);
+		std::memcpy(target.data(), data, count * sizeof(logic_state_t));
+		data += count * sizeof(logic_state_t);
+	};
+	std::vector<logic_state_t> states;
+	read(states, header.blockCount);
+	bool restoredSimulation = false;
+	if (header.stateCount == layout.simulatorIds.size() && header.netlistFingerprint == layout.netlistFingerprint) {
+		SimulationState simulationState;
+		simulationState.tickCount = header.tickCount;
+		read(simulationState.statesA, header.stateCount);
+		read(simulationState.statesB, header.stateCount);
+		read(simulationState.delayHistory, header.delayStateCount);
+		restoredSimulation = evalSimulator.setSimulationState(pauseGuard, layout.simulatorIds, simulationState);
+	}
+	if (!restoredSimulation) {
+		// optimized differently, only the blocks can be matched up
+		logWarning(
+			"{} does not simulate the circuit like the checkpoint did, only the block states are restored", "Evaluator::restoreCheckpoint",
+			getEvaluatorName()
+		);
+		evalSimulator.setStates(layout.points, states);
+		evalSimulator.setTickCount(pauseGuard, header.tickCount);
+	}
+	evalConfig.resetSprintCount();
+	if (header.sprintCount > 0) evalConfig.addSprint(header.sprintCount);
+	return true;
+}
+
+bool Evaluator::saveCheckpoint(const std::string& path) {
+	const std::vector<uint8_t> checkpoint = getCheckpoint();
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		logError("Failed to open checkpoint file: {}", "Evaluator::saveCheckpoint", path);
+		return false;
+	}
+	if (!file.write(reinterpret_cast<const char*>(checkpoint.data()), checkpoint.size())) {
+		logError("Failed to write checkpoint file: {}", "Evaluator::saveCheckpoint", path);
+		return false;
+	}
+	return true;
+}
+
+bool Evaluator::loadCheckpoint(const std::string& path) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		logError("Failed to open checkpoint file: {}", "Evaluator::loadCheckpoint", path);
+		return false;
+	}
+
+	std::streamsize size = file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	std::vector<uint8_t> checkpoint(size);
+	if (!file.read(reinterpret_cast<char*>(checkpoint.data()), size)) {
+		logError("Failed to read checkpoint file: {}", "Evaluator::loadCheckpoint", path);
+		return false;
+	}
+	return restoreCheckpoint(checkpoint);
 }
 
 void Evaluator::checkToCreateExternalConnections(SimPauseGuard& pauseGuard, eval_circuit_id_t evalCircuitId, Position position) {
@@ -836,6 +1408,11 @@ void Evaluator::traceOutwardsIC(
 		logError("CircuitBlockData for circuit ID {} not found", "Evaluator::traceOutwardsIC", circuitId);
 		return;
 	}
+	// only a block on a port of the IC reaches outside of it
+	BidirectionalMultiSecondKeyMap<connection_end_id_t, Position>::constIteratorPairT2 connectionIds = circuitBlockData->getConnectionPositionToId(position);
+	if (connectionIds.first == connectionIds.second) {
+		return;
+	}
 	SharedCircuit innerCircuit = circuitManager.getCircuit(evalCircuit->getCircuitId());
 	if (!innerCircuit) {
 		logError("Inner circuit for evalCircuitId {} not found", "Evaluator::traceOutwardsIC", evalCircuitId);
@@ -885,9 +1462,27 @@ void Evaluator::traceOutwardsIC(
 		return;
 	}
 
-	circuitNodeDependencies.insert(node.value());
+	// what is outside of the IC depends on where it is placed, so a template of it keeps the trace instead of its result
+	std::vector<size_t> tracedRecordings;
+	for (size_t i = 0; i < templateRecordings.size(); ++i) {
+		EvalCircuitTemplateRecording& recording = templateRecordings[i];
+		if (recording.outsideDepth != 0 || recording.rootEvalCircuitId != evalCircuitId) {
+			continue;
+		}
+		std::optional<EvalConnectionPoint> localConnectionPoint = recording.toLocal(targetConnectionPoint);
+		std::optional<std::vector<CircuitNode>> localNodeDependencies = recording.toLocal(circuitNodeDependencies);
+		if (localConnectionPoint.has_value() && localNodeDependencies.has_value()) {
+			recording.evalCircuitTemplate.steps.push_back(EvalCircuitTemplate::TraceOutwards{
+				position, direction, localConnectionPoint.value(), circuitPortDependencies, std::move(localNodeDependencies.value())
+			});
+		} else {
+			recording.valid = false;
+		}
+		++recording.outsideDepth;
+		tracedRecordings.push_back(i);
+	}
 
-	BidirectionalMultiSecondKeyMap<connection_end_id_t, Position>::constIteratorPairT2 connectionIds = circuitBlockData->getConnectionPositionToId(position);
+	circuitNodeDependencies.insert(node.value());
 
 	for (auto iter = connectionIds.first; iter != connectionIds.second; ++iter) {
 		connection_end_id_t connectionEndId = iter->second;
@@ -941,8 +1536,8 @@ void Evaluator::traceOutwardsIC(
 			} else {
 				evalConnection = EvalConnection(targetConnectionPoint, connectionPoint.value());
 			}
-			evalSimulator.makeConnection(pauseGuard, evalConnection);
-			interCircuitConnections.push_back({
+			makeConnection(pauseGuard, evalConnection);
+			addInterCircuitConnection({
 				evalConnection,
 				circuitPortDependenciesCopy,
 				circuitNodeDependenciesCopy
@@ -963,6 +1558,9 @@ void Evaluator::traceOutwardsIC(
 	}
 
 	circuitNodeDependencies.erase(node.value());
+	for (size_t i : tracedRecordings) {
+		--templateRecordings[i].outsideDepth;
+	}
 }
 
 void Evaluator::processDirtyNodes() {
@@ -997,7 +1595,8 @@ void Evaluator::processDirtyNodes() {
 		dirtyNodesToProcess.push_back(evalPosition);
 		connectionPointsToRequest.push_back(connectionPoint.value());
 	}
-	dirtyNodes.clear();
+	// clearing goes over every bucket, which stay many after a big load
+	if (!dirtyNodes.empty()) dirtyNodes.clear();
 
 	std::vector<SimulatorStateAndPinSimId> simulatorIdPairs = evalSimulator.getSimulatorIds(connectionPointsToRequest);
 
@@ -1049,7 +1648,7 @@ void Evaluator::dirtyBlockAt(Position position, eval_circuit_id_t evalCircuitId)
 		return;
 	}
 	if (block->type() == BlockType::LIGHT) {
-		dirtyNodes.insert({position, evalCircuitId});
+		dirtyNode(EvalPosition(position, evalCircuitId));
 		return;
 	}
 	const BlockData* blockData = blockDataManager.getBlockData(block->type());
@@ -1064,9 +1663,24 @@ void Evaluator::dirtyBlockAt(Position position, eval_circuit_id_t evalCircuitId)
 				logError("Port position not found for connection ID {}", "Evaluator::dirtyBlockAt", i);
 				continue;
 			}
-			dirtyNodes.insert({portPositionOpt.value(), evalCircuitId});
+			dirtyNode(EvalPosition(portPositionOpt.value(), evalCircuitId));
+		}
+	}
+}
+
+void Evaluator::dirtyNode(EvalPosition evalPosition) {
+	for (EvalCircuitTemplateRecording& recording : templateRecordings) {
+		if (recording.outsideDepth != 0) {
+			continue;
+		}
+		auto iter = recording.localEvalCircuitIds.find(evalPosition.evalCircuitId);
+		if (iter == recording.localEvalCircuitIds.end()) {
+			recording.valid = false;
+			continue;
 		}
+		recording.evalCircuitTemplate.steps.push_back(EvalCircuitTemplate::DirtyNode{ EvalPosition(evalPosition.position, iter->second) });
 	}
+	dirtyNodes.insert(evalPosition);
 }
 
 std::vector<simulator_id_t> Evaluator::getBlockSimulatorIds(const Address& addressOrigin, const std::vector<Position>& positions) const {
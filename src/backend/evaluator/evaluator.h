@@ -57,6 +57,90 @@ struct DependentConnectionPoint {
 	std::set<CircuitNode> circuitNodeDependencies;
 };
 
+// What placing an IC does to the evaluator. It is recorded while the first instance of a circuit is built and replayed
+// for the instances after it, so they skip the creation Difference and the block lookups behind it. Ids in the steps are
+// local to the instance: eval circuit 0 is the placed IC, the nested ICs and the gates count up in the order they were
+// added. Everything that depends on where the instance sits is kept as a trace out of it and done again on replay.
+struct EvalCircuitTemplate {
+	struct AddCircuit {
+		eval_circuit_id_t parentEvalCircuitId;
+		circuit_id_t circuitId;
+		Position position;
+	};
+	struct AddGate {
+		eval_circuit_id_t evalCircuitId;
+		Position position;
+		GateType gateType;
+	};
+	struct MakeConnection {
+		EvalConnection connection;
+	};
+	struct AddInterCircuitConnection {
+		EvalConnection connection;
+		std::set<CircuitPortDependency> circuitPortDependencies;
+		std::vector<CircuitNode> circuitNodeDependencies;
+	};
+	struct DirtyNode {
+		EvalPosition evalPosition;
+	};
+	// a block on a port of the placed IC, traceOutwardsIC connects it to the circuit the instance is placed in
+	struct TraceOutwards {
+		Position position;
+		Direction direction;
+		EvalConnectionPoint targetConnectionPoint;
+		std::set<CircuitPortDependency> circuitPortDependencies;
+		std::vector<CircuitNode> circuitNodeDependencies;
+	};
+	typedef std::variant<AddCircuit, AddGate, MakeConnection, AddInterCircuitConnection, DirtyNode, TraceOutwards> Step;
+
+	std::vector<Step> steps;
+	// the template is stale once any of these circuits is edited
+	std::vector<std::pair<circuit_id_t, unsigned long long>> circuitEditCounts;
+	eval_circuit_id_t evalCircuitCount = 1;
+	middle_id_t gateCount = 0;
+};
+
+struct EvalCircuitTemplateRecording {
+	EvalCircuitTemplateRecording(circuit_id_t circuitId, eval_circuit_id_t rootEvalCircuitId)
+		: circuitId(circuitId), rootEvalCircuitId(rootEvalCircuitId) {
+		localEvalCircuitIds[rootEvalCircuitId] = 0;
+	}
+
+	std::optional<CircuitNode> toLocal(CircuitNode node) const {
+		if (node.isIC()) {
+			auto iter = localEvalCircuitIds.find(node.getId());
+			if (iter == localEvalCircuitIds.end()) return std::nullopt;
+			return CircuitNode::fromIC(iter->second);
+		}
+		auto iter = localMiddleIds.find(node.getId());
+		if (iter == localMiddleIds.end()) return std::nullopt;
+		return CircuitNode::fromMiddle(iter->second);
+	}
+	std::optional<EvalConnectionPoint> toLocal(EvalConnectionPoint point) const {
+		auto iter = localMiddleIds.find(point.gateId);
+		if (iter == localMiddleIds.end()) return std::nullopt;
+		return EvalConnectionPoint(iter->second, point.portId);
+	}
+	std::optional<std::vector<CircuitNode>> toLocal(const std::set<CircuitNode>& nodes) const {
+		std::vector<CircuitNode> localNodes;
+		localNodes.reserve(nodes.size());
+		for (CircuitNode node : nodes) {
+			std::optional<CircuitNode> localNode = toLocal(node);
+			if (!localNode.has_value()) return std::nullopt;
+			localNodes.push_back(localNode.value());
+		}
+		return localNodes;
+	}
+
+	circuit_id_t circuitId;
+	eval_circuit_id_t rootEvalCircuitId;
+	EvalCircuitTemplate evalCircuitTemplate;
+	std::unordered_map<eval_circuit_id_t, eval_circuit_id_t> localEvalCircuitIds;
+	std::unordered_map<middle_id_t, middle_id_t> localMiddleIds;
+	unsigned int outsideDepth = 0; // tracing out of the placed IC, nothing done there belongs to the template
+	bool valid = true;
+};
+
 class Evaluator {
 public:
 	typedef std::tuple<BlockType, connection_end_id_t, Position> RemoveCircuitIOData; // I hate tuples, but this is how I get the data
@@ -68,7 +152,8 @@ public:
 		BlockDataManager& blockDataManager,
 		CircuitBlockDataManager& circuitBlockDataManager,
 		circuit_id_t circuitId,
-		DataUpdateEventManager* dataUpdateEventManager
+		DataUpdateEventManager* dataUpdateEventManager,
+		std::shared_ptr<SimulationExecutor> simulationExecutor = nullptr
 	);
 
 	inline evaluator_id_t getEvaluatorId() const { return evaluatorId; }
@@ -98,16 +183,69 @@ public:
 	void tickStep() { tickStep (1); }
 	void setRealistic(bool realistic) { evalConfig.setRealistic(realistic); }
 	bool isRealistic() const { return evalConfig.isRealistic(); }
+	void setEventDriven(bool eventDriven) { evalConfig.setEventDriven(eventDriven); }
+	bool isEventDriven() const { return evalConfig.isEventDriven(); }
+	void setBitPacked(bool bitPacked) { evalConfig.setBitPacked(bitPacked); }
+	bool isBitPacked() const { return evalConfig.isBitPacked(); }
+	void setSettleMode(bool settleMode) { evalConfig.setSettleMode(settleMode); }
+	bool isSettleMode() const { return evalConfig.isSettleMode(); }
+	void setNativeCompiled(bool nativeCompiled) { evalConfig.setNativeCompiled(nativeCompiled); }
+	bool isNativeCompiled() const { return evalConfig.isNativeCompiled(); }
+	void setGateOptimization(bool gateOptimization);
+	bool isGateOptimization() const { return evalConfig.isGateOptimization(); }
+	void setFunctionalOptimization(bool functionalOptimization);
+	bool isFunctionalOptimization() const { return evalConfig.isFunctionalOptimization(); }
+	void setWaitPolicy(WaitPolicy waitPolicy) { evalConfig.setWaitPolicy(waitPolicy); }
+	WaitPolicy getWaitPolicy() const { return evalConfig.getWaitPolicy(); }
+	void setAutoThreadCount(bool autoThreadCount) { evalConfig.setAutoThreadCount(autoThreadCount); }
+	bool isAutoThreadCount() const { return evalConfig.isAutoThreadCount(); }
 	void setTickrate(double tickrate) { evalConfig.setTargetTickrate(tickrate); }
 	double getTickrate() const { return evalConfig.getTargetTickrate(); }
 	void setUseTickrate(bool useTickrate) { evalConfig.setTickrateLimiter(useTickrate); }
 	bool getUseTickrate() const { return evalConfig.isTickrateLimiterEnabled(); }
 	double getRealTickrate() const { return evalSimulator.getAverageTickrate(); }
+	// busy and idle time of every simulation thread, the last entry is the thread that drives the ticks
+	std::vector<ThreadPool::WorkerStats> getWorkerStats() const { return evalSimulator.getWorkerStats(); }
+	bool isNativeTickActive() const { return evalSimulator.isNativeTickActive(); }
+	// true while placing the circuit as an IC replays what its first instance did. For tests.
+	bool hasCircuitTemplate(circuit_id_t circuitId) const { return circuitTemplates.contains(circuitId); }
+	// compiles the native ticks right away and waits for them, true when they took over. For tests and benchmarks.
+	bool compileNativeTicks();
+	void resetWorkerStats() { evalSimulator.resetWorkerStats(); }
 	void makeEdit(DifferenceSharedPtr difference, circuit_id_t circuitId);
+	// Edits between these share one pause of the simulation. The junction merge, the job regeneration and the update of
+	// the dirty nodes run once in commitEditTransaction instead of after every edit. Transactions nest, only the
+	// outermost commit applies them. States read before the commit can lag behind the edits.
+	void beginEditTransaction();
+	void commitEditTransaction();
+	// packs the simulator ids so connected gates are close in memory, this also happens on its own after big edits
+	void renumberSimulatorIds();
+	// Runs the circuit once for every input vector, 64 at a time, without touching the live simulation.
+	// Input vector i holds the states of inputPorts (CircuitBlockData connection ids of this circuit), the returned
+	// vector i holds the states of outputPorts after nTicks. Every run starts from the current states.
+	std::vector<std::vector<logic_state_t>> simulateBatch(
+		const std::vector<connection_end_id_t>& inputPorts,
+		const std::vector<connection_end_id_t>& outputPorts,
+		const std::vector<std::vector<logic_state_t>>& inputVectors,
+		unsigned int nTicks
+	);
 	logic_state_t getState(const Address& address);
 	bool getBoolState(const Address& address) { return toBool(getState(address)); };
 	void setState(const Address& address, logic_state_t state);
 	void setState(const Address& address, bool state) { setState(address, fromBool(state)); }
+	// all states that are set while the simulation runs take effect in the same tick
+	void setStates(const std::vector<Address>& addresses, const std::vector<logic_state_t>& states);
+	uint64_t getTickCount() const { return evalSimulator.getTickCount(); }
+	// A checkpoint holds the simulator state (both state buffers and the delay rings) of the gates of the blocks, the tick
+	// count, the sprint ticks that are left and the output of every block. All of it is stored in the order of the block
+	// addresses instead of by simulator id, so an evaluator of the same circuit that simulates it the same way, like a new
+	// one, restores all of it. Any other evaluator of the circuit only gets the block states, so delays in flight start
+	// over. States set with setState that did not take effect yet are not part of it. The first checkpoint after an edit
+	// walks every block to lay it out, later ones only copy the states.
+	std::vector<uint8_t> getCheckpoint();
+	bool restoreCheckpoint(const std::vector<uint8_t>& checkpoint);
+	bool saveCheckpoint(const std::string& path);
+	bool loadCheckpoint(const std::string& path);
 	circuit_id_t getCircuitId() const { return evalCircuitContainer.getCircuitId(0).value_or(0); }
 	circuit_id_t getCircuitId(const Address& address) const {
 		std::shared_lock lk(simMutex);
@@ -160,6 +298,12 @@ private:
 
 	bool changedICs = false;
 
+	unsigned int editTransactionDepth = 0;
+	std::unique_ptr<SimPauseGuard> editTransactionPauseGuard;
+	std::vector<circuit_id_t> editTransactionCircuits; // circuits whose transactions this evaluator takes part in
+	void beginCircuitEditTransaction(const DataUpdateEventManager::EventData* data);
+	void commitCircuitEditTransaction(const DataUpdateEventManager::EventData* data);
+
 	void makeEditInPlace(SimPauseGuard& pauseGuard, eval_circuit_id_t evalCircuitId, DifferenceSharedPtr difference, DiffCache& diffCache);
 
 	void edit_removeBlock(SimPauseGuard& pauseGuard, eval_circuit_id_t evalCircuitId, DiffCache& diffCache, Position position, Orientation orientation, BlockType type);
@@ -178,6 +322,22 @@ private:
 	std::optional<middle_id_t> getMiddleId(const eval_circuit_id_t startingPoint, const Address& address) const;
 	std::optional<middle_id_t> getMiddleId(const eval_circuit_id_t startingPoint, const Address& address, const BlockContainer* blockContainer) const;
 	std::optional<middle_id_t> getMiddleId(const Address& address) const;
+	// the point setState writes to for an address, simMutex has to be held
+	std::optional<EvalConnectionPoint> getSettableConnectionPoint(const Address& address);
+	// the output of every block in the order a checkpoint stores them, fingerprint changes with the circuit tree, the
+	// block types and the connections
+	void getCheckpointPoints(eval_circuit_id_t evalCircuitId, std::vector<EvalConnectionPoint>& points, uint64_t& fingerprint) const;
+	// The order and fingerprints a checkpoint is written and checked with. Building it walks every block, so it is kept
+	// until the next edit and a checkpoint of an unchanged circuit only copies the states. simMutex has to be held.
+	struct CheckpointLayout {
+		std::vector<EvalConnectionPoint> points;
+		uint64_t fingerprint = 0;
+		std::vector<simulator_id_t> blockSimulatorIds; // of the points
+		std::vector<simulator_id_t> simulatorIds; // of the points without repeats, the simulator state is stored in this order
+		uint64_t netlistFingerprint = 0;
+	};
+	std::optional<CheckpointLayout> checkpointLayout;
+	const CheckpointLayout& getCheckpointLayout(SimPauseGuard& pauseGuard);
 
 	std::optional<connection_port_id_t> getPortId(const circuit_id_t circuitId, const Position blockPosition, const Position portPosition, Direction direction) const;
 	std::optional<connection_port_id_t> getPortId(const BlockContainer* blockContainer, const Position blockPosition, const Position portPosition, Direction direction) const;
@@ -203,6 +363,20 @@ private:
 		std::set<CircuitPortDependency>& circuitPortDependencies,
 		std::set<CircuitNode>& circuitNodeDependencies
 	);
+	void makeConnection(SimPauseGuard& pauseGuard, const EvalConnection& connection);
+	void addInterCircuitConnection(InterCircuitConnection&& interCircuitConnection);
+
+	std::unordered_map<circuit_id_t, EvalCircuitTemplate> circuitTemplates;
+	// innermost last, an IC placed inside of one that is being recorded is recorded by both
+	std::vector<EvalCircuitTemplateRecording> templateRecordings;
+	const EvalCircuitTemplate* getCircuitTemplate(circuit_id_t circuitId) const;
+	// the ports decide what the templates trace out of ICs and which port of a block a checkpoint stores
+	void blockDataConnectionsChanged(const DataUpdateEventManager::EventData* data);
+	void removeCircuitTemplates(const DataUpdateEventManager::EventData* data);
+	void placeICFromTemplate(SimPauseGuard& pauseGuard, eval_circuit_id_t evalCircuitId, const EvalCircuitTemplate& evalCircuitTemplate);
+	void recordAddCircuit(eval_circuit_id_t parentEvalCircuitId, eval_circuit_id_t evalCircuitId, circuit_id_t circuitId, Position position);
+	void recordAddGate(eval_circuit_id_t evalCircuitId, middle_id_t gateId, Position position, GateType gateType);
+
 	std::vector<simulator_id_t> dirtySimulatorIds;
 	std::unordered_set<EvalPosition> dirtyNodes;
 	std::unordered_multimap<simulator_id_t, EvalPosition> portSimulatorIdToEvalPositionMap;
@@ -220,6 +394,7 @@ private:
 private:
 	void processDirtyNodes();
 	void dirtyBlockAt(Position position, eval_circuit_id_t evalCircuitId);
+	void dirtyNode(EvalPosition evalPosition);
 
 	mutable std::shared_mutex simMutex;
 };
@@ -29,7 +29,8 @@ public:
 			circuitManager,
 			*circuitManager.getBlockDataManager(),
 			*circuitManager.getCircuitBlockDataManager(),
-			circuitId, dataUpdateEventManager
+			circuitId, dataUpdateEventManager,
+			simulationExecutor
 		));
 		dataUpdateEventManager->sendEvent("addressTreeMakeBranch");
 		return id;
@@ -44,6 +45,8 @@ public:
 	typedef std::map<evaluator_id_t, SharedEvaluator>::iterator iterator;
 	typedef std::map<evaluator_id_t, SharedEvaluator>::const_iterator const_iterator;
 
+	inline const SimulationExecutor& getSimulationExecutor() const { return *simulationExecutor; }
+
 	inline iterator begin() { return evaluators.begin(); }
 	inline iterator end() { return evaluators.end(); }
 	inline const_iterator begin() const { return evaluators.begin(); }
@@ -61,6 +64,9 @@ private:
 	DataUpdateEventManager* dataUpdateEventManager;
 	
 	evaluator_id_t lastId = 0;
+	// runs the ticks of every evaluator of the process, the simulators share ownership so evaluators kept alive elsewhere
+	// still work
+	std::shared_ptr<SimulationExecutor> simulationExecutor = SimulationExecutor::getShared();
 	std::map<evaluator_id_t, SharedEvaluator> evaluators;
 };
 
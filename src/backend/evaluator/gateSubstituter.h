@@ -106,6 +106,15 @@ public:
 	inline void endEdit(SimPauseGuard& pauseGuard) {
 		replacer.endEdit(pauseGuard);
 	}
+	inline void updateGateOptimization(SimPauseGuard& pauseGuard) {
+		replacer.updateGateOptimization(pauseGuard);
+	}
+	inline void renumberSimulatorIds(SimPauseGuard& pauseGuard) {
+		replacer.renumberSimulatorIds(pauseGuard);
+	}
+	inline void compileLanes(SimPauseGuard& pauseGuard, LaneSimulator& laneSimulator) const {
+		replacer.compileLanes(pauseGuard, laneSimulator);
+	}
 
 	inline logic_state_t getState(EvalConnectionPoint point) const {
 		return replacer.getState(point);
@@ -131,6 +140,9 @@ public:
 	inline void setState(EvalConnectionPoint point, logic_state_t state) {
 		replacer.setState(point, state);
 	}
+	inline void setStates(const std::vector<EvalConnectionPoint>& points, const std::vector<logic_state_t>& states) {
+		replacer.setStates(points, states);
+	}
 	void makeConnection(SimPauseGuard& pauseGuard, EvalConnection connection) {
 		middle_id_t sourceGateId = connection.source.gateId;
 		middle_id_t destinationGateId = connection.destination.gateId;
@@ -191,6 +203,33 @@ public:
 	inline double getAverageTickrate() const {
 		return replacer.getAverageTickrate();
 	}
+	inline std::vector<ThreadPool::WorkerStats> getWorkerStats() const {
+		return replacer.getWorkerStats();
+	}
+	inline bool isNativeTickActive() const {
+		return replacer.isNativeTickActive();
+	}
+	inline bool compileNativeTicks(SimPauseGuard& pauseGuard) {
+		return replacer.compileNativeTicks(pauseGuard);
+	}
+	inline void resetWorkerStats() {
+		replacer.resetWorkerStats();
+	}
+	inline uint64_t getTickCount() const {
+		return replacer.getTickCount();
+	}
+	inline void setTickCount(SimPauseGuard& pauseGuard, uint64_t tickCount) {
+		replacer.setTickCount(pauseGuard, tickCount);
+	}
+	inline SimulationState getSimulationState(SimPauseGuard& pauseGuard, const std::vector<simulator_id_t>& simulatorIds) const {
+		return replacer.getSimulationState(pauseGuard, simulatorIds);
+	}
+	inline bool setSimulationState(SimPauseGuard& pauseGuard, const std::vector<simulator_id_t>& simulatorIds, const SimulationState& state) {
+		return replacer.setSimulationState(pauseGuard, simulatorIds, state);
+	}
+	inline uint64_t getNetlistFingerprint(SimPauseGuard& pauseGuard, const std::vector<simulator_id_t>& simulatorIds) const {
+		return replacer.getNetlistFingerprint(pauseGuard, simulatorIds);
+	}
 
 private:
 	Replacer replacer;
@@ -1,61 +1,121 @@
 #ifndef idProvider_h
 #define idProvider_h
 
+// Hands out the lowest free ids. Every id below lastId has a bit that is set while it is in use (the bits from lastId
+// to the end of the last word are set too, so they are never found as free), and every word of those bits has a
+// summary bit that is set while the word still has a free id. Finding a free id skips 4096 used ids per summary word.
 template<typename T>
 class IdProvider {
 public:
 	IdProvider() : lastId(0) {}
 
 	inline T getNewId() {
-		if (unusedIds.empty()) {
-			return lastId++;
-		} else {
-			T id = *unusedIds.begin();
-			unusedIds.erase(unusedIds.begin());
-			return id;
-		}
+		return takeId(findFreeId(0));
 	}
+	// preferredId when it is free and fewer than half of the ids are free, otherwise the lowest free id.
+	// preferredId == lastId skips the free ids below it.
 	inline T getNewId(T preferredId) {
-		if (unusedIds.size() * 2 < lastId && unusedIds.contains(preferredId)) {
-			unusedIds.erase(preferredId);
-			return preferredId;
+		if (freeIdCount * 2 < lastId && preferredId < lastId && !isIdUsed(preferredId)) {
+			return takeId(preferredId);
 		}
-		if (preferredId == lastId || unusedIds.empty()) {
-			return lastId++;
-		} else {
-			T id = *unusedIds.begin();
-			unusedIds.erase(unusedIds.begin());
-			return id;
+		if (preferredId == lastId || freeIdCount == 0) {
+			return takeId(lastId);
 		}
+		return getNewId();
 	}
 	inline void releaseId(T id) {
-		if (id > lastId || unusedIds.contains(id)) {
+		if (!isIdUsed(id)) {
 			return;
 		}
-		unusedIds.insert(id);
+		usedBits[id / wordBits] &= ~bit(id);
+		++freeIdCount;
+		freeWords[id / summaryBits] |= bit(id / wordBits);
+		firstFreeSummary = std::min(firstFreeSummary, (size_t)id / summaryBits);
 	}
 	inline bool isIdUsed(T id) const {
-		return id <= lastId && !unusedIds.contains(id);
+		return id < lastId && (usedBits[id / wordBits] & bit(id)) != 0;
 	}
 	inline T getLastId() const {
 		return lastId;
 	}
 	inline void reset() {
-		lastId = 0;
-		unusedIds.clear();
+		reset(0);
+	}
+	// marks the ids [0, usedIdCount) as used and everything after as free
+	inline void reset(T usedIdCount) {
+		lastId = usedIdCount;
+		freeIdCount = 0;
+		usedBits.assign((usedIdCount + wordBits - 1) / wordBits, ~(uint64_t)0);
+		freeWords.assign((usedBits.size() + wordBits - 1) / wordBits, 0);
+		firstFreeSummary = freeWords.size();
 	}
 	inline std::vector<T> getUsedIds() const {
 		std::vector<T> usedIds;
-		for (T id = 0; id < lastId; ++id) {
-			if (!unusedIds.contains(id)) {
-				usedIds.push_back(id);
+		for (size_t word = 0; word < usedBits.size(); ++word) {
+			uint64_t bits = usedBits[word];
+			// the bits from lastId on are set but are not ids
+			if ((word + 1) * wordBits > lastId) bits &= (~(uint64_t)0) >> ((word + 1) * wordBits - lastId);
+			for (; bits != 0; bits &= bits - 1) {
+				usedIds.push_back(word * wordBits + std::countr_zero(bits));
 			}
 		}
 		return usedIds;
 	}
 private:
+	static constexpr size_t wordBits = 64;
+	static constexpr size_t summaryBits = wordBits * wordBits;
+
+	static inline uint64_t bit(size_t index) { return (uint64_t)1 << (index % wordBits); }
+
+	// the lowest free id from begin on, lastId when there is none
+	size_t findFreeId(size_t begin) {
+		// nothing below firstFreeSummary is free, and a search that covers everything from there can move it up
+		const size_t firstFreeId = firstFreeSummary * summaryBits;
+		const bool fromFirstFree = begin <= firstFreeId;
+		if (fromFirstFree) begin = firstFreeId;
+		size_t word = begin / wordBits;
+		if (word >= usedBits.size()) {
+			if (fromFirstFree) firstFreeSummary = freeWords.size();
+			return lastId;
+		}
+		const uint64_t freeBits = ~usedBits[word] & (~(uint64_t)0 << (begin % wordBits));
+		if (freeBits != 0) {
+			return word * wordBits + std::countr_zero(freeBits);
+		}
+		++word;
+		uint64_t summaryMask = ~(uint64_t)0 << (word % wordBits);
+		for (size_t summary = word / wordBits; summary < freeWords.size(); ++summary, summaryMask = ~(uint64_t)0) {
+			const uint64_t words = freeWords[summary] & summaryMask;
+			if (words == 0) {
+				continue;
+			}
+			if (fromFirstFree) firstFreeSummary = summary;
+			const size_t freeWord = summary * wordBits + std::countr_zero(words);
+			return freeWord * wordBits + std::countr_zero(~usedBits[freeWord]);
+		}
+		if (fromFirstFree) firstFreeSummary = freeWords.size();
+		return lastId;
+	}
+	T takeId(size_t id) {
+		if (id == lastId) {
+			if (lastId % wordBits == 0) {
+				usedBits.push_back(~(uint64_t)0);
+				if (usedBits.size() > freeWords.size() * wordBits) freeWords.push_back(0);
+			}
+			return lastId++;
+		}
+		uint64_t& word = usedBits[id / wordBits];
+		word |= bit(id);
+		--freeIdCount;
+		if (word == ~(uint64_t)0) freeWords[id / summaryBits] &= ~bit(id / wordBits);
+		return id;
+	}
+
 	T lastId;
-	std::set<T> unusedIds;
+	size_t freeIdCount = 0; // released ids below lastId
+	std::vector<uint64_t> usedBits;
+	std::vector<uint64_t> freeWords;
+	size_t firstFreeSummary = 0; // no summary word below this one has a free word
 };
 
 #endif /* idProvider_h */
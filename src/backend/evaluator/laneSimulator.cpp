@@ -0,0 +1,142 @@
+#include "laneSimulator.h"
+
+void LaneSimulator::compile(
+	const std::vector<logic_state_t>& statesA,
+	const std::vector<logic_state_t>& statesB,
+	const std::vector<ANDLikeGate>& andGates,
+	const std::vector<XORLikeGate>& xorGates,
+	const std::vector<TristateBufferGate>& tristateBuffers,
+	const std::vector<JunctionGate>& junctions,
+	const std::vector<ConstantResetGate>& constantResetGates,
+	const std::vector<CopySelfOutputGate>& copySelfOutputGates,
+	const std::vector<BufferGate>& buffers,
+	bool realistic
+) {
+	this->realistic = realistic;
+	initialStatesA = statesA;
+	initialStatesB = statesB;
+
+	andTable = GateTable();
+	for (const ANDLikeGate& gate : andGates) {
+		andTable.add(gate.getId(), (gate.inputsInverted ? INPUTS_INVERTED : 0) | (gate.outputInverted ? OUTPUT_INVERTED : 0), gate.getInputs());
+	}
+	xorTable = GateTable();
+	for (const XORLikeGate& gate : xorGates) {
+		xorTable.add(gate.getId(), gate.outputInverted ? OUTPUT_INVERTED : 0, gate.getInputs());
+	}
+	tristateTable = GateTable();
+	for (const TristateBufferGate& gate : tristateBuffers) {
+		std::vector<simulator_id_t> inputs = gate.inputs;
+		inputs.insert(inputs.end(), gate.enableInputs.begin(), gate.enableInputs.end());
+		tristateTable.add(gate.getId(), gate.enableInverted ? ENABLE_INVERTED : 0, inputs);
+		tristateTable.enableCounts.push_back(gate.enableInputs.size());
+	}
+	junctionTable = GateTable();
+	for (const JunctionGate& gate : junctions) {
+		junctionTable.add(gate.getId(), 0, gate.inputs);
+	}
+	constantResetIds.clear();
+	constantResetStates.clear();
+	for (const ConstantResetGate& gate : constantResetGates) {
+		constantResetIds.push_back(gate.getId());
+		constantResetStates.push_back(gate.outputState);
+	}
+	copySelfOutputIds.clear();
+	for (const CopySelfOutputGate& gate : copySelfOutputGates) {
+		copySelfOutputIds.push_back(gate.getId());
+	}
+	delayLines.clear();
+	historyOffsets.assign(1, 0);
+	initialHistory.clear();
+	initialHeads.clear();
+	for (const BufferGate& gate : buffers) {
+		delayLines.push_back({ gate.getId(), gate.getInput(), gate.outputInverted, 0 });
+		initialHistory.insert(initialHistory.end(), gate.history.begin(), gate.history.end());
+		historyOffsets.push_back(initialHistory.size());
+		initialHeads.push_back(gate.historyHead);
+	}
+
+	reset();
+}
+
+void LaneSimulator::reset() {
+	wordsA.resize(initialStatesA.size());
+	wordsB.resize(initialStatesB.size());
+	for (simulator_id_t id = 0; id < initialStatesA.size(); ++id) {
+		wordsA[id] = LogicWord::broadcast(initialStatesA[id]);
+		wordsB[id] = LogicWord::broadcast(initialStatesB[id]);
+	}
+	history.resize(initialHistory.size());
+	for (size_t i = 0; i < initialHistory.size(); ++i) history[i] = LogicWord::broadcast(initialHistory[i]);
+	for (size_t i = 0; i < delayLines.size(); ++i) delayLines[i].head = initialHeads[i];
+}
+
+LogicWord LaneSimulator::calculateJunction(size_t junctionIndex, const std::vector<LogicWord>& words) const {
+	const simulator_id_t* inputs = junctionTable.inputIds.data() + junctionTable.inputOffsets[junctionIndex];
+	return LogicWord::junction(junctionTable.inputCount(junctionIndex), [&](uint32_t input) { return words[inputs[input]]; });
+}
+
+void LaneSimulator::doubleTickJunctions() {
+	for (size_t i = 0; i < junctionTable.ids.size(); ++i) {
+		const LogicWord word = calculateJunction(i, wordsB);
+		wordsA[junctionTable.ids[i]] = word;
+		wordsB[junctionTable.ids[i]] = word;
+	}
+}
+
+void LaneSimulator::tick(unsigned int nTicks) {
+	for (unsigned int tickIndex = 0; tickIndex < nTicks; ++tickIndex) {
+		const LogicWord* current = wordsA.data();
+		LogicWord* next = wordsB.data();
+		auto store = [&](simulator_id_t id, LogicWord target) {
+			next[id] = realistic ? LogicWord::realistic(target, current[id]) : target;
+		};
+
+		for (size_t i = 0; i < andTable.ids.size(); ++i) {
+			const simulator_id_t* inputs = andTable.inputIds.data() + andTable.inputOffsets[i];
+			const uint8_t gateFlags = andTable.flags[i];
+			store(andTable.ids[i], LogicWord::andLike(
+				andTable.inputCount(i), gateFlags & INPUTS_INVERTED, gateFlags & OUTPUT_INVERTED,
+				[&](uint32_t input) { return current[inputs[input]]; }
+			));
+		}
+		for (size_t i = 0; i < xorTable.ids.size(); ++i) {
+			const simulator_id_t* inputs = xorTable.inputIds.data() + xorTable.inputOffsets[i];
+			store(xorTable.ids[i], LogicWord::xorLike(
+				xorTable.inputCount(i), xorTable.flags[i] & OUTPUT_INVERTED,
+				[&](uint32_t input) { return current[inputs[input]]; }
+			));
+		}
+		for (size_t i = 0; i < tristateTable.ids.size(); ++i) {
+			const simulator_id_t* inputs = tristateTable.inputIds.data() + tristateTable.inputOffsets[i];
+			const uint32_t enableCount = tristateTable.enableCounts[i];
+			store(tristateTable.ids[i], LogicWord::tristate(
+				tristateTable.inputCount(i) - enableCount, enableCount, tristateTable.flags[i] & ENABLE_INVERTED,
+				[&](uint32_t input) { return current[inputs[input]]; }
+			));
+		}
+		for (size_t i = 0; i < constantResetIds.size(); ++i) {
+			next[constantResetIds[i]] = LogicWord::broadcast(constantResetStates[i]);
+		}
+		for (simulator_id_t id : copySelfOutputIds) {
+			next[id] = current[id];
+		}
+		// same as BufferGate::shift
+		for (size_t i = 0; i < delayLines.size(); ++i) {
+			DelayLine& line = delayLines[i];
+			LogicWord word = line.input.has_value() ? current[line.input.value()] : LogicWord();
+			const uint32_t historyLength = historyOffsets[i + 1] - historyOffsets[i];
+			if (historyLength != 0) {
+				std::swap(word, history[historyOffsets[i] + line.head]);
+				if (++line.head == historyLength) line.head = 0;
+			}
+			if (line.outputInverted) word = LogicWord::andLike(1, false, true, [&](uint32_t) { return word; });
+			store(line.id, word);
+		}
+		// junctions read and write the next buffer in place, same as CompiledGates::tickJunctions
+		for (size_t i = 0; i < junctionTable.ids.size(); ++i) {
+			wordsB[junctionTable.ids[i]] = calculateJunction(i, wordsB);
+		}
+		std::swap(wordsA, wordsB);
+	}
+}
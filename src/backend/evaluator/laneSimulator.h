@@ -0,0 +1,92 @@
+#ifndef laneSimulator_h
+#define laneSimulator_h
+
+#include "logicWord.h"
+#include "simulatorGates.h"
+
+// Runs 64 independent copies of the circuit of a LogicSimulator at once, copy i lives in lane i of every LogicWord.
+// It is a snapshot made by LogicSimulator::compileLanes and is not changed by edits to the simulator after that.
+// A tick gives the same result as LogicSimulator::tickOnceFull does for every lane.
+class LaneSimulator {
+public:
+	static constexpr unsigned int laneCount = 64;
+
+	void compile(
+		const std::vector<logic_state_t>& statesA,
+		const std::vector<logic_state_t>& statesB,
+		const std::vector<ANDLikeGate>& andGates,
+		const std::vector<XORLikeGate>& xorGates,
+		const std::vector<TristateBufferGate>& tristateBuffers,
+		const std::vector<JunctionGate>& junctions,
+		const std::vector<ConstantResetGate>& constantResetGates,
+		const std::vector<CopySelfOutputGate>& copySelfOutputGates,
+		const std::vector<BufferGate>& buffers,
+		bool realistic
+	);
+	// puts every lane back to the states it was compiled with
+	void reset();
+
+	size_t getStateCount() const { return wordsA.size(); }
+	logic_state_t getState(simulator_id_t id, unsigned int lane) const { return wordsA[id].getLane(lane); }
+	// sets the state in both buffers like LogicSimulator::setState, call doubleTickJunctions once all states are set
+	void setState(simulator_id_t id, unsigned int lane, logic_state_t state) {
+		wordsA[id].setLane(lane, state);
+		wordsB[id].setLane(lane, state);
+	}
+	void doubleTickJunctions();
+	void tick(unsigned int nTicks = 1);
+
+private:
+	enum GateFlags : uint8_t {
+		INPUTS_INVERTED = 1 << 0,
+		OUTPUT_INVERTED = 1 << 1,
+		ENABLE_INVERTED = 1 << 2
+	};
+
+	struct GateTable {
+		std::vector<simulator_id_t> ids;
+		std::vector<uint8_t> flags;
+		std::vector<uint32_t> inputOffsets { 0 }; // inputs of gate i are inputIds[inputOffsets[i], inputOffsets[i + 1])
+		std::vector<uint32_t> enableCounts; // tristate buffers only, the enable inputs are the last inputs of the gate
+		std::vector<simulator_id_t> inputIds;
+
+		void add(simulator_id_t id, uint8_t gateFlags, const std::vector<simulator_id_t>& inputs) {
+			ids.push_back(id);
+			flags.push_back(gateFlags);
+			inputIds.insert(inputIds.end(), inputs.begin(), inputs.end());
+			inputOffsets.push_back(inputIds.size());
+		}
+		uint32_t inputCount(size_t i) const { return inputOffsets[i + 1] - inputOffsets[i]; }
+	};
+
+	LogicWord calculateJunction(size_t junctionIndex, const std::vector<LogicWord>& words) const;
+
+	bool realistic = false;
+	std::vector<logic_state_t> initialStatesA;
+	std::vector<logic_state_t> initialStatesB;
+	std::vector<LogicWord> wordsA;
+	std::vector<LogicWord> wordsB;
+
+	GateTable andTable;
+	GateTable xorTable;
+	GateTable tristateTable;
+	GateTable junctionTable;
+	std::vector<simulator_id_t> constantResetIds;
+	std::vector<logic_state_t> constantResetStates;
+	std::vector<simulator_id_t> copySelfOutputIds;
+
+	// the delay rings of the buffers, buffer i uses history[historyOffsets[i], historyOffsets[i + 1])
+	struct DelayLine {
+		simulator_id_t id;
+		std::optional<simulator_id_t> input;
+		bool outputInverted;
+		uint32_t head;
+	};
+	std::vector<DelayLine> delayLines;
+	std::vector<uint32_t> historyOffsets { 0 };
+	std::vector<logic_state_t> initialHistory;
+	std::vector<uint32_t> initialHeads;
+	std::vector<LogicWord> history;
+};
+
+#endif /* laneSimulator_h */
@@ -0,0 +1,185 @@
+#include "levelizedGates.h"
+
+void LevelizedGates::compile(
+	const std::vector<ANDLikeGate>& andGates,
+	const std::vector<XORLikeGate>& xorGates,
+	const std::vector<TristateBufferGate>& tristateBuffers,
+	const std::vector<JunctionGate>& junctions,
+	const std::vector<ConstantResetGate>& constantResetGates,
+	const std::vector<CopySelfOutputGate>& copySelfOutputGates
+) {
+	struct Node {
+		NodeKind kind;
+		uint8_t flags;
+		simulator_id_t id;
+		std::vector<simulator_id_t> inputs; // data inputs followed by the enable inputs
+		uint32_t dataInputCount;
+	};
+	std::vector<Node> nodes;
+	nodes.reserve(andGates.size() + xorGates.size() + tristateBuffers.size() + junctions.size() + constantResetGates.size() + copySelfOutputGates.size());
+	for (const ANDLikeGate& gate : andGates) {
+		const uint8_t nodeFlags = (gate.inputsInverted ? INPUTS_INVERTED : 0) | (gate.outputInverted ? OUTPUT_INVERTED : 0);
+		nodes.push_back({ NodeKind::AND, nodeFlags, gate.getId(), gate.getInputs(), (uint32_t)gate.getInputs().size() });
+	}
+	for (const XORLikeGate& gate : xorGates) {
+		nodes.push_back({ NodeKind::XOR, (uint8_t)(gate.outputInverted ? OUTPUT_INVERTED : 0), gate.getId(), gate.getInputs(), (uint32_t)gate.getInputs().size() });
+	}
+	for (const TristateBufferGate& gate : tristateBuffers) {
+		std::vector<simulator_id_t> inputs = gate.inputs;
+		inputs.insert(inputs.end(), gate.enableInputs.begin(), gate.enableInputs.end());
+		nodes.push_back({ NodeKind::TRISTATE_BUFFER, (uint8_t)(gate.enableInverted ? ENABLE_INVERTED : 0), gate.getId(), std::move(inputs), (uint32_t)gate.inputs.size() });
+	}
+	for (const JunctionGate& gate : junctions) {
+		nodes.push_back({ NodeKind::JUNCTION, 0, gate.getId(), gate.inputs, (uint32_t)gate.inputs.size() });
+	}
+	for (const ConstantResetGate& gate : constantResetGates) {
+		nodes.push_back({ NodeKind::CONSTANT_RESET, (uint8_t)gate.outputState, gate.getId(), {}, 0 });
+	}
+	for (const CopySelfOutputGate& gate : copySelfOutputGates) {
+		nodes.push_back({ NodeKind::COPY_SELF_OUTPUT, 0, gate.getId(), {}, 0 });
+	}
+	const uint32_t nodeCount = nodes.size();
+
+	// edges go from the node that drives an input to the node that reads it, ids that are not ticked are constant during a tick
+	constexpr uint32_t noNode = std::numeric_limits<uint32_t>::max();
+	simulator_id_t idCount = 0;
+	for (const Node& node : nodes) {
+		idCount = std::max(idCount, node.id + 1);
+		for (simulator_id_t inputId : node.inputs) idCount = std::max(idCount, inputId + 1);
+	}
+	std::vector<uint32_t> nodeOfId(idCount, noNode);
+	for (uint32_t node = 0; node < nodeCount; ++node) nodeOfId[nodes[node].id] = node;
+
+	std::vector<uint32_t> successorOffsets(nodeCount + 1, 0);
+	for (const Node& node : nodes) {
+		for (simulator_id_t inputId : node.inputs) {
+			if (nodeOfId[inputId] != noNode) ++successorOffsets[nodeOfId[inputId] + 1];
+		}
+	}
+	for (uint32_t node = 0; node < nodeCount; ++node) successorOffsets[node + 1] += successorOffsets[node];
+	std::vector<uint32_t> successors(successorOffsets.back());
+	std::vector<bool> selfLoop(nodeCount, false);
+	{
+		std::vector<uint32_t> cursor(successorOffsets.begin(), successorOffsets.end() - 1);
+		for (uint32_t node = 0; node < nodeCount; ++node) {
+			for (simulator_id_t inputId : nodes[node].inputs) {
+				const uint32_t driver = nodeOfId[inputId];
+				if (driver == noNode) continue;
+				successors[cursor[driver]++] = node;
+				if (driver == node) selfLoop[node] = true;
+			}
+		}
+	}
+
+	// Tarjan's strongly connected components without recursion, big circuits would overflow the stack
+	constexpr uint32_t unvisited = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> visitIndex(nodeCount, unvisited);
+	std::vector<uint32_t> lowLink(nodeCount, 0);
+	std::vector<bool> onStack(nodeCount, false);
+	std::vector<uint32_t> componentSize(nodeCount, 0); // per node, the size of its component
+	std::vector<uint32_t> componentStack;
+	std::vector<std::pair<uint32_t, uint32_t>> callStack; // node and its next successor
+	uint32_t nextVisitIndex = 0;
+	auto visit = [&](uint32_t node) {
+		visitIndex[node] = lowLink[node] = nextVisitIndex++;
+		componentStack.push_back(node);
+		onStack[node] = true;
+		callStack.emplace_back(node, successorOffsets[node]);
+	};
+	for (uint32_t root = 0; root < nodeCount; ++root) {
+		if (visitIndex[root] != unvisited) continue;
+		visit(root);
+		while (!callStack.empty()) {
+			const uint32_t node = callStack.back().first;
+			if (callStack.back().second < successorOffsets[node + 1]) {
+				const uint32_t successor = successors[callStack.back().second++];
+				if (visitIndex[successor] == unvisited) {
+					visit(successor);
+				} else if (onStack[successor]) {
+					lowLink[node] = std::min(lowLink[node], visitIndex[successor]);
+				}
+				continue;
+			}
+			if (lowLink[node] == visitIndex[node]) {
+				const size_t componentBegin = std::find(componentStack.rbegin(), componentStack.rend(), node).base() - componentStack.begin() - 1;
+				const uint32_t size = componentStack.size() - componentBegin;
+				for (size_t i = componentBegin; i < componentStack.size(); ++i) {
+					onStack[componentStack[i]] = false;
+					componentSize[componentStack[i]] = size;
+				}
+				componentStack.resize(componentBegin);
+			}
+			callStack.pop_back();
+			if (!callStack.empty()) {
+				const uint32_t caller = callStack.back().first;
+				lowLink[caller] = std::min(lowLink[caller], lowLink[node]);
+			}
+		}
+	}
+
+	// level 0 breaks every loop, the rest is levelized with Kahn's algorithm
+	constexpr uint32_t unleveled = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> level(nodeCount, unleveled);
+	std::vector<uint32_t> pendingInputs(nodeCount, 0);
+	for (uint32_t node = 0; node < nodeCount; ++node) {
+		const NodeKind kind = nodes[node].kind;
+		const bool onLoop = componentSize[node] > 1 || selfLoop[node];
+		if (kind == NodeKind::CONSTANT_RESET || kind == NodeKind::COPY_SELF_OUTPUT || (onLoop && kind != NodeKind::JUNCTION)) {
+			level[node] = 0;
+		}
+	}
+	for (uint32_t node = 0; node < nodeCount; ++node) {
+		if (level[node] == 0) continue;
+		for (uint32_t i = successorOffsets[node]; i < successorOffsets[node + 1]; ++i) {
+			++pendingInputs[successors[i]];
+		}
+	}
+	std::vector<uint32_t> queue;
+	std::vector<uint32_t> reachedLevel(nodeCount, 1);
+	for (uint32_t node = 0; node < nodeCount; ++node) {
+		if (level[node] != 0 && pendingInputs[node] == 0) queue.push_back(node);
+	}
+	uint32_t levelCount = 1;
+	for (size_t queueIndex = 0; queueIndex < queue.size(); ++queueIndex) {
+		const uint32_t node = queue[queueIndex];
+		level[node] = reachedLevel[node];
+		levelCount = std::max(levelCount, level[node] + 1);
+		for (uint32_t i = successorOffsets[node]; i < successorOffsets[node + 1]; ++i) {
+			const uint32_t successor = successors[i];
+			if (level[successor] == 0) continue;
+			reachedLevel[successor] = std::max(reachedLevel[successor], level[node] + 1);
+			if (--pendingInputs[successor] == 0) queue.push_back(successor);
+		}
+	}
+
+	// counting sort by level, the unleveled nodes go last and keep their order
+	levelOffsets.assign(levelCount + 2, 0);
+	for (uint32_t node = 0; node < nodeCount; ++node) {
+		++levelOffsets[(level[node] == unleveled ? levelCount : level[node]) + 1];
+	}
+	for (size_t i = 1; i < levelOffsets.size(); ++i) levelOffsets[i] += levelOffsets[i - 1];
+	std::vector<uint32_t> order(nodeCount);
+	{
+		std::vector<size_t> cursor(levelOffsets.begin(), levelOffsets.end() - 1);
+		for (uint32_t node = 0; node < nodeCount; ++node) {
+			order[cursor[level[node] == unleveled ? levelCount : level[node]]++] = node;
+		}
+	}
+	levelOffsets.pop_back(); // the unleveled nodes are found through levelOffsets.back()
+
+	kinds.clear();
+	flags.clear();
+	ids.clear();
+	inputOffsets.assign(1, 0);
+	enableOffsets.clear();
+	inputIds.clear();
+	for (uint32_t node : order) {
+		const Node& source = nodes[node];
+		kinds.push_back(source.kind);
+		flags.push_back(source.flags);
+		ids.push_back(source.id);
+		enableOffsets.push_back(inputIds.size() + source.dataInputCount);
+		inputIds.insert(inputIds.end(), source.inputs.begin(), source.inputs.end());
+		inputOffsets.push_back(inputIds.size());
+	}
+}
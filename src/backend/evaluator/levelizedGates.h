@@ -0,0 +1,98 @@
+#ifndef levelizedGates_h
+#define levelizedGates_h
+
+#include "simulatorGates.h"
+
+// The ticked gates sorted into levels for the settle mode, rebuilt by LogicSimulator::regenerateJobs after edits.
+// Gates that sit on a feedback loop (and gates without inputs) keep their one tick delay and make up level 0, they read
+// statesA like a normal tick. Every other gate only depends on lower levels, so evaluating the levels in order on statesB
+// settles all logic between the loops within a single tick. Junctions never delay so they are always levelized.
+// Nodes that can not be levelized (loops made only of junctions) are evaluated last in order, like the junction pass.
+class LevelizedGates {
+public:
+	void compile(
+		const std::vector<ANDLikeGate>& andGates,
+		const std::vector<XORLikeGate>& xorGates,
+		const std::vector<TristateBufferGate>& tristateBuffers,
+		const std::vector<JunctionGate>& junctions,
+		const std::vector<ConstantResetGate>& constantResetGates,
+		const std::vector<CopySelfOutputGate>& copySelfOutputGates
+	);
+
+	// nodes of level l are [getLevelBegin(l), getLevelBegin(l + 1)), the unleveled nodes follow the last level
+	size_t getLevelCount() const { return levelOffsets.size() - 1; }
+	size_t getLevelBegin(size_t level) const { return levelOffsets[level]; }
+	size_t getNodeCount() const { return ids.size(); }
+
+	template <bool realistic>
+	inline void tickDelayed(size_t begin, size_t end, const logic_state_t* statesA, logic_state_t* statesB) const noexcept {
+		for (size_t node = begin; node < end; ++node) {
+			const logic_state_t targetState = calculate(node, statesA);
+			if constexpr (realistic) {
+				if (kinds[node] == NodeKind::AND || kinds[node] == NodeKind::XOR || kinds[node] == NodeKind::TRISTATE_BUFFER) {
+					statesB[ids[node]] = SimulatorGate::realisticState(targetState, statesA[ids[node]]);
+					continue;
+				}
+			}
+			statesB[ids[node]] = targetState;
+		}
+	}
+	// zero delay, there is no intermediate state to pass through so the realistic flag does not apply
+	inline void tickSettled(size_t begin, size_t end, logic_state_t* statesB) const noexcept {
+		for (size_t node = begin; node < end; ++node) {
+			statesB[ids[node]] = calculate(node, statesB);
+		}
+	}
+	inline void tickUnleveled(logic_state_t* statesB) const noexcept {
+		tickSettled(levelOffsets.back(), ids.size(), statesB);
+	}
+
+private:
+	enum class NodeKind : uint8_t {
+		AND,
+		XOR,
+		TRISTATE_BUFFER,
+		JUNCTION,
+		CONSTANT_RESET,
+		COPY_SELF_OUTPUT
+	};
+	enum NodeFlags : uint8_t {
+		INPUTS_INVERTED = 1 << 0,
+		OUTPUT_INVERTED = 1 << 1,
+		ENABLE_INVERTED = 1 << 2
+	};
+
+	inline logic_state_t calculate(size_t node, const logic_state_t* states) const noexcept {
+		const simulator_id_t* inputsBegin = inputIds.data() + inputOffsets[node];
+		const simulator_id_t* inputsEnd = inputIds.data() + inputOffsets[node + 1];
+		const uint8_t nodeFlags = flags[node];
+		switch (kinds[node]) {
+		case NodeKind::AND:
+			return ANDLikeGate::calculate(states, inputsBegin, inputsEnd, nodeFlags & INPUTS_INVERTED, nodeFlags & OUTPUT_INVERTED);
+		case NodeKind::XOR:
+			return XORLikeGate::calculate(states, inputsBegin, inputsEnd, nodeFlags & OUTPUT_INVERTED);
+		case NodeKind::TRISTATE_BUFFER: {
+			const simulator_id_t* enableBegin = inputIds.data() + enableOffsets[node];
+			return TristateBufferGate::calculate(states, inputsBegin, enableBegin, enableBegin, inputsEnd, nodeFlags & ENABLE_INVERTED);
+		}
+		case NodeKind::JUNCTION:
+			return JunctionGate::calculate(states, inputsBegin, inputsEnd);
+		case NodeKind::CONSTANT_RESET:
+			return (logic_state_t)nodeFlags; // the flags hold the output state
+		case NodeKind::COPY_SELF_OUTPUT:
+			return states[ids[node]];
+		}
+		return logic_state_t::UNDEFINED;
+	}
+
+	// sorted by level
+	std::vector<NodeKind> kinds;
+	std::vector<uint8_t> flags;
+	std::vector<simulator_id_t> ids;
+	std::vector<uint32_t> inputOffsets { 0 }; // inputs of node i are inputIds[inputOffsets[i], inputOffsets[i + 1])
+	std::vector<uint32_t> enableOffsets; // tristate buffers: the enable inputs start at inputIds[enableOffsets[i]]
+	std::vector<simulator_id_t> inputIds;
+	std::vector<size_t> levelOffsets { 0 };
+};
+
+#endif /* levelizedGates_h */
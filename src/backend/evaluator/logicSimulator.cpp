@@ -1,11 +1,16 @@
 #include "logicSimulator.h"
 #include "gateType.h"
 #include "util/fastMath.h"
+#include "util/algorithm.h"
+#include "wasmTickModule.h"
+
+#include <numeric>
 
 LogicSimulator::LogicSimulator(
 	EvalConfig& evalConfig,
 	std::vector<simulator_id_t>& dirtySimulatorIds) :
 	evalConfig(evalConfig),
+	simulationExecutor(evalConfig.getSimulationExecutor()),
 	dirtySimulatorIds(dirtySimulatorIds) {
 	evalConfig.subscribe([this]() {
 		{
@@ -14,13 +19,22 @@ LogicSimulator::LogicSimulator(
 		}
 		bool shouldSprint = (this->evalConfig.isRunning() && !this->evalConfig.isTickrateLimiterEnabled());
 		this->threadPool.setSprinting(shouldSprint);
+		this->threadPool.setWaitPolicy(this->evalConfig.getWaitPolicy());
 
-		std::lock_guard<std::mutex> lk(cvMutex);
-		cv.notify_all();
+		{
+			std::lock_guard<std::mutex> lk(cvMutex);
+			cv.notify_all();
+		}
+		this->wakeSimulation();
 	});
 
-	simulationThread = std::thread(&LogicSimulator::simulationLoop, this);
 	extendDataVectors(simulatorIdProvider.getNewId()); // reserve the 0th id to be used as an invalid id
+	if (simulationExecutor) {
+		isPaused = true; // paused whenever the executor is not running a slice
+		simulationExecutor->add(this);
+	} else {
+		simulationThread = std::thread(&LogicSimulator::simulationLoop, this);
+	}
 }
 
 LogicSimulator::~LogicSimulator() {
@@ -29,6 +43,7 @@ LogicSimulator::~LogicSimulator() {
 		running = false;
 		cv.notify_all();
 	}
+	if (simulationExecutor) simulationExecutor->remove(this);
 	if (simulationThread.joinable()) {
 		simulationThread.join();
 	}
@@ -102,8 +117,7 @@ void LogicSimulator::simulationLoop() {
 				averageTickrate.store(0.0, std::memory_order_release);
 				std::unique_lock lk(cvMutex);
 				cv.wait(lk, [&] {
-					std::lock_guard<std::mutex> stateLock(stateChangeQueueMutex);
-					return pauseRequest || !running || evalConfig.isRunning() || evalConfig.getSprintCount() > 0 || !pendingStateChanges.empty();
+					return pauseRequest || !running || evalConfig.isRunning() || evalConfig.getSprintCount() > 0 || stateChangeRing.hasPending();
 				});
 				nextTick = clock::now();
 				lastTickTime = clock::now();
@@ -113,6 +127,70 @@ void LogicSimulator::simulationLoop() {
 	}
 }
 
+std::optional<std::chrono::steady_clock::time_point> LogicSimulator::runSlice(std::chrono::nanoseconds sliceLength) {
+	using clock = std::chrono::steady_clock;
+	{
+		std::lock_guard<std::mutex> lk(cvMutex);
+		// the pause guard wakes the simulator again when it is done
+		if (pauseRequest.load(std::memory_order_acquire) || !running) {
+			sliceTimingValid = false;
+			return std::nullopt;
+		}
+		isPaused.store(false, std::memory_order_release);
+	}
+	const auto sliceEnd = clock::now() + sliceLength;
+	if (!sliceTimingValid) {
+		sliceNextTick = clock::now();
+		sliceLastTickTime = clock::now();
+		sliceFirstTick = true;
+		sliceTimingValid = true;
+	}
+
+	// same as one pass of simulationLoop, but it returns instead of waiting
+	std::optional<clock::time_point> readyAt;
+	while (true) {
+		if (!running || pauseRequest.load(std::memory_order_acquire)) {
+			sliceTimingValid = false;
+			break;
+		}
+		processPendingStateChanges();
+
+		auto currentTime = clock::now();
+		if (evalConfig.canConsumeSprintTick()) {
+			tickOnce();
+			evalConfig.consumeSprintTick();
+			updateEmaTickrate(currentTime, sliceLastTickTime, sliceFirstTick);
+		} else if (evalConfig.isRunning()) {
+			double targetTickrate = evalConfig.getTargetTickrate();
+			if (evalConfig.isTickrateLimiterEnabled() && targetTickrate > 0) {
+				if (currentTime < sliceNextTick) {
+					readyAt = sliceNextTick;
+					break;
+				}
+				sliceNextTick += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(1.0 / targetTickrate));
+			}
+			tickOnce();
+			updateEmaTickrate(currentTime, sliceLastTickTime, sliceFirstTick);
+		} else {
+			averageTickrate.store(0.0, std::memory_order_release);
+			sliceTimingValid = false;
+			if (!stateChangeRing.hasPending()) break;
+			continue;
+		}
+		if (clock::now() >= sliceEnd) {
+			readyAt = clock::now();
+			break;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lk(cvMutex);
+		isPaused.store(true, std::memory_order_release);
+		cv.notify_all();
+	}
+	return readyAt;
+}
+
 inline void LogicSimulator::updateEmaTickrate(
 	const std::chrono::steady_clock::time_point& currentTime,
 	std::chrono::steady_clock::time_point& lastTickTime,
@@ -140,70 +218,615 @@ inline void LogicSimulator::updateEmaTickrate(
 }
 
 inline void LogicSimulator::tickOnce() {
+	// the tick boundary where queued state changes take effect
+	processPendingStateChanges();
+	tickCount.fetch_add(1, std::memory_order_release);
+	if (settleActive) {
+		tickOnceSettle();
+		return;
+	}
+	if (nativeTickEnabled) {
+		tickOnceNativeTrial();
+		return;
+	}
+	tickOnceInterpreted();
+}
+
+inline void LogicSimulator::tickOnceInterpreted() {
+	if (bitPlanesActive) {
+		tickOnceBitPlanes();
+		return;
+	}
+	if (evalConfig.isEventDriven()) {
+		tickOnceEventDriven();
+		return;
+	}
+	tickOnceFull();
+}
+
+inline void LogicSimulator::tickOnceFull() {
 	std::unique_lock lkNext(statesBMutex);
 
 	threadPool.resetAndLoad(jobs);
 	threadPool.waitForCompletion(true);
+	sampleRoundTiming();
 
-	for (auto& gate : junctions) gate.tick(statesB);
+	tickJunctionLevels();
 	std::unique_lock lkCurEx(statesAMutex);
 	std::swap(statesA, statesB);
+	pendingSnapshotChanges.everything = true;
+	publishSnapshot();
 }
 
-void LogicSimulator::processPendingStateChanges() {
-	std::queue<StateChange> localQueue;
-	{
-		std::lock_guard<std::mutex> lock(stateChangeQueueMutex);
-		std::swap(localQueue, pendingStateChanges);
+void LogicSimulator::tickJunctionLevels() {
+	for (size_t level = 0; level < compiledGates.getJunctionLevelCount(); ++level) {
+		if (level < junctionJobs.size() && !junctionJobs[level].empty()) {
+			threadPool.resetAndLoad(junctionJobs[level]);
+			threadPool.waitForCompletion(true);
+			continue;
+		}
+		compiledGates.tickJunctionLevel(compiledGates.getJunctionLevelBegin(level), compiledGates.getJunctionLevelBegin(level + 1), statesB.data());
+	}
+}
+
+void LogicSimulator::tickOnceSettle() {
+	std::unique_lock lkNext(statesBMutex);
+
+	// the levels treat the buffer outputs as constant, they get the state of this tick before any level reads them
+	if (settleRealistic) tickBuffers<true>(0, buffers.size());
+	else tickBuffers<false>(0, buffers.size());
+	for (size_t level = 0; level < levelizedGates.getLevelCount(); ++level) {
+		if (!settleJobs[level].empty()) {
+			threadPool.resetAndLoad(settleJobs[level]);
+			threadPool.waitForCompletion(true);
+			continue;
+		}
+		const size_t begin = levelizedGates.getLevelBegin(level);
+		const size_t end = levelizedGates.getLevelBegin(level + 1);
+		if (level != 0) {
+			levelizedGates.tickSettled(begin, end, statesB.data());
+		} else if (settleRealistic) {
+			levelizedGates.tickDelayed<true>(begin, end, statesA.data(), statesB.data());
+		} else {
+			levelizedGates.tickDelayed<false>(begin, end, statesA.data(), statesB.data());
+		}
+	}
+	levelizedGates.tickUnleveled(statesB.data());
+	// the event driven bookkeeping does not follow settle ticks
+	changedIds.clear();
+	eventStateValid = false;
+
+	std::unique_lock lkCurEx(statesAMutex);
+	std::swap(statesA, statesB);
+	pendingSnapshotChanges.everything = true;
+	publishSnapshot();
+}
+
+void LogicSimulator::tickOnceBitPlanes() {
+	std::unique_lock lkNext(statesBMutex);
+
+	threadPool.resetAndLoad(jobs);
+	threadPool.waitForCompletion(true);
+	sampleRoundTiming();
+
+	// the buffers are not part of any batch, their output slots sit behind the batch words that the jobs write
+	const bool isRealistic = evalConfig.isRealistic();
+	for (BufferGate& gate : buffers) {
+		const logic_state_t targetState = gate.shift(gate.getInput().has_value() ? bitPlanes.getState(gate.getInput().value()) : logic_state_t::LOW);
+		bitPlanes.setNextState(gate.getId(), isRealistic ? SimulatorGate::realisticState(targetState, bitPlanes.getState(gate.getId())) : targetState);
 	}
+	bitPlanes.tickJunctions();
+	std::unique_lock lkCurEx(statesAMutex);
+	bitPlanes.swapPlanes();
+	pendingSnapshotChanges.everything = true;
+	publishSnapshot();
+}
 
-	if (!localQueue.empty()) {
+bool LogicSimulator::prepareNativeProgram() {
+	if (nativeProgram) {
+		if (nativeStatesLoaded || nativeProgram->getStateCount() == statesA.size()) return true;
+		// a state change added ids
+		dropNativeProgram();
+		return false;
+	}
+	if (!nativeRequested) {
+		// edits come in bursts, the netlist has to stay the same for a moment before it is worth compiling
+		if (!compiledGatesValid || std::chrono::steady_clock::now() - nativeEditTime < nativeCompileDelay) return false;
+		nativeCompiler.request(WasmTickModule::generate(compiledGates, statesA.size(), nativeRealistic), statesA.size(), nativeRealistic, nativeVersion);
+		nativeRequested = true;
+		return false;
+	}
+	nativeProgram = nativeCompiler.take(nativeVersion);
+	if (!nativeProgram) return false;
+	nativeTickActive.store(true, std::memory_order_release);
+	return prepareNativeProgram();
+}
+
+bool LogicSimulator::compileNativeTicks() {
+	if (!nativeTickEnabled || !compiledGatesValid) return false;
+	if (!nativeProgram) {
+		if (!nativeRequested) {
+			nativeCompiler.request(WasmTickModule::generate(compiledGates, statesA.size(), nativeRealistic), statesA.size(), nativeRealistic, nativeVersion);
+			nativeRequested = true;
+		}
+		// a program that was given up is not requested again
+		if (!nativeCompiler.waitForFinished(nativeCompileTimeout)) return false;
+	}
+	// without interpreted ticks to compare with the trial keeps the program
+	return prepareNativeProgram();
+}
+
+void LogicSimulator::tickOnceNativeTrial() {
+	const bool hasProgram = prepareNativeProgram();
+	if (nativeTrialTicks > nativeTrialTickCount) {
+		if (hasProgram) tickOnceNative();
+		else tickOnceInterpreted();
+		return;
+	}
+	// Straight-line code can be slower than the interpreter, once it no longer fits in the caches or the interpreter has
+	// more threads. So the interpreted ticks are timed while the program compiles and the program has to beat them.
+	const auto start = std::chrono::steady_clock::now();
+	if (hasProgram) tickOnceNative();
+	else tickOnceInterpreted();
+	const double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	if (!hasProgram || !nativeProgram) {
+		nativeInterpretedNanoseconds = nativeInterpretedTicks == 0 ? nanoseconds :
+			nativeInterpretedNanoseconds + timingSmoothing * (nanoseconds - nativeInterpretedNanoseconds);
+		++nativeInterpretedTicks;
+		return;
+	}
+	// the first tick loads the states
+	if (nativeTrialTicks++ == 0) return;
+	nativeTrialNanoseconds += nanoseconds;
+	if (nativeTrialTicks <= nativeTrialTickCount || nativeInterpretedTicks == 0) return;
+	if (nativeTrialNanoseconds / nativeTrialTickCount > nativeInterpretedNanoseconds) {
 		std::scoped_lock lk(statesBMutex, statesAMutex);
-		while (!localQueue.empty()) {
-			const StateChange& change = localQueue.front();
+		giveUpNativeProgram();
+	}
+}
 
-			extendDataVectors(change.id);
+void LogicSimulator::tickOnceNative() {
+	std::unique_lock lkNext(statesBMutex);
+	if (!nativeStatesLoaded) {
+		std::unique_lock lkCurEx(statesAMutex);
+		loadNativeStates();
+	}
 
-			statesA[change.id] = change.state;
-			statesB[change.id] = change.state;
-			localQueue.pop();
+	if (!nativeProgram->tickGates()) {
+		{
+			std::unique_lock lkCurEx(statesAMutex);
+			giveUpNativeProgram();
 		}
-		for (auto& gate : junctions) gate.doubleTick(statesA, statesB);
+		lkNext.unlock();
+		if (evalConfig.isEventDriven()) tickOnceEventDriven();
+		else tickOnceFull();
+		return;
+	}
+	// the buffers keep their delay rings, they write their outputs before the junctions read them
+	const logic_state_t* current = nativeProgram->getStates();
+	logic_state_t* next = nativeProgram->getNextStates();
+	if (nativeRealistic) {
+		for (BufferGate& gate : buffers) gate.realisticTick(current, next);
+	} else {
+		for (BufferGate& gate : buffers) gate.tick(current, next);
+	}
+	bool junctionsTicked = nativeProgram->tickJunctions();
+	// the event driven bookkeeping does not follow native ticks
+	changedIds.clear();
+	eventStateValid = false;
+
+	std::unique_lock lkCurEx(statesAMutex);
+	if (!junctionsTicked) {
+		giveUpNativeProgram();
+		tickJunctionLevels();
+		std::swap(statesA, statesB);
+	} else {
+		nativeProgram->swapStates();
 	}
+	pendingSnapshotChanges.everything = true;
+	publishSnapshot();
 }
 
-void LogicSimulator::setState(simulator_id_t id, logic_state_t st) {
-	// we don't want to freeze up if the mutexes are locked, so we'll only set the state if we can successfully lock. otherwise, we'll wait until the next tick to set the states.
-	std::unique_lock lkB(statesBMutex, std::try_to_lock);
-	std::unique_lock lkA(statesAMutex, std::try_to_lock);
+void LogicSimulator::loadNativeStates() {
+	if (nativeStatesLoaded) return;
+	std::copy(statesA.begin(), statesA.end(), nativeProgram->getStates());
+	std::copy(statesB.begin(), statesB.end(), nativeProgram->getNextStates());
+	nativeStatesLoaded = true;
+}
+
+void LogicSimulator::unloadNativeStates() {
+	if (!nativeStatesLoaded) return;
+	std::copy(nativeProgram->getStates(), nativeProgram->getStates() + statesA.size(), statesA.begin());
+	std::copy(nativeProgram->getNextStates(), nativeProgram->getNextStates() + statesB.size(), statesB.begin());
+	nativeStatesLoaded = false;
+}
+
+void LogicSimulator::dropNativeProgram() {
+	unloadNativeStates();
+	if (nativeProgram) {
+		nativeProgram.reset();
+		nativeTickActive.store(false, std::memory_order_release);
+	}
+	nativeRequested = false;
+	++nativeVersion;
+	nativeEditTime = std::chrono::steady_clock::now();
+	nativeInterpretedTicks = 0;
+	nativeTrialTicks = 0;
+	nativeTrialNanoseconds = 0.0;
+}
+
+void LogicSimulator::giveUpNativeProgram() {
+	dropNativeProgram();
+	// the interpreter keeps the ticks until the next edit
+	nativeRequested = true;
+	nativeTrialTicks = nativeTrialTickCount + 1;
+}
 
-	if (lkB.owns_lock() && lkA.owns_lock()) {
-		if (statesA.size() <= id) {
-			statesA.resize(id + 1, logic_state_t::UNDEFINED);
-			statesB.resize(id + 1, logic_state_t::UNDEFINED);
+void LogicSimulator::publishSnapshot() {
+	if (!stateSnapshots.takeWanted()) {
+		// nobody read since the last publish, the next reader reads under statesAMutex and asks for a frame of the tick after
+		stateSnapshots.invalidate();
+		return;
+	}
+	StateSnapshots::Frame* frame = stateSnapshots.beginPublish();
+	if (frame == nullptr) return; // readers hold every other frame, the changes wait for the next tick
+
+	const uint64_t sequence = stateSnapshots.getPublishCount() + 1;
+	std::swap(snapshotChangeLog[sequence % snapshotChangeLogSize], pendingSnapshotChanges);
+	pendingSnapshotChanges.ids.clear();
+	pendingSnapshotChanges.everything = false;
+
+	bool catchUp = !bitPlanesActive && !frame->bitPlanes && frame->sequence != 0 &&
+		sequence - frame->sequence <= snapshotChangeLogSize && frame->states.size() == statesA.size();
+	for (uint64_t changes = frame->sequence + 1; catchUp && changes <= sequence; ++changes) {
+		catchUp = !snapshotChangeLog[changes % snapshotChangeLogSize].everything;
+	}
+	if (catchUp) {
+		for (uint64_t changes = frame->sequence + 1; changes <= sequence; ++changes) {
+			for (simulator_id_t id : snapshotChangeLog[changes % snapshotChangeLogSize].ids) frame->states[id] = statesA[id];
 		}
-		statesA[id] = st;
-		statesB[id] = st;
-		for (auto& gate : junctions) gate.doubleTick(statesA, statesB);
+	} else if (bitPlanesActive) {
+		frame->value = bitPlanes.getValuePlane();
+		frame->unknown = bitPlanes.getUnknownPlane();
+		if (frame->layoutVersion != bitPlaneLayoutVersion) {
+			frame->slotOfId = bitPlanes.getSlotOfId();
+			frame->layoutVersion = bitPlaneLayoutVersion;
+		}
+	} else if (nativeStatesLoaded) {
+		frame->states.assign(nativeProgram->getStates(), nativeProgram->getStates() + nativeProgram->getStateCount());
 	} else {
-		std::lock_guard<std::mutex> lock(stateChangeQueueMutex);
-		pendingStateChanges.push({ id, st });
-		cv.notify_one();
+		frame->states = statesA;
+	}
+	frame->bitPlanes = bitPlanesActive;
+	stateSnapshots.publish(frame);
+}
+
+void LogicSimulator::packBitPlanes() {
+	bitPlanes.compile(statesA, statesB, andGates, xorGates, tristateBuffers, junctions, constantResetGates, copySelfOutputGates);
+	std::vector<logic_state_t>().swap(statesA);
+	std::vector<logic_state_t>().swap(statesB);
+	bitPlanesActive = true;
+	++bitPlaneLayoutVersion;
+	// logInfo("packed {} states into bit planes ({} kernel)", "LogicSimulator::packBitPlanes", bitPlanes.getStateCount(), BitPlaneSimulator::getKernelName());
+}
+
+void LogicSimulator::unpackBitPlanes() {
+	if (!bitPlanesActive) return;
+	bitPlanes.unpack(statesA, statesB);
+	bitPlanes.clear();
+	bitPlanesActive = false;
+	fanoutTableValid = false;
+}
+
+void LogicSimulator::tickOnceEventDriven() {
+	std::unique_lock lkNext(statesBMutex);
+
+	// statesB only differs from statesA at the changed ids, so syncing those turns statesB into a copy of statesA.
+	// Every gate that is not ticked this round then keeps its state, exactly like it would in a full tick.
+	++eventTick;
+	activeGates.clear();
+	activeJunctions.clear();
+	for (const simulator_id_t id : changedIds) {
+		statesB[id] = statesA[id];
+		if (!eventStateValid || id + 1 >= fanoutOffsets.size()) continue;
+		for (size_t i = fanoutOffsets[id]; i < fanoutOffsets[id + 1]; ++i) {
+			const FanoutEntry& entry = fanoutEntries[i];
+			if (scheduledTick[entry.gateId] == eventTick) continue;
+			if (entry.location.gateType == SimGateType::JUNCTION) {
+				// junctions read the states of this tick so they run after the gates. A junction that changed outside
+				// of a tick (setState or doubleTick from stale inputs) gets resolved again, like the full tick does.
+				if (entry.gateId != id) continue;
+				scheduledTick[entry.gateId] = eventTick;
+				activeJunctions.push_back(entry);
+				continue;
+			}
+			scheduledTick[entry.gateId] = eventTick;
+			activeGates.push_back(entry);
+		}
+	}
+	changedIds.clear();
+
+	size_t tickedGateCount = andGates.size() + xorGates.size() + tristateBuffers.size() + constantResetGates.size();
+	if (!eventStateValid || activeGates.size() * 4 > tickedGateCount) {
+		// most of the circuit is active (or the fanout table was just rebuilt), the parallel full tick is cheaper
+		threadPool.resetAndLoad(jobs);
+		threadPool.waitForCompletion(true);
+		sampleRoundTiming();
+		tickJunctionLevels();
+		for (simulator_id_t id = 0; id < statesB.size(); ++id) {
+			if (statesA[id] != statesB[id]) changedIds.push_back(id);
+		}
+		eventStateValid = true;
+	} else {
+		const bool isRealistic = evalConfig.isRealistic();
+		const logic_state_t* current = statesA.data();
+		logic_state_t* next = statesB.data();
+		for (const FanoutEntry& entry : activeGates) {
+			const size_t gateIndex = entry.location.gateIndex;
+			switch (entry.location.gateType) {
+			case SimGateType::AND:
+				if (isRealistic) compiledGates.tickANDGates<true>(gateIndex, gateIndex + 1, current, next);
+				else compiledGates.tickANDGates<false>(gateIndex, gateIndex + 1, current, next);
+				break;
+			case SimGateType::XOR:
+				if (isRealistic) compiledGates.tickXORGates<true>(gateIndex, gateIndex + 1, current, next);
+				else compiledGates.tickXORGates<false>(gateIndex, gateIndex + 1, current, next);
+				break;
+			case SimGateType::TRISTATE_BUFFER:
+				if (isRealistic) compiledGates.tickTristateBuffers<true>(gateIndex, gateIndex + 1, current, next);
+				else compiledGates.tickTristateBuffers<false>(gateIndex, gateIndex + 1, current, next);
+				break;
+			case SimGateType::CONSTANT_RESET:
+				compiledGates.tickConstantResetGates(gateIndex, gateIndex + 1, next);
+				break;
+			default:
+				break;
+			}
+			if (statesB[entry.gateId] != statesA[entry.gateId]) changedIds.push_back(entry.gateId);
+		}
+		// the delay rings move on every tick, so the buffers are never idle
+		for (BufferGate& gate : buffers) {
+			if (isRealistic) gate.realisticTick(current, next);
+			else gate.tick(current, next);
+			if (statesB[gate.getId()] != statesA[gate.getId()]) changedIds.push_back(gate.getId());
+		}
+		for (const FanoutEntry& entry : activeJunctions) {
+			compiledGates.tickJunctions(entry.location.gateIndex, entry.location.gateIndex + 1, statesB.data());
+			if (statesB[entry.gateId] != statesA[entry.gateId]) changedIds.push_back(entry.gateId);
+		}
+		// changedIds grows while we walk it so junctions that change get their own fanout resolved too
+		for (size_t changedIndex = 0; changedIndex < changedIds.size(); ++changedIndex) {
+			const simulator_id_t id = changedIds[changedIndex];
+			for (size_t i = fanoutOffsets[id]; i < fanoutOffsets[id + 1]; ++i) {
+				const FanoutEntry& entry = fanoutEntries[i];
+				if (entry.location.gateType != SimGateType::JUNCTION || scheduledTick[entry.gateId] == eventTick) continue;
+				scheduledTick[entry.gateId] = eventTick;
+				compiledGates.tickJunctions(entry.location.gateIndex, entry.location.gateIndex + 1, statesB.data());
+				if (statesB[entry.gateId] != statesA[entry.gateId]) changedIds.push_back(entry.gateId);
+			}
+		}
+	}
+
+	std::unique_lock lkCurEx(statesAMutex);
+	std::swap(statesA, statesB);
+	// a frame that missed too many changes gets copied whole anyway
+	if (pendingSnapshotChanges.ids.size() + changedIds.size() > statesA.size() / 4) pendingSnapshotChanges.everything = true;
+	if (!pendingSnapshotChanges.everything) pendingSnapshotChanges.ids.insert(pendingSnapshotChanges.ids.end(), changedIds.begin(), changedIds.end());
+	publishSnapshot();
+}
+
+void LogicSimulator::buildFanoutTable() {
+	eventStateValid = false;
+	fanoutTableValid = evalConfig.isEventDriven();
+	if (!fanoutTableValid) {
+		fanoutOffsets.clear();
+		fanoutEntries.clear();
+		scheduledTick.clear();
+		changedIds.clear();
+		return;
+	}
+	// only the gate types that get ticked in tickOnceFull can be scheduled
+	auto isTicked = [](SimGateType gateType) {
+		return gateType == SimGateType::AND || gateType == SimGateType::XOR || gateType == SimGateType::TRISTATE_BUFFER ||
+			gateType == SimGateType::CONSTANT_RESET || gateType == SimGateType::JUNCTION;
+	};
+	const size_t idCount = statesA.size();
+	fanoutOffsets.assign(idCount + 1, 0);
+	// a gate whose own state changed is rescheduled too (realistic ticks and tick inputs depend on it)
+	for (simulator_id_t gateId = 0; gateId < std::min(idCount, gateLocations.size()); ++gateId) {
+		const GateLocation& location = gateLocations[gateId];
+		if (location.isGate() && isTicked(location.gateType)) ++fanoutOffsets[gateId + 1];
+	}
+	for (simulator_id_t outputId = 0; outputId < std::min(idCount, outputDependencies.size()); ++outputId) {
+		for (const GateDependency& dependency : outputDependencies[outputId]) {
+			const GateLocation* location = findGateLocation(dependency.gateId);
+			if (location && isTicked(location->gateType)) ++fanoutOffsets[outputId + 1];
+		}
+	}
+	for (size_t i = 1; i <= idCount; ++i) fanoutOffsets[i] += fanoutOffsets[i - 1];
+
+	fanoutEntries.resize(fanoutOffsets.back());
+	std::vector<size_t> cursor(fanoutOffsets.begin(), fanoutOffsets.end() - 1);
+	for (simulator_id_t gateId = 0; gateId < std::min(idCount, gateLocations.size()); ++gateId) {
+		const GateLocation& location = gateLocations[gateId];
+		if (location.isGate() && isTicked(location.gateType)) {
+			fanoutEntries[cursor[gateId]++] = { gateId, location };
+		}
+	}
+	for (simulator_id_t outputId = 0; outputId < std::min(idCount, outputDependencies.size()); ++outputId) {
+		for (const GateDependency& dependency : outputDependencies[outputId]) {
+			const GateLocation* location = findGateLocation(dependency.gateId);
+			if (location && isTicked(location->gateType)) {
+				fanoutEntries[cursor[outputId]++] = { dependency.gateId, *location };
+			}
+		}
+	}
+	scheduledTick.assign(idCount, 0);
+	eventTick = 0;
+}
+
+void LogicSimulator::doubleTickJunctions() {
+	if (!evalConfig.isEventDriven()) {
+		for (auto& gate : junctions) gate.doubleTick(statesA, statesB);
+		return;
+	}
+	for (auto& gate : junctions) {
+		const logic_state_t oldState = statesA[gate.getId()];
+		gate.doubleTick(statesA, statesB);
+		if (statesA[gate.getId()] != oldState) changedIds.push_back(gate.getId());
+	}
+}
+
+void LogicSimulator::buildJunctionReaders() {
+	const size_t idCount = statesA.size();
+	junctionReaderOffsets.assign(idCount + 1, 0);
+	for (const JunctionGate& gate : junctions) {
+		for (simulator_id_t input : gate.inputs) {
+			if (input < idCount) ++junctionReaderOffsets[input + 1];
+		}
+	}
+	std::partial_sum(junctionReaderOffsets.begin(), junctionReaderOffsets.end(), junctionReaderOffsets.begin());
+	junctionReaders.resize(junctionReaderOffsets.back());
+	std::vector<uint32_t> cursor(junctionReaderOffsets.begin(), junctionReaderOffsets.end() - 1);
+	for (uint32_t i = 0; i < junctions.size(); ++i) {
+		for (simulator_id_t input : junctions[i].inputs) {
+			if (input < idCount) junctionReaders[cursor[input]++] = i;
+		}
+	}
+	junctionQueued.assign(junctions.size(), 0);
+	junctionReadersValid = true;
+}
+
+void LogicSimulator::resolveJunctionsReading(const simulator_id_t* idsBegin, const simulator_id_t* idsEnd) {
+	if (junctions.empty()) return;
+	if (!junctionReadersValid) buildJunctionReaders();
+
+	// readers with an index below firstIndex already ran in the full pass before the junction they read changed
+	const auto queueReaders = [&](simulator_id_t id, uint32_t firstIndex) {
+		if ((size_t)id + 1 >= junctionReaderOffsets.size()) return;
+		for (uint32_t i = junctionReaderOffsets[id]; i < junctionReaderOffsets[id + 1]; ++i) {
+			const uint32_t reader = junctionReaders[i];
+			if (reader < firstIndex || junctionQueued[reader]) continue;
+			junctionQueued[reader] = 1;
+			junctionResolveHeap.push_back(reader);
+			std::push_heap(junctionResolveHeap.begin(), junctionResolveHeap.end(), std::greater<uint32_t>());
+		}
+	};
+	for (const simulator_id_t* id = idsBegin; id != idsEnd; ++id) queueReaders(*id, 0);
+
+	while (!junctionResolveHeap.empty()) {
+		std::pop_heap(junctionResolveHeap.begin(), junctionResolveHeap.end(), std::greater<uint32_t>());
+		const uint32_t index = junctionResolveHeap.back();
+		junctionResolveHeap.pop_back();
+		junctionQueued[index] = 0;
+
+		// from the current states, the next buffer still holds the gate states of the tick before
+		const JunctionGate& gate = junctions[index];
+		const logic_state_t state = gate.calculate(statesA);
+		const logic_state_t oldState = statesA[gate.getId()];
+		statesA[gate.getId()] = state;
+		statesB[gate.getId()] = state;
+		if (state != oldState) {
+			markChanged(gate.getId());
+			queueReaders(gate.getId(), index + 1);
+		}
+	}
+}
+
+void LogicSimulator::processPendingStateChanges() {
+	if (!stateChangeRing.hasPending()) return;
+	std::scoped_lock lk(statesBMutex, statesAMutex);
+	applyStateChanges({});
+}
+
+void LogicSimulator::applyStateChanges(std::span<const StateChange> changes) {
+	invalidateSnapshot();
+	// the next native tick loads the states again
+	unloadNativeStates();
+	stateChangeIds.clear();
+	const auto apply = [&](const StateChange& change) {
+		if (bitPlanesActive) {
+			if (change.id < bitPlanes.getStateCount()) bitPlanes.setState(change.id, change.state);
+			return;
+		}
+		extendDataVectors(change.id);
+		statesA[change.id] = change.state;
+		statesB[change.id] = change.state;
+		markChanged(change.id);
+		stateChangeIds.push_back(change.id);
+	};
+	// the changes in the ring are older, they go first
+	stateChangeRing.drain(apply);
+	for (const StateChange& change : changes) apply(change);
+	if (bitPlanesActive) {
+		bitPlanes.doubleTickJunctions();
+		return;
+	}
+	resolveJunctionsReading(stateChangeIds.data(), stateChangeIds.data() + stateChangeIds.size());
+}
+
+void LogicSimulator::setStates(std::span<const StateChange> changes) {
+	// a pause guard keeps the simulation thread parked until it is released, so only readers can hold the mutexes and
+	// waiting on them is short. The caller reads its states back right away.
+	if (pauseRequest.load(std::memory_order_acquire) && isPaused.load(std::memory_order_acquire)) {
+		std::scoped_lock lk(statesBMutex, statesAMutex);
+		applyStateChanges(changes);
+		return;
+	}
+	while (!changes.empty()) {
+		// no tick can run, so nothing waits on the mutexes. They can still be taken by another caller or the end of a sprint.
+		if (!canTick()) {
+			std::unique_lock lkB(statesBMutex, std::try_to_lock);
+			std::unique_lock lkA(statesAMutex, std::try_to_lock);
+			if (lkB.owns_lock() && lkA.owns_lock()) {
+				applyStateChanges(changes);
+				return;
+			}
+		}
+		const std::span<const StateChange> batch = changes.first(std::min(changes.size(), StateChangeRing::capacity));
+		if (stateChangeRing.tryPush(batch)) {
+			changes = changes.subspan(batch.size());
+		} else {
+			// full, the next tick makes room
+			wakeSimulation();
+			std::this_thread::yield();
+		}
 	}
+	{
+		// an idle simulation thread checks the ring under cvMutex before it waits
+		std::lock_guard<std::mutex> lk(cvMutex);
+	}
+	cv.notify_one();
+	wakeSimulation();
 }
 
 logic_state_t LogicSimulator::getState(simulator_id_t id) const {
+	if (const StateSnapshots::Reader snapshot = stateSnapshots.read()) return snapshot->getState(id);
 	std::shared_lock lk(statesAMutex);
+	if (bitPlanesActive) return bitPlanes.getState(id);
+	if (nativeStatesLoaded) return nativeProgram->getStates()[id];
 	return statesA[id];
 }
 
 std::vector<logic_state_t> LogicSimulator::getStates(const std::vector<simulator_id_t>& ids) const {
 	std::vector<logic_state_t> result(ids.size());
+	if (const StateSnapshots::Reader snapshot = stateSnapshots.read()) {
+		// every state comes from the same tick
+		for (size_t i = 0; i < ids.size(); ++i) result[i] = snapshot->getState(ids[i]);
+		return result;
+	}
 	std::shared_lock lk(statesAMutex);
+	if (bitPlanesActive) {
+		for (size_t i = 0; i < ids.size(); ++i) {
+			result[i] = ids[i] < bitPlanes.getStateCount() ? bitPlanes.getState(ids[i]) : logic_state_t::UNDEFINED;
+		}
+		return result;
+	}
+	const logic_state_t* states = nativeStatesLoaded ? nativeProgram->getStates() : statesA.data();
 	for (size_t i = 0; i < ids.size(); ++i) {
 		const size_t id = ids[i];
 		if (id < statesA.size()) {
-			result[i] = statesA[id];
+			result[i] = states[id];
 		} else {
 			result[i] = logic_state_t::UNDEFINED;
 		}
@@ -212,6 +835,7 @@ std::vector<logic_state_t> LogicSimulator::getStates(const std::vector<simulator
 }
 
 simulator_id_t LogicSimulator::addGate(const GateType gateType) {
+	markStructureDirty();
 	simulator_id_t simulatorId;
 
 	switch (gateType) {
@@ -312,12 +936,12 @@ simulator_id_t LogicSimulator::addGate(const GateType gateType) {
 		copySelfOutputGates.back().resetState(evalConfig.isRealistic(), statesB);
 		break;
 	case GateType::THROUGH:
-		simulatorId = singleBuffers.size() == 0 ? simulatorIdProvider.getNewId() : simulatorIdProvider.getNewId(singleBuffers.back().getId());
+		simulatorId = buffers.size() == 0 ? simulatorIdProvider.getNewId() : simulatorIdProvider.getNewId(buffers.back().getId());
 		extendDataVectors(simulatorId);
-		singleBuffers.push_back({ simulatorId, false });
-		updateGateLocation(simulatorId, SimGateType::SINGLE_BUFFER, singleBuffers.size() - 1);
-		singleBuffers.back().resetState(evalConfig.isRealistic(), statesA);
-		singleBuffers.back().resetState(evalConfig.isRealistic(), statesB);
+		buffers.push_back({ simulatorId, false });
+		updateGateLocation(simulatorId, SimGateType::BUFFER, buffers.size() - 1);
+		buffers.back().resetState(evalConfig.isRealistic(), statesA);
+		buffers.back().resetState(evalConfig.isRealistic(), statesB);
 		break;
 	case GateType::TICK_INPUT:
 		simulatorId = constantResetGates.size() == 0 ? simulatorIdProvider.getNewId() : simulatorIdProvider.getNewId(constantResetGates.back().getId());
@@ -331,12 +955,14 @@ simulator_id_t LogicSimulator::addGate(const GateType gateType) {
 		logError("Cannot add gate of type NONE", "LogicSimulator::addGate");
 		return 0;
 	}
+	markGateDirty(gateLocations[simulatorId]);
 	return simulatorId;
 }
 
 void LogicSimulator::removeGate(simulator_id_t simulatorId) {
-	auto locationIt = gateLocations.find(simulatorId);
-	if (locationIt == gateLocations.end()) {
+	markStructureDirty();
+	const GateLocation* location = findGateLocation(simulatorId);
+	if (!location) {
 		logError("Cannot remove gate: not found " + std::to_string(simulatorId), "LogicSimulator::removeGate");
 		return;
 	}
@@ -349,14 +975,14 @@ void LogicSimulator::removeGate(simulator_id_t simulatorId) {
 	const auto& outputIds = outputIdsOpt.value();
 
 	for (const auto& outId : outputIds) {
-		auto depIt = outputDependencies.find(outId);
-		if (depIt != outputDependencies.end()) {
-			for (const auto& dependency : depIt->second) {
-				auto depLocIt = gateLocations.find(dependency.gateId);
-				if (depLocIt == gateLocations.end()) continue;
-
-				const auto depType = depLocIt->second.gateType;
-				const auto depIdx = depLocIt->second.gateIndex;
+		if (outId < outputDependencies.size()) {
+			for (const auto& dependency : outputDependencies[outId]) {
+				const GateLocation* depLocation = findGateLocation(dependency.gateId);
+				if (!depLocation) continue;
+
+				const auto depType = depLocation->gateType;
+				const auto depIdx = depLocation->gateIndex;
+				markGateDirty(*depLocation);
 				switch (depType) {
 				case SimGateType::AND:             if (depIdx < andGates.size())             andGates[depIdx].removeIdRefs(outId); break;
 				case SimGateType::XOR:             if (depIdx < xorGates.size())             xorGates[depIdx].removeIdRefs(outId); break;
@@ -369,17 +995,20 @@ void LogicSimulator::removeGate(simulator_id_t simulatorId) {
 				case SimGateType::COPY_SELF_OUTPUT:if (depIdx < copySelfOutputGates.size())  copySelfOutputGates[depIdx].removeIdRefs(outId); break;
 				}
 			}
-			outputDependencies.erase(depIt);
+			outputDependencies[outId] = {};
 		}
 		simulatorIdProvider.releaseId(outId);
 		dirtySimulatorIds.push_back(outId);
 	}
 
-	SimGateType gateType = locationIt->second.gateType;
-	size_t gateIndex = locationIt->second.gateIndex;
+	SimGateType gateType = location->gateType;
+	size_t gateIndex = location->gateIndex;
 
+	// the last gate moves into the hole, both places change
 	auto fixMovedIndex = [&](auto& vec) {
 		const size_t last = vec.size() - 1;
+		markGateDirty(GateLocation(gateType, gateIndex));
+		markGateDirty(GateLocation(gateType, last));
 		if (gateIndex != last) {
 			std::swap(vec[gateIndex], vec[last]);
 			simulator_id_t movedId = vec[gateIndex].getId();
@@ -403,7 +1032,151 @@ void LogicSimulator::removeGate(simulator_id_t simulatorId) {
 	removeGateLocation(simulatorId);
 }
 
+void LogicSimulator::setDelayTicks(simulator_id_t gateId, unsigned int delayTicks, std::span<const logic_state_t> pipeline) {
+	const GateLocation* location = findGateLocation(gateId);
+	if (!location || location->gateType != SimGateType::BUFFER) {
+		logError("Gate {} is not a buffer", "LogicSimulator::setDelayTicks", gateId);
+		return;
+	}
+	if (delayTicks == 0 || (!pipeline.empty() && pipeline.size() != delayTicks)) {
+		logError("A buffer delays by at least one tick and needs a state for every tick of the delay", "LogicSimulator::setDelayTicks");
+		return;
+	}
+	markStructureDirty();
+	BufferGate& gate = buffers[location->gateIndex];
+	if (pipeline.empty()) {
+		// the output holds its state until the input reaches it
+		gate.setExtraDelayTicks(delayTicks - 1, statesA[gateId]);
+		return;
+	}
+	gate.setExtraDelayTicks(delayTicks - 1, logic_state_t::LOW);
+	std::copy(pipeline.begin() + 1, pipeline.end(), gate.history.begin());
+	if (statesA[gateId] != pipeline[0]) markChanged(gateId);
+	statesA[gateId] = pipeline[0];
+	statesB[gateId] = pipeline[0];
+}
+
+std::optional<unsigned int> LogicSimulator::getDelayTicks(simulator_id_t gateId) const {
+	const GateLocation* location = findGateLocation(gateId);
+	if (!location || location->gateType != SimGateType::BUFFER) return std::nullopt;
+	return buffers[location->gateIndex].extraDelayTicks + 1;
+}
+
+std::vector<logic_state_t> LogicSimulator::getDelayPipeline(simulator_id_t gateId) const {
+	const GateLocation* location = findGateLocation(gateId);
+	if (!location || location->gateType != SimGateType::BUFFER) return {};
+	const BufferGate& gate = buffers[location->gateIndex];
+	std::vector<logic_state_t> pipeline;
+	pipeline.reserve(gate.history.size() + 1);
+	pipeline.push_back(statesA[gateId]);
+	for (size_t i = 0; i < gate.history.size(); ++i) {
+		pipeline.push_back(gate.history[(gate.historyHead + i) % gate.history.size()]);
+	}
+	return pipeline;
+}
+
+SimulationState LogicSimulator::getSimulationState(const std::vector<simulator_id_t>& ids) const {
+	SimulationState state;
+	state.tickCount = getTickCount();
+	state.statesA.reserve(ids.size());
+	state.statesB.reserve(ids.size());
+	for (simulator_id_t id : ids) {
+		if (bitPlanesActive) {
+			state.statesA.push_back(bitPlanes.getState(id));
+			state.statesB.push_back(bitPlanes.getNextState(id));
+		} else if (nativeStatesLoaded) {
+			state.statesA.push_back(nativeProgram->getStates()[id]);
+			state.statesB.push_back(nativeProgram->getNextStates()[id]);
+		} else {
+			state.statesA.push_back(statesA[id]);
+			state.statesB.push_back(statesB[id]);
+		}
+		const GateLocation* location = findGateLocation(id);
+		if (!location || location->gateType != SimGateType::BUFFER) continue;
+		const BufferGate& gate = buffers[location->gateIndex];
+		for (size_t i = 0; i < gate.history.size(); ++i) {
+			state.delayHistory.push_back(gate.history[(gate.historyHead + i) % gate.history.size()]);
+		}
+	}
+	return state;
+}
+
+bool LogicSimulator::setSimulationState(const std::vector<simulator_id_t>& ids, const SimulationState& state) {
+	size_t delayHistorySize = 0;
+	for (simulator_id_t id : ids) {
+		const GateLocation* location = findGateLocation(id);
+		if (location && location->gateType == SimGateType::BUFFER) delayHistorySize += buffers[location->gateIndex].history.size();
+	}
+	if (state.statesA.size() != ids.size() || state.statesB.size() != ids.size() || state.delayHistory.size() != delayHistorySize) {
+		logError(
+			"State of {} ids and {} delay ticks does not fit {} ids and {} delay ticks", "LogicSimulator::setSimulationState",
+			state.statesA.size(), state.delayHistory.size(), ids.size(), delayHistorySize
+		);
+		return false;
+	}
+
+	invalidateSnapshot();
+	unpackBitPlanes();
+	unloadNativeStates();
+	// older than the state that replaces them
+	stateChangeRing.drain([](const StateChange&) {});
+	auto history = state.delayHistory.begin();
+	for (size_t i = 0; i < ids.size(); ++i) {
+		const simulator_id_t id = ids[i];
+		extendDataVectors(id);
+		statesA[id] = state.statesA[i];
+		statesB[id] = state.statesB[i];
+		const GateLocation* location = findGateLocation(id);
+		if (!location || location->gateType != SimGateType::BUFFER) continue;
+		BufferGate& gate = buffers[location->gateIndex];
+		std::copy(history, history + gate.history.size(), gate.history.begin());
+		history += gate.history.size();
+		gate.historyHead = 0;
+	}
+	setTickCount(state.tickCount);
+	// the event driven tick finds the ids that differ between the buffers again
+	changedIds.clear();
+	eventStateValid = false;
+	resolveJunctionsReading(ids.data(), ids.data() + ids.size());
+	// packs the bit planes again
+	regenerateJobs();
+	return true;
+}
+
+uint64_t LogicSimulator::getNetlistFingerprint(const std::vector<simulator_id_t>& ids) const {
+	// ids.size() for the ids that are not in ids
+	std::vector<uint64_t> indexOfId(gateLocations.size(), ids.size());
+	for (size_t i = ids.size(); i-- > 0;) {
+		if (ids[i] < indexOfId.size()) indexOfId[ids[i]] = i;
+	}
+
+	uint64_t fingerprint = 0;
+	mixFingerprint(fingerprint, ids.size());
+	std::vector<uint64_t> readers;
+	for (simulator_id_t id : ids) {
+		const GateLocation* location = findGateLocation(id);
+		if (!location) {
+			mixFingerprint(fingerprint, std::numeric_limits<uint64_t>::max());
+			continue;
+		}
+		mixFingerprint(fingerprint, (uint64_t)location->gateType);
+		if (location->gateType == SimGateType::BUFFER) mixFingerprint(fingerprint, buffers[location->gateIndex].extraDelayTicks);
+		// the order of the readers depends on the order of the edits
+		readers.clear();
+		if (id < outputDependencies.size()) {
+			for (const GateDependency& dependency : outputDependencies[id]) {
+				readers.push_back(dependency.gateId < indexOfId.size() ? indexOfId[dependency.gateId] : ids.size());
+			}
+		}
+		std::sort(readers.begin(), readers.end());
+		mixFingerprint(fingerprint, readers.size());
+		for (uint64_t reader : readers) mixFingerprint(fingerprint, reader);
+	}
+	return fingerprint;
+}
+
 void LogicSimulator::makeConnection(simulator_id_t sourceId, connection_port_id_t sourcePort, simulator_id_t destinationId, connection_port_id_t destinationPort) {
+	markStructureDirty();
 	std::optional<simulator_id_t> actualSourceId = getOutputPortId(sourceId, sourcePort);
 
 	if (!actualSourceId.has_value()) {
@@ -415,6 +1188,7 @@ void LogicSimulator::makeConnection(simulator_id_t sourceId, connection_port_id_
 }
 
 void LogicSimulator::removeConnection(simulator_id_t sourceId, connection_port_id_t sourcePort, simulator_id_t destinationId, connection_port_id_t destinationPort) {
+	markStructureDirty();
 	std::optional<simulator_id_t> actualSourceId = getOutputPortId(sourceId, sourcePort);
 	if (!actualSourceId.has_value()) {
 		logError("Cannot resolve actual source ID for disconnection", "LogicSimulator::removeConnection");
@@ -424,15 +1198,181 @@ void LogicSimulator::removeConnection(simulator_id_t sourceId, connection_port_i
 }
 
 void LogicSimulator::endEdit() {
-	for (auto& gate : junctions) gate.doubleTick(statesA, statesB);
+	invalidateSnapshot();
+	unpackBitPlanes();
+	unloadNativeStates();
+	doubleTickJunctions();
+	fanoutTableValid = false;
 	regenerateJobs();
 }
 
+void LogicSimulator::compileLanes(LaneSimulator& laneSimulator) const {
+	const bool realistic = evalConfig.isRealistic();
+	if (bitPlanesActive) {
+		std::vector<logic_state_t> unpackedStatesA;
+		std::vector<logic_state_t> unpackedStatesB;
+		bitPlanes.unpack(unpackedStatesA, unpackedStatesB);
+		laneSimulator.compile(unpackedStatesA, unpackedStatesB, andGates, xorGates, tristateBuffers, junctions, constantResetGates, copySelfOutputGates, buffers, realistic);
+		return;
+	}
+	if (nativeStatesLoaded) {
+		const std::vector<logic_state_t> nativeStatesA(nativeProgram->getStates(), nativeProgram->getStates() + statesA.size());
+		const std::vector<logic_state_t> nativeStatesB(nativeProgram->getNextStates(), nativeProgram->getNextStates() + statesB.size());
+		laneSimulator.compile(nativeStatesA, nativeStatesB, andGates, xorGates, tristateBuffers, junctions, constantResetGates, copySelfOutputGates, buffers, realistic);
+		return;
+	}
+	laneSimulator.compile(statesA, statesB, andGates, xorGates, tristateBuffers, junctions, constantResetGates, copySelfOutputGates, buffers, realistic);
+}
+
+double LogicSimulator::getIdFragmentation() const {
+	if (gateCount == 0) return 0.0;
+	const double idCount = statesA.size();
+	// ids that are not in use plus the average distance between a gate and its inputs, both relative to the id count
+	double distanceSum = 0.0;
+	size_t connectionCount = 0;
+	for (simulator_id_t outputId = 0; outputId < outputDependencies.size(); ++outputId) {
+		for (const GateDependency& dependency : outputDependencies[outputId]) {
+			distanceSum += std::abs((double)outputId - (double)dependency.gateId);
+			++connectionCount;
+		}
+	}
+	const double unusedRatio = 1.0 - (double)gateCount / idCount;
+	const double spread = connectionCount == 0 ? 0.0 : distanceSum / connectionCount / idCount;
+	return unusedRatio + spread;
+}
+
+bool LogicSimulator::shouldRenumberIds() {
+	if (gateCount < minRenumberGateCount) return false;
+	// measuring walks every connection so only do it once a decent part of the circuit was edited
+	if (editsSinceFragmentationCheck < gateCount / 8) return false;
+	editsSinceFragmentationCheck = 0;
+	// some netlists can not be packed tightly, only renumber if things got clearly worse than the last result
+	return getIdFragmentation() > std::max(renumberFragmentationThreshold, 2.0 * fragmentationAfterRenumber);
+}
+
+std::vector<simulator_id_t> LogicSimulator::renumberIds() {
+	// queued changes still use the old ids
+	processPendingStateChanges();
+	markStructureDirty();
+	compiledGates.markAllDirty(); // every gate gets a new id
+	const size_t idCount = statesA.size();
+
+	// undirected adjacency between every gate and its inputs, in CSR form
+	std::vector<size_t> adjacencyOffsets(idCount + 1, 0);
+	for (simulator_id_t outputId = 0; outputId < outputDependencies.size(); ++outputId) {
+		for (const GateDependency& dependency : outputDependencies[outputId]) {
+			++adjacencyOffsets[outputId + 1];
+			++adjacencyOffsets[dependency.gateId + 1];
+		}
+	}
+	for (size_t i = 1; i <= idCount; ++i) adjacencyOffsets[i] += adjacencyOffsets[i - 1];
+	std::vector<simulator_id_t> adjacency(adjacencyOffsets.back());
+	{
+		std::vector<size_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (simulator_id_t outputId = 0; outputId < outputDependencies.size(); ++outputId) {
+			for (const GateDependency& dependency : outputDependencies[outputId]) {
+				adjacency[cursor[outputId]++] = dependency.gateId;
+				adjacency[cursor[dependency.gateId]++] = outputId;
+			}
+		}
+	}
+	auto degree = [&](simulator_id_t id) { return adjacencyOffsets[id + 1] - adjacencyOffsets[id]; };
+
+	// Cuthill-McKee: breadth first from the lowest degree gate of every component, neighbours in order of degree
+	std::vector<simulator_id_t> startOrder;
+	startOrder.reserve(gateCount);
+	for (simulator_id_t gateId = 0; gateId < gateLocations.size(); ++gateId) {
+		if (gateLocations[gateId].isGate()) startOrder.push_back(gateId);
+	}
+	std::sort(startOrder.begin(), startOrder.end(), [&](simulator_id_t a, simulator_id_t b) {
+		return degree(a) != degree(b) ? degree(a) < degree(b) : a < b;
+	});
+	std::vector<bool> visited(idCount, false);
+	std::vector<simulator_id_t> order;
+	order.reserve(startOrder.size());
+	for (simulator_id_t startId : startOrder) {
+		if (visited[startId]) continue;
+		visited[startId] = true;
+		size_t queueIndex = order.size();
+		order.push_back(startId);
+		while (queueIndex < order.size()) {
+			const simulator_id_t id = order[queueIndex++];
+			const size_t firstNeighbour = order.size();
+			for (size_t i = adjacencyOffsets[id]; i < adjacencyOffsets[id + 1]; ++i) {
+				const simulator_id_t neighbour = adjacency[i];
+				if (visited[neighbour] || !findGateLocation(neighbour)) continue;
+				visited[neighbour] = true;
+				order.push_back(neighbour);
+			}
+			std::sort(order.begin() + firstNeighbour, order.end(), [&](simulator_id_t a, simulator_id_t b) {
+				return degree(a) != degree(b) ? degree(a) < degree(b) : a < b;
+			});
+		}
+	}
+	std::reverse(order.begin(), order.end());
+
+	// id 0 stays reserved as the invalid id
+	std::vector<simulator_id_t> newIds(idCount, 0);
+	for (size_t i = 0; i < order.size(); ++i) newIds[order[i]] = i + 1;
+
+	std::vector<logic_state_t> newStatesA(order.size() + 1, logic_state_t::UNDEFINED);
+	std::vector<logic_state_t> newStatesB(order.size() + 1, logic_state_t::UNDEFINED);
+	for (simulator_id_t oldId : order) {
+		newStatesA[newIds[oldId]] = statesA[oldId];
+		newStatesB[newIds[oldId]] = statesB[oldId];
+	}
+	{
+		std::scoped_lock lk(statesBMutex, statesAMutex);
+		statesA.swap(newStatesA);
+		statesB.swap(newStatesB);
+	}
+
+	// gates are stored in id order so the jobs walk the states front to back
+	gateLocations.assign(order.size() + 1, GateLocation());
+	gateCount = 0;
+	auto remapGates = [&](auto& gates, SimGateType gateType) {
+		for (auto& gate : gates) gate.remapIds(newIds);
+		std::sort(gates.begin(), gates.end(), [](const auto& a, const auto& b) { return a.getId() < b.getId(); });
+		for (size_t i = 0; i < gates.size(); ++i) updateGateLocation(gates[i].getId(), gateType, i);
+	};
+	remapGates(andGates, SimGateType::AND);
+	remapGates(xorGates, SimGateType::XOR);
+	remapGates(junctions, SimGateType::JUNCTION);
+	remapGates(buffers, SimGateType::BUFFER);
+	remapGates(singleBuffers, SimGateType::SINGLE_BUFFER);
+	remapGates(tristateBuffers, SimGateType::TRISTATE_BUFFER);
+	remapGates(constantGates, SimGateType::CONSTANT);
+	remapGates(constantResetGates, SimGateType::CONSTANT_RESET);
+	remapGates(copySelfOutputGates, SimGateType::COPY_SELF_OUTPUT);
+
+	std::vector<std::vector<GateDependency>> newOutputDependencies(order.size() + 1);
+	for (simulator_id_t outputId = 0; outputId < outputDependencies.size(); ++outputId) {
+		if (newIds[outputId] == 0) continue;
+		const std::vector<GateDependency>& dependencies = outputDependencies[outputId];
+		std::vector<GateDependency>& newDependencies = newOutputDependencies[newIds[outputId]];
+		newDependencies.reserve(dependencies.size());
+		for (const GateDependency& dependency : dependencies) {
+			if (newIds[dependency.gateId] != 0) newDependencies.emplace_back(newIds[dependency.gateId]);
+		}
+	}
+	outputDependencies.swap(newOutputDependencies);
+
+	changedIds.clear();
+
+	simulatorIdProvider.reset(order.size() + 1);
+	for (simulator_id_t oldId : order) {
+		if (newIds[oldId] != oldId) dirtySimulatorIds.push_back(oldId);
+	}
+	fragmentationAfterRenumber = getIdFragmentation();
+	editsSinceFragmentationCheck = 0;
+	return newIds;
+}
+
 std::optional<simulator_id_t> LogicSimulator::getOutputPortId(simulator_id_t simId, connection_port_id_t portId) const {
-	auto locationIt = gateLocations.find(simId);
-	if (locationIt != gateLocations.end()) {
-		SimGateType gateType = locationIt->second.gateType;
-		size_t gateIndex = locationIt->second.gateIndex;
+	const GateLocation* location = findGateLocation(simId);
+	if (location) {
+		SimGateType gateType = location->gateType;
+		size_t gateIndex = location->gateIndex;
 
 		switch (gateType) {
 		case SimGateType::AND:
@@ -488,10 +1428,11 @@ std::optional<simulator_id_t> LogicSimulator::getOutputPortId(simulator_id_t sim
 
 void LogicSimulator::addInputToGate(simulator_id_t simId, simulator_id_t inputId, connection_port_id_t portId) {
 	dirtySimulatorIds.push_back(inputId);
-	auto locationIt = gateLocations.find(simId);
-	if (locationIt != gateLocations.end()) {
-		SimGateType gateType = locationIt->second.gateType;
-		size_t gateIndex = locationIt->second.gateIndex;
+	const GateLocation* location = findGateLocation(simId);
+	if (location) {
+		SimGateType gateType = location->gateType;
+		size_t gateIndex = location->gateIndex;
+		markGateDirty(*location);
 
 		switch (gateType) {
 		case SimGateType::AND:
@@ -557,10 +1498,11 @@ void LogicSimulator::addInputToGate(simulator_id_t simId, simulator_id_t inputId
 
 void LogicSimulator::removeInputFromGate(simulator_id_t simId, simulator_id_t inputId, connection_port_id_t portId) {
 	dirtySimulatorIds.push_back(inputId);
-	auto locationIt = gateLocations.find(simId);
-	if (locationIt != gateLocations.end()) {
-		SimGateType gateType = locationIt->second.gateType;
-		size_t gateIndex = locationIt->second.gateIndex;
+	const GateLocation* location = findGateLocation(simId);
+	if (location) {
+		SimGateType gateType = location->gateType;
+		size_t gateIndex = location->gateIndex;
+		markGateDirty(*location);
 
 		switch (gateType) {
 		case SimGateType::AND:
@@ -625,11 +1567,11 @@ void LogicSimulator::removeInputFromGate(simulator_id_t simId, simulator_id_t in
 }
 
 std::optional<std::vector<simulator_id_t>> LogicSimulator::getOutputSimIdsFromGate(simulator_id_t simId) const {
-	auto locationIt = gateLocations.find(simId);
-	if (locationIt == gateLocations.end()) return std::nullopt;
+	const GateLocation* location = findGateLocation(simId);
+	if (!location) return std::nullopt;
 
-	SimGateType gateType = locationIt->second.gateType;
-	size_t gateIndex = locationIt->second.gateIndex;
+	SimGateType gateType = location->gateType;
+	size_t gateIndex = location->gateIndex;
 
 	switch (gateType) {
 	case SimGateType::AND:
@@ -664,104 +1606,388 @@ std::optional<std::vector<simulator_id_t>> LogicSimulator::getOutputSimIdsFromGa
 }
 
 void LogicSimulator::updateGateLocation(simulator_id_t gateId, SimGateType gateType, size_t gateIndex) {
+	if (gateLocations.size() <= gateId) gateLocations.resize(gateId + 1);
+	if (!gateLocations[gateId].isGate()) ++gateCount;
 	gateLocations[gateId] = GateLocation(gateType, gateIndex);
 }
 
+void LogicSimulator::markGateDirty(const GateLocation& location) {
+	switch (location.gateType) {
+	case SimGateType::AND:              compiledGates.markDirty(CompiledGates::Table::AND, location.gateIndex); break;
+	case SimGateType::XOR:              compiledGates.markDirty(CompiledGates::Table::XOR, location.gateIndex); break;
+	case SimGateType::JUNCTION:         compiledGates.markDirty(CompiledGates::Table::JUNCTION, location.gateIndex); break;
+	case SimGateType::TRISTATE_BUFFER:  compiledGates.markDirty(CompiledGates::Table::TRISTATE_BUFFER, location.gateIndex); break;
+	case SimGateType::CONSTANT_RESET:   compiledGates.markDirty(CompiledGates::Table::CONSTANT_RESET, location.gateIndex); break;
+	case SimGateType::COPY_SELF_OUTPUT: compiledGates.markDirty(CompiledGates::Table::COPY_SELF_OUTPUT, location.gateIndex); break;
+	// ticked straight from their vectors
+	case SimGateType::BUFFER:
+	case SimGateType::SINGLE_BUFFER:
+	case SimGateType::CONSTANT:
+		break;
+	}
+}
+
 void LogicSimulator::removeGateLocation(simulator_id_t gateId) {
-	gateLocations.erase(gateId);
+	if (gateId < gateLocations.size() && gateLocations[gateId].isGate()) {
+		gateLocations[gateId] = GateLocation();
+		--gateCount;
+	}
 }
 
 void LogicSimulator::addOutputDependency(simulator_id_t outputId, simulator_id_t dependentGateId) {
+	if (outputDependencies.size() <= outputId) outputDependencies.resize(outputId + 1);
 	outputDependencies[outputId].emplace_back(dependentGateId);
 }
 
 void LogicSimulator::removeOutputDependency(simulator_id_t outputId, simulator_id_t dependentGateId) {
-	auto it = outputDependencies.find(outputId);
-	if (it != outputDependencies.end()) {
-		auto& deps = it->second;
-		deps.erase(std::remove(deps.begin(), deps.end(), GateDependency(dependentGateId)), deps.end());
-		if (deps.empty()) {
-			outputDependencies.erase(it);
-		}
-	}
+	if (outputId >= outputDependencies.size()) return;
+	auto& deps = outputDependencies[outputId];
+	// there is an entry for every connection, the gate can read the output more than once
+	auto it = std::find(deps.begin(), deps.end(), GateDependency(dependentGateId));
+	if (it != deps.end()) deps.erase(it);
+	if (deps.empty()) deps = {};
 }
 
 void LogicSimulator::regenerateJobs() {
 	threadPool.waitForCompletion();
-	jobInstructionStorage.clear();
 	bool isRealistic = evalConfig.isRealistic();
 
-	auto makeJI = [&](size_t start, size_t end) -> JobInstruction* {
-		jobInstructionStorage.emplace_back(std::make_unique<JobInstruction>(JobInstruction{ this, start, end }));
-		return jobInstructionStorage.back().get();
-	};
-	std::vector<ThreadPool::Job> allJobs;
-
 	constexpr size_t batch = 256;
 
-	for (size_t i = 0; i < andGates.size(); i += batch) {
-		JobInstruction* ji = makeJI(i, std::min(i + batch, andGates.size()));
-		allJobs.push_back(ThreadPool::Job{ isRealistic ? &LogicSimulator::execANDRealistic : &LogicSimulator::execAND, ji });
+	size_t settleThreadCount = 0;
+	bool keptJobs = false;
+	settleActive = evalConfig.isSettleMode();
+	// the tick workers are borrowed from the executor, the ones that are not used are given back by updateThreadCount
+	threadCountLimit = std::max(evalConfig.getMaxThreadCount(), 1);
+	if (simulationExecutor) threadCountLimit = 1 + simulationExecutor->reserveWorkers(this, threadCountLimit - 1);
+	nativeTickEnabled = !settleActive && evalConfig.isNativeCompiled();
+	// the program is kept over config changes that do not change it
+	if (!nativeTickEnabled || nativeRealistic != isRealistic) dropNativeProgram();
+	nativeRealistic = isRealistic;
+	if (settleActive) {
+		unpackBitPlanes();
+		clearJobs();
+		settleRealistic = isRealistic;
+		settleThreadCount = makeSettleJobs(batch);
+	} else if (evalConfig.isBitPacked() && !nativeTickEnabled) {
+		if (!bitPlanesActive) packBitPlanes();
+		clearJobs();
+		allJobs = bitPlanes.makeJobs(isRealistic, batch / 64, jobCosts);
+	} else {
+		unpackBitPlanes();
+		if (!compiledGatesValid) {
+			compiledGates.update(andGates, xorGates, tristateBuffers, junctions, constantResetGates, copySelfOutputGates);
+			compiledGatesValid = true;
+		}
+		keptJobs = updateCompiledJobs(isRealistic);
 	}
-	for (size_t i = 0; i < xorGates.size(); i += batch) {
-		JobInstruction* ji = makeJI(i, std::min(i + batch, xorGates.size()));
-		allJobs.push_back(ThreadPool::Job{ isRealistic ? &LogicSimulator::execXORRealistic : &LogicSimulator::execXOR, ji });
+	totalJobCost = 0;
+	largestJobCost = 0;
+	for (size_t cost : jobCosts) {
+		totalJobCost += cost;
+		largestJobCost = std::max(largestJobCost, cost);
 	}
-	for (size_t i = 0; i < tristateBuffers.size(); i += batch) {
-		JobInstruction* ji = makeJI(i, std::min(i + batch, tristateBuffers.size()));
-		allJobs.push_back(ThreadPool::Job{ isRealistic ? &LogicSimulator::execTristateRealistic : &LogicSimulator::execTristate, ji });
+	if (threadCountModel.bitPlanes != bitPlanesActive) threadCountModel = ThreadCountModel { .bitPlanes = bitPlanesActive };
+	if (settleActive) {
+		jobs.clear();
+		updateThreadCount(settleThreadCount);
+	} else if (const unsigned int threadCount = pickThreadCount(); !keptJobs || !jobThreadsBalanced(threadCount)) {
+		distributeJobs(threadCount);
+	} else {
+		// the jobs stay on their threads, only the junction levels can have changed
+		distributeJunctionJobs(threadCount);
 	}
-	for (size_t i = 0; i < constantResetGates.size(); i += batch) {
-		JobInstruction* ji = makeJI(i, std::min(i + batch, constantResetGates.size()));
-		allJobs.push_back(ThreadPool::Job{ &LogicSimulator::execConstantReset, ji });
+	// config changes also land here, the fanout table only has to follow edits and the event driven flag
+	if (!bitPlanesActive && evalConfig.isEventDriven() != fanoutTableValid) buildFanoutTable();
+	// logInfo("{} jobs created for the current round", "LogicSimulator::regenerateJobs", jobs.size());
+}
+
+void LogicSimulator::clearJobs() {
+	jobInstructionStorage.clear();
+	allJobs.clear();
+	jobCosts.clear();
+	compiledJobs.clear();
+	compiledJobsValid = false;
+}
+
+bool LogicSimulator::updateCompiledJobs(bool isRealistic) {
+	constexpr size_t chunkSize = CompiledGates::chunkSize;
+	// jobs are cut by the inputs they read instead of the gate count, so a few huge gates do not stall one thread
+	std::array<std::vector<size_t>, (size_t)JobKind::COUNT> chunkCosts;
+	std::array<size_t, (size_t)JobKind::COUNT> gateCounts;
+	size_t totalCost = 0;
+	auto addTable = [&](JobKind kind, CompiledGates::Table table) {
+		gateCounts[(size_t)kind] = compiledGates.getGateCount(table);
+		for (size_t chunk = 0; chunk < compiledGates.getChunkCount(table); ++chunk) {
+			chunkCosts[(size_t)kind].push_back(
+				gateCostOverhead * compiledGates.getChunkGateCount(table, chunk) + compiledGates.getChunkInputCount(table, chunk)
+			);
+			totalCost += chunkCosts[(size_t)kind].back();
+		}
+	};
+	addTable(JobKind::AND, CompiledGates::Table::AND);
+	addTable(JobKind::XOR, CompiledGates::Table::XOR);
+	addTable(JobKind::TRISTATE_BUFFER, CompiledGates::Table::TRISTATE_BUFFER);
+	addTable(JobKind::CONSTANT_RESET, CompiledGates::Table::CONSTANT_RESET);
+	addTable(JobKind::COPY_SELF_OUTPUT, CompiledGates::Table::COPY_SELF_OUTPUT);
+	// the buffers are ticked from their vector, they get chunks of the same size
+	gateCounts[(size_t)JobKind::BUFFER] = buffers.size();
+	for (size_t begin = 0; begin < buffers.size(); begin += chunkSize) {
+		chunkCosts[(size_t)JobKind::BUFFER].push_back((gateCostOverhead + 1) * std::min(chunkSize, buffers.size() - begin));
+		totalCost += chunkCosts[(size_t)JobKind::BUFFER].back();
+	}
+	const size_t maxThreadCount = std::max(evalConfig.getMaxThreadCount(), 1);
+	const size_t targetJobCost = std::max(minJobCost, totalCost / (maxThreadCount * jobsPerThread));
+
+	auto costOf = [&](const CompiledJob& job) {
+		const std::vector<size_t>& costs = chunkCosts[(size_t)job.kind];
+		return std::accumulate(costs.begin() + job.chunkBegin, costs.begin() + job.chunkEnd, size_t(0));
+	};
+	auto gateEnd = [&](const CompiledJob& job) { return std::min(job.chunkEnd * chunkSize, gateCounts[(size_t)job.kind]); };
+
+	// keep the cut while every job stays within a factor of two of the target, the last job of a kind may be smaller
+	bool keepCut = compiledJobsValid && compiledJobsRealistic == isRealistic;
+	std::array<size_t, (size_t)JobKind::COUNT> coveredChunks {};
+	for (size_t i = 0; keepCut && i < compiledJobs.size(); ++i) {
+		CompiledJob& job = compiledJobs[i];
+		const bool lastOfKind = i + 1 == compiledJobs.size() || compiledJobs[i + 1].kind != job.kind;
+		// the last job of a kind grows and shrinks with the gate count
+		if (lastOfKind) job.chunkEnd = chunkCosts[(size_t)job.kind].size();
+		if (job.chunkBegin >= job.chunkEnd) {
+			keepCut = false;
+			break;
+		}
+		const size_t cost = costOf(job);
+		if ((cost > 2 * targetJobCost && job.chunkEnd - job.chunkBegin > 1) || (cost < targetJobCost / 2 && !lastOfKind)) keepCut = false;
+		coveredChunks[(size_t)job.kind] = job.chunkEnd;
 	}
-	for (size_t i = 0; i < copySelfOutputGates.size(); i += batch) {
-		JobInstruction* ji = makeJI(i, std::min(i + batch, copySelfOutputGates.size()));
-		allJobs.push_back(ThreadPool::Job{ &LogicSimulator::execCopySelfOutput, ji });
+	for (size_t kind = 0; keepCut && kind < (size_t)JobKind::COUNT; ++kind) {
+		// a kind that got its first gates has no job yet
+		if (coveredChunks[kind] != chunkCosts[kind].size()) keepCut = false;
 	}
-	unsigned int threadCount = min(allJobs.size(), evalConfig.getMaxThreadCount());
-	if (threadCount == 0 && allJobs.size() != 0) { threadCount = 1; }
+	if (keepCut) {
+		for (size_t i = 0; i < compiledJobs.size(); ++i) {
+			jobCosts[i] = costOf(compiledJobs[i]);
+			// the pool only holds pointers to the instructions, so the threads pick the new range up as well
+			static_cast<JobInstruction*>(allJobs[i].arg)->end = gateEnd(compiledJobs[i]);
+		}
+		return true;
+	}
+
+	clearJobs();
+	const std::array<void (*)(void*), (size_t)JobKind::COUNT> execs {
+		isRealistic ? &LogicSimulator::execANDRealistic : &LogicSimulator::execAND,
+		isRealistic ? &LogicSimulator::execXORRealistic : &LogicSimulator::execXOR,
+		isRealistic ? &LogicSimulator::execTristateRealistic : &LogicSimulator::execTristate,
+		&LogicSimulator::execConstantReset,
+		&LogicSimulator::execCopySelfOutput,
+		isRealistic ? &LogicSimulator::execBufferRealistic : &LogicSimulator::execBuffer,
+	};
+	for (size_t kind = 0; kind < (size_t)JobKind::COUNT; ++kind) {
+		const std::vector<size_t>& costs = chunkCosts[kind];
+		size_t chunkBegin = 0;
+		size_t cost = 0;
+		for (size_t chunk = 0; chunk < costs.size(); ++chunk) {
+			cost += costs[chunk];
+			if (cost < targetJobCost && chunk + 1 != costs.size()) continue;
+			compiledJobs.push_back(CompiledJob { (JobKind)kind, chunkBegin, chunk + 1 });
+			jobInstructionStorage.emplace_back(std::make_unique<JobInstruction>(
+				JobInstruction { this, chunkBegin * chunkSize, gateEnd(compiledJobs.back()) }
+			));
+			allJobs.push_back(ThreadPool::Job { execs[kind], jobInstructionStorage.back().get() });
+			jobCosts.push_back(cost);
+			chunkBegin = chunk + 1;
+			cost = 0;
+		}
+	}
+	compiledJobsValid = true;
+	compiledJobsRealistic = isRealistic;
+	return false;
+}
+
+bool LogicSimulator::jobThreadsBalanced(unsigned int threadCount) const {
+	if (threadCount == 0 || threadCount != jobs.size() || jobThreads.size() != allJobs.size()) return false;
+	std::vector<size_t> threadCosts(threadCount, 0);
+	for (size_t job = 0; job < allJobs.size(); ++job) threadCosts[jobThreads[job]] += jobCosts[job];
+	// a thread can not do better than its largest job, so that one is never counted as imbalance
+	const double idealCost = std::max((double)totalJobCost / threadCount, (double)largestJobCost);
+	return *std::max_element(threadCosts.begin(), threadCosts.end()) <= idealCost * jobThreadImbalance;
+}
+
+void LogicSimulator::distributeJobs(unsigned int threadCount) {
 	jobs.clear();
 	jobs.resize(threadCount);
-	unsigned int threadIndex = 0;
-	while (!allJobs.empty()) {
-		jobs[threadIndex].emplace_back(allJobs.back());
-		allJobs.pop_back();
-		if (++threadIndex >= threadCount) threadIndex = 0;
+	jobThreads.assign(allJobs.size(), 0);
+	// longest job first onto the least loaded thread, every thread then runs its own jobs in memory order
+	std::vector<size_t> jobOrder(allJobs.size());
+	std::iota(jobOrder.begin(), jobOrder.end(), 0);
+	std::stable_sort(jobOrder.begin(), jobOrder.end(), [&](size_t a, size_t b) { return jobCosts[a] > jobCosts[b]; });
+	std::vector<size_t> threadCosts(threadCount, 0);
+	std::vector<std::vector<size_t>> threadJobs(threadCount);
+	for (size_t job : jobOrder) {
+		const size_t threadIndex = std::min_element(threadCosts.begin(), threadCosts.end()) - threadCosts.begin();
+		threadCosts[threadIndex] += jobCosts[job];
+		threadJobs[threadIndex].push_back(job);
+		jobThreads[job] = threadIndex;
+	}
+	for (unsigned int threadIndex = 0; threadIndex < threadCount; ++threadIndex) {
+		std::sort(threadJobs[threadIndex].begin(), threadJobs[threadIndex].end());
+		for (size_t job : threadJobs[threadIndex]) jobs[threadIndex].push_back(allJobs[job]);
+	}
+	distributeJunctionJobs(threadCount);
+}
+
+void LogicSimulator::distributeJunctionJobs(unsigned int threadCount) {
+	junctionJobs.clear();
+	junctionJobInstructions.clear();
+	if (threadCount > 1 && compiledGatesValid && !bitPlanesActive) {
+		junctionJobs.resize(compiledGates.getJunctionLevelCount());
+		for (size_t level = 0; level < compiledGates.getJunctionLevelCount(); ++level) {
+			const size_t begin = compiledGates.getJunctionLevelBegin(level);
+			const size_t end = compiledGates.getJunctionLevelBegin(level + 1);
+			if (end - begin <= junctionBatch) continue;
+			junctionJobs[level].resize(threadCount);
+			size_t threadIndex = 0;
+			for (size_t i = begin; i < end; i += junctionBatch) {
+				junctionJobInstructions.emplace_back(std::make_unique<JobInstruction>(JobInstruction{ this, i, std::min(i + junctionBatch, end) }));
+				junctionJobs[level][threadIndex].push_back(ThreadPool::Job{ &LogicSimulator::execJunctionLevel, junctionJobInstructions.back().get() });
+				if (++threadIndex >= threadCount) threadIndex = 0;
+			}
+		}
 	}
 	updateThreadCount(threadCount);
-	// logInfo("{} jobs created for the current round", "LogicSimulator::regenerateJobs", jobs.size());
+}
+
+double LogicSimulator::predictTickNanoseconds(unsigned int threadCount) const {
+	const double work = threadCountModel.nanosecondsPerCost * totalJobCost;
+	// a thread can not finish before the largest job it runs
+	const double threadWork = std::max(work / threadCount, threadCountModel.nanosecondsPerCost * largestJobCost);
+	return threadCountModel.dispatchNanosecondsPerWorker * (threadCount - 1) + threadWork;
+}
+
+unsigned int LogicSimulator::pickThreadCount() const {
+	const unsigned int maxThreadCount = std::min<size_t>(allJobs.size(), threadCountLimit);
+	if (maxThreadCount <= 1 || !evalConfig.isAutoThreadCount()) return maxThreadCount;
+	unsigned int bestThreadCount = 1;
+	double bestTime = predictTickNanoseconds(1);
+	for (unsigned int threadCount = 2; threadCount <= maxThreadCount; ++threadCount) {
+		const double time = predictTickNanoseconds(threadCount);
+		if (time < bestTime) {
+			bestTime = time;
+			bestThreadCount = threadCount;
+		}
+	}
+	return bestThreadCount;
+}
+
+void LogicSimulator::sampleRoundTiming() {
+	const double busyNanoseconds = threadPool.getLastRoundBusyNanoseconds();
+	if (totalJobCost == 0 || busyNanoseconds == 0) return;
+	ThreadCountModel& model = threadCountModel;
+	model.nanosecondsPerCost += (busyNanoseconds / totalJobCost - model.nanosecondsPerCost) * timingSmoothing;
+	const size_t workerCount = threadPool.threadCount();
+	if (workerCount != 0) {
+		// whatever the round took on top of a perfect split of the work went into handing it out
+		const double roundNanoseconds = threadPool.getLastRoundNanoseconds();
+		const double dispatchNanoseconds = std::max(0.0, roundNanoseconds - busyNanoseconds / (workerCount + 1)) / workerCount;
+		model.dispatchNanosecondsPerWorker += (dispatchNanoseconds - model.dispatchNanosecondsPerWorker) * timingSmoothing;
+	}
+	if (++model.sampledRounds % threadCountRevisitInterval != 0 || !evalConfig.isAutoThreadCount()) return;
+	// between rounds only this thread touches the jobs, so they can be split again right here
+	const unsigned int threadCount = pickThreadCount();
+	if (threadCount != jobs.size() && predictTickNanoseconds(threadCount) < predictTickNanoseconds(jobs.size()) * threadCountSwitchGain) {
+		distributeJobs(threadCount);
+	}
+}
+
+size_t LogicSimulator::makeSettleJobs(size_t batch) {
+	if (!levelizedGatesValid) {
+		levelizedGates.compile(andGates, xorGates, tristateBuffers, junctions, constantResetGates, copySelfOutputGates);
+		levelizedGatesValid = true;
+	}
+	settleJobs.clear();
+	settleJobs.resize(levelizedGates.getLevelCount());
+
+	// every round of the pool needs one job list per thread, so all parallel levels use the same thread count
+	size_t maxJobCount = 0;
+	for (size_t level = 0; level < levelizedGates.getLevelCount(); ++level) {
+		const size_t levelSize = levelizedGates.getLevelBegin(level + 1) - levelizedGates.getLevelBegin(level);
+		maxJobCount = std::max(maxJobCount, (levelSize + batch - 1) / batch);
+	}
+	const size_t threadCount = std::max<size_t>(1, std::min<size_t>(maxJobCount, threadCountLimit));
+	if (threadCount == 1) return threadCount;
+
+	for (size_t level = 0; level < levelizedGates.getLevelCount(); ++level) {
+		const size_t begin = levelizedGates.getLevelBegin(level);
+		const size_t end = levelizedGates.getLevelBegin(level + 1);
+		// handing a small level to the pool costs more than ticking it
+		if (end - begin <= batch) continue;
+		void (*exec)(void*) = &LogicSimulator::execSettleLevel;
+		if (level == 0) exec = settleRealistic ? &LogicSimulator::execSettleDelayedRealistic : &LogicSimulator::execSettleDelayed;
+		settleJobs[level].resize(threadCount);
+		size_t threadIndex = 0;
+		for (size_t i = begin; i < end; i += batch) {
+			jobInstructionStorage.emplace_back(std::make_unique<JobInstruction>(JobInstruction{ this, i, std::min(i + batch, end) }));
+			settleJobs[level][threadIndex].push_back(ThreadPool::Job{ exec, jobInstructionStorage.back().get() });
+			if (++threadIndex >= threadCount) threadIndex = 0;
+		}
+	}
+	return threadCount;
 }
 
 void LogicSimulator::execAND(void* jobInstruction) {
 	auto* ji = static_cast<JobInstruction*>(jobInstruction);
-	for (size_t i = ji->start; i < ji->end; ++i) ji->self->andGates[i].tick(ji->self->statesA, ji->self->statesB);
+	ji->self->compiledGates.tickANDGates<false>(ji->start, ji->end, ji->self->statesA.data(), ji->self->statesB.data());
 }
 void LogicSimulator::execANDRealistic(void* jobInstruction) {
 	auto* ji = static_cast<JobInstruction*>(jobInstruction);
-	for (size_t i = ji->start; i < ji->end; ++i) ji->self->andGates[i].realisticTick(ji->self->statesA, ji->self->statesB);
+	ji->self->compiledGates.tickANDGates<true>(ji->start, ji->end, ji->self->statesA.data(), ji->self->statesB.data());
 }
 void LogicSimulator::execXOR(void* jobInstruction) {
 	auto* ji = static_cast<JobInstruction*>(jobInstruction);
-	for (size_t i = ji->start; i < ji->end; ++i) ji->self->xorGates[i].tick(ji->self->statesA, ji->self->statesB);
+	ji->self->compiledGates.tickXORGates<false>(ji->start, ji->end, ji->self->statesA.data(), ji->self->statesB.data());
 }
 void LogicSimulator::execXORRealistic(void* jobInstruction) {
 	auto* ji = static_cast<JobInstruction*>(jobInstruction);
-	for (size_t i = ji->start; i < ji->end; ++i) ji->self->xorGates[i].realisticTick(ji->self->statesA, ji->self->statesB);
+	ji->self->compiledGates.tickXORGates<true>(ji->start, ji->end, ji->self->statesA.data(), ji->self->statesB.data());
 }
 void LogicSimulator::execTristate(void* jobInstruction) {
 	auto* ji = static_cast<JobInstruction*>(jobInstruction);
-	for (size_t i = ji->start; i < ji->end; ++i) ji->self->tristateBuffers[i].tick(ji->self->statesA, ji->self->statesB);
+	ji->self->compiledGates.tickTristateBuffers<false>(ji->start, ji->end, ji->self->statesA.data(), ji->self->statesB.data());
 }
 void LogicSimulator::execTristateRealistic(void* jobInstruction) {
 	auto* ji = static_cast<JobInstruction*>(jobInstruction);
-	for (size_t i = ji->start; i < ji->end; ++i) ji->self->tristateBuffers[i].realisticTick(ji->self->statesA, ji->self->statesB);
+	ji->self->compiledGates.tickTristateBuffers<true>(ji->start, ji->end, ji->self->statesA.data(), ji->self->statesB.data());
 }
 void LogicSimulator::execConstantReset(void* jobInstruction) {
 	auto* ji = static_cast<JobInstruction*>(jobInstruction);
-	for (size_t i = ji->start; i < ji->end; ++i) ji->self->constantResetGates[i].tick(ji->self->statesB);
+	ji->self->compiledGates.tickConstantResetGates(ji->start, ji->end, ji->self->statesB.data());
 }
 void LogicSimulator::execCopySelfOutput(void* jobInstruction) {
 	auto* ji = static_cast<JobInstruction*>(jobInstruction);
-	for (size_t i = ji->start; i < ji->end; ++i) ji->self->copySelfOutputGates[i].tick(ji->self->statesA, ji->self->statesB);
+	ji->self->compiledGates.tickCopySelfOutputGates(ji->start, ji->end, ji->self->statesA.data(), ji->self->statesB.data());
+}
+void LogicSimulator::execBuffer(void* jobInstruction) {
+	auto* ji = static_cast<JobInstruction*>(jobInstruction);
+	ji->self->tickBuffers<false>(ji->start, ji->end);
+}
+void LogicSimulator::execBufferRealistic(void* jobInstruction) {
+	auto* ji = static_cast<JobInstruction*>(jobInstruction);
+	ji->self->tickBuffers<true>(ji->start, ji->end);
+}
+void LogicSimulator::execSettleDelayed(void* jobInstruction) {
+	auto* ji = static_cast<JobInstruction*>(jobInstruction);
+	ji->self->levelizedGates.tickDelayed<false>(ji->start, ji->end, ji->self->statesA.data(), ji->self->statesB.data());
+}
+void LogicSimulator::execSettleDelayedRealistic(void* jobInstruction) {
+	auto* ji = static_cast<JobInstruction*>(jobInstruction);
+	ji->self->levelizedGates.tickDelayed<true>(ji->start, ji->end, ji->self->statesA.data(), ji->self->statesB.data());
+}
+void LogicSimulator::execJunctionLevel(void* jobInstruction) {
+	auto* ji = static_cast<JobInstruction*>(jobInstruction);
+	ji->self->compiledGates.tickJunctionLevel(ji->start, ji->end, ji->self->statesB.data());
+}
+void LogicSimulator::execSettleLevel(void* jobInstruction) {
+	auto* ji = static_cast<JobInstruction*>(jobInstruction);
+	ji->self->levelizedGates.tickSettled(ji->start, ji->end, ji->self->statesB.data());
 }
\ No newline at end of file
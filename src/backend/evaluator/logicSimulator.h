@@ -2,10 +2,18 @@
 #define logicSimulator_h
 
 #include "simulatorGates.h"
+#include "bitPlaneSimulator.h"
+#include "compiledGates.h"
+#include "laneSimulator.h"
+#include "levelizedGates.h"
 #include "gateType.h"
 #include "idProvider.h"
 #include "evalConfig.h"
 #include "threadPool.h"
+#include "simulationExecutor.h"
+#include "stateSnapshots.h"
+#include "stateChangeRing.h"
+#include "wasmTickProgram.h"
 
 enum class SimGateType : int {
 	AND = 0,
@@ -19,6 +27,15 @@ enum class SimGateType : int {
 	COPY_SELF_OUTPUT = 8
 };
 
+// What a tick reads besides the netlist, for a list of ids, see LogicSimulator::getSimulationState
+struct SimulationState {
+	uint64_t tickCount = 0;
+	std::vector<logic_state_t> statesA; // of every id of the list
+	std::vector<logic_state_t> statesB;
+	// the delay rings of the BUFFER gates of the list in its order, every ring from its oldest entry
+	std::vector<logic_state_t> delayHistory;
+};
+
 class LogicSimulator {
 friend class SimulatorOptimizer;
 friend class SimPauseGuard;
@@ -29,7 +46,34 @@ public:
 	~LogicSimulator();
 	void clearState();
 	double getAverageTickrate() const;
-	void setState(simulator_id_t id, logic_state_t state);
+	std::vector<ThreadPool::WorkerStats> getWorkerStats() const { return threadPool.getWorkerStats(); }
+	// true while the ticks run compiled native code, see EvalConfig::isNativeCompiled
+	bool isNativeTickActive() const { return nativeTickActive.load(std::memory_order_acquire); }
+	// Compiles the native ticks now instead of after nativeCompileDelay and waits for them, so tests do not have to tick
+	// until the background compile is done. Only call it while paused. True when the native ticks took over.
+	bool compileNativeTicks();
+	void resetWorkerStats() { threadPool.resetWorkerStats(); }
+	// the ticks simulated so far, only set it while the simulation is paused
+	uint64_t getTickCount() const { return tickCount.load(std::memory_order_acquire); }
+	void setTickCount(uint64_t count) { tickCount.store(count, std::memory_order_release); }
+	// The states of ids in both buffers and their delay rings, with the tick count and the netlist they decide every later
+	// tick. The ids are usually the ids of the blocks in a fixed order, so the state moves to another numbering of the
+	// same netlist. Only call them while paused. setSimulationState drops the state changes that did not take effect yet,
+	// junctions outside of ids are resolved again. It fails when the state does not fit the delays of the buffers.
+	SimulationState getSimulationState(const std::vector<simulator_id_t>& ids) const;
+	bool setSimulationState(const std::vector<simulator_id_t>& ids, const SimulationState& state);
+	// Changes with the gate types, the delays of the buffers and which of the ids reads which, ids are hashed as their
+	// index in ids so the numbering does not matter. The states are not part of it.
+	uint64_t getNetlistFingerprint(const std::vector<simulator_id_t>& ids) const;
+	void setState(simulator_id_t id, logic_state_t state) {
+		const StateChange change { id, state };
+		setStates(std::span<const StateChange>(&change, 1));
+	}
+	// While the simulation can tick the changes are applied at the start of the next tick, all changes of one call in the
+	// same tick as long as there are at most StateChangeRing::capacity of them, so getState only returns them after that
+	// tick. While a SimPauseGuard is held they are applied right away. When the simulation is stopped they are applied
+	// right away unless a reader holds the states, then the idle simulation thread applies them.
+	void setStates(std::span<const StateChange> changes);
 
 	logic_state_t getState(simulator_id_t id) const;
 	std::vector<logic_state_t> getStates(const std::vector<simulator_id_t>& ids) const;
@@ -39,16 +83,46 @@ public:
 	void removeGate(simulator_id_t gateId);
 	void makeConnection(simulator_id_t sourceId, connection_port_id_t sourcePort, simulator_id_t destinationId, connection_port_id_t destinationPort);
 	void removeConnection(simulator_id_t sourceId, connection_port_id_t sourcePort, simulator_id_t destinationId, connection_port_id_t destinationPort);
+	// The number of ticks a BUFFER gate (GateType::THROUGH) takes to pass its input on, at least 1. pipeline[i] is the
+	// state of the output i ticks from now until the input reaches it, without one the output keeps its current state.
+	void setDelayTicks(simulator_id_t gateId, unsigned int delayTicks, std::span<const logic_state_t> pipeline = {});
+	std::optional<unsigned int> getDelayTicks(simulator_id_t gateId) const;
+	// the states the output of a BUFFER gate gets over the next ticks as setDelayTicks takes them, empty for other gates
+	std::vector<logic_state_t> getDelayPipeline(simulator_id_t gateId) const;
 	void endEdit();
 
+	// Permutes the simulator ids (reverse Cuthill-McKee over the netlist) so gates sit close to their inputs in statesA.
+	// Returns the new id of every old id (0 for ids that are not in use) and pushes the changed old ids to dirtySimulatorIds.
+	std::vector<simulator_id_t> renumberIds();
+	// Cheap to call after every edit, the fragmentation is only measured once enough edits happened.
+	bool shouldRenumberIds();
+	double getIdFragmentation() const;
+
+	// snapshot of the circuit and its current states for running 64 copies of it at once, the simulation has to be paused
+	void compileLanes(LaneSimulator& laneSimulator) const;
+
 	const std::vector<simulator_id_t> getOutputs(simulator_id_t simId);
 
+	// Called by the SimulationExecutor instead of simulationLoop. Ticks for at most about sliceLength and returns when
+	// it wants to run again, nothing means it waits for SimulationExecutor::wake.
+	std::optional<std::chrono::steady_clock::time_point> runSlice(std::chrono::nanoseconds sliceLength);
+
 private:
 	EvalConfig& evalConfig;
+	std::shared_ptr<SimulationExecutor> simulationExecutor; // shared so it outlives every simulator that uses it
 	std::thread simulationThread;
 	std::atomic<bool> running { true };
+	// the tick rate timing of runSlice, it is kept between slices and reset after a pause or idle time
+	std::chrono::steady_clock::time_point sliceNextTick;
+	std::chrono::steady_clock::time_point sliceLastTickTime;
+	bool sliceFirstTick = true;
+	bool sliceTimingValid = false;
+	void wakeSimulation() {
+		if (simulationExecutor) simulationExecutor->wake(this);
+	}
 
 	std::atomic<bool> pauseRequest { false };
+	unsigned int pauseGuardCount = 0; // guarded by cvMutex, the request stays up until the last SimPauseGuard is gone
 	std::atomic<bool> isPaused { false };
 	std::mutex cvMutex;
 	std::condition_variable cv;
@@ -59,12 +133,33 @@ private:
 	mutable std::shared_mutex statesAMutex;
 	std::mutex statesBMutex;
 
-	struct StateChange {
-		simulator_id_t id;
-		logic_state_t state;
+	// A tick after a read publishes statesA while it still holds statesAMutex, getState and getStates read the published
+	// frame and only lock statesAMutex when there is none of the current tick. Ticks nobody read since the last publish
+	// only invalidate the frame, so a simulation without readers never copies the states. Event driven ticks only copy the
+	// ids that changed since the tick the reused frame holds, snapshotChangeLog has the changes of the last publishes.
+	StateSnapshots stateSnapshots;
+	struct SnapshotChanges {
+		std::vector<simulator_id_t> ids;
+		bool everything = true;
 	};
-	std::queue<StateChange> pendingStateChanges;
-	std::mutex stateChangeQueueMutex;
+	static constexpr size_t snapshotChangeLogSize = 2 * StateSnapshots::frameCount;
+	std::array<SnapshotChanges, snapshotChangeLogSize> snapshotChangeLog;
+	SnapshotChanges pendingSnapshotChanges; // since the last publish
+	uint64_t bitPlaneLayoutVersion = 0;
+	void publishSnapshot();
+	// before changing statesA outside of a tick
+	inline void invalidateSnapshot() {
+		stateSnapshots.invalidate();
+		pendingSnapshotChanges.everything = true;
+	}
+
+	StateChangeRing stateChangeRing;
+	std::vector<simulator_id_t> stateChangeIds;
+	bool canTick() const {
+		return !pauseRequest.load(std::memory_order_acquire) && (evalConfig.isRunning() || evalConfig.getSprintCount() > 0);
+	}
+	// needs both state mutexes, applies the changes waiting in stateChangeRing and then changes
+	void applyStateChanges(std::span<const StateChange> changes);
 
 	std::vector<ANDLikeGate> andGates;
 	std::vector<XORLikeGate> xorGates;
@@ -76,6 +171,19 @@ private:
 	std::vector<ConstantResetGate> constantResetGates;
 	std::vector<CopySelfOutputGate> copySelfOutputGates;
 
+	// the buffers are ticked straight from their vector, every one owns the ring of its delay
+	template <bool realistic>
+	inline void tickBuffers(size_t begin, size_t end) noexcept {
+		for (size_t i = begin; i < end; ++i) {
+			if constexpr (realistic) buffers[i].realisticTick(statesA.data(), statesB.data());
+			else buffers[i].tick(statesA.data(), statesB.data());
+		}
+	}
+
+	// what the tick path actually reads, updated from the vectors above in regenerateJobs after an edit
+	CompiledGates compiledGates;
+	bool compiledGatesValid = false;
+
 	struct JobInstruction {
 		LogicSimulator* self;
 		size_t start;
@@ -91,56 +199,12 @@ private:
 	static void execTristateRealistic(void* jobInstruction);
 	static void execConstantReset(void* jobInstruction);
 	static void execCopySelfOutput(void* jobInstruction);
-
-	void tickANDGates(void* jobInstruction) {
-		auto* ji = static_cast<JobInstruction*>(jobInstruction);
-		for (size_t i = ji->start; i < ji->end; ++i) {
-			andGates[i].tick(statesA, statesB);
-		}
-	};
-	void tickXORGates(void* jobInstruction) {
-		auto* ji = static_cast<JobInstruction*>(jobInstruction);
-		for (size_t i = ji->start; i < ji->end; ++i) {
-			xorGates[i].tick(statesA, statesB);
-		}
-	};
-	void tickTristateBuffers(void* jobInstruction) {
-		auto* ji = static_cast<JobInstruction*>(jobInstruction);
-		for (size_t i = ji->start; i < ji->end; ++i) {
-			tristateBuffers[i].tick(statesA, statesB);
-		}
-	};
-	void tickConstantResetGates(void* jobInstruction) {
-		auto* ji = static_cast<JobInstruction*>(jobInstruction);
-		for (size_t i = ji->start; i < ji->end; ++i) {
-			constantResetGates[i].tick(statesB);
-		}
-	}
-	void tickCopySelfOutputGates(void* jobInstruction) {
-		auto* ji = static_cast<JobInstruction*>(jobInstruction);
-		for (size_t i = ji->start; i < ji->end; ++i) {
-			copySelfOutputGates[i].tick(statesA, statesB);
-		}
-	}
-
-	void realisticTickANDGates(void* jobInstruction) {
-		auto* ji = static_cast<JobInstruction*>(jobInstruction);
-		for (size_t i = ji->start; i < ji->end; ++i) {
-			andGates[i].realisticTick(statesA, statesB);
-		}
-	};
-	void realisticTickXORGates(void* jobInstruction) {
-		auto* ji = static_cast<JobInstruction*>(jobInstruction);
-		for (size_t i = ji->start; i < ji->end; ++i) {
-			xorGates[i].realisticTick(statesA, statesB);
-		}
-	};
-	void realisticTickTristateBuffers(void* jobInstruction) {
-		auto* ji = static_cast<JobInstruction*>(jobInstruction);
-		for (size_t i = ji->start; i < ji->end; ++i) {
-			tristateBuffers[i].realisticTick(statesA, statesB);
-		}
-	};
+	static void execBuffer(void* jobInstruction);
+	static void execBufferRealistic(void* jobInstruction);
+	static void execSettleDelayed(void* jobInstruction);
+	static void execSettleDelayedRealistic(void* jobInstruction);
+	static void execSettleLevel(void* jobInstruction);
+	static void execJunctionLevel(void* jobInstruction);
 
 	IdProvider<simulator_id_t> simulatorIdProvider;
 
@@ -156,20 +220,131 @@ private:
 	};
 
 	struct GateLocation {
+		static constexpr uint32_t noGateIndex = std::numeric_limits<uint32_t>::max();
+
 		SimGateType gateType;
-		size_t gateIndex;
+		uint32_t gateIndex; // noGateIndex for ids without a gate
 
-		GateLocation() : gateType(SimGateType::AND), gateIndex(0) {}
+		GateLocation() : gateType(SimGateType::AND), gateIndex(noGateIndex) {}
 		GateLocation(SimGateType type, size_t index) : gateType(type), gateIndex(index) {}
+
+		bool isGate() const { return gateIndex != noGateIndex; }
 	};
 
-	std::unordered_map<simulator_id_t, std::vector<GateDependency>> outputDependencies;
-	std::unordered_map<simulator_id_t, GateLocation> gateLocations;
+	// both indexed by simulator id, ids are handed out densely by simulatorIdProvider
+	std::vector<std::vector<GateDependency>> outputDependencies;
+	std::vector<GateLocation> gateLocations;
+	size_t gateCount = 0;
+	// nullptr when no gate has the id
+	const GateLocation* findGateLocation(simulator_id_t gateId) const {
+		if (gateId >= gateLocations.size() || !gateLocations[gateId].isGate()) return nullptr;
+		return &gateLocations[gateId];
+	}
+	// edits call this for every gate they change, regenerateJobs only compiles the chunks of those gates again
+	void markGateDirty(const GateLocation& location);
+
+	// Event driven evaluation: only gates whose inputs changed in the previous tick are ticked.
+	// The fanout of every simulator id is flattened into CSR form by buildFanoutTable.
+	struct FanoutEntry {
+		simulator_id_t gateId;
+		GateLocation location;
+	};
+	std::vector<size_t> fanoutOffsets;
+	std::vector<FanoutEntry> fanoutEntries;
+	std::vector<simulator_id_t> changedIds; // ids whose state differs between statesA and statesB
+	std::vector<FanoutEntry> activeGates;
+	std::vector<FanoutEntry> activeJunctions;
+	std::vector<uint64_t> scheduledTick;
+	uint64_t eventTick = 0;
+	bool eventStateValid = false;
+	bool fanoutTableValid = false;
 
 	void simulationLoop();
 	inline void tickOnce();
+	inline void tickOnceInterpreted();
+	inline void tickOnceFull();
+	void tickOnceEventDriven();
+	void buildFanoutTable();
+	inline void markChanged(simulator_id_t id) {
+		if (evalConfig.isEventDriven()) changedIds.push_back(id);
+	}
+	void doubleTickJunctions();
 	void processPendingStateChanges();
 
+	// Indices into junctions of the junctions that read an id, in CSR form. setState only re-resolves the junctions that
+	// read the set ids and, when one of them changes, the junctions after it that read it, same as the full pass would.
+	std::vector<uint32_t> junctionReaderOffsets;
+	std::vector<uint32_t> junctionReaders;
+	bool junctionReadersValid = false;
+	std::vector<uint32_t> junctionResolveHeap;
+	std::vector<uint8_t> junctionQueued;
+	void buildJunctionReaders();
+	void resolveJunctionsReading(const simulator_id_t* idsBegin, const simulator_id_t* idsEnd);
+
+	// Bit packed evaluation: while active the bit planes own the state and statesA/statesB are released.
+	// Edits unpack the planes back into statesA first, regenerateJobs packs them again.
+	BitPlaneSimulator bitPlanes;
+	bool bitPlanesActive = false;
+	void tickOnceBitPlanes();
+	void packBitPlanes();
+	void unpackBitPlanes();
+
+	// Settle mode: the levels of levelizedGates are evaluated in order within one tick.
+	// Levels with few gates are ticked on the simulation thread, settleJobs is empty for them.
+	LevelizedGates levelizedGates;
+	bool levelizedGatesValid = false;
+	bool settleActive = false;
+	bool settleRealistic = false;
+	std::vector<std::vector<std::vector<ThreadPool::Job>>> settleJobs;
+	void tickOnceSettle();
+	size_t makeSettleJobs(size_t batch);
+
+	// Native ticks: compiledGates is written out as a WasmTickModule once no edit happened for nativeCompileDelay, it is
+	// compiled by nativeCompiler while the interpreted ticks go on and takes over the ticks when it is ready. While
+	// nativeStatesLoaded the memory of nativeProgram owns the states and statesA/statesB are out of date, like with the
+	// bit planes. Every edit unloads the states and drops the program, the version throws away programs of older netlists.
+	WasmTickCompiler nativeCompiler;
+	std::unique_ptr<WasmTickProgram> nativeProgram;
+	bool nativeTickEnabled = false;
+	bool nativeRealistic = false;
+	bool nativeRequested = false;
+	bool nativeStatesLoaded = false;
+	uint64_t nativeVersion = 0;
+	std::chrono::steady_clock::time_point nativeEditTime;
+	std::atomic<bool> nativeTickActive { false };
+	static constexpr std::chrono::milliseconds nativeCompileDelay { 100 };
+	static constexpr std::chrono::seconds nativeCompileTimeout { 10 }; // for compileNativeTicks
+	// the program is only kept when its first ticks were faster than the interpreted ticks while it compiled
+	double nativeInterpretedNanoseconds = 0.0;
+	size_t nativeInterpretedTicks = 0;
+	double nativeTrialNanoseconds = 0.0;
+	size_t nativeTrialTicks = 0;
+	static constexpr size_t nativeTrialTickCount = 64;
+	bool prepareNativeProgram(); // true when nativeProgram can tick
+	void tickOnceNativeTrial();
+	void tickOnceNative();
+	void giveUpNativeProgram();
+	void loadNativeStates();
+	void unloadNativeStates();
+	void dropNativeProgram();
+
+	// called by every edit before the gate vectors change
+	inline void markStructureDirty() {
+		invalidateSnapshot();
+		unpackBitPlanes();
+		dropNativeProgram();
+		compiledGatesValid = false;
+		levelizedGatesValid = false;
+		fanoutTableValid = false;
+		junctionReadersValid = false;
+		++editsSinceFragmentationCheck;
+	}
+
+	static constexpr size_t minRenumberGateCount = 1 << 15; // smaller circuits fit in cache anyway
+	static constexpr double renumberFragmentationThreshold = 0.1;
+	size_t editsSinceFragmentationCheck = 0;
+	double fragmentationAfterRenumber = 0.0;
+
 	inline void updateEmaTickrate(
 		const std::chrono::steady_clock::time_point& currentTime,
 		std::chrono::steady_clock::time_point& lastTickTime,
@@ -185,15 +360,76 @@ private:
 	void removeOutputDependency(simulator_id_t outputId, simulator_id_t dependentGateId);
 
 	std::atomic<double> averageTickrate { 0.0 };
+	std::atomic<uint64_t> tickCount { 0 };
 	double tickrateHalflife { 0.3 };
 
 	std::vector<simulator_id_t>& dirtySimulatorIds;
 
 	ThreadPool threadPool;
 	std::vector<std::vector<ThreadPool::Job>> jobs;
+	std::vector<ThreadPool::Job> allJobs; // the jobs of one round before they are split over the threads
+	std::vector<size_t> jobCosts; // the number of inputs a job reads, used to balance the threads
+	size_t totalJobCost = 0;
+	size_t largestJobCost = 0;
+	static constexpr size_t gateCostOverhead = 2; // cost of a gate on top of its inputs
+	static constexpr size_t minJobCost = 768; // about 256 two input gates, smaller jobs cost more to hand out than to run
+	static constexpr size_t jobsPerThread = 4; // spare jobs per thread so the threads have something to steal
 	std::vector<std::unique_ptr<JobInstruction>> jobInstructionStorage;
+	std::vector<unsigned int> jobThreads; // the thread every job of allJobs was given by distributeJobs
+
+	// Jobs of the compiled gates cover whole chunks of one kind of gate, compiledJobs[i] holds the chunks of allJobs[i].
+	// An edit only changes the cost of the jobs over the chunks it touched, so the cut and the thread of every job are kept
+	// until a job drifts too far from the target cost or the threads get too uneven.
+	enum class JobKind : uint8_t {
+		AND,
+		XOR,
+		TRISTATE_BUFFER,
+		CONSTANT_RESET,
+		COPY_SELF_OUTPUT,
+		BUFFER,
+		COUNT
+	};
+	struct CompiledJob {
+		JobKind kind;
+		size_t chunkBegin;
+		size_t chunkEnd;
+	};
+	std::vector<CompiledJob> compiledJobs;
+	bool compiledJobsValid = false; // false while allJobs holds settle or bit plane jobs
+	bool compiledJobsRealistic = false;
+	static constexpr double jobThreadImbalance = 1.25; // busiest thread over the average before the jobs are spread again
 
 	void regenerateJobs();
+	void clearJobs();
+	bool updateCompiledJobs(bool isRealistic); // false when the jobs were cut again and have to be distributed
+	bool jobThreadsBalanced(unsigned int threadCount) const;
+	void distributeJobs(unsigned int threadCount);
+
+	// Junction levels of compiledGates with more than junctionBatch junctions go through the pool, junctionJobs is empty
+	// for the others. Rebuilt by distributeJunctionJobs after every edit, since every round needs one job list per thread.
+	std::vector<std::vector<std::vector<ThreadPool::Job>>> junctionJobs;
+	std::vector<std::unique_ptr<JobInstruction>> junctionJobInstructions;
+	static constexpr size_t junctionBatch = 1024;
+	void distributeJunctionJobs(unsigned int threadCount);
+	void tickJunctionLevels();
+
+	// Picks the thread count with the highest tick rate for small circuits, where handing out a round costs more than
+	// running it. A tick on t threads is modeled as dispatch * (t - 1) + work / t, both are measured from the rounds that ran.
+	struct ThreadCountModel {
+		double nanosecondsPerCost = defaultNanosecondsPerCost; // one thread running one unit of job cost
+		double dispatchNanosecondsPerWorker = defaultDispatchNanoseconds; // waking a worker and waiting for it
+		bool bitPlanes = false; // job costs of the bit planes are counted per lane, the measurements do not carry over
+		size_t sampledRounds = 0;
+	};
+	static constexpr double defaultNanosecondsPerCost = 1.0;
+	static constexpr double defaultDispatchNanoseconds = 2000.0;
+	static constexpr double timingSmoothing = 1.0 / 16.0;
+	static constexpr size_t threadCountRevisitInterval = 1024; // rounds between checks while running
+	static constexpr double threadCountSwitchGain = 0.9; // only switch for a predicted tick time below 90%
+	ThreadCountModel threadCountModel;
+	double predictTickNanoseconds(unsigned int threadCount) const;
+	unsigned int pickThreadCount() const;
+	void sampleRoundTiming();
 
 	void extendDataVectors(simulator_id_t id) {
 		if (statesA.size() <= id) {
@@ -202,17 +438,21 @@ private:
 		}
 	}
 
+	size_t threadCountLimit = 1; // the thread count the executor lent, set by regenerateJobs
 	void updateThreadCount(size_t threadCount) {
 		threadCount = std::max(threadCount, size_t(1));
+		if (simulationExecutor) simulationExecutor->reserveWorkers(this, threadCount - 1);
 		threadPool.resizeThreads(threadCount - 1);
 	}
 };
 
 class SimPauseGuard {
 public:
+	// guards nest, an edit transaction keeps the simulation paused while the edits inside it take their own guards
 	explicit SimPauseGuard(LogicSimulator& s) : sim(s) {
 		{
 			std::lock_guard<std::mutex> lk(sim.cvMutex);
+			++sim.pauseGuardCount;
 			sim.pauseRequest.store(true, std::memory_order_release);
 			sim.cv.notify_all();
 		}
@@ -220,12 +460,16 @@ public:
 		std::unique_lock<std::mutex> lk(sim.cvMutex);
 		sim.cv.wait(lk, [&]{ return sim.isPaused.load(std::memory_order_acquire); });
 	}
+	SimPauseGuard(const SimPauseGuard&) = delete;
+	SimPauseGuard& operator=(const SimPauseGuard&) = delete;
 	~SimPauseGuard() {
 		{
 			std::lock_guard<std::mutex> lk(sim.cvMutex);
+			if (--sim.pauseGuardCount != 0) return;
 			sim.pauseRequest.store(false, std::memory_order_release);
 			sim.cv.notify_all();
 		}
+		sim.wakeSimulation();
 	}
 
 private:
@@ -0,0 +1,108 @@
+#ifndef logicWord_h
+#define logicWord_h
+
+#include "logicState.h"
+
+// 64 logic states packed into two words, lane i is bit i of both words. The value word holds bit 0 of the
+// logic_state_t and the unknown word holds bit 1 (LOW = 00, HIGH = 01, FLOATING = 10, UNDEFINED = 11).
+// The gate functions give the same results as the SimulatorGate calculate functions for every lane.
+// getInput(k) returns the word of input k.
+struct LogicWord {
+	uint64_t value = 0;
+	uint64_t unknown = 0;
+
+	static constexpr uint64_t allBits(bool set) { return set ? ~uint64_t(0) : uint64_t(0); }
+
+	static constexpr LogicWord broadcast(logic_state_t state) {
+		return { allBits((unsigned char)state & 1), allBits((unsigned char)state & 2) };
+	}
+	inline logic_state_t getLane(unsigned int lane) const {
+		return (logic_state_t)(((value >> lane) & 1) | (((unknown >> lane) & 1) << 1));
+	}
+	inline void setLane(unsigned int lane, logic_state_t state) {
+		const uint64_t bit = uint64_t(1) << lane;
+		value = ((unsigned char)state & 1) ? (value | bit) : (value & ~bit);
+		unknown = ((unsigned char)state & 2) ? (unknown | bit) : (unknown & ~bit);
+	}
+
+	template <class GetInput>
+	static inline LogicWord andLike(uint32_t inputCount, bool inputsInverted, bool outputInverted, GetInput&& getInput) {
+		if (inputCount == 0) return {}; // LOW
+		uint64_t decisive = 0;
+		uint64_t anyUnknown = 0;
+		const uint64_t desired = allBits(inputsInverted);
+		for (uint32_t input = 0; input < inputCount; ++input) {
+			const LogicWord word = getInput(input);
+			decisive |= ~word.unknown & ~(word.value ^ desired);
+			anyUnknown |= word.unknown;
+		}
+		const uint64_t inverted = allBits(outputInverted);
+		return { (decisive & inverted) | (~decisive & (anyUnknown | ~inverted)), ~decisive & anyUnknown };
+	}
+
+	template <class GetInput>
+	static inline LogicWord xorLike(uint32_t inputCount, bool outputInverted, GetInput&& getInput) {
+		if (inputCount == 0) return {}; // LOW
+		uint64_t parity = allBits(outputInverted);
+		uint64_t anyUnknown = 0;
+		for (uint32_t input = 0; input < inputCount; ++input) {
+			const LogicWord word = getInput(input);
+			parity ^= word.value;
+			anyUnknown |= word.unknown;
+		}
+		return { anyUnknown | parity, anyUnknown };
+	}
+
+	// the enable inputs follow the data inputs
+	template <class GetInput>
+	static inline LogicWord tristate(uint32_t inputCount, uint32_t enableCount, bool enableInverted, GetInput&& getInput) {
+		const Drivers enable = collectDrivers(inputCount, inputCount + enableCount, getInput);
+		Drivers data = collectDrivers(0, inputCount, getInput);
+		data.undefined |= allBits(inputCount == 0) | (data.high & data.low);
+		const uint64_t goofy = enable.undefined | ~(enable.high ^ enable.low);
+		const uint64_t disabled = ~goofy & ~(enable.high ^ allBits(enableInverted));
+		const uint64_t undefined = goofy | (~disabled & data.undefined);
+		const uint64_t floating = ~undefined & (disabled | (~data.high & ~data.low));
+		return { undefined | (~floating & data.high), undefined | floating };
+	}
+
+	template <class GetInput>
+	static inline LogicWord junction(uint32_t inputCount, GetInput&& getInput) {
+		const Drivers drivers = collectDrivers(0, inputCount, getInput);
+		const uint64_t undefined = drivers.undefined | (drivers.high & drivers.low);
+		const uint64_t floating = ~undefined & ~drivers.high & ~drivers.low;
+		return { undefined | drivers.high, undefined | floating };
+	}
+
+	// same as SimulatorGate::realisticState: UNDEFINED takes the target, a change passes through UNDEFINED first
+	static inline LogicWord realistic(LogicWord target, LogicWord current) {
+		const uint64_t currentUndefined = current.value & current.unknown;
+		const uint64_t changed = (target.value ^ current.value) | (target.unknown ^ current.unknown);
+		return {
+			(currentUndefined & target.value) | (~currentUndefined & (changed | current.value)),
+			(currentUndefined & target.unknown) | (~currentUndefined & (changed | current.unknown))
+		};
+	}
+
+	bool operator==(const LogicWord& other) const = default;
+
+private:
+	struct Drivers {
+		uint64_t undefined = 0;
+		uint64_t high = 0;
+		uint64_t low = 0;
+	};
+	template <class GetInput>
+	static inline Drivers collectDrivers(uint32_t begin, uint32_t end, GetInput& getInput) {
+		Drivers drivers;
+		for (uint32_t input = begin; input < end; ++input) {
+			const LogicWord word = getInput(input);
+			drivers.undefined |= word.unknown & word.value;
+			drivers.high |= ~word.unknown & word.value;
+			drivers.low |= ~word.unknown & ~word.value;
+		}
+		return drivers;
+	}
+};
+
+#endif /* logicWord_h */
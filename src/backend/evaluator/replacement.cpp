@@ -7,17 +7,22 @@ void Replacement::revert(SimPauseGuard& pauseGuard) {
 	}
 	isReverting = true;
 	isEmpty = true;
+	std::vector<logic_state_t> delayedStates;
+	if (!delayChainIds.empty()) {
+		delayedStates = simulatorOptimizer->getDelayPipeline(delayBufferId);
+	}
+	replacer->untrackReplacement(*this);
 	for (const auto& conn : addedConnections) {
-		replacer->pingOutputs(pauseGuard, conn.source.gateId);
-		replacer->pingInputs(pauseGuard, conn.destination.gateId);
+		replacer->pingOutputs(pauseGuard, conn.source.gateId, this);
+		replacer->pingInputs(pauseGuard, conn.destination.gateId, this);
 	}
 	for (const auto& conn : deletedConnections) {
-		replacer->pingOutputs(pauseGuard, conn.source.gateId);
-		replacer->pingInputs(pauseGuard, conn.destination.gateId);
+		replacer->pingOutputs(pauseGuard, conn.source.gateId, this);
+		replacer->pingInputs(pauseGuard, conn.destination.gateId, this);
 	}
 	for (const auto& conn : addedGates) {
-		replacer->pingOutputs(pauseGuard, conn.id);
-		replacer->pingInputs(pauseGuard, conn.id);
+		replacer->pingOutputs(pauseGuard, conn.id, this);
+		replacer->pingInputs(pauseGuard, conn.id, this);
 	}
 	for (const auto& conn : addedConnections) {
 		simulatorOptimizer->removeConnection(pauseGuard, conn);
@@ -27,12 +32,17 @@ void Replacement::revert(SimPauseGuard& pauseGuard) {
 	}
 	for (const auto& gate : deletedGates) {
 		simulatorOptimizer->addGate(pauseGuard, gate.type, gate.id);
+		replacer->markEdited(gate.id);
 		replacedConnectionPoints->erase(gate.id);
 		replacedIds->erase(gate.id);
 	}
 	for (const auto& conn : deletedConnections) {
 		simulatorOptimizer->makeConnection(pauseGuard, conn);
 	}
+	// the last gate of the chain has the state of the buffer output, the ones before it are further ahead
+	for (size_t i = 0; i < delayedStates.size() && i < delayChainIds.size(); ++i) {
+		simulatorOptimizer->setState(EvalConnectionPoint(delayChainIds[delayChainIds.size() - 1 - i], 0), delayedStates[i]);
+	}
 	for (const auto& id : reservedIds) {
 		middleIdProvider->releaseId(id);
 		replacementIds->erase(id);
@@ -44,5 +54,6 @@ void Replacement::revert(SimPauseGuard& pauseGuard) {
 	reservedIds.clear();
 	idsToTrackInputs.clear();
 	idsToTrackOutputs.clear();
+	delayChainIds.clear();
 	isReverting = false;
 }
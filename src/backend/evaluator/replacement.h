@@ -18,14 +18,16 @@ public:
 		IdProvider<middle_id_t>* middleIdProvider,
 		std::unordered_map<middle_id_t, middle_id_t>* replacedIds,
 		std::unordered_map<middle_id_t, std::unordered_map<connection_port_id_t, EvalConnectionPoint>>* replacedConnectionPoints,
-		std::unordered_set<middle_id_t>* replacementIds
+		std::unordered_set<middle_id_t>* replacementIds,
+		uint64_t order
 	) :
 		replacer(replacer),
 		simulatorOptimizer(optimizer),
 		middleIdProvider(middleIdProvider),
 		replacedIds(replacedIds),
 		replacedConnectionPoints(replacedConnectionPoints),
-		replacementIds(replacementIds) {}
+		replacementIds(replacementIds),
+		order(order) {}
 
 	void removeGate(SimPauseGuard& pauseGuard, middle_id_t gateId, std::unordered_map<connection_port_id_t, EvalConnectionPoint> replacementConnectionPoints) {
 		isEmpty = false;
@@ -65,7 +67,6 @@ public:
 		idsToTrackOutputs.insert(gateId);
 		replacedIds->insert({ gateId, replacementId });
 		simulatorOptimizer->removeGate(pauseGuard, gateId);
-		replacementIds->insert(replacementId);
 	}
 
 	void addGate(SimPauseGuard& pauseGuard, GateType gateType, middle_id_t gateId) {
@@ -73,6 +74,7 @@ public:
 		simulatorOptimizer->addGate(pauseGuard, gateType, gateId);
 		// we don't need to track, because nothing can happen to this gate
 		addedGates.push_back({ gateId, gateType });
+		replacementIds->insert(gateId);
 	}
 
 	void removeConnection(SimPauseGuard& pauseGuard, EvalConnection connection) {
@@ -111,6 +113,11 @@ public:
 		}
 	}
 
+	// replacements made later have a higher order
+	uint64_t getOrder() const {
+		return order;
+	}
+
 	bool getIsEmpty() const {
 		return isEmpty;
 	}
@@ -121,12 +128,28 @@ public:
 		return newId;
 	}
 
+	const std::set<middle_id_t>& getIdsToTrackOutputs() const {
+		return idsToTrackOutputs;
+	}
+	const std::set<middle_id_t>& getIdsToTrackInputs() const {
+		return idsToTrackInputs;
+	}
+
 	void trackOutput(middle_id_t id) {
 		idsToTrackOutputs.insert(id);
 	}
 	void trackInput(middle_id_t id) {
 		idsToTrackInputs.insert(id);
 	}
+	// the gates in order that the buffer delays for, a revert gives them the states that are on their way through it
+	void setDelayChain(middle_id_t bufferId, std::vector<middle_id_t> chainIds) {
+		delayBufferId = bufferId;
+		delayChainIds = std::move(chainIds);
+	}
+	std::optional<middle_id_t> getDelayBufferId() const {
+		if (delayChainIds.empty()) return std::nullopt;
+		return delayBufferId;
+	}
 
 private:
 	Replacer* replacer;
@@ -135,6 +158,7 @@ private:
 	std::unordered_map<middle_id_t, middle_id_t>* replacedIds;
 	std::unordered_map<middle_id_t, std::unordered_map<connection_port_id_t, EvalConnectionPoint>>* replacedConnectionPoints;
 	std::unordered_set<middle_id_t>* replacementIds;
+	uint64_t order;
 	std::vector<ReplacementGate> addedGates;
 	std::vector<ReplacementGate> deletedGates;
 	std::vector<EvalConnection> addedConnections;
@@ -142,6 +166,8 @@ private:
 	std::vector<middle_id_t> reservedIds;
 	std::set<middle_id_t> idsToTrackOutputs;
 	std::set<middle_id_t> idsToTrackInputs;
+	middle_id_t delayBufferId { 0 };
+	std::vector<middle_id_t> delayChainIds;
 	bool isEmpty { true };
 	bool isReverting { false };
 };
@@ -1,47 +1,162 @@
 #include "replacer.h"
 
+void Replacer::removeGate(SimPauseGuard& pauseGuard, const middle_id_t gateId) {
+    pingOutputs(pauseGuard, gateId);
+    pingInputs(pauseGuard, gateId);
+    // The gate takes its connections with it, its neighbours lose them like the connections were removed. A revert can
+    // give the gate connections back, so the neighbours are pinged until no new ones show up.
+    std::unordered_set<middle_id_t> pingedSources;
+    std::unordered_set<middle_id_t> pingedDestinations;
+    bool pinged = true;
+    while (pinged) {
+        pinged = false;
+        std::vector<EvalConnection> inputs = simulatorOptimizer.getInputs(gateId);
+        for (const auto& input : inputs) {
+            if (pingedSources.insert(input.source.gateId).second) {
+                pingOutputs(pauseGuard, input.source.gateId);
+                pinged = true;
+            }
+        }
+        std::vector<EvalConnection> outputs = simulatorOptimizer.getOutputs(gateId);
+        for (const auto& output : outputs) {
+            if (pingedDestinations.insert(output.destination.gateId).second) {
+                pingInputs(pauseGuard, output.destination.gateId);
+                pinged = true;
+            }
+        }
+    }
+    simulatorOptimizer.removeGate(pauseGuard, gateId);
+}
+
 Replacement& Replacer::makeReplacement() {
-    replacements.push_back(Replacement(
+    std::unique_ptr<Replacement> replacement = std::make_unique<Replacement>(
         this,
         &simulatorOptimizer,
         &middleIdProvider,
         &replacedIds,
         &replacedConnectionPoints,
-        &replacementIds
-    ));
-    return replacements.back();
+        &replacementIds,
+        replacementCount++
+    );
+    Replacement& result = *replacement;
+    replacements.emplace(&result, std::move(replacement));
+    return result;
+}
+
+void Replacer::trackReplacement(Replacement& replacement) {
+    for (const middle_id_t id : replacement.getIdsToTrackInputs()) {
+        replacementsTrackingInputs[id].push_back(&replacement);
+    }
+    for (const middle_id_t id : replacement.getIdsToTrackOutputs()) {
+        replacementsTrackingOutputs[id].push_back(&replacement);
+    }
+}
+
+void Replacer::untrackReplacement(const Replacement& replacement) {
+    auto untrack = [&](std::unordered_map<middle_id_t, std::vector<Replacement*>>& tracking, middle_id_t id) {
+        auto iter = tracking.find(id);
+        if (iter == tracking.end()) {
+            return;
+        }
+        std::erase(iter->second, &replacement);
+        if (iter->second.empty()) {
+            tracking.erase(iter);
+        }
+    };
+    for (const middle_id_t id : replacement.getIdsToTrackInputs()) {
+        untrack(replacementsTrackingInputs, id);
+    }
+    for (const middle_id_t id : replacement.getIdsToTrackOutputs()) {
+        untrack(replacementsTrackingOutputs, id);
+    }
+    optimizationReplacements.erase(&replacement);
+    functionalReplacements.erase(&replacement);
+    revertedReplacements.push_back(&replacement);
 }
 
 void Replacer::cleanReplacements() {
-    for (auto it = replacements.begin(); it != replacements.end();) {
-        if (it->getIsEmpty()) {
-            it = replacements.erase(it);
-        } else {
-            ++it;
+    for (const Replacement* replacement : revertedReplacements) {
+        replacements.erase(replacement);
+    }
+    revertedReplacements.clear();
+}
+
+void Replacer::pingOutputs(SimPauseGuard& pauseGuard, middle_id_t id, const Replacement* reverting) {
+    markEdited(id);
+    auto iter = replacementsTrackingOutputs.find(id);
+    if (iter == replacementsTrackingOutputs.end()) {
+        return;
+    }
+    // reverting untracks the replacement, so go over a copy
+    std::vector<Replacement*> tracking = iter->second;
+    for (Replacement* replacement : tracking) {
+        if (reverting != nullptr && replacement->getOrder() <= reverting->getOrder()) {
+            continue;
         }
+        replacement->pingOutput(pauseGuard, id);
     }
 }
 
-void Replacer::pingOutputs(SimPauseGuard& pauseGuard, middle_id_t id) {
-    for (auto& replacement : replacements) {
-        replacement.pingOutput(pauseGuard, id);
+void Replacer::pingInputs(SimPauseGuard& pauseGuard, middle_id_t id, const Replacement* reverting) {
+    markEdited(id);
+    auto iter = replacementsTrackingInputs.find(id);
+    if (iter == replacementsTrackingInputs.end()) {
+        return;
+    }
+    std::vector<Replacement*> tracking = iter->second;
+    for (Replacement* replacement : tracking) {
+        if (reverting != nullptr && replacement->getOrder() <= reverting->getOrder()) {
+            continue;
+        }
+        replacement->pingInput(pauseGuard, id);
     }
 }
 
-void Replacer::pingInputs(SimPauseGuard& pauseGuard, middle_id_t id) {
-    for (auto& replacement : replacements) {
-        replacement.pingInput(pauseGuard, id);
+void Replacer::revertReplacements(SimPauseGuard& pauseGuard, std::unordered_set<const Replacement*>& toRevert) {
+    while (!toRevert.empty()) {
+        const Replacement* oldest = *std::min_element(
+            toRevert.begin(), toRevert.end(),
+            [](const Replacement* a, const Replacement* b) { return a->getOrder() < b->getOrder(); }
+        );
+        replacements.at(oldest)->revert(pauseGuard);
     }
 }
 
-EvalConnectionPoint Replacer::getReplacementConnectionPoint(EvalConnectionPoint point) const {
-    if (replacedIds.contains(point.gateId)) {
-        return EvalConnectionPoint(replacedIds.at(point.gateId), point.portId);
+void Replacer::updateGateOptimization(SimPauseGuard& pauseGuard) {
+    if (!evalConfig.isGateOptimization()) {
+        revertReplacements(pauseGuard, optimizationReplacements);
+    }
+    if (!evalConfig.isFunctionalOptimization()) {
+        revertReplacements(pauseGuard, functionalReplacements);
+    }
+    if (!evalConfig.isGateOptimization() && !evalConfig.isFunctionalOptimization()) {
+        return;
+    }
+    for (middle_id_t id = 0; id < middleIdProvider.getLastId(); ++id) {
+        if (middleIdProvider.isIdUsed(id) && isLogicGate(id)) {
+            markEdited(id);
+        }
     }
-    if (replacedConnectionPoints.contains(point.gateId) && replacedConnectionPoints.at(point.gateId).contains(point.portId)) {
-        return replacedConnectionPoints.at(point.gateId).at(point.portId);
+}
+
+EvalConnectionPoint Replacer::getReplacementConnectionPoint(EvalConnectionPoint point) const {
+    // a replacement can remove the gate an earlier replacement points to, so follow the points until a gate is left
+    while (true) {
+        auto replacedId = replacedIds.find(point.gateId);
+        if (replacedId != replacedIds.end()) {
+            point = EvalConnectionPoint(replacedId->second, point.portId);
+            continue;
+        }
+        auto replacedPoints = replacedConnectionPoints.find(point.gateId);
+        if (replacedPoints == replacedConnectionPoints.end()) {
+            return point;
+        }
+        auto replacedPoint = replacedPoints->second.find(point.portId);
+        if (replacedPoint == replacedPoints->second.end()) {
+            return point;
+        }
+        point = replacedPoint->second;
     }
-    return point;
 }
 
 std::vector<EvalConnectionPoint> Replacer::getReplacementConnectionPoints(const std::vector<EvalConnectionPoint>& points) const {
@@ -67,51 +182,76 @@ std::vector<std::optional<EvalConnectionPoint>> Replacer::getReplacementConnecti
 }
 
 void Replacer::mergeJunctions(SimPauseGuard& pauseGuard) {
-    std::vector<middle_id_t> allMiddleIds = middleIdProvider.getUsedIds();
-    for (const middle_id_t id : allMiddleIds) {
-        if (replacementIds.contains(id)) {
-            continue;
+    // a network that no edit touched was already merged (or had nothing to merge) at the last endEdit
+    std::vector<middle_id_t> junctionIds;
+    auto addJunction = [&](middle_id_t id) {
+        if (simulatorOptimizer.getGateType(id) == GateType::JUNCTION && !replacementIds.contains(id)) {
+            junctionIds.push_back(id);
+        }
+    };
+    for (const middle_id_t id : editedIds) {
+        addJunction(id);
+        for (const auto& input : simulatorOptimizer.getInputs(id)) {
+            addJunction(input.source.gateId);
+        }
+        for (const auto& output : simulatorOptimizer.getOutputs(id)) {
+            addJunction(output.destination.gateId);
         }
-        // check if we're a junction
-        GateType gateType = simulatorOptimizer.getGateType(id);
-        if (gateType != GateType::JUNCTION) {
+    }
+    std::sort(junctionIds.begin(), junctionIds.end());
+    junctionIds.erase(std::unique(junctionIds.begin(), junctionIds.end()), junctionIds.end());
+    std::unordered_set<middle_id_t> floodedIds;
+    for (const middle_id_t id : junctionIds) {
+        // merged networks are gone, networks without an output going into them stay and are only flooded once
+        if (floodedIds.contains(id) || simulatorOptimizer.getGateType(id) != GateType::JUNCTION) {
             continue;
         }
         JunctionFloodFillResult floodFillResult = junctionFloodFill(id);
-
+        floodedIds.insert(floodFillResult.junctionIds.begin(), floodFillResult.junctionIds.end());
         if (floodFillResult.outputsGoingIntoJunctions.size() == 0) {
             continue;
         }
+        mergeJunctionNetwork(pauseGuard, floodFillResult);
+    }
+}
 
-        Replacement& replacement = makeReplacement();
-        if (floodFillResult.outputsGoingIntoJunctions.size() == 1) {
-            EvalConnectionPoint output = floodFillResult.outputsGoingIntoJunctions.at(0);
-            for (const auto& junctionId : floodFillResult.junctionIds) {
-                replacement.removeGate(pauseGuard, junctionId, { {0, output }, {1, output } });
-            }
-            for (const auto& input : floodFillResult.inputsPullingFromJunctions) {
-                replacement.makeConnection(pauseGuard, EvalConnection(output, input.destination));
-            }
-            replacement.trackOutput(output.gateId);
-        } else {
-            middle_id_t newJunctionId = replacement.getNewId();
-            replacement.addGate(pauseGuard, GateType::JUNCTION, newJunctionId);
-            for (const auto& junctionId : floodFillResult.junctionIds) {
-                replacement.removeGate(pauseGuard, junctionId, newJunctionId);
-            }
-            for (const auto& input : floodFillResult.inputsPullingFromJunctions) {
-                replacement.makeConnection(pauseGuard, EvalConnection(EvalConnectionPoint(newJunctionId, 0), input.destination));
-            }
-            for (const auto& output : floodFillResult.outputsGoingIntoJunctions) {
-                replacement.makeConnection(pauseGuard, EvalConnection(output, EvalConnectionPoint(newJunctionId, 0)));
-            }
-            for (const auto& conn : floodFillResult.connectionsToReroute) {
-                EvalConnection newConnection = EvalConnection(EvalConnectionPoint(newJunctionId, 0), conn.destination);
-                replacement.removeConnection(pauseGuard, conn);
-                replacement.makeConnection(pauseGuard, newConnection);
-            }
+void Replacer::mergeJunctionNetwork(SimPauseGuard& pauseGuard, const JunctionFloodFillResult& floodFillResult) {
+    Replacement& replacement = makeReplacement();
+    if (floodFillResult.outputsGoingIntoJunctions.size() == 1) {
+        EvalConnectionPoint output = floodFillResult.outputsGoingIntoJunctions.at(0);
+        for (const auto& junctionId : floodFillResult.junctionIds) {
+            replacement.removeGate(pauseGuard, junctionId, { {0, output }, {1, output } });
+        }
+        for (const auto& input : floodFillResult.inputsPullingFromJunctions) {
+            replacement.makeConnection(pauseGuard, EvalConnection(output, input.destination));
+        }
+        replacement.trackOutput(output.gateId);
+    } else {
+        middle_id_t newJunctionId = replacement.getNewId();
+        replacement.addGate(pauseGuard, GateType::JUNCTION, newJunctionId);
+        for (const auto& junctionId : floodFillResult.junctionIds) {
+            replacement.removeGate(pauseGuard, junctionId, newJunctionId);
+        }
+        for (const auto& input : floodFillResult.inputsPullingFromJunctions) {
+            replacement.makeConnection(pauseGuard, EvalConnection(EvalConnectionPoint(newJunctionId, 0), input.destination));
+        }
+        for (const auto& output : floodFillResult.outputsGoingIntoJunctions) {
+            replacement.makeConnection(pauseGuard, EvalConnection(output, EvalConnectionPoint(newJunctionId, 0)));
+        }
+        for (const auto& conn : floodFillResult.connectionsToReroute) {
+            EvalConnection newConnection = EvalConnection(EvalConnectionPoint(newJunctionId, 0), conn.destination);
+            replacement.removeConnection(pauseGuard, conn);
+            replacement.makeConnection(pauseGuard, newConnection);
         }
     }
+    trackReplacement(replacement);
+    // gates that read the junctions now read the output directly, which can line up buffers into a chain
+    for (const auto& output : floodFillResult.outputsGoingIntoJunctions) {
+        markEdited(output.gateId);
+    }
+    for (const auto& input : floodFillResult.inputsPullingFromJunctions) {
+        markEdited(input.destination.gateId);
+    }
 }
 
 Replacer::JunctionFloodFillResult Replacer::junctionFloodFill(middle_id_t junctionId) {
@@ -125,8 +265,8 @@ Replacer::JunctionFloodFillResult Replacer::junctionFloodFill(middle_id_t juncti
         middle_id_t currentId = queue.front();
         queue.pop();
         result.junctionIds.push_back(currentId);
-        std::vector<EvalConnection> outputs = simulatorOptimizer.getOutputs(currentId);
-        std::vector<EvalConnection> inputs = simulatorOptimizer.getInputs(currentId);
+        const std::vector<EvalConnection>& outputs = simulatorOptimizer.getOutputs(currentId);
+        const std::vector<EvalConnection>& inputs = simulatorOptimizer.getInputs(currentId);
         for (const auto& output : outputs) {
             if (visited.contains(output.destination.gateId)) {
                 continue;
@@ -155,7 +295,7 @@ Replacer::JunctionFloodFillResult Replacer::junctionFloodFill(middle_id_t juncti
             }
             visitedOutputs.insert(input.source);
             result.outputsGoingIntoJunctions.push_back(input.source);
-            std::vector<EvalConnection> nodeOutputs = simulatorOptimizer.getOutputs(input.source.gateId);
+            const std::vector<EvalConnection>& nodeOutputs = simulatorOptimizer.getOutputs(input.source.gateId);
             for (const auto& nodeOutput : nodeOutputs) {
                 if (nodeOutput.source.portId != input.source.portId) {
                     continue; // only consider outputs from the same port
@@ -174,4 +314,497 @@ Replacer::JunctionFloodFillResult Replacer::junctionFloodFill(middle_id_t juncti
         }
     }
     return result;
-}
\ No newline at end of file
+}
+
+bool Replacer::isLogicGate(middle_id_t id) const {
+    if (replacementIds.contains(id)) {
+        return false;
+    }
+    switch (simulatorOptimizer.getGateType(id)) {
+    case GateType::AND:
+    case GateType::OR:
+    case GateType::NAND:
+    case GateType::NOR:
+    case GateType::XOR:
+    case GateType::XNOR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::optional<logic_state_t> Replacer::getConstantState(middle_id_t id) const {
+    switch (simulatorOptimizer.getGateType(id)) {
+    case GateType::CONSTANT_OFF: return logic_state_t::LOW;
+    case GateType::CONSTANT_ON: return logic_state_t::HIGH;
+    default: return std::nullopt;
+    }
+}
+
+std::optional<logic_state_t> Replacer::getFoldedState(middle_id_t id) const {
+    const GateType gateType = simulatorOptimizer.getGateType(id);
+    const std::vector<EvalConnection>& inputs = simulatorOptimizer.getInputs(id);
+    // a gate without inputs is ticked to LOW
+    if (inputs.empty()) {
+        return logic_state_t::LOW;
+    }
+    if (gateType == GateType::XOR || gateType == GateType::XNOR) {
+        bool parity = gateType == GateType::XNOR;
+        for (const auto& input : inputs) {
+            std::optional<logic_state_t> state = getConstantState(input.source.gateId);
+            if (!state.has_value()) {
+                return std::nullopt;
+            }
+            parity ^= state.value() == logic_state_t::HIGH;
+        }
+        return fromBool(parity);
+    }
+    // the same flags as the ANDLikeGate the gate is ticked as
+    const bool inputsInverted = gateType == GateType::OR || gateType == GateType::NOR;
+    const bool outputInverted = gateType == GateType::OR || gateType == GateType::NAND;
+    bool allConstant = true;
+    for (const auto& input : inputs) {
+        std::optional<logic_state_t> state = getConstantState(input.source.gateId);
+        if (!state.has_value()) {
+            allConstant = false;
+        } else if (state.value() == fromBool(inputsInverted)) {
+            return fromBool(outputInverted);
+        }
+    }
+    if (!allConstant) {
+        return std::nullopt;
+    }
+    return fromBool(!outputInverted);
+}
+
+void Replacer::foldConstants(SimPauseGuard& pauseGuard) {
+    std::vector<middle_id_t> queue;
+    auto addGate = [&](middle_id_t id) {
+        if (isLogicGate(id)) {
+            queue.push_back(id);
+        }
+    };
+    for (const middle_id_t id : editedIds) {
+        addGate(id);
+        for (const auto& output : simulatorOptimizer.getOutputs(id)) {
+            addGate(output.destination.gateId);
+        }
+    }
+    // a gate is looked at again when one of its inputs folds, the gates that stay are trimmed once nothing folds anymore
+    std::vector<middle_id_t> remainingIds;
+    while (!queue.empty()) {
+        middle_id_t id = queue.back();
+        queue.pop_back();
+        if (!isLogicGate(id)) {
+            continue;
+        }
+        std::optional<logic_state_t> state = getFoldedState(id);
+        if (!state.has_value()) {
+            remainingIds.push_back(id);
+            continue;
+        }
+        std::vector<EvalConnection> outputs = simulatorOptimizer.getOutputs(id);
+        foldConstant(pauseGuard, id, state.value());
+        for (const auto& output : outputs) {
+            addGate(output.destination.gateId);
+        }
+    }
+    std::sort(remainingIds.begin(), remainingIds.end());
+    remainingIds.erase(std::unique(remainingIds.begin(), remainingIds.end()), remainingIds.end());
+    for (const middle_id_t id : remainingIds) {
+        if (isLogicGate(id)) {
+            disconnectConstantInputs(pauseGuard, id);
+        }
+    }
+}
+
+void Replacer::foldConstant(SimPauseGuard& pauseGuard, middle_id_t id, logic_state_t state) {
+    std::vector<EvalConnection> inputs = simulatorOptimizer.getInputs(id);
+    std::vector<EvalConnection> outputs = simulatorOptimizer.getOutputs(id);
+
+    Replacement& replacement = makeReplacement();
+    middle_id_t constantId = replacement.getNewId();
+    replacement.addGate(pauseGuard, state == logic_state_t::HIGH ? GateType::CONSTANT_ON : GateType::CONSTANT_OFF, constantId);
+    replacement.removeGate(pauseGuard, id, constantId);
+    for (const auto& output : outputs) {
+        if (output.destination.gateId == id) {
+            continue;
+        }
+        replacement.makeConnection(pauseGuard, EvalConnection(EvalConnectionPoint(constantId, output.source.portId), output.destination));
+        markEdited(output.destination.gateId);
+    }
+    // the constants it was folded from going away or getting new readers has to bring the gate back
+    for (const auto& input : inputs) {
+        replacement.trackOutput(input.source.gateId);
+    }
+    trackReplacement(replacement);
+    optimizationReplacements.insert(&replacement);
+}
+
+void Replacer::disconnectConstantInputs(SimPauseGuard& pauseGuard, middle_id_t id) {
+    // the AND like gates ignore the inputs that are not their deciding state, the XOR like gates the LOW inputs
+    const GateType gateType = simulatorOptimizer.getGateType(id);
+    logic_state_t ignoredState = logic_state_t::LOW;
+    if (gateType == GateType::AND || gateType == GateType::NAND) {
+        ignoredState = logic_state_t::HIGH;
+    }
+    std::vector<EvalConnection> inputs = simulatorOptimizer.getInputs(id);
+    std::vector<EvalConnection> ignoredInputs;
+    for (const auto& input : inputs) {
+        if (getConstantState(input.source.gateId) == ignoredState) {
+            ignoredInputs.push_back(input);
+        }
+    }
+    // a gate needs an input left, without inputs it is ticked to LOW
+    if (ignoredInputs.empty() || ignoredInputs.size() == inputs.size()) {
+        return;
+    }
+    Replacement& replacement = makeReplacement();
+    for (const auto& input : ignoredInputs) {
+        replacement.removeConnection(pauseGuard, input);
+    }
+    trackReplacement(replacement);
+    optimizationReplacements.insert(&replacement);
+    markEdited(id);
+}
+
+std::vector<std::pair<EvalConnectionPoint, connection_port_id_t>> Replacer::getInputKey(middle_id_t id) const {
+    std::vector<std::pair<EvalConnectionPoint, connection_port_id_t>> key;
+    for (const auto& input : simulatorOptimizer.getInputs(id)) {
+        key.emplace_back(input.source, input.destination.portId);
+    }
+    std::sort(key.begin(), key.end());
+    return key;
+}
+
+std::optional<middle_id_t> Replacer::findDuplicateGate(middle_id_t id) const {
+    const std::vector<EvalConnection>& inputs = simulatorOptimizer.getInputs(id);
+    // a gate without inputs has nothing to be read from, and a gate reading itself can not read the other gate instead
+    if (inputs.empty()) {
+        return std::nullopt;
+    }
+    for (const auto& input : inputs) {
+        if (input.source.gateId == id) {
+            return std::nullopt;
+        }
+    }
+    const GateType gateType = simulatorOptimizer.getGateType(id);
+    const std::vector<std::pair<EvalConnectionPoint, connection_port_id_t>> key = getInputKey(id);
+    // a duplicate reads the same outputs, so it is one of the readers of any of them
+    const EvalConnectionPoint source = key.front().first;
+    for (const auto& output : simulatorOptimizer.getOutputs(source.gateId)) {
+        const middle_id_t otherId = output.destination.gateId;
+        if (output.source.portId != source.portId || otherId == id || !isLogicGate(otherId)) {
+            continue;
+        }
+        if (simulatorOptimizer.getGateType(otherId) != gateType || simulatorOptimizer.getNumInputs(otherId) != (int)key.size()) {
+            continue;
+        }
+        if (getInputKey(otherId) == key) {
+            return otherId;
+        }
+    }
+    return std::nullopt;
+}
+
+void Replacer::mergeDuplicateGates(SimPauseGuard& pauseGuard) {
+    std::vector<middle_id_t> queue;
+    for (const middle_id_t id : editedIds) {
+        if (isLogicGate(id)) {
+            queue.push_back(id);
+        }
+    }
+    // the readers of a merged gate read the gate it was merged into, which can make them duplicates too
+    while (!queue.empty()) {
+        middle_id_t id = queue.back();
+        queue.pop_back();
+        if (!isLogicGate(id)) {
+            continue;
+        }
+        std::optional<middle_id_t> duplicateId = findDuplicateGate(id);
+        if (!duplicateId.has_value()) {
+            continue;
+        }
+        std::vector<EvalConnection> outputs = simulatorOptimizer.getOutputs(id);
+        mergeDuplicateGate(pauseGuard, id, duplicateId.value());
+        for (const auto& output : outputs) {
+            if (isLogicGate(output.destination.gateId)) {
+                queue.push_back(output.destination.gateId);
+            }
+        }
+    }
+}
+
+void Replacer::mergeDuplicateGate(SimPauseGuard& pauseGuard, middle_id_t id, middle_id_t survivorId) {
+    std::vector<EvalConnection> outputs = simulatorOptimizer.getOutputs(id);
+
+    Replacement& replacement = makeReplacement();
+    replacement.removeGate(pauseGuard, id, survivorId);
+    for (const auto& output : outputs) {
+        replacement.makeConnection(pauseGuard, EvalConnection(EvalConnectionPoint(survivorId, output.source.portId), output.destination));
+        markEdited(output.destination.gateId);
+    }
+    // the gates only compute the same state while the survivor keeps the same inputs
+    replacement.trackInput(survivorId);
+    trackReplacement(replacement);
+    optimizationReplacements.insert(&replacement);
+}
+
+bool Replacer::isChainBuffer(middle_id_t id) const {
+    if (replacementIds.contains(id)) {
+        return false;
+    }
+    switch (simulatorOptimizer.getGateType(id)) {
+    case GateType::THROUGH:
+        return simulatorOptimizer.getDelayTicks(id) == 1u;
+    case GateType::AND:
+    case GateType::OR:
+    case GateType::XOR:
+        return simulatorOptimizer.getNumInputs(id) == 1;
+    default:
+        return false;
+    }
+}
+
+std::optional<middle_id_t> Replacer::getNextChainBuffer(middle_id_t id) const {
+    if (!isChainBuffer(id)) {
+        return std::nullopt;
+    }
+    const std::vector<EvalConnection>& outputs = simulatorOptimizer.getOutputs(id);
+    if (outputs.size() != 1) {
+        return std::nullopt;
+    }
+    middle_id_t nextId = outputs.at(0).destination.gateId;
+    if (nextId == id || !isChainBuffer(nextId) || simulatorOptimizer.getNumInputs(nextId) != 1) {
+        return std::nullopt;
+    }
+    // a gate behind a buffer that passes FLOATING on turns it into UNDEFINED, it starts a chain of its own
+    if (simulatorOptimizer.getGateType(id) == GateType::THROUGH && simulatorOptimizer.getGateType(nextId) != GateType::THROUGH) {
+        return std::nullopt;
+    }
+    return nextId;
+}
+
+Replacement* Replacer::getJoinedDelayChain(middle_id_t id) const {
+    const std::vector<EvalConnection>& outputs = simulatorOptimizer.getOutputs(id);
+    if (outputs.size() != 1 || !replacementIds.contains(outputs.at(0).destination.gateId)) {
+        return nullptr;
+    }
+    auto iter = replacementsTrackingOutputs.find(id);
+    if (iter == replacementsTrackingOutputs.end()) {
+        return nullptr;
+    }
+    for (Replacement* replacement : iter->second) {
+        if (replacement->getDelayBufferId() == outputs.at(0).destination.gateId) {
+            return replacement;
+        }
+    }
+    return nullptr;
+}
+
+void Replacer::collapseBufferChains(SimPauseGuard& pauseGuard) {
+    // walk back from every buffer next to an edit to the start of its chain
+    std::vector<middle_id_t> chainStarts;
+    std::unordered_set<middle_id_t> walkedIds;
+    auto addChain = [&](middle_id_t id) {
+        if (!isChainBuffer(id)) {
+            return;
+        }
+        while (walkedIds.insert(id).second) {
+            const std::vector<EvalConnection>& inputs = simulatorOptimizer.getInputs(id);
+            if (inputs.size() != 1 || getNextChainBuffer(inputs.at(0).source.gateId) != id) {
+                break;
+            }
+            id = inputs.at(0).source.gateId;
+        }
+        // a buffer reached from an earlier walk is not the start of its chain, collapseBufferChain skips those
+        if (getNextChainBuffer(id).has_value()) {
+            chainStarts.push_back(id);
+        }
+    };
+    for (const middle_id_t id : editedIds) {
+        addChain(id);
+        for (const auto& input : simulatorOptimizer.getInputs(id)) {
+            addChain(input.source.gateId);
+        }
+        for (const auto& output : simulatorOptimizer.getOutputs(id)) {
+            addChain(output.destination.gateId);
+        }
+    }
+    std::sort(chainStarts.begin(), chainStarts.end());
+    chainStarts.erase(std::unique(chainStarts.begin(), chainStarts.end()), chainStarts.end());
+    for (const middle_id_t id : chainStarts) {
+        collapseBufferChain(pauseGuard, id);
+    }
+}
+
+void Replacer::collapseBufferChain(SimPauseGuard& pauseGuard, middle_id_t id) {
+    if (!getNextChainBuffer(id).has_value()) {
+        return;
+    }
+    // only start at the first buffer of a chain
+    std::vector<EvalConnection> inputs = simulatorOptimizer.getInputs(id);
+    if (inputs.size() == 1 && getNextChainBuffer(inputs.at(0).source.gateId) == id) {
+        return;
+    }
+    std::vector<middle_id_t> chain = { id };
+    while (std::optional<middle_id_t> nextId = getNextChainBuffer(chain.back())) {
+        if (nextId.value() == id) {
+            break;
+        }
+        chain.push_back(nextId.value());
+    }
+    // a chain that runs into the first gate of a collapsed chain joins it, so that buffer goes back to its gates first
+    if (Replacement* joined = getJoinedDelayChain(chain.back())) {
+        joined->revert(pauseGuard);
+        collapseBufferChain(pauseGuard, id);
+        return;
+    }
+    // the first gate of a chain of logic gates stays, the gates behind it pass its states on unchanged
+    if (simulatorOptimizer.getGateType(id) != GateType::THROUGH) {
+        chain.erase(chain.begin());
+        if (chain.size() < 2) {
+            return;
+        }
+        inputs = simulatorOptimizer.getInputs(chain.front());
+    }
+    middle_id_t lastId = chain.back();
+    std::vector<EvalConnection> outputs = simulatorOptimizer.getOutputs(lastId);
+
+    // a loop that runs through the chain keeps its buffers, the new buffer could not read itself
+    auto inChain = [&](middle_id_t gateId) {
+        return std::find(chain.begin(), chain.end(), gateId) != chain.end();
+    };
+    if (std::any_of(inputs.begin(), inputs.end(), [&](const EvalConnection& conn) { return inChain(conn.source.gateId); }) ||
+        std::any_of(outputs.begin(), outputs.end(), [&](const EvalConnection& conn) { return inChain(conn.destination.gateId); })) {
+        return;
+    }
+
+    // the states on their way through the chain, the last buffer has the state of the output right now
+    std::vector<logic_state_t> pipeline;
+    pipeline.reserve(chain.size());
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        pipeline.push_back(simulatorOptimizer.getState(EvalConnectionPoint(*it, 0)));
+    }
+
+    Replacement& replacement = makeReplacement();
+    middle_id_t newBufferId = replacement.getNewId();
+    replacement.addGate(pauseGuard, GateType::THROUGH, newBufferId);
+    simulatorOptimizer.setDelayTicks(pauseGuard, newBufferId, chain.size(), pipeline);
+    for (const middle_id_t chainId : chain) {
+        replacement.removeGate(pauseGuard, chainId, newBufferId);
+    }
+    for (const auto& input : inputs) {
+        replacement.makeConnection(pauseGuard, EvalConnection(input.source, EvalConnectionPoint(newBufferId, input.destination.portId)));
+    }
+    for (const auto& output : outputs) {
+        replacement.makeConnection(pauseGuard, EvalConnection(EvalConnectionPoint(newBufferId, output.source.portId), output.destination));
+    }
+    replacement.setDelayChain(newBufferId, chain);
+    trackReplacement(replacement);
+    optimizationReplacements.insert(&replacement);
+}
+
+bool Replacer::isAbsorbableInverter(middle_id_t id) const {
+    if (replacementIds.contains(id) || simulatorOptimizer.getNumInputs(id) != 1) {
+        return false;
+    }
+    const GateType gateType = simulatorOptimizer.getGateType(id);
+    if (gateType != GateType::NAND && gateType != GateType::NOR) {
+        return false;
+    }
+    return simulatorOptimizer.getInputs(id).at(0).source.gateId != id;
+}
+
+bool Replacer::canAbsorbInverters(middle_id_t id) const {
+    const std::vector<EvalConnection>& inputs = simulatorOptimizer.getInputs(id);
+    if (inputs.empty()) {
+        return false;
+    }
+    for (const auto& input : inputs) {
+        const middle_id_t inverterId = input.source.gateId;
+        if (inverterId == id || !isAbsorbableInverter(inverterId)) {
+            return false;
+        }
+        // a loop through the inverter would have the new gate read the gate it replaces
+        if (simulatorOptimizer.getInputs(inverterId).at(0).source.gateId == id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Replacer::absorbInverters(SimPauseGuard& pauseGuard) {
+    std::vector<middle_id_t> ids;
+    auto addGate = [&](middle_id_t id) {
+        if (isLogicGate(id)) {
+            ids.push_back(id);
+        }
+    };
+    for (const middle_id_t id : editedIds) {
+        addGate(id);
+        for (const auto& output : simulatorOptimizer.getOutputs(id)) {
+            addGate(output.destination.gateId);
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    // absorbing removes inverters, which can be further on in the list
+    for (const middle_id_t id : ids) {
+        if (isLogicGate(id) && canAbsorbInverters(id)) {
+            absorbInverters(pauseGuard, id);
+        }
+    }
+}
+
+void Replacer::absorbInverters(SimPauseGuard& pauseGuard, middle_id_t id) {
+    std::vector<EvalConnection> inputs = simulatorOptimizer.getInputs(id);
+    std::vector<EvalConnection> outputs = simulatorOptimizer.getOutputs(id);
+    // AND(!a, !b) = NOR(a, b) and NAND(!a, !b) = OR(a, b), every inverted input of a XOR flips its output
+    GateType gateType = simulatorOptimizer.getGateType(id);
+    const bool oddInputs = inputs.size() % 2 == 1;
+    switch (gateType) {
+    case GateType::AND: gateType = GateType::NOR; break;
+    case GateType::NOR: gateType = GateType::AND; break;
+    case GateType::NAND: gateType = GateType::OR; break;
+    case GateType::OR: gateType = GateType::NAND; break;
+    case GateType::XOR: gateType = oddInputs ? GateType::XNOR : GateType::XOR; break;
+    case GateType::XNOR: gateType = oddInputs ? GateType::XOR : GateType::XNOR; break;
+    default: return;
+    }
+    std::vector<EvalConnection> newInputs;
+    std::vector<middle_id_t> inverterIds;
+    for (const auto& input : inputs) {
+        const middle_id_t inverterId = input.source.gateId;
+        newInputs.push_back(simulatorOptimizer.getInputs(inverterId).at(0));
+        inverterIds.push_back(inverterId);
+    }
+    std::sort(inverterIds.begin(), inverterIds.end());
+    inverterIds.erase(std::unique(inverterIds.begin(), inverterIds.end()), inverterIds.end());
+    const logic_state_t state = simulatorOptimizer.getState(EvalConnectionPoint(id, 0));
+
+    Replacement& replacement = makeReplacement();
+    middle_id_t newGateId = replacement.getNewId();
+    replacement.addGate(pauseGuard, gateType, newGateId);
+    replacement.removeGate(pauseGuard, id, newGateId);
+    for (const middle_id_t inverterId : inverterIds) {
+        if (simulatorOptimizer.getOutputs(inverterId).empty()) {
+            replacement.removeGate(pauseGuard, inverterId, newGateId);
+        } else {
+            // the new gate reads what the inverter reads, so that has to stay the same. Once its other readers are
+            // gone it can be removed as well.
+            replacement.trackInput(inverterId);
+            replacement.trackOutput(inverterId);
+        }
+    }
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        replacement.makeConnection(pauseGuard, EvalConnection(newInputs[i].source, EvalConnectionPoint(newGateId, inputs[i].destination.portId)));
+    }
+    for (const auto& output : outputs) {
+        replacement.makeConnection(pauseGuard, EvalConnection(EvalConnectionPoint(newGateId, output.source.portId), output.destination));
+        markEdited(output.destination.gateId);
+    }
+    simulatorOptimizer.setState(EvalConnectionPoint(newGateId, 0), state);
+    trackReplacement(replacement);
+    functionalReplacements.insert(&replacement);
+}
@@ -25,13 +25,10 @@ public:
 
 	inline void addGate(SimPauseGuard& pauseGuard, const GateType gateType, const middle_id_t gateId) {
 		simulatorOptimizer.addGate(pauseGuard, gateType, gateId);
+		markEdited(gateId);
 	}
 
-	void removeGate(SimPauseGuard& pauseGuard, const middle_id_t gateId) {
-		pingOutputs(pauseGuard, gateId);
-		pingInputs(pauseGuard, gateId);
-		simulatorOptimizer.removeGate(pauseGuard, gateId);
-	}
+	void removeGate(SimPauseGuard& pauseGuard, const middle_id_t gateId);
 
 	inline SimPauseGuard beginEdit() {
 		return simulatorOptimizer.beginEdit();
@@ -40,9 +37,27 @@ public:
 	void endEdit(SimPauseGuard& pauseGuard) {
 		cleanReplacements();
 		mergeJunctions(pauseGuard);
+		if (evalConfig.isGateOptimization()) {
+			foldConstants(pauseGuard);
+			mergeDuplicateGates(pauseGuard);
+			collapseBufferChains(pauseGuard);
+		}
+		if (evalConfig.isFunctionalOptimization()) {
+			absorbInverters(pauseGuard);
+		}
+		clearEditedIds();
 
 		simulatorOptimizer.endEdit(pauseGuard);
 	}
+	// call after the gate or functional optimization setting changed and before endEdit. Turning one off reverts the
+	// replacements of its passes, turning one on has endEdit look at every gate.
+	void updateGateOptimization(SimPauseGuard& pauseGuard);
+	inline void renumberSimulatorIds(SimPauseGuard& pauseGuard) {
+		simulatorOptimizer.renumberSimulatorIds(pauseGuard);
+	}
+	inline void compileLanes(SimPauseGuard& pauseGuard, LaneSimulator& laneSimulator) const {
+		simulatorOptimizer.compileLanes(pauseGuard, laneSimulator);
+	}
 
 	inline std::optional<simulator_id_t> getSimIdFromMiddleId(middle_id_t middleId) const {
 		return simulatorOptimizer.getSimIdFromMiddleId(middleId);
@@ -83,6 +98,9 @@ public:
 	inline void setState(EvalConnectionPoint id, logic_state_t state) {
 		simulatorOptimizer.setState(getReplacementConnectionPoint(id), state);
 	}
+	inline void setStates(const std::vector<EvalConnectionPoint>& points, const std::vector<logic_state_t>& states) {
+		simulatorOptimizer.setStates(getReplacementConnectionPoints(points), states);
+	}
 
 	void makeConnection(SimPauseGuard& pauseGuard, EvalConnection connection) {
 		pingOutputs(pauseGuard, connection.source.gateId);
@@ -99,15 +117,56 @@ public:
 	inline double getAverageTickrate() const {
 		return simulatorOptimizer.getAverageTickrate();
 	}
+	inline std::vector<ThreadPool::WorkerStats> getWorkerStats() const {
+		return simulatorOptimizer.getWorkerStats();
+	}
+	inline bool isNativeTickActive() const {
+		return simulatorOptimizer.isNativeTickActive();
+	}
+	inline bool compileNativeTicks(SimPauseGuard& pauseGuard) {
+		return simulatorOptimizer.compileNativeTicks(pauseGuard);
+	}
+	inline void resetWorkerStats() {
+		simulatorOptimizer.resetWorkerStats();
+	}
+	inline uint64_t getTickCount() const {
+		return simulatorOptimizer.getTickCount();
+	}
+	inline void setTickCount(SimPauseGuard& pauseGuard, uint64_t tickCount) {
+		simulatorOptimizer.setTickCount(pauseGuard, tickCount);
+	}
+	inline SimulationState getSimulationState(SimPauseGuard& pauseGuard, const std::vector<simulator_id_t>& simulatorIds) const {
+		return simulatorOptimizer.getSimulationState(pauseGuard, simulatorIds);
+	}
+	inline bool setSimulationState(SimPauseGuard& pauseGuard, const std::vector<simulator_id_t>& simulatorIds, const SimulationState& state) {
+		return simulatorOptimizer.setSimulationState(pauseGuard, simulatorIds, state);
+	}
+	inline uint64_t getNetlistFingerprint(SimPauseGuard& pauseGuard, const std::vector<simulator_id_t>& simulatorIds) const {
+		return simulatorOptimizer.getNetlistFingerprint(pauseGuard, simulatorIds);
+	}
 
 private:
 	SimulatorOptimizer simulatorOptimizer;
 	EvalConfig& evalConfig;
 	IdProvider<middle_id_t>& middleIdProvider;
-	std::vector<Replacement> replacements;
+	std::unordered_map<const Replacement*, std::unique_ptr<Replacement>> replacements;
+	uint64_t replacementCount = 0;
+	// the replacements that revert when the inputs or outputs of a gate change, so a ping only visits those. A ping
+	// reverts them in the order they were made, later replacements can be built on top of earlier ones.
+	std::unordered_map<middle_id_t, std::vector<Replacement*>> replacementsTrackingInputs;
+	std::unordered_map<middle_id_t, std::vector<Replacement*>> replacementsTrackingOutputs;
+	std::vector<const Replacement*> revertedReplacements;
+	// the replacements made by the passes behind the gate optimization setting, they are reverted when it is turned off
+	std::unordered_set<const Replacement*> optimizationReplacements;
+	// the replacements made by the passes behind the functional optimization setting
+	std::unordered_set<const Replacement*> functionalReplacements;
 	std::unordered_map<middle_id_t, std::unordered_map<connection_port_id_t, EvalConnectionPoint>> replacedConnectionPoints;
 	std::unordered_map<middle_id_t, middle_id_t> replacedIds;
 	std::unordered_set<middle_id_t> replacementIds;
+	// gates that were added, connected, disconnected or brought back by a revert since the last endEdit. Junction
+	// networks and buffer chains only change next to these, so endEdit does not have to look at the rest of the gates.
+	std::vector<middle_id_t> editedIds;
+	std::vector<bool> isEdited;
 
 	struct JunctionFloodFillResult {
 		std::vector<EvalConnectionPoint> outputsGoingIntoJunctions;
@@ -123,14 +182,74 @@ private:
 	};
 
 	Replacement& makeReplacement();
+	// call once the replacement is made, it starts listening to the pings of the ids it tracks
+	void trackReplacement(Replacement& replacement);
+	void untrackReplacement(const Replacement& replacement);
 	void cleanReplacements();
-	void pingOutputs(SimPauseGuard& pauseGuard, middle_id_t id);
-	void pingInputs(SimPauseGuard& pauseGuard, middle_id_t id);
+	// reverting a replacement reverts the ones built on top of it, so the oldest goes first
+	void revertReplacements(SimPauseGuard& pauseGuard, std::unordered_set<const Replacement*>& toRevert);
+	// A revert only pings the replacements made after the reverting one. It puts the gates back the way the earlier
+	// replacements left them, so those stay and only the ones built on top of it have to go first.
+	void pingOutputs(SimPauseGuard& pauseGuard, middle_id_t id, const Replacement* reverting = nullptr);
+	void pingInputs(SimPauseGuard& pauseGuard, middle_id_t id, const Replacement* reverting = nullptr);
+	inline void markEdited(middle_id_t id) {
+		if (id >= isEdited.size()) isEdited.resize(id + 1, false);
+		if (isEdited[id]) return;
+		isEdited[id] = true;
+		editedIds.push_back(id);
+	}
+	void clearEditedIds() {
+		for (const middle_id_t id : editedIds) isEdited[id] = false;
+		editedIds.clear();
+	}
 	EvalConnectionPoint getReplacementConnectionPoint(EvalConnectionPoint point) const;
 	std::vector<EvalConnectionPoint> getReplacementConnectionPoints(const std::vector<EvalConnectionPoint>& points) const;
 	std::vector<std::optional<EvalConnectionPoint>> getReplacementConnectionPoints(const std::vector<std::optional<EvalConnectionPoint>>& points) const;
+	// merges the junction networks next to the edited gates
 	void mergeJunctions(SimPauseGuard& pauseGuard);
+	void mergeJunctionNetwork(SimPauseGuard& pauseGuard, const JunctionFloodFillResult& floodFillResult);
 	JunctionFloodFillResult junctionFloodFill(middle_id_t junctionId);
+	// Gates the constants decide on their own become constant gates, which are never ticked. A folded gate maps to its
+	// constant so getState still reads it, and its readers are looked at next, so the constants spread as far as they
+	// decide anything. The constant inputs of a gate that stays and that can not change its output are disconnected.
+	// A folded gate shows its constant right away instead of on the next tick.
+	void foldConstants(SimPauseGuard& pauseGuard);
+	void foldConstant(SimPauseGuard& pauseGuard, middle_id_t id, logic_state_t state);
+	void disconnectConstantInputs(SimPauseGuard& pauseGuard, middle_id_t id);
+	// the AND and XOR like gates that were not added by a replacement
+	bool isLogicGate(middle_id_t id) const;
+	std::optional<logic_state_t> getConstantState(middle_id_t id) const;
+	// the state the constant inputs of the gate hold it at, nullopt while its other inputs can still change it
+	std::optional<logic_state_t> getFoldedState(middle_id_t id) const;
+	// Gates of the same type that read the same outputs compute the same state every tick, so one of them is merged into
+	// the other. The merged gate maps to the survivor so getState still reads it, and its readers read the survivor.
+	// They are looked at next, reading the same gate can make them duplicates too. A merged gate that was just edited
+	// shows the state of the survivor right away instead of on the next tick.
+	void mergeDuplicateGates(SimPauseGuard& pauseGuard);
+	void mergeDuplicateGate(SimPauseGuard& pauseGuard, middle_id_t id, middle_id_t survivorId);
+	std::optional<middle_id_t> findDuplicateGate(middle_id_t id) const;
+	// the inputs of the gate sorted, gates with the same type and key compute the same state
+	std::vector<std::pair<EvalConnectionPoint, connection_port_id_t>> getInputKey(middle_id_t id) const;
+	// A chain of one tick buffers where every buffer only feeds the next one becomes a single buffer that delays by the
+	// length of the chain. AND, OR and XOR gates with one input are buffers that turn FLOATING into UNDEFINED, so a
+	// chain of them keeps its first gate and the buffer delays its output. The gates inside the chain map to the buffer
+	// and show the state of the end of the chain, a revert gives them back the states that were on their way through.
+	// Only chains that run through or next to an edited gate are looked at.
+	void collapseBufferChains(SimPauseGuard& pauseGuard);
+	void collapseBufferChain(SimPauseGuard& pauseGuard, middle_id_t id);
+	bool isChainBuffer(middle_id_t id) const;
+	std::optional<middle_id_t> getNextChainBuffer(middle_id_t id) const;
+	// the collapsed chain whose buffer the gate feeds as the first gate of that chain, if there is one
+	Replacement* getJoinedDelayChain(middle_id_t id) const;
+	// A gate whose inputs all come from inverters, one input NAND and NOR gates, reads the inputs of the inverters
+	// instead. It becomes the gate type that computes the same state from the inverted inputs, an AND becomes a NOR,
+	// a NAND an OR and the other way around, and a XOR or XNOR flips its output for an odd number of inputs. That takes
+	// a tick off every path through the inverters. Inverters that only fed the gate are removed and show the state of
+	// the gate.
+	void absorbInverters(SimPauseGuard& pauseGuard);
+	void absorbInverters(SimPauseGuard& pauseGuard, middle_id_t id);
+	bool isAbsorbableInverter(middle_id_t id) const;
+	bool canAbsorbInverters(middle_id_t id) const;
 };
 
 #endif /* replacer_h */
@@ -0,0 +1,153 @@
+#include "simulationExecutor.h"
+
+#include "logicSimulator.h"
+
+SimulationExecutor::SimulationExecutor(unsigned int maxThreadCount) : maxThreadCount(std::max(1u, maxThreadCount)) { }
+
+std::shared_ptr<SimulationExecutor> SimulationExecutor::getShared() {
+	static std::mutex sharedMutex;
+	// weak so the threads are joined when the last user goes away instead of during static destruction
+	static std::weak_ptr<SimulationExecutor> shared;
+	std::lock_guard<std::mutex> lk(sharedMutex);
+	std::shared_ptr<SimulationExecutor> executor = shared.lock();
+	if (!executor) {
+		executor = std::make_shared<SimulationExecutor>();
+		shared = executor;
+	}
+	return executor;
+}
+
+SimulationExecutor::~SimulationExecutor() {
+	{
+		std::lock_guard<std::mutex> lk(mutex);
+		stopping = true;
+		if (!entries.empty()) {
+			logError("{} simulators are still registered", "SimulationExecutor::~SimulationExecutor", entries.size());
+		}
+	}
+	readyCv.notify_all();
+	for (std::thread& thread : threads) {
+		if (thread.joinable()) thread.join();
+	}
+}
+
+void SimulationExecutor::add(LogicSimulator* simulator) {
+	{
+		std::lock_guard<std::mutex> lk(mutex);
+		Entry entry;
+		entry.readyAt = clock::now();
+		entry.usedNanoseconds = getMinUsedNanoseconds();
+		entries.emplace(simulator, entry);
+		// more threads than simulators would only wait
+		if (threads.size() < std::min<size_t>(maxThreadCount, entries.size())) {
+			threads.emplace_back(&SimulationExecutor::threadLoop, this);
+		}
+	}
+	readyCv.notify_one();
+}
+
+void SimulationExecutor::remove(LogicSimulator* simulator) {
+	std::unique_lock<std::mutex> lk(mutex);
+	auto iter = entries.find(simulator);
+	if (iter == entries.end()) return;
+	iter->second.removed = true;
+	removedCv.wait(lk, [&] { return !iter->second.active; });
+	reservedWorkers -= iter->second.workerCount;
+	entries.erase(iter);
+}
+
+size_t SimulationExecutor::reserveWorkers(LogicSimulator* simulator, size_t count) {
+	std::lock_guard<std::mutex> lk(mutex);
+	auto iter = entries.find(simulator);
+	if (iter == entries.end()) return count;
+	Entry& entry = iter->second;
+	const size_t otherWorkers = reservedWorkers - entry.workerCount;
+	const size_t workerBudget = maxThreadCount - 1;
+	const size_t granted = std::min(count, workerBudget - std::min(workerBudget, otherWorkers));
+	reservedWorkers = otherWorkers + granted;
+	entry.workerCount = granted;
+	return granted;
+}
+
+void SimulationExecutor::wake(LogicSimulator* simulator) {
+	{
+		std::lock_guard<std::mutex> lk(mutex);
+		auto iter = entries.find(simulator);
+		if (iter == entries.end()) return;
+		Entry& entry = iter->second;
+		if (entry.active) {
+			entry.woken = true;
+			return;
+		}
+		if (entry.idle) entry.usedNanoseconds = std::max(entry.usedNanoseconds, getMinUsedNanoseconds());
+		entry.idle = false;
+		entry.readyAt = clock::now();
+	}
+	readyCv.notify_one();
+}
+
+uint64_t SimulationExecutor::getMinUsedNanoseconds() const {
+	uint64_t minUsed = std::numeric_limits<uint64_t>::max();
+	for (const auto& [simulator, entry] : entries) {
+		if (!entry.idle && !entry.removed) minUsed = std::min(minUsed, entry.usedNanoseconds);
+	}
+	return minUsed == std::numeric_limits<uint64_t>::max() ? 0 : minUsed;
+}
+
+LogicSimulator* SimulationExecutor::pickNext(clock::time_point now, clock::time_point& nextWake) {
+	LogicSimulator* next = nullptr;
+	uint64_t nextUsed = std::numeric_limits<uint64_t>::max();
+	nextWake = clock::time_point::max();
+	for (const auto& [simulator, entry] : entries) {
+		if (entry.idle || entry.active || entry.removed) continue;
+		if (entry.readyAt > now) {
+			nextWake = std::min(nextWake, entry.readyAt);
+			continue;
+		}
+		if (entry.usedNanoseconds < nextUsed) {
+			next = simulator;
+			nextUsed = entry.usedNanoseconds;
+		}
+	}
+	return next;
+}
+
+void SimulationExecutor::threadLoop() {
+	std::unique_lock<std::mutex> lk(mutex);
+	while (!stopping) {
+		clock::time_point nextWake;
+		LogicSimulator* simulator = pickNext(clock::now(), nextWake);
+		if (simulator == nullptr) {
+			if (nextWake == clock::time_point::max()) readyCv.wait(lk);
+			else readyCv.wait_until(lk, nextWake);
+			continue;
+		}
+		Entry& entry = entries.at(simulator); // map nodes do not move, so the reference outlives the unlock
+		entry.active = true;
+		entry.woken = false;
+		lk.unlock();
+
+		const clock::time_point sliceStart = clock::now();
+		const std::optional<clock::time_point> readyAt = simulator->runSlice(sliceLength);
+		const clock::time_point sliceEnd = clock::now();
+
+		lk.lock();
+		entry.active = false;
+		entry.usedNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(sliceEnd - sliceStart).count();
+		if (entry.removed) {
+			removedCv.notify_all();
+			continue;
+		}
+		if (entry.woken) {
+			entry.idle = false;
+			entry.readyAt = sliceEnd;
+		} else if (readyAt.has_value()) {
+			entry.idle = false;
+			entry.readyAt = *readyAt;
+		} else {
+			entry.idle = true;
+		}
+		// a sleeping thread may be waiting for a later wake time than the one this simulator has now
+		readyCv.notify_one();
+	}
+}
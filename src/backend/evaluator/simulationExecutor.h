@@ -0,0 +1,66 @@
+#ifndef simulationExecutor_h
+#define simulationExecutor_h
+
+class LogicSimulator;
+
+// Runs the ticks of all simulators of the process on one bounded set of threads instead of a thread per simulator.
+// Simulators run in slices of at most sliceLength. The ready simulator that used the least thread time goes next, so busy
+// evaluators share the threads fairly while every simulator keeps to its own target tick rate.
+// The threads are started as simulators are added, up to maxThreadCount, so an executor without evaluators costs nothing.
+// The ThreadPool workers that split a tick are borrowed from a budget of maxThreadCount - 1 shared by all simulators.
+class SimulationExecutor {
+public:
+	explicit SimulationExecutor(unsigned int maxThreadCount = std::max(1u, std::thread::hardware_concurrency()));
+	~SimulationExecutor();
+
+	// the executor of the process, made by the first caller and kept while anything holds it
+	static std::shared_ptr<SimulationExecutor> getShared();
+
+	void add(LogicSimulator* simulator);
+	// returns once no thread runs the simulator anymore
+	void remove(LogicSimulator* simulator);
+	// the simulator has something to do, like a sprint, a config change, a state change or the end of a pause
+	void wake(LogicSimulator* simulator);
+
+	// Sets the tick workers the simulator borrows to count, or to as many as the other simulators left over.
+	// Returns the workers it got. A simulator that is not added gets all of them.
+	size_t reserveWorkers(LogicSimulator* simulator, size_t count);
+
+	size_t getThreadCount() const {
+		std::lock_guard<std::mutex> lk(mutex);
+		return threads.size();
+	}
+	unsigned int getMaxThreadCount() const { return maxThreadCount; }
+
+	static constexpr std::chrono::microseconds sliceLength { 2000 };
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	struct Entry {
+		clock::time_point readyAt;
+		bool idle = false; // waits for wake, readyAt does not apply
+		bool active = false; // a thread runs a slice of it
+		bool woken = false; // wake was called during the slice
+		bool removed = false;
+		uint64_t usedNanoseconds = 0; // thread time of all its slices
+		size_t workerCount = 0; // borrowed tick workers
+	};
+
+	void threadLoop();
+	// the ready simulator with the least used time, otherwise sets nextWake to when the next one gets ready
+	LogicSimulator* pickNext(clock::time_point now, clock::time_point& nextWake);
+	// a simulator that slept does not get to catch up on the time it did not use
+	uint64_t getMinUsedNanoseconds() const;
+
+	const unsigned int maxThreadCount;
+	std::map<LogicSimulator*, Entry> entries;
+	std::vector<std::thread> threads;
+	size_t reservedWorkers = 0; // the workerCount of all entries
+	mutable std::mutex mutex;
+	std::condition_variable readyCv;
+	std::condition_variable removedCv;
+	bool stopping = false;
+};
+
+#endif /* simulationExecutor_h */
@@ -17,6 +17,8 @@ public:
 	virtual simulator_id_t getIdOfOutputPort(connection_port_id_t portId) const = 0;
 	virtual void resetState(bool realistic, std::vector<logic_state_t>& states) = 0;
 	virtual std::vector<simulator_id_t> getOutputSimIds() const = 0;
+	// newIds[oldId] is the id after LogicSimulator::renumberIds
+	virtual void remapIds(const std::vector<simulator_id_t>& newIds) { id = newIds[id]; }
 
 	simulator_id_t getId() const { return id; }
 
@@ -24,13 +26,17 @@ protected:
 	simulator_id_t id;
 
 	inline void applyRealisticTick(logic_state_t targetState, const std::vector<logic_state_t>& statesA, std::vector<logic_state_t>& statesB) noexcept {
-		logic_state_t currentState = statesA[id];
+		statesB[id] = realisticState(targetState, statesA[id]);
+	}
+
+public:
+	static inline logic_state_t realisticState(logic_state_t targetState, logic_state_t currentState) noexcept {
 		if (currentState == logic_state_t::UNDEFINED) {
-			statesB[id] = targetState;
+			return targetState;
 		} else if (targetState != currentState) {
-			statesB[id] = logic_state_t::UNDEFINED;
+			return logic_state_t::UNDEFINED;
 		} else {
-			statesB[id] = currentState;
+			return currentState;
 		}
 	}
 };
@@ -75,6 +81,13 @@ public:
 		inputs.erase(std::remove(inputs.begin(), inputs.end(), otherId), inputs.end());
 	}
 
+	void remapIds(const std::vector<simulator_id_t>& newIds) override {
+		LogicGate::remapIds(newIds);
+		for (simulator_id_t& inputId : inputs) inputId = newIds[inputId];
+	}
+
+	const std::vector<simulator_id_t>& getInputs() const { return inputs; }
+
 protected:
 	std::vector<simulator_id_t> inputs;
 };
@@ -105,6 +118,13 @@ public:
 		}
 	}
 
+	void remapIds(const std::vector<simulator_id_t>& newIds) override {
+		LogicGate::remapIds(newIds);
+		if (input.has_value()) input = newIds[input.value()];
+	}
+
+	const std::optional<simulator_id_t>& getInput() const { return input; }
+
 protected:
 	std::optional<simulator_id_t> input;
 };
@@ -119,13 +139,19 @@ struct ANDLikeGate : public MultiInputGate {
 		: MultiInputGate(id), inputsInverted(inputsInverted), outputInverted(outputInverted) {}
 
 	inline logic_state_t calculate(const std::vector<logic_state_t>& statesA) const noexcept {
-		if (inputs.empty()) [[unlikely]] {
+		return calculate(statesA.data(), inputs.data(), inputs.data() + inputs.size(), inputsInverted, outputInverted);
+	}
+
+	static inline logic_state_t calculate(
+		const logic_state_t* statesA, const simulator_id_t* inputsBegin, const simulator_id_t* inputsEnd, bool inputsInverted, bool outputInverted
+	) noexcept {
+		if (inputsBegin == inputsEnd) [[unlikely]] {
 			return logic_state_t::LOW;
 		}
 		bool foundGoofyState = false;
 		const logic_state_t desiredState = (logic_state_t)inputsInverted;
-		for (const simulator_id_t inputId : inputs) {
-			const logic_state_t state = statesA[inputId];
+		for (const simulator_id_t* input = inputsBegin; input != inputsEnd; ++input) {
+			const logic_state_t state = statesA[*input];
 			// Early-out if the decisive (desired) state is present
 			if (state == desiredState) {
 				return (logic_state_t)outputInverted;
@@ -155,13 +181,19 @@ struct XORLikeGate : public MultiInputGate {
 		: MultiInputGate(id), outputInverted(outputInverted) {}
 
 	inline logic_state_t calculate(const std::vector<logic_state_t>& statesA) const noexcept {
-		if (inputs.empty()) {
+		return calculate(statesA.data(), inputs.data(), inputs.data() + inputs.size(), outputInverted);
+	}
+
+	static inline logic_state_t calculate(
+		const logic_state_t* statesA, const simulator_id_t* inputsBegin, const simulator_id_t* inputsEnd, bool outputInverted
+	) noexcept {
+		if (inputsBegin == inputsEnd) {
 			return logic_state_t::LOW;
 		}
 		// parity == true means current result would be HIGH
 		bool parity = outputInverted;
-		for (const simulator_id_t inputId : inputs) {
-			const logic_state_t state = statesA[inputId];
+		for (const simulator_id_t* input = inputsBegin; input != inputsEnd; ++input) {
+			const logic_state_t state = statesA[*input];
 			if (state >= logic_state_t::FLOATING) { // FLOATING or UNDEFINED
 				return logic_state_t::UNDEFINED;
 			}
@@ -186,9 +218,13 @@ struct JunctionGate : public SimulatorGate {
 	JunctionGate(simulator_id_t id) : SimulatorGate(id) {}
 
 	inline logic_state_t calculate(const std::vector<logic_state_t>& states) const noexcept {
+		return calculate(states.data(), inputs.data(), inputs.data() + inputs.size());
+	}
+
+	static inline logic_state_t calculate(const logic_state_t* states, const simulator_id_t* inputsBegin, const simulator_id_t* inputsEnd) noexcept {
 		logic_state_t outputState = logic_state_t::FLOATING;
-		for (const simulator_id_t inputId : inputs) {
-			const logic_state_t state = states[inputId];
+		for (const simulator_id_t* input = inputsBegin; input != inputsEnd; ++input) {
+			const logic_state_t state = states[*input];
 			if (state == logic_state_t::FLOATING) {
 				continue;
 			}
@@ -229,6 +265,11 @@ struct JunctionGate : public SimulatorGate {
 		inputs.erase(std::remove(inputs.begin(), inputs.end(), otherId), inputs.end());
 	}
 
+	void remapIds(const std::vector<simulator_id_t>& newIds) override {
+		SimulatorGate::remapIds(newIds);
+		for (simulator_id_t& inputId : inputs) inputId = newIds[inputId];
+	}
+
 	void resetState(bool realistic, std::vector<logic_state_t>& states) override {
 		states[id] = logic_state_t::FLOATING;
 	}
@@ -251,13 +292,53 @@ public:
 		: SingleInputGate(id), outputInverted(outputInverted) {}
 };
 
+// Delays its input by 1 + extraDelayTicks ticks. The input of the last extraDelayTicks ticks waits in history, a ring
+// whose oldest entry is at historyHead, so a chain of buffers can be replaced by one of them with a longer delay.
+// The ring lives in the gate so it survives edits and renumbering like the states do. Every tick has to call tick
+// (or shift) exactly once, since it moves the ring on.
 struct BufferGate : public BufferGateBase {
 	unsigned int extraDelayTicks;
+	std::vector<logic_state_t> history;
+	uint32_t historyHead = 0;
 
 	BufferGate(simulator_id_t id, bool outputInverted = false, unsigned int extraDelayTicks = 0)
-		: BufferGateBase(id, outputInverted), extraDelayTicks(extraDelayTicks) {}
+		: BufferGateBase(id, outputInverted), extraDelayTicks(extraDelayTicks), history(extraDelayTicks, logic_state_t::LOW) {}
 
-	inline void tick(const std::vector<logic_state_t>& statesA, std::vector<logic_state_t>& statesB) noexcept {}
+	// the ring reads as if the input had been fillState for the whole delay
+	void setExtraDelayTicks(unsigned int ticks, logic_state_t fillState) {
+		extraDelayTicks = ticks;
+		history.assign(ticks, fillState);
+		historyHead = 0;
+	}
+
+	void resetState(bool realistic, std::vector<logic_state_t>& states) override {
+		LogicGate::resetState(realistic, states);
+		std::fill(history.begin(), history.end(), states[id]);
+		historyHead = 0;
+	}
+
+	inline logic_state_t getInputState(const logic_state_t* statesA) const noexcept {
+		return input.has_value() ? statesA[input.value()] : logic_state_t::LOW;
+	}
+
+	// pushes the state the input has this tick and returns the state the output gets
+	inline logic_state_t shift(logic_state_t inputState) noexcept {
+		if (!history.empty()) {
+			std::swap(inputState, history[historyHead]);
+			if (++historyHead == history.size()) historyHead = 0;
+		}
+		if (!outputInverted) return inputState;
+		// same as a single input NOR gate
+		return isValid(inputState) ? (logic_state_t)!toBool(inputState) : logic_state_t::UNDEFINED;
+	}
+
+	inline void tick(const logic_state_t* statesA, logic_state_t* statesB) noexcept {
+		statesB[id] = shift(getInputState(statesA));
+	}
+
+	inline void realisticTick(const logic_state_t* statesA, logic_state_t* statesB) noexcept {
+		statesB[id] = realisticState(shift(getInputState(statesA)), statesA[id]);
+	}
 };
 
 struct SingleBufferGate : public BufferGateBase {
@@ -313,6 +394,12 @@ struct TristateBufferGate : public SimulatorGate {
 		enableInputs.erase(std::remove(enableInputs.begin(), enableInputs.end(), otherId), enableInputs.end());
 	}
 
+	void remapIds(const std::vector<simulator_id_t>& newIds) override {
+		SimulatorGate::remapIds(newIds);
+		for (simulator_id_t& inputId : inputs) inputId = newIds[inputId];
+		for (simulator_id_t& inputId : enableInputs) inputId = newIds[inputId];
+	}
+
 	void resetState(bool realistic, std::vector<logic_state_t>& states) override {
 		if (realistic) {
 			states[id] = logic_state_t::UNDEFINED;
@@ -322,11 +409,21 @@ struct TristateBufferGate : public SimulatorGate {
 	}
 
 	inline logic_state_t calculate(const std::vector<logic_state_t>& statesA) const noexcept {
+		return calculate(
+			statesA.data(), inputs.data(), inputs.data() + inputs.size(),
+			enableInputs.data(), enableInputs.data() + enableInputs.size(), enableInverted
+		);
+	}
+
+	static inline logic_state_t calculate(
+		const logic_state_t* statesA, const simulator_id_t* inputsBegin, const simulator_id_t* inputsEnd,
+		const simulator_id_t* enableBegin, const simulator_id_t* enableEnd, bool enableInverted
+	) noexcept {
 		bool foundGoofyState = false;
 		bool foundEnabled = false;
 		bool foundDisabled = false;
-		for (const simulator_id_t enableId : enableInputs) {
-			logic_state_t enableState = statesA[enableId];
+		for (const simulator_id_t* enable = enableBegin; enable != enableEnd; ++enable) {
+			logic_state_t enableState = statesA[*enable];
 			if (enableState == logic_state_t::UNDEFINED) {
 				foundGoofyState = true;
 				break;
@@ -349,12 +446,12 @@ struct TristateBufferGate : public SimulatorGate {
 		if (foundEnabled == enableInverted) {
 			return logic_state_t::FLOATING;
 		}
-		if (inputs.empty()) {
+		if (inputsBegin == inputsEnd) {
 			return logic_state_t::UNDEFINED;
 		}
 		logic_state_t outputState = logic_state_t::FLOATING;
-		for (const simulator_id_t inputId : inputs) {
-			logic_state_t state = statesA[inputId];
+		for (const simulator_id_t* input = inputsBegin; input != inputsEnd; ++input) {
+			logic_state_t state = statesA[*input];
 			if (state == logic_state_t::UNDEFINED) {
 				foundGoofyState = true;
 				break;
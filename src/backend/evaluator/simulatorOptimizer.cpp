@@ -26,6 +26,24 @@ void SimulatorOptimizer::addGate(SimPauseGuard& pauseGuard, const GateType gateT
 	gateTypes[gateId] = gateType;
 }
 
+void SimulatorOptimizer::renumberSimulatorIds(SimPauseGuard& pauseGuard) {
+	std::vector<simulator_id_t> newIds = simulator.renumberIds();
+
+	std::vector<middle_id_t> newSimulatorIds;
+	for (middle_id_t middleId = 0; middleId < middleIds.size(); ++middleId) {
+		if (middleId >= gateTypes.size() || gateTypes[middleId] == GateType::NONE) continue;
+		simulator_id_t oldId = middleIds[middleId];
+		if (oldId >= newIds.size() || newIds[oldId] == 0) continue;
+		simulator_id_t newId = newIds[oldId];
+		middleIds[middleId] = newId;
+		if (newSimulatorIds.size() <= newId) {
+			newSimulatorIds.resize(newId + 1);
+		}
+		newSimulatorIds[newId] = middleId;
+	}
+	simulatorIds.swap(newSimulatorIds);
+}
+
 void SimulatorOptimizer::removeGate(SimPauseGuard& pauseGuard, const middle_id_t gateId) {
 	// Find the gate in the simulator and remove it
 
@@ -144,16 +162,18 @@ void SimulatorOptimizer::removeConnection(SimPauseGuard& pauseGuard, EvalConnect
 	}
 }
 
-std::vector<EvalConnection> SimulatorOptimizer::getInputs(middle_id_t middleId) const {
+const std::vector<EvalConnection>& SimulatorOptimizer::getInputs(middle_id_t middleId) const {
+	static const std::vector<EvalConnection> noConnections;
 	if (middleId >= inputConnections.size()) {
-		return {};
+		return noConnections;
 	}
 	return inputConnections.at(middleId);
 }
 
-std::vector<EvalConnection> SimulatorOptimizer::getOutputs(middle_id_t middleId) const {
+const std::vector<EvalConnection>& SimulatorOptimizer::getOutputs(middle_id_t middleId) const {
+	static const std::vector<EvalConnection> noConnections;
 	if (middleId >= outputConnections.size()) {
-		return {};
+		return noConnections;
 	}
 	return outputConnections.at(middleId);
 }
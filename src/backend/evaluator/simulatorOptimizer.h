@@ -34,8 +34,14 @@ public:
 		return SimPauseGuard(simulator);
 	}
 	void endEdit(SimPauseGuard& pauseGuard) {
+		if (simulator.shouldRenumberIds()) renumberSimulatorIds(pauseGuard);
 		simulator.endEdit();
 	};
+	// renumbers the simulator ids for memory locality, the moved ids are reported through dirtySimulatorIds
+	void renumberSimulatorIds(SimPauseGuard& pauseGuard);
+	void compileLanes(SimPauseGuard& pauseGuard, LaneSimulator& laneSimulator) const {
+		simulator.compileLanes(laneSimulator);
+	}
 
 	std::optional<simulator_id_t> getSimIdFromMiddleId(middle_id_t middleId) const {
 		if (middleId < middleIds.size()) {
@@ -174,11 +180,43 @@ public:
 		}
 		simulator.setState(simIdOpt.value(), state);
 	}
+	void setStates(const std::vector<EvalConnectionPoint>& points, const std::vector<logic_state_t>& states) {
+		std::vector<StateChange> changes;
+		changes.reserve(points.size());
+		for (size_t i = 0; i < points.size(); ++i) {
+			std::optional<simulator_id_t> simIdOpt = getSimIdFromConnectionPoint(points[i]);
+			if (!simIdOpt.has_value()) {
+				logError("Sim ID not found for connection point", "SimulatorOptimizer::setStates");
+				continue;
+			}
+			changes.push_back({ simIdOpt.value(), states[i] });
+		}
+		simulator.setStates(changes);
+	}
 	void makeConnection(SimPauseGuard& pauseGuard, EvalConnection connection);
 	void removeConnection(SimPauseGuard& pauseGuard, EvalConnection connection);
+	void setDelayTicks(SimPauseGuard& pauseGuard, middle_id_t middleId, unsigned int delayTicks, std::span<const logic_state_t> pipeline = {}) {
+		std::optional<simulator_id_t> simIdOpt = getSimIdFromMiddleId(middleId);
+		if (!simIdOpt.has_value()) {
+			logError("Sim ID not found for middle ID", "SimulatorOptimizer::setDelayTicks");
+			return;
+		}
+		simulator.setDelayTicks(simIdOpt.value(), delayTicks, pipeline);
+	}
+	std::optional<unsigned int> getDelayTicks(middle_id_t middleId) const {
+		std::optional<simulator_id_t> simIdOpt = getSimIdFromMiddleId(middleId);
+		if (!simIdOpt.has_value()) return std::nullopt;
+		return simulator.getDelayTicks(simIdOpt.value());
+	}
+	std::vector<logic_state_t> getDelayPipeline(middle_id_t middleId) const {
+		std::optional<simulator_id_t> simIdOpt = getSimIdFromMiddleId(middleId);
+		if (!simIdOpt.has_value()) return {};
+		return simulator.getDelayPipeline(simIdOpt.value());
+	}
 
-	std::vector<EvalConnection> getInputs(middle_id_t middleId) const;
-	std::vector<EvalConnection> getOutputs(middle_id_t middleId) const;
+	// the connections stay put until the next edit of the gate, callers that edit while reading them have to copy
+	const std::vector<EvalConnection>& getInputs(middle_id_t middleId) const;
+	const std::vector<EvalConnection>& getOutputs(middle_id_t middleId) const;
 	int getNumInputs(middle_id_t middleId) const {
 		if (middleId < inputConnections.size()) {
 			return static_cast<int>(inputConnections[middleId].size());
@@ -201,6 +239,33 @@ public:
 	inline double getAverageTickrate() const {
 		return simulator.getAverageTickrate();
 	}
+	inline std::vector<ThreadPool::WorkerStats> getWorkerStats() const {
+		return simulator.getWorkerStats();
+	}
+	inline bool isNativeTickActive() const {
+		return simulator.isNativeTickActive();
+	}
+	inline bool compileNativeTicks(SimPauseGuard& pauseGuard) {
+		return simulator.compileNativeTicks();
+	}
+	inline void resetWorkerStats() {
+		simulator.resetWorkerStats();
+	}
+	inline uint64_t getTickCount() const {
+		return simulator.getTickCount();
+	}
+	inline void setTickCount(SimPauseGuard& pauseGuard, uint64_t tickCount) {
+		simulator.setTickCount(tickCount);
+	}
+	inline SimulationState getSimulationState(SimPauseGuard& pauseGuard, const std::vector<simulator_id_t>& simulatorIds) const {
+		return simulator.getSimulationState(simulatorIds);
+	}
+	inline bool setSimulationState(SimPauseGuard& pauseGuard, const std::vector<simulator_id_t>& simulatorIds, const SimulationState& state) {
+		return simulator.setSimulationState(simulatorIds, state);
+	}
+	inline uint64_t getNetlistFingerprint(SimPauseGuard& pauseGuard, const std::vector<simulator_id_t>& simulatorIds) const {
+		return simulator.getNetlistFingerprint(simulatorIds);
+	}
 
 private:
 	LogicSimulator simulator;
@@ -0,0 +1,84 @@
+#ifndef stateChangeRing_h
+#define stateChangeRing_h
+
+#include "evalTypedef.h"
+#include "logicState.h"
+
+struct StateChange {
+	simulator_id_t id;
+	logic_state_t state;
+};
+
+// Bounded multi producer single consumer queue for the state changes that wait for the start of the next tick.
+// Producers claim cells with a CAS and never lock, the consumer is whoever holds both state mutexes of the LogicSimulator.
+// Every cell carries a sequence number like the bounded queue of Dmitry Vyukov: the cell of position p holds p while it is
+// free and p + 1 once it is filled. A batch claims consecutive cells and fills its first cell last, so the consumer takes
+// either all changes of a batch or none of them and a batch always lands in a single tick.
+class StateChangeRing {
+public:
+	static constexpr size_t capacity = 4096;
+
+	StateChangeRing() {
+		for (size_t i = 0; i < capacity; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	StateChangeRing(const StateChangeRing&) = delete;
+	StateChangeRing& operator=(const StateChangeRing&) = delete;
+
+	// all or nothing, false when the ring has no room for the batch right now. changes.size() has to be at most capacity.
+	bool tryPush(std::span<const StateChange> changes) {
+		if (changes.empty()) return true;
+		size_t position = enqueuePosition.load(std::memory_order_relaxed);
+		while (true) {
+			// cells are freed in order, so when the last cell of the batch is free all cells before it are too
+			const size_t lastPosition = position + changes.size() - 1;
+			const size_t sequence = cells[lastPosition & mask].sequence.load(std::memory_order_acquire);
+			const intptr_t difference = (intptr_t)sequence - (intptr_t)lastPosition;
+			if (difference == 0) {
+				if (enqueuePosition.compare_exchange_weak(position, position + changes.size(), std::memory_order_relaxed)) break;
+			} else if (difference < 0) {
+				return false;
+			} else {
+				position = enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+		for (size_t i = changes.size(); i-- > 0;) {
+			Cell& cell = cells[(position + i) & mask];
+			cell.change = changes[i];
+			cell.sequence.store(position + i + 1, std::memory_order_release);
+		}
+		return true;
+	}
+
+	bool hasPending() const {
+		const size_t position = dequeuePosition.load(std::memory_order_relaxed);
+		return cells[position & mask].sequence.load(std::memory_order_acquire) == position + 1;
+	}
+
+	// consumer only, calls apply for every filled cell in order
+	template <class Apply>
+	void drain(Apply&& apply) {
+		size_t position = dequeuePosition.load(std::memory_order_relaxed);
+		while (true) {
+			Cell& cell = cells[position & mask];
+			if (cell.sequence.load(std::memory_order_acquire) != position + 1) break;
+			apply(cell.change);
+			cell.sequence.store(position + capacity, std::memory_order_release);
+			++position;
+		}
+		dequeuePosition.store(position, std::memory_order_relaxed);
+	}
+
+private:
+	static_assert((capacity & (capacity - 1)) == 0, "the ring masks positions");
+	static constexpr size_t mask = capacity - 1;
+
+	struct Cell {
+		std::atomic<size_t> sequence;
+		StateChange change;
+	};
+	std::array<Cell, capacity> cells;
+	alignas(64) std::atomic<size_t> enqueuePosition { 0 };
+	alignas(64) std::atomic<size_t> dequeuePosition { 0 };
+};
+
+#endif /* stateChangeRing_h */
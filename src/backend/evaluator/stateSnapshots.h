@@ -0,0 +1,101 @@
+#ifndef stateSnapshots_h
+#define stateSnapshots_h
+
+#include "bitPlaneSimulator.h"
+
+// Hands the states of whole ticks from the simulation thread to readers without either side waiting on the other.
+// The simulation thread fills a frame that no reader holds and publishes it, readers pin the published frame and read
+// it for as long as they like. With one reader this is a triple buffer, the extra frames let a few readers hold frames
+// of different ticks at once. When every other frame is pinned the tick just does not publish and readers keep seeing
+// the frame before, they never see a torn one. Frames are only filled for ticks after a read, a tick that no reader
+// asked for just invalidates the published frame, so the simulation thread does not copy the states while nobody looks.
+class StateSnapshots {
+public:
+	static constexpr size_t frameCount = 4;
+
+	struct Frame {
+		uint64_t sequence = 0; // which publish the frame holds, 0 for none
+		bool bitPlanes = false;
+		std::vector<logic_state_t> states;
+		// bit plane frames copy the current planes instead of unpacking them, slotOfId only changes with the layout
+		std::vector<uint64_t> value;
+		std::vector<uint64_t> unknown;
+		std::vector<uint32_t> slotOfId;
+		uint64_t layoutVersion = 0;
+
+		size_t getStateCount() const { return bitPlanes ? slotOfId.size() : states.size(); }
+		logic_state_t getState(simulator_id_t id) const {
+			if (id >= getStateCount()) return logic_state_t::UNDEFINED;
+			if (bitPlanes) return BitPlaneSimulator::getSlotState(value, unknown, slotOfId[id]);
+			return states[id];
+		}
+
+	private:
+		friend class StateSnapshots;
+		mutable std::atomic<uint32_t> readers { 0 };
+	};
+
+	// Keeps a frame pinned while it lives. Empty when there is no current frame, the caller then has to read the states
+	// some other way (that only happens before the first tick and while states are changed outside of a tick).
+	class Reader {
+	public:
+		Reader() = default;
+		Reader(const Reader&) = delete;
+		Reader& operator=(const Reader&) = delete;
+		~Reader() {
+			if (frame) frame->readers.fetch_sub(1, std::memory_order_release);
+		}
+		const Frame* operator->() const { return frame; }
+		explicit operator bool() const { return frame != nullptr; }
+
+	private:
+		friend class StateSnapshots;
+		explicit Reader(const Frame* frame) : frame(frame) {}
+		const Frame* frame = nullptr;
+	};
+
+	Reader read() const {
+		wanted.store(true, std::memory_order_relaxed);
+		while (current.load()) {
+			const Frame* frame = published.load();
+			frame->readers.fetch_add(1);
+			// the writer only refills frames that are not published and not pinned, so if the frame is still the
+			// published one after pinning it, it is complete and stays that way until the reader lets go
+			if (published.load() == frame && current.load()) return Reader(frame);
+			frame->readers.fetch_sub(1, std::memory_order_release);
+		}
+		return Reader();
+	}
+
+	// Simulation side. Returns a frame to fill or nullptr when every other frame is pinned.
+	Frame* beginPublish() {
+		const Frame* latest = published.load();
+		for (size_t i = 0; i < frameCount; ++i) {
+			Frame& frame = frames[(nextFrame + i) % frameCount];
+			if (&frame == latest || frame.readers.load() != 0) continue;
+			nextFrame = (nextFrame + i + 1) % frameCount;
+			return &frame;
+		}
+		return nullptr;
+	}
+	void publish(Frame* frame) {
+		frame->sequence = ++publishCount;
+		published.store(frame);
+		current.store(true);
+	}
+	// the states changed outside of a tick, readers go back to the caller until the next publish
+	void invalidate() { current.store(false); }
+	// true when a reader came since the last call, only then the tick has to fill a frame
+	bool takeWanted() { return wanted.exchange(false, std::memory_order_relaxed); }
+	uint64_t getPublishCount() const { return publishCount; }
+
+private:
+	std::array<Frame, frameCount> frames;
+	std::atomic<Frame*> published { &frames[0] };
+	std::atomic<bool> current { false };
+	mutable std::atomic<bool> wanted { false };
+	size_t nextFrame = 0;
+	uint64_t publishCount = 0;
+};
+
+#endif /* stateSnapshots_h */
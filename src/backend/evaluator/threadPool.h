@@ -1,6 +1,8 @@
 #ifndef threadPool_h
 #define threadPool_h
 
+#include "tickBarrier.h"
+
 #ifdef TRACY_PROFILER
 #include <tracy/Tracy.hpp>
 #endif
@@ -12,6 +14,7 @@ public:
 	{
 		workers.reserve(nthreads);
 		for (size_t i = 0; i < nthreads; ++i) spawnOne();
+		resizeStats();
 	}
 
 	~ThreadPool() {
@@ -19,7 +22,7 @@ public:
 		waitForCompletion();
 		stop.store(true, std::memory_order_relaxed);
 		for (auto& w : workers) w->retire.store(true, std::memory_order_relaxed);
-		cv.notify_all(); // wake any sleepers
+		wakeWorkers(); // wake any sleepers
 		for (auto& w : workers) if (w->th.joinable()) w->th.join();
 	}
 
@@ -28,44 +31,59 @@ public:
 		void* arg;
 	};
 
+	// Time is counted per thread slot, the last slot is the thread that calls waitForCompletion.
+	struct WorkerStats {
+		uint64_t busyNanoseconds = 0; // running jobs
+		uint64_t idleNanoseconds = 0; // waiting for a round or for the other threads to finish
+		uint64_t jobCount = 0;
+		uint64_t stealCount = 0; // jobs taken from the list of another thread
+	};
+
 	// Load a new round that references the caller-owned jobs (no copy/move).
+	// Job list i is owned by thread i, the lists should be balanced by cost. Threads that run out steal from the others.
+	// Rounds are started and waited for by one thread at a time.
 	void resetAndLoad(const std::vector<std::vector<Job>>& new_jobs) {
-		{
-			std::lock_guard lk(mtx);
-			jobsRef = &new_jobs;
-
-			threadsWaiting.store(0, std::memory_order_relaxed);
-			next.resize((*jobsRef).size());
-			for (auto& index : next) {
-				if (!index) index = std::make_shared<std::atomic<unsigned int>>(0);
-				else index->store(0, std::memory_order_relaxed);
-			}
-			round.fetch_add(1, std::memory_order_release);
+		waitForCompletion();
+		jobsRef = &new_jobs;
+		while (ranges.size() < (*jobsRef).size()) ranges.push_back(std::make_unique<JobRange>());
+		for (size_t i = 0; i < (*jobsRef).size(); ++i) {
+			ranges[i]->reset((*jobsRef)[i].size());
 		}
-		cv.notify_all();
+		barrier.setParticipants(workers.size() + 1);
+		roundStart = std::chrono::steady_clock::now();
+		roundPending = true;
+		round.fetch_add(1, std::memory_order_release);
+		wakeWorkers();
 	}
 
 	void waitForCompletion(bool helpCompute = false) {
-		bool sprintingNow = sprinting.load(std::memory_order_acquire);
+		if (!roundPending) return;
 #ifdef TRACY_PROFILER
 		ZoneScoped;
 #endif
 		if (helpCompute && jobsRef != nullptr && (*jobsRef).size() != 0)
 			runTillDone((*jobsRef).size()-1); // if your waiting might as well help do the compute
-		uint32_t w = threadsWaiting.fetch_add(1, std::memory_order_acq_rel);
-		while (true) {
-			if (w >= workers.size()+1) break;
-			if (!sprintingNow) { std::this_thread::yield(); }
-			w = threadsWaiting.load(std::memory_order_acquire);
-		}
+		const auto waitStart = std::chrono::steady_clock::now();
+		barrier.arriveAndWait(waitPolicy.load(std::memory_order_relaxed), spinCount());
+		roundPending = false;
+		lastRoundNanoseconds = nanosecondsSince(roundStart);
+		lastRoundBusyNanoseconds = roundBusyNanoseconds.exchange(0, std::memory_order_relaxed);
+		addIdleTime(workers.size(), waitStart);
 	}
 
+	// timing of the last finished round, for the thread that starts the rounds
+	uint64_t getLastRoundNanoseconds() const { return lastRoundNanoseconds; }
+	// the time all threads together spent running jobs in the last round
+	uint64_t getLastRoundBusyNanoseconds() const { return lastRoundBusyNanoseconds; }
+
 	void resizeThreads(size_t new_count) {
 		size_t cur = workers.size();
 		if (new_count > cur) {
+			waitForCompletion();
 			size_t add = new_count - cur;
 			workers.reserve(workers.size() + add);
 			for (size_t i = 0; i < add; ++i) spawnOne();
+			resizeStats();
 			return;
 		}
 		if (new_count < cur) {
@@ -73,101 +91,214 @@ public:
 			waitForCompletion();
 			for (size_t i = 0; i < kill; ++i)
 				workers[workers.size() - 1 - i]->retire.store(true, std::memory_order_relaxed);
-			cv.notify_all(); // wake sleepers so they can retire
+			wakeWorkers(); // wake sleepers so they can retire
 			for (size_t i = 0; i < kill; ++i) {
 				auto idx = workers.size() - 1;
 				auto& w = workers[idx];
 				if (w->th.joinable()) w->th.join();
 				workers.pop_back();
 			}
+			resizeStats();
 		}
 	}
 
 	size_t threadCount() const { return workers.size(); }
 
+	std::vector<WorkerStats> getWorkerStats() const {
+		std::lock_guard lk(statsMutex);
+		std::vector<WorkerStats> result;
+		result.reserve(stats.size());
+		for (const auto& slot : stats) {
+			result.push_back({
+				slot->busyNanoseconds.load(std::memory_order_relaxed),
+				slot->idleNanoseconds.load(std::memory_order_relaxed),
+				slot->jobCount.load(std::memory_order_relaxed),
+				slot->stealCount.load(std::memory_order_relaxed)
+			});
+		}
+		return result;
+	}
+	void resetWorkerStats() {
+		std::lock_guard lk(statsMutex);
+		for (auto& slot : stats) slot->reset();
+	}
+
+	// sprinting means the next round follows right after the last one, so SPIN_THEN_PARK spins longer before it parks
 	void setSprinting(bool sprint) {
 		sprinting.store(sprint, std::memory_order_release);
 		// logInfo("ThreadPool: sprinting mode {}", "ThreadPool::setSprinting", sprint ? "enabled" : "disabled");
 	}
 
+	void setWaitPolicy(WaitPolicy policy) {
+		if (waitPolicy.exchange(policy, std::memory_order_relaxed) != policy) {
+			wakeWorkers(); // parked workers pick up the new policy
+		}
+	}
+
 private:
 	struct Worker {
 		std::thread th;
 		std::atomic<bool> retire{false};
 		unsigned int threadIndex;
+		uint64_t startRound; // read before the thread starts so the first round can not be missed
 	};
 
 	void spawnOne() {
 		auto w = std::make_unique<Worker>();
 		Worker* self = w.get();
 		w->threadIndex = workers.size();
+		w->startRound = round.load(std::memory_order_relaxed);
 		w->th = std::thread([this, self]{ workerLoop(self); });
 		workers.emplace_back(std::move(w));
 	}
 
 	void workerLoop(Worker* self) {
-		uint64_t local_round = round.load(std::memory_order_acquire);
+		uint64_t local_round = self->startRound;
 		while (true) {
-			threadsWaiting.fetch_add(1, std::memory_order_acq_rel);
-			if (sprinting.load(std::memory_order_acquire)) {
-				while (true) {
-					if (self->retire.load(std::memory_order_relaxed) || stop.load(std::memory_order_relaxed)) {
-						return;
-					}
-					uint64_t cur_round = round.load(std::memory_order_acquire);
-					if (cur_round != local_round) {
-						local_round = cur_round;
-						break;
-					}
-				}
-			} else {
-				std::unique_lock lk(mtx);
-				cv.wait(lk, [this, self, &local_round]{
-					return self->retire.load(std::memory_order_relaxed)
-					   || stop.load(std::memory_order_relaxed)
-					   || round.load(std::memory_order_acquire) != local_round;
-				});
+			const auto waitStart = std::chrono::steady_clock::now();
+			// the signal is read before the round so a round started in between always changes the signal
+			uint32_t signal = wakeSignal.load(std::memory_order_acquire);
+			while (true) {
 				if (self->retire.load(std::memory_order_relaxed) || stop.load(std::memory_order_relaxed)) {
 					return;
 				}
-				local_round = round.load(std::memory_order_acquire);
+				if (round.load(std::memory_order_acquire) != local_round) break;
+				signal = waitWhileEqual(wakeSignal, signal, waitPolicy.load(std::memory_order_relaxed), spinCount());
 			}
+			// a new round can not start before this thread arrived at the barrier, so no round is skipped
+			++local_round;
+			addIdleTime(self->threadIndex, waitStart);
 			runTillDone(self->threadIndex);
+			barrier.arrive();
+		}
+	}
+
+	void wakeWorkers() {
+		wakeSignal.fetch_add(1, std::memory_order_release);
+		wakeSignal.notify_all();
+	}
+
+	uint32_t spinCount() const {
+		return sprinting.load(std::memory_order_relaxed) ? sprintSpinCount : idleSpinCount;
+	}
+
+	// The unclaimed jobs of one list. The owner takes jobs from the front and thieves take them from the back, both ends
+	// live in one word so a single CAS claims a job. Jobs are only added by resetAndLoad so no Chase-Lev buffer is needed.
+	struct alignas(64) JobRange {
+		std::atomic<uint64_t> bounds { 0 }; // front in the low half, back in the high half
+
+		void reset(uint32_t size) { bounds.store((uint64_t)size << 32, std::memory_order_relaxed); }
+		bool popFront(uint32_t& index) {
+			uint64_t current = bounds.load(std::memory_order_acquire);
+			while ((uint32_t)current < (uint32_t)(current >> 32)) {
+				if (bounds.compare_exchange_weak(current, current + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+					index = (uint32_t)current;
+					return true;
+				}
+			}
+			return false;
+		}
+		bool stealBack(uint32_t& index) {
+			uint64_t current = bounds.load(std::memory_order_acquire);
+			while ((uint32_t)current < (uint32_t)(current >> 32)) {
+				if (bounds.compare_exchange_weak(current, current - ((uint64_t)1 << 32), std::memory_order_acq_rel, std::memory_order_acquire)) {
+					index = (uint32_t)(current >> 32) - 1;
+					return true;
+				}
+			}
+			return false;
+		}
+	};
+
+	struct alignas(64) StatsSlot {
+		std::atomic<uint64_t> busyNanoseconds { 0 };
+		std::atomic<uint64_t> idleNanoseconds { 0 };
+		std::atomic<uint64_t> jobCount { 0 };
+		std::atomic<uint64_t> stealCount { 0 };
+
+		void reset() {
+			busyNanoseconds.store(0, std::memory_order_relaxed);
+			idleNanoseconds.store(0, std::memory_order_relaxed);
+			jobCount.store(0, std::memory_order_relaxed);
+			stealCount.store(0, std::memory_order_relaxed);
 		}
+	};
+
+	static inline uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+	inline void addIdleTime(size_t slot, std::chrono::steady_clock::time_point start) {
+		if (slot < stats.size()) stats[slot]->idleNanoseconds.fetch_add(nanosecondsSince(start), std::memory_order_relaxed);
+	}
+	// only called while no round is running
+	void resizeStats() {
+		std::lock_guard lk(statsMutex);
+		while (stats.size() < workers.size() + 1) stats.push_back(std::make_unique<StatsSlot>());
+		stats.resize(workers.size() + 1);
 	}
 
 	inline void runTillDone(unsigned int threadIndex) {
-		unsigned int jobArrayIndex = threadIndex;
-		auto* ptr = next[jobArrayIndex].get();
-		uint32_t i = ptr->fetch_add(1, std::memory_order_acq_rel);
-		while (true) {
 #ifdef TRACY_PROFILER
-			ZoneScoped;
+		ZoneScoped;
 #endif
-			while (i >= (*jobsRef)[jobArrayIndex].size()) {
-				uint32_t w = threadsWaiting.load(std::memory_order_acquire);
-				if (w > 0 || (jobArrayIndex + 1)%(*jobsRef).size() == threadIndex) return;
-				jobArrayIndex = (jobArrayIndex + 1) % (*jobsRef).size();
-				i = next[jobArrayIndex]->fetch_add(1, std::memory_order_acq_rel);
+		// Safe because resetAndLoad keeps jobsRef stable for the duration of the round.
+		const std::vector<std::vector<Job>>& jobLists = *jobsRef;
+		const size_t listCount = jobLists.size();
+		if (listCount == 0) return;
+		const auto busyStart = std::chrono::steady_clock::now();
+		uint64_t jobCount = 0;
+		uint64_t stealCount = 0;
+		uint32_t index;
+
+		if (threadIndex < listCount) {
+			while (ranges[threadIndex]->popFront(index)) {
+				const Job j = jobLists[threadIndex][index];
+				j.fn(j.arg);
+				++jobCount;
 			}
-			// Safe because resetAndLoad keeps jobsRef stable for the duration of the round.
+		}
+		// Nothing is added during a round, so a list that was seen empty stays empty and one pass over the victims is enough.
+		// Every thread starts at a different victim to spread the thieves out.
+		for (size_t offset = 1; offset <= listCount; ++offset) {
+			const size_t victim = (threadIndex + offset) % listCount;
+			if (victim == threadIndex) continue;
+			while (ranges[victim]->stealBack(index)) {
+				const Job j = jobLists[victim][index];
+				j.fn(j.arg);
+				++stealCount;
+			}
+		}
 
-			const Job j = (*jobsRef)[jobArrayIndex][i];
-			j.fn(j.arg);
-			i = next[jobArrayIndex]->fetch_add(1, std::memory_order_acq_rel);
+		const uint64_t busyNanoseconds = nanosecondsSince(busyStart);
+		roundBusyNanoseconds.fetch_add(busyNanoseconds, std::memory_order_relaxed);
+		if (threadIndex < stats.size()) {
+			StatsSlot& slot = *stats[threadIndex];
+			slot.busyNanoseconds.fetch_add(busyNanoseconds, std::memory_order_relaxed);
+			slot.jobCount.fetch_add(jobCount + stealCount, std::memory_order_relaxed);
+			slot.stealCount.fetch_add(stealCount, std::memory_order_relaxed);
 		}
 	}
 
 	std::vector<std::unique_ptr<Worker>> workers;
 	const std::vector<std::vector<Job>>* jobsRef{nullptr}; // reference to current round’s jobs
-	std::vector<std::shared_ptr<std::atomic<uint32_t>>> next; // next index to claim
+	std::vector<std::unique_ptr<JobRange>> ranges; // unclaimed jobs of every list
+	std::vector<std::unique_ptr<StatsSlot>> stats;
+	mutable std::mutex statsMutex;
 	std::atomic<bool> stop{false}; // global shutdown (idle-only)
-	std::atomic<bool> sprinting{false}; // will make waiting for completion not yield
-	std::atomic<uint64_t> round{0}; // generation/epoch for cv wakeups
-	std::atomic<uint32_t> threadsWaiting{0}; // generation/epoch for cv wakeups
+	std::atomic<bool> sprinting{false}; // makes SPIN_THEN_PARK spin longer
+	std::atomic<WaitPolicy> waitPolicy{WaitPolicy::SPIN_THEN_PARK};
+	std::atomic<uint64_t> round{0}; // generation/epoch of the loaded jobs
+	std::atomic<uint32_t> wakeSignal{0}; // changes on every new round and on shutdown, the workers park on it
+	TickBarrier barrier; // end of the round
+	bool roundPending = false; // only touched by the thread that starts the rounds
+	std::chrono::steady_clock::time_point roundStart;
+	std::atomic<uint64_t> roundBusyNanoseconds{0};
+	uint64_t lastRoundNanoseconds = 0;
+	uint64_t lastRoundBusyNanoseconds = 0;
 
-	std::mutex mtx;
-	std::condition_variable cv;
+	// pauses before SPIN_THEN_PARK parks, roughly a millisecond while sprinting and a few microseconds otherwise
+	static constexpr uint32_t sprintSpinCount = 1 << 14;
+	static constexpr uint32_t idleSpinCount = 1 << 8;
 };
 
 #endif /* threadPool_h */
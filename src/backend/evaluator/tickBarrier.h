@@ -0,0 +1,71 @@
+#ifndef tickBarrier_h
+#define tickBarrier_h
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+// How the simulation threads wait for the next tick and for each other to finish one.
+enum class WaitPolicy : uint8_t {
+	SPIN, // lowest latency, every simulation thread keeps a core busy for as long as the simulator exists
+	SPIN_THEN_PARK, // spins for a short while and then sleeps in the kernel
+	PARK // sleeps right away, for machines that run many evaluators at once
+};
+
+inline void spinPause() noexcept {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	_mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+// Blocks while value == old and returns the new value. spinCount bounds the spinning of SPIN_THEN_PARK before the thread
+// parks in atomic::wait (a futex on linux), so whoever changes the value has to call notify_all.
+inline uint32_t waitWhileEqual(const std::atomic<uint32_t>& value, uint32_t old, WaitPolicy policy, uint32_t spinCount) noexcept {
+	uint32_t current = value.load(std::memory_order_acquire);
+	if (policy != WaitPolicy::PARK) {
+		for (uint32_t i = 0; current == old && (policy == WaitPolicy::SPIN || i < spinCount); ++i) {
+			spinPause();
+			current = value.load(std::memory_order_acquire);
+		}
+	}
+	while (current == old) {
+		value.wait(old, std::memory_order_acquire);
+		current = value.load(std::memory_order_acquire);
+	}
+	return current;
+}
+
+// Sense reversing barrier for the end of a ThreadPool round. The last thread to arrive resets the count and flips the
+// generation, so the barrier can be reused right away without a second phase. Threads that have nothing to do after the
+// round only arrive, the thread that waits for the round arrives and waits for the generation to flip.
+class TickBarrier {
+public:
+	// only while no thread is inside the barrier
+	void setParticipants(uint32_t count) {
+		participants = count;
+		remaining.store(count, std::memory_order_relaxed);
+	}
+
+	void arrive() noexcept {
+		if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			remaining.store(participants, std::memory_order_relaxed);
+			generation.fetch_add(1, std::memory_order_release);
+			generation.notify_all();
+		}
+	}
+
+	void arriveAndWait(WaitPolicy policy, uint32_t spinCount) noexcept {
+		const uint32_t current = generation.load(std::memory_order_acquire);
+		arrive();
+		waitWhileEqual(generation, current, policy, spinCount);
+	}
+
+private:
+	alignas(64) std::atomic<uint32_t> remaining { 0 };
+	alignas(64) std::atomic<uint32_t> generation { 0 };
+	uint32_t participants = 0;
+};
+
+#endif /* tickBarrier_h */
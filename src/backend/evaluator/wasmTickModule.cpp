@@ -0,0 +1,365 @@
+#include "wasmTickModule.h"
+
+namespace {
+	enum Opcode : uint8_t {
+		CALL = 0x10,
+		SELECT = 0x1B,
+		LOCAL_GET = 0x20,
+		LOCAL_SET = 0x21,
+		LOCAL_TEE = 0x22,
+		I32_LOAD8_U = 0x2D,
+		I32_STORE8 = 0x3A,
+		I32_CONST = 0x41,
+		I32_EQ = 0x46,
+		I32_AND = 0x71,
+		I32_OR = 0x72,
+		I32_XOR = 0x73,
+		I32_SHL = 0x74,
+		I32_SHR_U = 0x76,
+		END = 0x0B
+	};
+
+	void appendUnsigned(std::vector<uint8_t>& bytes, uint64_t value) {
+		do {
+			uint8_t byte = value & 0x7F;
+			value >>= 7;
+			if (value != 0) byte |= 0x80;
+			bytes.push_back(byte);
+		} while (value != 0);
+	}
+
+	void appendName(std::vector<uint8_t>& bytes, std::string_view name) {
+		appendUnsigned(bytes, name.size());
+		bytes.insert(bytes.end(), name.begin(), name.end());
+	}
+
+	void appendSection(std::vector<uint8_t>& bytes, uint8_t sectionId, const std::vector<uint8_t>& content) {
+		bytes.push_back(sectionId);
+		appendUnsigned(bytes, content.size());
+		bytes.insert(bytes.end(), content.begin(), content.end());
+	}
+
+	// mask of a single state, the masks of the inputs of a gate are or'ed together
+	constexpr int32_t stateBit(logic_state_t state) { return 1 << (int)state; }
+	// the resolved state of a mask of LOW and HIGH bits, two bits per mask: none, LOW, HIGH, both
+	constexpr int32_t resolvedStates =
+		(int)logic_state_t::FLOATING | (int)logic_state_t::LOW << 2 | (int)logic_state_t::HIGH << 4 | (int)logic_state_t::UNDEFINED << 6;
+}
+
+std::vector<uint8_t> WasmTickModule::generate(const CompiledGates& compiledGates, size_t stateCount, bool realistic) {
+	WasmTickModule module(realistic);
+	std::vector<uint32_t> calls;
+	const auto emitTable = [&](CompiledGates::Table table, auto&& emitGate) {
+		const CompiledGates::GateTable& gateTable = compiledGates.getTable(table);
+		gateTable.forEach(0, gateTable.ids.size(), [&](size_t i, const CompiledGates::Chunk& chunk, size_t gate) {
+			emitGate(gateTable.ids[i], gateTable.flags[i], chunk, gate);
+			if (module.code.size() >= maxFunctionSize) module.endFunction(calls);
+		});
+	};
+
+	emitTable(CompiledGates::Table::AND, [&](simulator_id_t id, uint8_t flags, const CompiledGates::Chunk& chunk, size_t gate) {
+		module.emitANDGate(id, flags, chunk.inputsBegin(gate), chunk.inputsEnd(gate));
+	});
+	emitTable(CompiledGates::Table::XOR, [&](simulator_id_t id, uint8_t flags, const CompiledGates::Chunk& chunk, size_t gate) {
+		module.emitXORGate(id, flags, chunk.inputsBegin(gate), chunk.inputsEnd(gate));
+	});
+	emitTable(CompiledGates::Table::TRISTATE_BUFFER, [&](simulator_id_t id, uint8_t flags, const CompiledGates::Chunk& chunk, size_t gate) {
+		module.emitTristateBuffer(id, flags, chunk.inputsBegin(gate), chunk.inputIds.data() + chunk.enableOffsets[gate], chunk.inputsEnd(gate));
+	});
+	// the flags of a constant reset gate hold its state
+	emitTable(CompiledGates::Table::CONSTANT_RESET, [&](simulator_id_t id, uint8_t flags, const CompiledGates::Chunk&, size_t) {
+		module.emitLocal(LOCAL_GET, nextLocal);
+		module.emitConst(flags);
+		module.emitStore(id);
+	});
+	emitTable(CompiledGates::Table::COPY_SELF_OUTPUT, [&](simulator_id_t id, uint8_t, const CompiledGates::Chunk&, size_t) {
+		module.emitLocal(LOCAL_GET, nextLocal);
+		module.emitLoad(currentLocal, id);
+		module.emitStore(id);
+	});
+	if (!module.code.empty()) module.endFunction(calls);
+	const uint32_t gatesFunction = module.addCaller(std::move(calls));
+
+	calls.clear();
+	emitTable(CompiledGates::Table::JUNCTION, [&](simulator_id_t id, uint8_t, const CompiledGates::Chunk& chunk, size_t gate) {
+		module.emitJunction(id, chunk.inputsBegin(gate), chunk.inputsEnd(gate));
+	});
+	if (!module.code.empty()) module.endFunction(calls);
+	const uint32_t junctionsFunction = module.addCaller(std::move(calls));
+
+	return module.finish(gatesFunction, junctionsFunction, stateCount);
+}
+
+void WasmTickModule::endFunction(std::vector<uint32_t>& calls) {
+	std::vector<uint8_t>& body = functions.emplace_back();
+	body.reserve(code.size() + 4);
+	// one group of locals: mask, parity, target and state
+	body.insert(body.end(), { 0x01, 0x04, 0x7F });
+	body.insert(body.end(), code.begin(), code.end());
+	body.push_back(END);
+	calls.push_back(functions.size() - 1);
+	code.clear();
+}
+
+uint32_t WasmTickModule::addCaller(std::vector<uint32_t> calls) {
+	// a call takes at most 9 bytes, callers of callers keep every function below maxFunctionSize
+	constexpr size_t maxCalls = maxFunctionSize / 9;
+	do {
+		std::vector<uint32_t> callers;
+		for (size_t begin = 0; begin == 0 || begin < calls.size(); begin += maxCalls) {
+			for (size_t i = begin; i < std::min(calls.size(), begin + maxCalls); ++i) {
+				emitLocal(LOCAL_GET, currentLocal);
+				emitLocal(LOCAL_GET, nextLocal);
+				emitByte(CALL);
+				emitUnsigned(calls[i]);
+			}
+			endFunction(callers);
+		}
+		calls = std::move(callers);
+	} while (calls.size() > 1);
+	return calls.front();
+}
+
+void WasmTickModule::emitUnsigned(uint32_t value) {
+	appendUnsigned(code, value);
+}
+
+void WasmTickModule::emitConst(int32_t value) {
+	emitByte(I32_CONST);
+	// signed LEB128
+	while (true) {
+		const uint8_t byte = value & 0x7F;
+		value >>= 7;
+		if ((value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40))) {
+			emitByte(byte);
+			return;
+		}
+		emitByte(byte | 0x80);
+	}
+}
+
+void WasmTickModule::emitLocal(uint8_t opcode, uint8_t local) {
+	emitByte(opcode);
+	emitByte(local);
+}
+
+void WasmTickModule::emitLoad(uint8_t base, simulator_id_t id) {
+	emitLocal(LOCAL_GET, base);
+	emitByte(I32_LOAD8_U);
+	emitByte(0); // alignment
+	emitUnsigned(id);
+}
+
+void WasmTickModule::emitStore(simulator_id_t id) {
+	emitByte(I32_STORE8);
+	emitByte(0); // alignment
+	emitUnsigned(id);
+}
+
+// stores the state on the stack to the next states, realistic stores go through SimulatorGate::realisticState
+void WasmTickModule::emitStoreTarget(simulator_id_t id, bool realisticStore) {
+	emitLocal(LOCAL_SET, targetLocal);
+	emitLocal(LOCAL_GET, nextLocal);
+	emitLocal(LOCAL_GET, targetLocal);
+	if (realisticStore) {
+		// the target when the current state is UNDEFINED or the same as the target, otherwise UNDEFINED
+		emitConst((int)logic_state_t::UNDEFINED);
+		emitLoad(currentLocal, id);
+		emitLocal(LOCAL_TEE, stateLocal);
+		emitConst((int)logic_state_t::UNDEFINED);
+		emitByte(I32_EQ);
+		emitLocal(LOCAL_GET, targetLocal);
+		emitLocal(LOCAL_GET, stateLocal);
+		emitByte(I32_EQ);
+		emitByte(I32_OR);
+		emitByte(SELECT);
+	}
+	emitStore(id);
+}
+
+// sets the local to the or of the stateBit of every input
+void WasmTickModule::emitStateMask(uint8_t base, const simulator_id_t* inputsBegin, const simulator_id_t* inputsEnd, uint8_t local) {
+	for (const simulator_id_t* input = inputsBegin; input != inputsEnd; ++input) {
+		emitConst(1);
+		emitLoad(base, *input);
+		emitByte(I32_SHL);
+		if (input != inputsBegin) emitByte(I32_OR);
+	}
+	emitLocal(LOCAL_SET, local);
+}
+
+// pushes the state that the drivers in the mask resolve to, same as JunctionGate::calculate
+void WasmTickModule::emitResolveMask(uint8_t local) {
+	emitConst((int)logic_state_t::UNDEFINED);
+	emitConst(resolvedStates);
+	emitLocal(LOCAL_GET, local);
+	emitConst(stateBit(logic_state_t::LOW) | stateBit(logic_state_t::HIGH));
+	emitByte(I32_AND);
+	emitConst(1);
+	emitByte(I32_SHL);
+	emitByte(I32_SHR_U);
+	emitConst(3);
+	emitByte(I32_AND);
+	emitLocal(LOCAL_GET, local);
+	emitConst(stateBit(logic_state_t::UNDEFINED));
+	emitByte(I32_AND);
+	emitByte(SELECT);
+}
+
+// same as ANDLikeGate::calculate
+void WasmTickModule::emitANDGate(simulator_id_t id, uint8_t flags, const simulator_id_t* inputsBegin, const simulator_id_t* inputsEnd) {
+	if (inputsBegin == inputsEnd) {
+		emitConst((int)logic_state_t::LOW);
+		emitStoreTarget(id, realistic);
+		return;
+	}
+	const bool inputsInverted = flags & CompiledGates::INPUTS_INVERTED;
+	const bool outputInverted = flags & CompiledGates::OUTPUT_INVERTED;
+	emitStateMask(currentLocal, inputsBegin, inputsEnd, maskLocal);
+	// the output for a decisive input, else UNDEFINED for a FLOATING or UNDEFINED input, else the other output
+	emitConst(outputInverted);
+	emitConst((int)logic_state_t::UNDEFINED);
+	emitConst(!outputInverted);
+	emitLocal(LOCAL_GET, maskLocal);
+	emitConst(stateBit(logic_state_t::FLOATING) | stateBit(logic_state_t::UNDEFINED));
+	emitByte(I32_AND);
+	emitByte(SELECT);
+	emitLocal(LOCAL_GET, maskLocal);
+	emitConst(stateBit((logic_state_t)inputsInverted));
+	emitByte(I32_AND);
+	emitByte(SELECT);
+	emitStoreTarget(id, realistic);
+}
+
+// same as XORLikeGate::calculate
+void WasmTickModule::emitXORGate(simulator_id_t id, uint8_t flags, const simulator_id_t* inputsBegin, const simulator_id_t* inputsEnd) {
+	if (inputsBegin == inputsEnd) {
+		emitConst((int)logic_state_t::LOW);
+		emitStoreTarget(id, realistic);
+		return;
+	}
+	// the xor of the states has the parity in bit 0, the or has bit 1 set when any input is FLOATING or UNDEFINED
+	for (const simulator_id_t* input = inputsBegin; input != inputsEnd; ++input) {
+		emitLoad(currentLocal, *input);
+		emitLocal(LOCAL_TEE, stateLocal);
+		if (input != inputsBegin) {
+			emitLocal(LOCAL_GET, parityLocal);
+			emitByte(I32_XOR);
+		}
+		emitLocal(LOCAL_SET, parityLocal);
+		emitLocal(LOCAL_GET, stateLocal);
+		if (input != inputsBegin) {
+			emitLocal(LOCAL_GET, maskLocal);
+			emitByte(I32_OR);
+		}
+		emitLocal(LOCAL_SET, maskLocal);
+	}
+	emitConst((int)logic_state_t::UNDEFINED);
+	emitLocal(LOCAL_GET, parityLocal);
+	emitConst(1);
+	emitByte(I32_AND);
+	if (flags & CompiledGates::OUTPUT_INVERTED) {
+		emitConst(1);
+		emitByte(I32_XOR);
+	}
+	emitLocal(LOCAL_GET, maskLocal);
+	emitConst(2);
+	emitByte(I32_AND);
+	emitByte(SELECT);
+	emitStoreTarget(id, realistic);
+}
+
+// same as TristateBufferGate::calculate
+void WasmTickModule::emitTristateBuffer(
+	simulator_id_t id, uint8_t flags, const simulator_id_t* inputsBegin, const simulator_id_t* enableBegin, const simulator_id_t* inputsEnd
+) {
+	if (enableBegin == inputsEnd) {
+		emitConst((int)logic_state_t::UNDEFINED);
+		emitStoreTarget(id, realistic);
+		return;
+	}
+	// Without UNDEFINED the enables pass the inputs on when they are all HIGH (LOW when the enable is inverted) and
+	// float the output when they are all the other one. Everything else is UNDEFINED.
+	const bool enableInverted = flags & CompiledGates::ENABLE_INVERTED;
+	const int32_t enableMask = stateBit(logic_state_t::LOW) | stateBit(logic_state_t::HIGH) | stateBit(logic_state_t::UNDEFINED);
+	const int32_t passMask = stateBit((logic_state_t)!enableInverted);
+	const int32_t floatMask = stateBit((logic_state_t)enableInverted);
+	emitStateMask(currentLocal, enableBegin, inputsEnd, maskLocal);
+	if (inputsBegin == enableBegin) {
+		emitConst((int)logic_state_t::UNDEFINED);
+	} else {
+		emitStateMask(currentLocal, inputsBegin, enableBegin, parityLocal);
+		emitResolveMask(parityLocal);
+	}
+	emitConst((int)logic_state_t::FLOATING);
+	emitConst((int)logic_state_t::UNDEFINED);
+	emitLocal(LOCAL_GET, maskLocal);
+	emitConst(enableMask);
+	emitByte(I32_AND);
+	emitConst(floatMask);
+	emitByte(I32_EQ);
+	emitByte(SELECT);
+	emitLocal(LOCAL_GET, maskLocal);
+	emitConst(enableMask);
+	emitByte(I32_AND);
+	emitConst(passMask);
+	emitByte(I32_EQ);
+	emitByte(SELECT);
+	emitStoreTarget(id, realistic);
+}
+
+// same as JunctionGate::calculate, junctions read and write the next states
+void WasmTickModule::emitJunction(simulator_id_t id, const simulator_id_t* inputsBegin, const simulator_id_t* inputsEnd) {
+	if (inputsBegin == inputsEnd) {
+		emitLocal(LOCAL_GET, nextLocal);
+		emitConst((int)logic_state_t::FLOATING);
+		emitStore(id);
+		return;
+	}
+	emitStateMask(nextLocal, inputsBegin, inputsEnd, maskLocal);
+	emitLocal(LOCAL_GET, nextLocal);
+	emitResolveMask(maskLocal);
+	emitStore(id);
+}
+
+std::vector<uint8_t> WasmTickModule::finish(uint32_t gatesFunction, uint32_t junctionsFunction, size_t stateCount) const {
+	std::vector<uint8_t> bytes = { 0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00 };
+	std::vector<uint8_t> content;
+
+	// one type for every function: (current: i32, next: i32) -> ()
+	content = { 0x01, 0x60, 0x02, 0x7F, 0x7F, 0x00 };
+	appendSection(bytes, 1, content);
+
+	content.clear();
+	appendUnsigned(content, functions.size());
+	content.insert(content.end(), functions.size(), 0x00);
+	appendSection(bytes, 3, content);
+
+	const size_t byteCount = getNextStatesOffset(stateCount) + stateCount;
+	content = { 0x01, 0x00 };
+	appendUnsigned(content, std::max<size_t>(1, (byteCount + wasmPageSize - 1) / wasmPageSize));
+	appendSection(bytes, 5, content);
+
+	content = { 0x03 };
+	appendName(content, "states");
+	content.insert(content.end(), { 0x02, 0x00 });
+	appendName(content, "gates");
+	content.push_back(0x00);
+	appendUnsigned(content, gatesFunction);
+	appendName(content, "junctions");
+	content.push_back(0x00);
+	appendUnsigned(content, junctionsFunction);
+	appendSection(bytes, 7, content);
+
+	size_t codeSize = 0;
+	for (const std::vector<uint8_t>& body : functions) codeSize += body.size() + 5;
+	content.clear();
+	content.reserve(codeSize + 5);
+	appendUnsigned(content, functions.size());
+	for (const std::vector<uint8_t>& body : functions) {
+		appendUnsigned(content, body.size());
+		content.insert(content.end(), body.begin(), body.end());
+	}
+	appendSection(bytes, 10, content);
+	return bytes;
+}
@@ -0,0 +1,60 @@
+#ifndef wasmTickModule_h
+#define wasmTickModule_h
+
+#include "compiledGates.h"
+
+// Writes one tick of the CompiledGates as a WebAssembly module with straight-line code for every gate, wasmtime turns it
+// into native code (see WasmTickProgram). The states are bytes in the linear memory "states", the ids are the load and
+// store offsets. Both exports take the offsets of the current and the next states:
+//   gates(current, next)      every AND, XOR, tristate buffer, constant reset and copy self output gate
+//   junctions(current, next)  the junctions in index order on next, same as CompiledGates::tickJunctions
+// The buffers are not part of the module, they keep their delay rings on the host and are ticked between the two calls.
+class WasmTickModule {
+public:
+	// the next states start here, the current states at 0
+	static size_t getNextStatesOffset(size_t stateCount) { return (stateCount + 7) & ~size_t(7); }
+
+	static std::vector<uint8_t> generate(const CompiledGates& compiledGates, size_t stateCount, bool realistic);
+
+private:
+	static constexpr size_t maxFunctionSize = 1 << 15; // bytes of code, cranelift is slow on huge functions
+	static constexpr size_t wasmPageSize = 1 << 16;
+
+	// locals of every function
+	static constexpr uint8_t currentLocal = 0;
+	static constexpr uint8_t nextLocal = 1;
+	static constexpr uint8_t maskLocal = 2;
+	static constexpr uint8_t parityLocal = 3;
+	static constexpr uint8_t targetLocal = 4;
+	static constexpr uint8_t stateLocal = 5;
+
+	WasmTickModule(bool realistic) : realistic(realistic) {}
+
+	bool realistic;
+	std::vector<std::vector<uint8_t>> functions; // the bodies without their size
+	std::vector<uint8_t> code;
+
+	void endFunction(std::vector<uint32_t>& calls);
+	uint32_t addCaller(std::vector<uint32_t> calls);
+
+	void emitByte(uint8_t byte) { code.push_back(byte); }
+	void emitUnsigned(uint32_t value);
+	void emitConst(int32_t value);
+	void emitLocal(uint8_t opcode, uint8_t local);
+	void emitLoad(uint8_t base, simulator_id_t id);
+	void emitStore(simulator_id_t id);
+	void emitStoreTarget(simulator_id_t id, bool realisticStore);
+	void emitStateMask(uint8_t base, const simulator_id_t* inputsBegin, const simulator_id_t* inputsEnd, uint8_t local);
+	void emitResolveMask(uint8_t local);
+
+	void emitANDGate(simulator_id_t id, uint8_t flags, const simulator_id_t* inputsBegin, const simulator_id_t* inputsEnd);
+	void emitXORGate(simulator_id_t id, uint8_t flags, const simulator_id_t* inputsBegin, const simulator_id_t* inputsEnd);
+	void emitTristateBuffer(
+		simulator_id_t id, uint8_t flags, const simulator_id_t* inputsBegin, const simulator_id_t* enableBegin, const simulator_id_t* inputsEnd
+	);
+	void emitJunction(simulator_id_t id, const simulator_id_t* inputsBegin, const simulator_id_t* inputsEnd);
+
+	std::vector<uint8_t> finish(uint32_t gatesFunction, uint32_t junctionsFunction, size_t stateCount) const;
+};
+
+#endif /* wasmTickModule_h */
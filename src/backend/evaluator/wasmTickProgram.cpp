@@ -0,0 +1,131 @@
+#include "wasmTickProgram.h"
+#include "wasmTickModule.h"
+
+#include "backend/wasm/wasm.h"
+
+struct WasmTickProgram::Instance {
+	wasmtime::Store store;
+	std::optional<wasmtime::Instance> instance;
+	std::array<std::optional<wasmtime::Func>, 2> functions;
+
+	Instance(wasmtime::Engine& engine) : store(engine) {}
+};
+
+std::unique_ptr<WasmTickProgram> WasmTickProgram::create(std::vector<uint8_t>& module, size_t stateCount, bool realistic) {
+	wasmtime::Engine* engine = Wasm::getEngine();
+	if (engine == nullptr) {
+		logError("Engine not initialized.", "WasmTickProgram::create");
+		return nullptr;
+	}
+
+	try {
+		wasmtime::Result<wasmtime::Module> moduleResult = wasmtime::Module::compile(*engine, module);
+		if (!moduleResult) {
+			logError("Module compilation failed: {}", "WasmTickProgram::create", moduleResult.err().message());
+			return nullptr;
+		}
+
+		std::unique_ptr<Instance> instance = std::make_unique<Instance>(*engine);
+		wasmtime::Linker linker(*engine);
+		auto instanceResult = linker.instantiate(instance->store, moduleResult.unwrap());
+		if (!instanceResult) {
+			logError("Failed to instantiate WASM module: {}", "WasmTickProgram::create", instanceResult.err().message());
+			return nullptr;
+		}
+		instance->instance.emplace(std::move(instanceResult.unwrap()));
+
+		std::optional<wasmtime::Extern> gatesExport = instance->instance.value().get(instance->store, "gates");
+		std::optional<wasmtime::Extern> junctionsExport = instance->instance.value().get(instance->store, "junctions");
+		std::optional<wasmtime::Extern> statesExport = instance->instance.value().get(instance->store, "states");
+		if (!gatesExport || !junctionsExport || !statesExport) {
+			logError("Failed to get the exports of the tick module.", "WasmTickProgram::create");
+			return nullptr;
+		}
+		instance->functions[gatesFunction].emplace(std::get<wasmtime::Func>(gatesExport.value()));
+		instance->functions[junctionsFunction].emplace(std::get<wasmtime::Func>(junctionsExport.value()));
+		// the memory never grows, so its data stays where it is
+		wasmtime::Memory memory = std::get<wasmtime::Memory>(statesExport.value());
+		logic_state_t* memoryData = reinterpret_cast<logic_state_t*>(memory.data(instance->store).data());
+
+		return std::unique_ptr<WasmTickProgram>(new WasmTickProgram(std::move(instance), memoryData, stateCount, realistic));
+	} catch (const std::exception& e) {
+		logError("Exception during module compilation: {}", "WasmTickProgram::create", e.what());
+		return nullptr;
+	}
+}
+
+WasmTickProgram::WasmTickProgram(std::unique_ptr<Instance> instance, logic_state_t* memory, size_t stateCount, bool realistic) :
+	instance(std::move(instance)), memory(memory), stateCount(stateCount), realistic(realistic),
+	nextOffset(WasmTickModule::getNextStatesOffset(stateCount)) {}
+
+WasmTickProgram::~WasmTickProgram() = default;
+
+bool WasmTickProgram::call(size_t function) {
+	auto result = instance->functions[function].value().call(
+		instance->store, { wasmtime::Val((int32_t)currentOffset), wasmtime::Val((int32_t)nextOffset) }
+	);
+	if (!result) {
+		logError("Tick module trapped: {}", "WasmTickProgram::call", result.err().message());
+		return false;
+	}
+	return true;
+}
+
+WasmTickCompiler::~WasmTickCompiler() {
+	{
+		std::lock_guard<std::mutex> lk(mutex);
+		running = false;
+		cv.notify_all();
+	}
+	// a compile that already started can not be stopped, this waits for it
+	if (thread.joinable()) thread.join();
+}
+
+void WasmTickCompiler::request(std::vector<uint8_t> module, size_t stateCount, bool realistic, uint64_t version) {
+	std::lock_guard<std::mutex> lk(mutex);
+	pending.emplace(Request { std::move(module), stateCount, realistic, version });
+	if (!thread.joinable()) thread = std::thread(&WasmTickCompiler::compileLoop, this);
+	cv.notify_all();
+}
+
+std::unique_ptr<WasmTickProgram> WasmTickCompiler::take(uint64_t version) {
+	if (!hasFinished.load(std::memory_order_acquire)) return nullptr;
+	std::unique_ptr<WasmTickProgram> program;
+	{
+		std::lock_guard<std::mutex> lk(mutex);
+		hasFinished.store(false, std::memory_order_relaxed);
+		program = std::move(finished);
+		if (finishedVersion != version) program.reset();
+	}
+	return program;
+}
+
+bool WasmTickCompiler::waitForFinished(std::chrono::milliseconds timeout) {
+	std::unique_lock<std::mutex> lk(mutex);
+	finishedCv.wait_for(lk, timeout, [&] {
+		return hasFinished.load(std::memory_order_relaxed) || (!pending.has_value() && !compiling);
+	});
+	return hasFinished.load(std::memory_order_relaxed);
+}
+
+void WasmTickCompiler::compileLoop() {
+	std::unique_lock<std::mutex> lk(mutex);
+	while (true) {
+		cv.wait(lk, [&] { return pending.has_value() || !running; });
+		if (!running) return;
+		Request request = std::move(pending.value());
+		pending.reset();
+		compiling = true;
+
+		lk.unlock();
+		std::unique_ptr<WasmTickProgram> program = WasmTickProgram::create(request.module, request.stateCount, request.realistic);
+		request.module = {};
+		lk.lock();
+
+		finished = std::move(program);
+		finishedVersion = request.version;
+		compiling = false;
+		hasFinished.store(true, std::memory_order_release);
+		finishedCv.notify_all();
+	}
+}
@@ -0,0 +1,79 @@
+#ifndef wasmTickProgram_h
+#define wasmTickProgram_h
+
+#include "logicState.h"
+
+// A WasmTickModule compiled to native code by wasmtime (cranelift) and instantiated in a store of its own, so it can be
+// made on one thread and ticked on another. The current and the next states live in the linear memory of the instance
+// and trade places every tick.
+class WasmTickProgram {
+public:
+	// nullptr when wasmtime is not initialized or the module does not compile, the reason is logged
+	static std::unique_ptr<WasmTickProgram> create(std::vector<uint8_t>& module, size_t stateCount, bool realistic);
+	~WasmTickProgram();
+
+	size_t getStateCount() const { return stateCount; }
+	bool isRealistic() const { return realistic; }
+	logic_state_t* getStates() { return memory + currentOffset; }
+	const logic_state_t* getStates() const { return memory + currentOffset; }
+	logic_state_t* getNextStates() { return memory + nextOffset; }
+	const logic_state_t* getNextStates() const { return memory + nextOffset; }
+
+	// both return false when the module trapped
+	bool tickGates() { return call(gatesFunction); }
+	bool tickJunctions() { return call(junctionsFunction); }
+	void swapStates() { std::swap(currentOffset, nextOffset); }
+
+private:
+	struct Instance;
+
+	WasmTickProgram(std::unique_ptr<Instance> instance, logic_state_t* memory, size_t stateCount, bool realistic);
+	bool call(size_t function);
+
+	static constexpr size_t gatesFunction = 0;
+	static constexpr size_t junctionsFunction = 1;
+
+	std::unique_ptr<Instance> instance;
+	logic_state_t* memory;
+	size_t stateCount;
+	bool realistic;
+	size_t currentOffset = 0;
+	size_t nextOffset;
+};
+
+// Turns modules into WasmTickPrograms on a thread of its own while the simulation goes on, the thread is started by the
+// first request. Only the newest request is compiled, older ones that did not start yet are dropped.
+class WasmTickCompiler {
+public:
+	~WasmTickCompiler();
+
+	void request(std::vector<uint8_t> module, size_t stateCount, bool realistic, uint64_t version);
+	// The program of the last finished request if it has the version, nullptr while it is compiling or when it failed.
+	// Cheap while nothing finished, so it can be asked every tick.
+	std::unique_ptr<WasmTickProgram> take(uint64_t version);
+	// Waits until a request finished or until timeout. False when nothing is requested or compiling, or on the timeout.
+	bool waitForFinished(std::chrono::milliseconds timeout);
+
+private:
+	struct Request {
+		std::vector<uint8_t> module;
+		size_t stateCount;
+		bool realistic;
+		uint64_t version;
+	};
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::condition_variable finishedCv;
+	bool running = true;
+	bool compiling = false;
+	std::optional<Request> pending;
+	std::unique_ptr<WasmTickProgram> finished;
+	uint64_t finishedVersion = 0;
+	std::atomic<bool> hasFinished { false };
+
+	void compileLoop();
+};
+
+#endif /* wasmTickProgram_h */
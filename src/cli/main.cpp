@@ -1,4 +1,85 @@
+#include "environment/environment.h"
+#include "computerAPI/directoryManager.h"
 
-int main() {
-	logInfo("Im the CLI app!");
+static const std::string usage = "Usage: <circuit file> [--ticks N] [--load-checkpoint PATH] [--save-checkpoint PATH]";
+
+// Reads a whole decimal number, rejecting signs, trailing characters and values that do not fit.
+static std::optional<unsigned long long> parseCount(const std::string& text) {
+	if (text.empty() || !std::isdigit((unsigned char)text.front())) return std::nullopt;
+	try {
+		size_t parsedLength = 0;
+		unsigned long long value = std::stoull(text, &parsedLength);
+		if (parsedLength != text.size()) return std::nullopt;
+		return value;
+	} catch (const std::exception&) {
+		return std::nullopt;
+	}
+}
+
+// Simulates the last circuit in the file for N ticks, starting from the checkpoint if one is given.
+int main(int argc, char* argv[]) {
+	std::string circuitPath;
+	std::string loadCheckpointPath;
+	std::string saveCheckpointPath;
+	unsigned long long ticks = 0;
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (arg == "--ticks" && i + 1 < argc) {
+			std::optional<unsigned long long> parsedTicks = parseCount(argv[++i]);
+			if (!parsedTicks) {
+				logError("--ticks takes a number of ticks, got \"{}\"", "CLI", argv[i]);
+				logInfo(usage, "CLI");
+				return EXIT_FAILURE;
+			}
+			ticks = parsedTicks.value();
+		} else if ((arg == "--ticks" || arg == "--load-checkpoint" || arg == "--save-checkpoint") && i + 1 >= argc) {
+			logError("{} is missing its value", "CLI", arg);
+			logInfo(usage, "CLI");
+			return EXIT_FAILURE;
+		} else if (arg == "--load-checkpoint" && i + 1 < argc) {
+			loadCheckpointPath = argv[++i];
+		} else if (arg == "--save-checkpoint" && i + 1 < argc) {
+			saveCheckpointPath = argv[++i];
+		} else if (circuitPath.empty()) {
+			circuitPath = arg;
+		} else {
+			logError("Unknown argument {}", "CLI", arg);
+			logInfo(usage, "CLI");
+			return EXIT_FAILURE;
+		}
+	}
+	if (circuitPath.empty()) {
+		logInfo(usage, "CLI");
+		return EXIT_SUCCESS;
+	}
+
+	DirectoryManager::findDirectories();
+	Environment environment;
+	std::vector<circuit_id_t> circuitIds = environment.getCircuitFileManager().loadFromFile(circuitPath);
+	if (circuitIds.empty()) {
+		logError("No circuits loaded from {}", "CLI", circuitPath);
+		return EXIT_FAILURE;
+	}
+	std::optional<evaluator_id_t> evaluatorId = environment.getBackend().createEvaluator(circuitIds.back());
+	if (!evaluatorId) {
+		logError("Failed to create an evaluator for {}", "CLI", circuitPath);
+		return EXIT_FAILURE;
+	}
+	SharedEvaluator evaluator = environment.getBackend().getEvaluator(evaluatorId.value());
+	if (!loadCheckpointPath.empty() && !evaluator->loadCheckpoint(loadCheckpointPath)) {
+		return EXIT_FAILURE;
+	}
+
+	// tickStep takes an unsigned int, so long runs are split up
+	while (ticks > 0) {
+		const unsigned int step = (unsigned int)std::min<unsigned long long>(ticks, std::numeric_limits<int>::max());
+		evaluator->tickStep(step);
+		ticks -= step;
+	}
+	logInfo("Simulated to tick {}", "CLI", evaluator->getTickCount());
+
+	if (!saveCheckpointPath.empty() && !evaluator->saveCheckpoint(saveCheckpointPath)) {
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
 }
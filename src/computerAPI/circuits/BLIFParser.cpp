@@ -44,6 +44,8 @@ std::vector<circuit_id_t> BLIFParser::load(const std::string& path) {
 				current.parsedCircuit = nullptr;
 			}
 			current.nameToConnectionEnd.clear();
+			current.nameAliases.clear();
+			current.nameToInverter.clear();
 			current.connectionsToMake.clear();
 			current.endId = 0;
 			current.inPortY = 0;
@@ -85,7 +87,12 @@ std::vector<circuit_id_t> BLIFParser::load(const std::string& path) {
 			std::string output = ports.back();
 			ports.pop_back();
 			inputFile >> std::ws;
+			// Each row is only given a gate when it needs one. A single '1' literal is the input signal itself, a row of
+			// only '0' literals is one NOR, and each signal gets one inverter that every row shares. A cover of one row is
+			// its row term, so the OR is only added when there is more than one term. The inverters stay, absorbing them into
+			// the gates that read them would take a tick off every path through them.
 			std::vector<block_id_t> gates;
+			std::vector<std::string> aliases;
 			while (!inputFile.eof() && inputFile.peek() != '.') {
 				inputFile >> token;
 				inputFile >> cToken;
@@ -93,28 +100,51 @@ std::vector<circuit_id_t> BLIFParser::load(const std::string& path) {
 				if (ports.size() != token.size()) {
 					logError("Bad input plane \"{}\" of size {}. Should be {} bits wide.", "BLIFParser", token, token.size(), ports.size());
 				}
-				current.parsedCircuit->addBlock(++current.blockIdCounter, BlockType::AND);
-
-				block_id_t blockId = current.blockIdCounter;
-				gates.push_back(blockId);
-				unsigned int index = 0;
-				for (char c : token) {
-					if (c == '1') {
-						current.connectionsToMake.emplace_back(ports[index], ConnectionEnd(blockId, 0));
-					} else if (c == '0') {
-						current.parsedCircuit->addBlock(++current.blockIdCounter, BlockType::NOR);
-						current.connectionsToMake.emplace_back(ports[index], ConnectionEnd(current.blockIdCounter, 0));
-						current.parsedCircuit->addConnection(current.blockIdCounter, 1, blockId, 0);
+				std::vector<std::string> ones;
+				std::vector<std::string> zeros;
+				for (unsigned int index = 0; index < token.size() && index < ports.size(); ++index) {
+					if (token[index] == '1') ones.push_back(ports[index]);
+					else if (token[index] == '0') zeros.push_back(ports[index]);
+				}
+				if (ones.size() == 1 && zeros.empty()) {
+					aliases.push_back(std::move(ones.front()));
+				} else if (ones.empty() && zeros.size() == 1) {
+					gates.push_back(getInverter(current, zeros.front()));
+				} else if (ones.empty() && !zeros.empty()) {
+					current.parsedCircuit->addBlock(++current.blockIdCounter, BlockType::NOR);
+					for (const std::string& name : zeros) {
+						current.connectionsToMake.emplace_back(name, ConnectionEnd(current.blockIdCounter, 0));
+					}
+					gates.push_back(current.blockIdCounter);
+				} else {
+					current.parsedCircuit->addBlock(++current.blockIdCounter, BlockType::AND);
+					block_id_t blockId = current.blockIdCounter;
+					for (const std::string& name : ones) {
+						current.connectionsToMake.emplace_back(name, ConnectionEnd(blockId, 0));
+					}
+					for (const std::string& name : zeros) {
+						current.parsedCircuit->addConnection(getInverter(current, name), 1, blockId, 0);
 					}
-					++index;
+					gates.push_back(blockId);
 				}
 				inputFile >> std::ws;
 			}
+			if (gates.size() + aliases.size() == 1) {
+				if (aliases.empty()) {
+					current.nameToConnectionEnd.emplace(output, ConnectionEnd(gates.front(), 1));
+				} else {
+					current.nameAliases.emplace(output, std::move(aliases.front()));
+				}
+				continue;
+			}
 			current.parsedCircuit->addBlock(++current.blockIdCounter, BlockType::OR);
 			current.nameToConnectionEnd.emplace(output, ConnectionEnd(current.blockIdCounter, 1));
 			for (block_id_t gate : gates) {
 				current.parsedCircuit->addConnection(gate, 1, current.blockIdCounter, 0);
 			}
+			for (const std::string& name : aliases) {
+				current.connectionsToMake.emplace_back(name, ConnectionEnd(current.blockIdCounter, 0));
+			}
 		} else if (token == ".subckt") {
 			std::string blockName;
 			inputFile >> blockName;
@@ -184,28 +214,28 @@ std::vector<circuit_id_t> BLIFParser::load(const std::string& path) {
 			}
 		}
 		for (const auto& connection : cirData.connectionsToMake) {
-			auto iter = cirData.nameToConnectionEnd.find(connection.first);
-			if (iter == cirData.nameToConnectionEnd.end()) {
+			const ConnectionEnd* connectionEnd = findConnectionEnd(cirData, connection.first);
+			if (!connectionEnd) {
 				logError("Failed to make connection. Port \"{}\" was never defined.", "BLIFParser", connection.first);
 				continue;
 			}
 			cirData.parsedCircuit->addConnection(
-				iter->second.getBlockId(),
-				iter->second.getConnectionId(),
+				connectionEnd->getBlockId(),
+				connectionEnd->getConnectionId(),
 				connection.second.getBlockId(),
 				connection.second.getConnectionId()
 			);
 		}
 		for (const auto& port : cirData.parsedCircuit->getConnectionPorts()) {
 			if (port.isInput) continue;
-			auto iter = cirData.nameToConnectionEnd.find(port.portName);
-			if (iter == cirData.nameToConnectionEnd.end()) {
+			const ConnectionEnd* connectionEnd = findConnectionEnd(cirData, port.portName);
+			if (!connectionEnd) {
 				logError("Failed to make connection. Port \"{}\" was never defined.", "BLIFParser", port.portName);
 				continue;
 			}
 			cirData.parsedCircuit->addConnection(
-				iter->second.getBlockId(),
-				iter->second.getConnectionId(),
+				connectionEnd->getBlockId(),
+				connectionEnd->getConnectionId(),
 				port.internalBlockId,
 				port.internalBlockConnectionEndId
 			);
@@ -218,3 +248,25 @@ std::vector<circuit_id_t> BLIFParser::load(const std::string& path) {
 	importedFiles.erase(path);
 	return circuitIds;
 }
+
+block_id_t BLIFParser::getInverter(BLIFParsedCircuitData& cirData, const std::string& name) {
+	auto iter = cirData.nameToInverter.find(name);
+	if (iter != cirData.nameToInverter.end()) return iter->second;
+	cirData.parsedCircuit->addBlock(++cirData.blockIdCounter, BlockType::NOR);
+	cirData.connectionsToMake.emplace_back(name, ConnectionEnd(cirData.blockIdCounter, 0));
+	cirData.nameToInverter.emplace(name, cirData.blockIdCounter);
+	return cirData.blockIdCounter;
+}
+
+const ConnectionEnd* BLIFParser::findConnectionEnd(const BLIFParsedCircuitData& cirData, const std::string& name) {
+	const std::string* current = &name;
+	// more hops than there are aliases means the aliases loop
+	for (size_t hops = 0; hops <= cirData.nameAliases.size(); ++hops) {
+		auto iter = cirData.nameToConnectionEnd.find(*current);
+		if (iter != cirData.nameToConnectionEnd.end()) return &(iter->second);
+		auto aliasIter = cirData.nameAliases.find(*current);
+		if (aliasIter == cirData.nameAliases.end()) return nullptr;
+		current = &(aliasIter->second);
+	}
+	return nullptr;
+}
@@ -17,6 +17,8 @@ private:
 		SharedParsedCircuit parsedCircuit;
 		std::vector<std::pair<std::string, std::unordered_map<std::string, std::string>>> customBlocksToAdd;
 		std::unordered_map<std::string, ConnectionEnd> nameToConnectionEnd;
+		std::unordered_map<std::string, std::string> nameAliases; // names defined as a buffer of another name
+		std::unordered_map<std::string, block_id_t> nameToInverter;
 		std::vector<std::pair<std::string, ConnectionEnd>> connectionsToMake;
 		connection_end_id_t endId;
 		coordinate_t inPortY;
@@ -25,6 +27,9 @@ private:
 		BlockType type = BlockType::NONE;
 	};
 
+	static block_id_t getInverter(BLIFParsedCircuitData& cirData, const std::string& name);
+	static const ConnectionEnd* findConnectionEnd(const BLIFParsedCircuitData& cirData, const std::string& name);
+
 	std::map<std::string, BLIFParsedCircuitData> BLIFParsedCircuits;
 	std::unordered_set<std::string> importedFiles;
 };
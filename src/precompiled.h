@@ -14,6 +14,7 @@
 #include <chrono>
 
 #include <array>
+#include <bit>
 #include <condition_variable>
 #include <list>
 #include <map>
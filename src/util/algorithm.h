@@ -73,4 +73,10 @@ inline void stringSplitInto(const std::string& s, const char delimiter, std::vec
 	}
 }
 
+// mixes value into a running 64 bit hash, the order of the values matters
+inline void mixFingerprint(uint64_t& fingerprint, uint64_t value) {
+	fingerprint = (fingerprint ^ value) * 0x9E3779B97F4A7C15ull;
+	fingerprint ^= fingerprint >> 32;
+}
+
 #endif /* algorithm_h */
@@ -0,0 +1,78 @@
+#include "blifParserTest.h"
+
+void BLIFParserTest::TearDown() {
+	for (const std::filesystem::path& file : files) {
+		std::filesystem::remove(file);
+	}
+}
+
+std::vector<circuit_id_t> BLIFParserTest::load(const std::string& text) {
+	std::filesystem::path file = std::filesystem::temp_directory_path() / ("blifParserTest" + std::to_string(files.size()) + ".blif");
+	std::ofstream(file) << text;
+	files.push_back(file);
+	return fileManager.loadFromFile(file.generic_string());
+}
+
+Position BLIFParserTest::getPortPosition(circuit_id_t circuitId, const std::string& portName) {
+	CircuitManager& circuitManager = backend.getCircuitManager();
+	const CircuitBlockData* circuitBlockData = circuitManager.getCircuitBlockDataManager()->getCircuitBlockData(circuitId);
+	const BlockData* blockData = circuitManager.getBlockDataManager()->getBlockData(circuitBlockData->getBlockType());
+	for (connection_end_id_t endId = 0; endId < blockData->getConnectionCount(); ++endId) {
+		if (blockData->getConnectionIdToName(endId) == portName) {
+			return *circuitBlockData->getConnectionIdToPosition(endId);
+		}
+	}
+	ADD_FAILURE() << "no port named " << portName;
+	return Position();
+}
+
+TEST_F(BLIFParserTest, CoverGates) {
+	std::vector<circuit_id_t> circuitIds = load(
+		".model cover\n"
+		".inputs a b c\n"
+		".outputs x y z w\n"
+		// one row of ones is one AND
+		".names a b x\n"
+		"11 1\n"
+		// two rows are an OR of two ANDs, the negated inputs share one inverter each
+		".names a b c y\n"
+		"1-0 1\n"
+		"01- 1\n"
+		// a single one is the input itself
+		".names a z\n"
+		"1 1\n"
+		// a row of zeros is one NOR
+		".names b c w\n"
+		"00 1\n"
+		".end\n"
+	);
+	ASSERT_EQ(circuitIds.size(), 1);
+	const circuit_id_t circuitId = circuitIds.front();
+	SharedCircuit circuit = backend.getCircuit(circuitId);
+	const BlockContainer& blockContainer = *circuit->getBlockContainer();
+	ASSERT_EQ(blockContainer.getBlockTypeCount(BlockType::SWITCH), 3);
+	ASSERT_EQ(blockContainer.getBlockTypeCount(BlockType::LIGHT), 4);
+	ASSERT_EQ(blockContainer.getBlockTypeCount(BlockType::AND), 3);
+	ASSERT_EQ(blockContainer.getBlockTypeCount(BlockType::OR), 1);
+	ASSERT_EQ(blockContainer.getBlockTypeCount(BlockType::NOR), 3);
+	ASSERT_EQ(blockContainer.getBlockCount(), 14);
+
+	SharedEvaluator evaluator = backend.getEvaluator(backend.createEvaluator(circuitId).value());
+	std::vector<Position> inputs = { getPortPosition(circuitId, "a"), getPortPosition(circuitId, "b"), getPortPosition(circuitId, "c") };
+	std::vector<Position> outputs = {
+		getPortPosition(circuitId, "x"), getPortPosition(circuitId, "y"), getPortPosition(circuitId, "z"), getPortPosition(circuitId, "w")
+	};
+	for (int row = 0; row < 8; ++row) {
+		const bool a = row & 1;
+		const bool b = row & 2;
+		const bool c = row & 4;
+		evaluator->setState(Address(inputs[0]), fromBool(a));
+		evaluator->setState(Address(inputs[1]), fromBool(b));
+		evaluator->setState(Address(inputs[2]), fromBool(c));
+		evaluator->tickStep(4);
+		const bool expected[] = { a && b, (a && !c) || (!a && b), a, !b && !c };
+		for (size_t j = 0; j < outputs.size(); ++j) {
+			ASSERT_EQ(evaluator->getState(Address(outputs[j])), fromBool(expected[j])) << "row " << row << " output " << j;
+		}
+	}
+}
@@ -0,0 +1,27 @@
+#ifndef blifParserTest_h
+#define blifParserTest_h
+
+#include <gtest/gtest.h>
+
+#include "backend/backend.h"
+#include "computerAPI/circuits/circuitFileManager.h"
+
+class BLIFParserTest : public ::testing::Test {
+public:
+	BLIFParserTest() : backend(nullptr), fileManager(&backend.getCircuitManager()) {
+		backend.getCircuitManager().getBlockDataManager()->initializeDefaults();
+	}
+
+protected:
+	void SetUp() override { }
+	void TearDown() override;
+	// writes the text to a .blif file and loads it
+	std::vector<circuit_id_t> load(const std::string& text);
+	// the position of the switch or light that the port of the circuit is connected to
+	Position getPortPosition(circuit_id_t circuitId, const std::string& portName);
+	Backend backend;
+	CircuitFileManager fileManager;
+	std::vector<std::filesystem::path> files;
+};
+
+#endif /* blifParserTest_h */
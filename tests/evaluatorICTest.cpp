@@ -1,5 +1,7 @@
 #include "evaluatorICTest.h"
 
+#include <set>
+
 void EvaluatorICTest::SetUp() {
     circuit_id_t circuitId = backend.createCircuit();
     parentCircuit = backend.getCircuit(circuitId);
@@ -41,6 +43,52 @@ circuit_id_t EvaluatorICTest::createPassThroughIC(const std::string& name) {
     return childId;
 }
 
+circuit_id_t EvaluatorICTest::createNestedAndIC(const std::string& name) {
+    const BlockType innerICType = getICBlockType(createPassThroughIC(name + "Inner"));
+    circuit_id_t icId = backend.createCircuit(name);
+    SharedCircuit circuit = backend.getCircuit(icId);
+
+    circuit->tryInsertBlock(Position(0, 0), Rotation::ZERO, BlockType::JUNCTION);
+    circuit->tryInsertBlock(Position(0, 1), Rotation::ZERO, BlockType::JUNCTION);
+    circuit->tryInsertBlock(Position(1, 0), Rotation::ZERO, BlockType::AND);
+    circuit->tryInsertBlock(Position(2, 0), Rotation::ZERO, innerICType);
+    circuit->tryInsertBlock(Position(3, 0), Rotation::ZERO, BlockType::JUNCTION);
+    circuit->tryCreateConnection(Position(0, 0), Position(1, 0));
+    circuit->tryCreateConnection(Position(0, 1), Position(1, 0));
+    circuit->tryCreateConnection(Position(1, 0), Position(2, 0));
+    circuit->tryCreateConnection(Position(2, 0), Position(3, 0));
+
+    CircuitManager& cm = backend.getCircuitManager();
+    BlockType icType = cm.setupBlockData(icId);
+
+    BlockData* bd = cm.getBlockDataManager()->getBlockData(icType);
+    bd->setDefaultData(false);
+    bd->setPrimitive(false);
+    bd->setPath("Custom");
+    bd->setSize(Size(1, 2));
+
+    bd->setConnectionInput(Vector(0, 0), 0);
+    bd->setConnectionInput(Vector(0, 1), 1);
+    bd->setConnectionOutput(Vector(0, 0), 2);
+
+    CircuitBlockData* cbd = cm.getCircuitBlockDataManager()->getCircuitBlockData(icId);
+    cbd->setConnectionIdPosition(0, Position(0, 0));
+    cbd->setConnectionIdPosition(1, Position(0, 1));
+    cbd->setConnectionIdPosition(2, Position(3, 0));
+
+    return icId;
+}
+
+std::vector<simulator_id_t> EvaluatorICTest::getNestedAndICSimulatorIds(Position icPosition) {
+    std::vector<simulator_id_t> simulatorIds = evaluator->getBlockSimulatorIds(
+        Address(icPosition), { Position(0, 0), Position(0, 1), Position(1, 0), Position(3, 0) }
+    );
+    Address innerAddress(icPosition);
+    innerAddress.addBlockId(Position(2, 0));
+    simulatorIds.push_back(evaluator->getBlockSimulatorIds(innerAddress, { Position(0, 0) }).at(0));
+    return simulatorIds;
+}
+
 TEST_F(EvaluatorICTest, SingleIC_PropagatesSignal) {
     const circuit_id_t icId = createPassThroughIC("PassThrough");
     const BlockType icBlockType = getICBlockType(icId);
@@ -146,3 +194,193 @@ TEST_F(EvaluatorICTest, SingleIC_MoveIOAndPropagatesSignal) {
     evaluator->setState(Address(pSwitch), logic_state_t::LOW);
     EXPECT_EQ(evaluator->getState(Address(pLight)), logic_state_t::LOW);
 }
+
+TEST_F(EvaluatorICTest, RepeatedICs_FollowEditsToTheIC) {
+    const circuit_id_t icId = createPassThroughIC("PassThrough");
+    const BlockType icBlockType = getICBlockType(icId);
+    SharedCircuit icCircuit = backend.getCircuit(icId);
+
+    std::vector<Position> switches;
+    std::vector<Position> lights;
+    auto placeInstance = [&]() {
+        const Position pSwitch(idx, 0);
+        const Position pIC(idx, 1);
+        const Position pLight(idx, 2);
+        ++idx;
+        ASSERT_TRUE(parentCircuit->tryInsertBlock(pSwitch, Rotation::ZERO, BlockType::SWITCH));
+        ASSERT_TRUE(parentCircuit->tryInsertBlock(pIC, Rotation::ZERO, icBlockType));
+        ASSERT_TRUE(parentCircuit->tryInsertBlock(pLight, Rotation::ZERO, BlockType::LIGHT));
+        ASSERT_TRUE(parentCircuit->tryCreateConnection(pSwitch, pIC));
+        ASSERT_TRUE(parentCircuit->tryCreateConnection(pIC, pLight));
+        switches.push_back(pSwitch);
+        lights.push_back(pLight);
+    };
+    auto expectLights = [&](logic_state_t lowInput, logic_state_t highInput) {
+        for (size_t i = 0; i < switches.size(); ++i) {
+            evaluator->setState(Address(switches[i]), logic_state_t::LOW);
+            evaluator->tickStep(2);
+            EXPECT_EQ(evaluator->getState(Address(lights[i])), lowInput) << "instance " << i;
+            evaluator->setState(Address(switches[i]), logic_state_t::HIGH);
+            evaluator->tickStep(2);
+            EXPECT_EQ(evaluator->getState(Address(lights[i])), highInput) << "instance " << i;
+        }
+    };
+
+    // the first instance is built from the IC, the ones after it from what that did
+    for (int i = 0; i < 3; ++i) placeInstance();
+    expectLights(logic_state_t::LOW, logic_state_t::HIGH);
+
+    // turning the IC into an inverter changes the placed instances and the ones placed after
+    ASSERT_TRUE(icCircuit->tryRemoveBlock(Position(0, 0)));
+    ASSERT_TRUE(icCircuit->tryInsertBlock(Position(0, 0), Rotation::ZERO, BlockType::NOR));
+    for (int i = 0; i < 2; ++i) placeInstance();
+    expectLights(logic_state_t::HIGH, logic_state_t::LOW);
+}
+
+TEST_F(EvaluatorICTest, RepeatedICs_MatchTheFirstInstance) {
+    const circuit_id_t icId = createNestedAndIC("NestedAnd");
+    const BlockType icBlockType = getICBlockType(icId);
+
+    std::vector<Position> switchesA;
+    std::vector<Position> switchesB;
+    std::vector<Position> ics;
+    std::vector<Position> lights;
+    auto placeInstance = [&]() {
+        const coordinate_t x = idx * 4; ++idx;
+        switchesA.emplace_back(x, 0);
+        switchesB.emplace_back(x, 1);
+        ics.emplace_back(x + 1, 0);
+        lights.emplace_back(x + 2, 0);
+        ASSERT_TRUE(parentCircuit->tryInsertBlock(switchesA.back(), Rotation::ZERO, BlockType::SWITCH));
+        ASSERT_TRUE(parentCircuit->tryInsertBlock(switchesB.back(), Rotation::ZERO, BlockType::SWITCH));
+        ASSERT_TRUE(parentCircuit->tryInsertBlock(ics.back(), Rotation::ZERO, icBlockType));
+        ASSERT_TRUE(parentCircuit->tryInsertBlock(lights.back(), Rotation::ZERO, BlockType::LIGHT));
+        // the port blocks of the IC are traced out to these
+        ASSERT_TRUE(parentCircuit->tryCreateConnection(switchesA.back(), ics.back()));
+        ASSERT_TRUE(parentCircuit->tryCreateConnection(switchesB.back(), ics.back() + Vector(0, 1)));
+        ASSERT_TRUE(parentCircuit->tryCreateConnection(ics.back(), lights.back()));
+    };
+    // the first instance is built from the IC and records the template, the others replay it
+    placeInstance();
+    ASSERT_TRUE(evaluator->hasCircuitTemplate(icId));
+    for (int i = 0; i < 3; ++i) placeInstance();
+
+    // the same blocks share simulator ids in every instance, and no instance shares one with another
+    const std::vector<simulator_id_t> firstIds = getNestedAndICSimulatorIds(ics[0]);
+    std::set<simulator_id_t> usedIds(firstIds.begin(), firstIds.end());
+    for (size_t i = 1; i < ics.size(); ++i) {
+        const std::vector<simulator_id_t> ids = getNestedAndICSimulatorIds(ics[i]);
+        ASSERT_EQ(ids.size(), firstIds.size());
+        for (size_t j = 0; j < ids.size(); ++j) {
+            for (size_t k = 0; k < ids.size(); ++k) {
+                EXPECT_EQ(ids[j] == ids[k], firstIds[j] == firstIds[k]) << "instance " << i;
+            }
+        }
+        for (simulator_id_t id : std::set<simulator_id_t>(ids.begin(), ids.end())) {
+            EXPECT_TRUE(usedIds.insert(id).second) << "instance " << i;
+        }
+    }
+
+    // and the same states
+    for (int row = 0; row < 4; ++row) {
+        for (size_t i = 0; i < ics.size(); ++i) {
+            evaluator->setState(Address(switchesA[i]), fromBool(row & 1));
+            evaluator->setState(Address(switchesB[i]), fromBool(row & 2));
+        }
+        evaluator->tickStep(4);
+        for (size_t i = 0; i < ics.size(); ++i) {
+            EXPECT_EQ(evaluator->getState(Address(lights[i])), fromBool(row == 3)) << "instance " << i;
+            for (const Position& position : { Position(0, 0), Position(0, 1), Position(1, 0), Position(3, 0) }) {
+                Address address(ics[i]);
+                address.addBlockId(position);
+                Address firstAddress(ics[0]);
+                firstAddress.addBlockId(position);
+                EXPECT_EQ(evaluator->getState(address), evaluator->getState(firstAddress)) << "instance " << i;
+            }
+        }
+    }
+}
+
+TEST_F(EvaluatorICTest, RepeatedICs_FollowPortChanges) {
+    const circuit_id_t icId = createNestedAndIC("NestedAnd");
+    const BlockType icBlockType = getICBlockType(icId);
+    CircuitManager& cm = backend.getCircuitManager();
+    BlockData* bd = cm.getBlockDataManager()->getBlockData(icBlockType);
+    CircuitBlockData* cbd = cm.getCircuitBlockDataManager()->getCircuitBlockData(icId);
+
+    std::vector<Position> switchesA;
+    std::vector<Position> ics;
+    std::vector<Position> lights;
+    std::vector<Position> secondLights;
+    auto placeInstance = [&]() {
+        const coordinate_t x = idx * 4; ++idx;
+        switchesA.emplace_back(x, 0);
+        ics.emplace_back(x + 1, 0);
+        lights.emplace_back(x + 2, 0);
+        secondLights.emplace_back(x + 2, 1);
+        const Position switchB(x, 1);
+        ASSERT_TRUE(parentCircuit->tryInsertBlock(switchesA.back(), Rotation::ZERO, BlockType::SWITCH));
+        ASSERT_TRUE(parentCircuit->tryInsertBlock(switchB, Rotation::ZERO, BlockType::SWITCH));
+        ASSERT_TRUE(parentCircuit->tryInsertBlock(ics.back(), Rotation::ZERO, icBlockType));
+        ASSERT_TRUE(parentCircuit->tryInsertBlock(lights.back(), Rotation::ZERO, BlockType::LIGHT));
+        ASSERT_TRUE(parentCircuit->tryInsertBlock(secondLights.back(), Rotation::ZERO, BlockType::LIGHT));
+        ASSERT_TRUE(parentCircuit->tryCreateConnection(switchesA.back(), ics.back()));
+        ASSERT_TRUE(parentCircuit->tryCreateConnection(switchB, ics.back() + Vector(0, 1)));
+        ASSERT_TRUE(parentCircuit->tryCreateConnection(ics.back(), lights.back()));
+        // switch B stays HIGH, so the AND gate follows switch A
+        evaluator->setState(Address(switchB), logic_state_t::HIGH);
+    };
+    auto expectLights = [&](const std::vector<Position>& checkedLights) {
+        for (logic_state_t state : { logic_state_t::HIGH, logic_state_t::LOW }) {
+            for (const Position& switchA : switchesA) evaluator->setState(Address(switchA), state);
+            evaluator->tickStep(4);
+            for (size_t i = 0; i < checkedLights.size(); ++i) {
+                EXPECT_EQ(evaluator->getState(Address(checkedLights[i])), state) << "instance " << i;
+            }
+        }
+    };
+    for (int i = 0; i < 2; ++i) placeInstance();
+    ASSERT_TRUE(evaluator->hasCircuitTemplate(icId));
+    expectLights(lights);
+
+    // moving the output port to the AND gate rebinds the placed instances and drops the template
+    cbd->setConnectionIdPosition(2, Position(1, 0));
+    ASSERT_FALSE(evaluator->hasCircuitTemplate(icId));
+    for (int i = 0; i < 2; ++i) placeInstance();
+    ASSERT_TRUE(evaluator->hasCircuitTemplate(icId));
+    expectLights(lights);
+    ASSERT_EQ(evaluator->getBlockSimulatorIds(Address(ics[2]), { Position(1, 0) }), evaluator->getPinSimulatorIds(Address(), { lights[2] }));
+
+    // a new output port drops the template too, the instances placed after it trace out of the new port
+    bd->setConnectionOutput(Vector(0, 1), 3);
+    ASSERT_FALSE(evaluator->hasCircuitTemplate(icId));
+    cbd->setConnectionIdPosition(3, Position(3, 0));
+    for (int i = 0; i < 2; ++i) placeInstance();
+    ASSERT_TRUE(evaluator->hasCircuitTemplate(icId));
+    for (size_t i = 0; i < ics.size(); ++i) {
+        ASSERT_TRUE(parentCircuit->tryCreateConnection(ics[i] + Vector(0, 1), secondLights[i]));
+    }
+    expectLights(lights);
+    expectLights(secondLights);
+}
+
+TEST_F(EvaluatorICTest, RepeatedICs_TemplatesDroppedWithTheirCircuit) {
+    const circuit_id_t icId = createNestedAndIC("NestedAnd");
+    const BlockType icBlockType = getICBlockType(icId);
+    const Position pIC(0, 0);
+    ASSERT_TRUE(parentCircuit->tryInsertBlock(pIC, Rotation::ZERO, icBlockType));
+    Address innerAddress(pIC);
+    innerAddress.addBlockId(Position(2, 0));
+    // the nested IC was recorded while the outer one was
+    const circuit_id_t innerICId = backend.getCircuitManager().getCircuitBlockDataManager()->getCircuitId(
+        backend.getCircuit(icId)->getBlockContainer()->getBlock(Position(2, 0))->type()
+    );
+    ASSERT_TRUE(evaluator->hasCircuitTemplate(icId));
+    ASSERT_TRUE(evaluator->hasCircuitTemplate(innerICId));
+
+    // the outer template replays the nested IC, so it goes with it
+    ASSERT_TRUE(parentCircuit->tryRemoveBlock(pIC));
+    backend.getCircuitManager().destroyCircuit(innerICId);
+    ASSERT_FALSE(evaluator->hasCircuitTemplate(innerICId));
+    ASSERT_FALSE(evaluator->hasCircuitTemplate(icId));
+}
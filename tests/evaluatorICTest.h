@@ -19,6 +19,10 @@ protected:
     int idx;
 
     circuit_id_t createPassThroughIC(const std::string& name);
+    // two junction inputs into an AND gate that feeds a nested pass through IC, its output junction is the output port
+    circuit_id_t createNestedAndIC(const std::string& name);
+    // the simulator ids of the blocks of createNestedAndIC placed at the position, the nested junction last
+    std::vector<simulator_id_t> getNestedAndICSimulatorIds(Position icPosition);
     inline BlockType getICBlockType(circuit_id_t cid) {
         auto* cbdm = backend.getCircuitManager().getCircuitBlockDataManager();
         auto* cbd = cbdm->getCircuitBlockData(cid);
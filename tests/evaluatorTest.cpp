@@ -1,5 +1,7 @@
 #include "evaluatorTest.h"
 
+#include <random>
+
 // Note that logic simulator is tested separately
 void EvaluatorTest::SetUp() {
 	circuit_id_t circuitId = backend.createCircuit();
@@ -48,6 +50,21 @@ TEST_F(EvaluatorTest, TickrateTest) {
 }
 
 
+TEST_F(EvaluatorTest, SharedSimulationExecutor) {
+	// the threads start with the first simulator
+	SimulationExecutor executor;
+	ASSERT_EQ(executor.getThreadCount(), 0);
+
+	// every backend runs its evaluators on the same executor, with a thread per evaluator up to the limit
+	const SimulationExecutor& sharedExecutor = backend.getEvaluatorManager().getSimulationExecutor();
+	ASSERT_EQ(sharedExecutor.getThreadCount(), 1);
+	Backend otherBackend(nullptr);
+	ASSERT_EQ(&otherBackend.getEvaluatorManager().getSimulationExecutor(), &sharedExecutor);
+	otherBackend.getCircuitManager().getBlockDataManager()->initializeDefaults();
+	otherBackend.createEvaluator(otherBackend.createCircuit());
+	ASSERT_EQ(sharedExecutor.getThreadCount(), std::min(2u, sharedExecutor.getMaxThreadCount()));
+}
+
 TEST_F(EvaluatorTest, BasicStateManagement) {
 	Position pos(i, i); ++i;
 	Rotation rot = Rotation::ZERO;
@@ -63,6 +80,39 @@ TEST_F(EvaluatorTest, BasicStateManagement) {
 	ASSERT_EQ(evaluator->getState(addr), logic_state_t::HIGH);
 }
 
+TEST_F(EvaluatorTest, SetStatesBatch) {
+	std::vector<Address> addresses;
+	for (int j = 0; j < 3; ++j) {
+		Position pos(i, i); ++i;
+		circuit->tryInsertBlock(pos, Rotation::ZERO, BlockType::SWITCH);
+		addresses.emplace_back(pos);
+	}
+
+	// paused, so the states are set right away
+	evaluator->setStates(addresses, { logic_state_t::HIGH, logic_state_t::LOW, logic_state_t::HIGH });
+	ASSERT_EQ(evaluator->getState(addresses[0]), logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(addresses[1]), logic_state_t::LOW);
+	ASSERT_EQ(evaluator->getState(addresses[2]), logic_state_t::HIGH);
+
+	// running, they show up once the next tick took them
+	evaluator->setPause(false);
+	evaluator->setStates(addresses, { logic_state_t::LOW, logic_state_t::HIGH, logic_state_t::LOW });
+	evaluator->tickStep();
+	ASSERT_EQ(evaluator->getState(addresses[0]), logic_state_t::LOW);
+	ASSERT_EQ(evaluator->getState(addresses[1]), logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(addresses[2]), logic_state_t::LOW);
+
+	// an edit transaction holds the simulation, so the states read back right away while it is running
+	evaluator->setPause(false);
+	evaluator->beginEditTransaction();
+	evaluator->setStates(addresses, { logic_state_t::HIGH, logic_state_t::HIGH, logic_state_t::LOW });
+	ASSERT_EQ(evaluator->getState(addresses[0]), logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(addresses[1]), logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(addresses[2]), logic_state_t::LOW);
+	evaluator->commitEditTransaction();
+	evaluator->setPause(true);
+}
+
 // TEST_F(EvaluatorTest, BulkStateOperations) {
 // 	std::vector<Position> positions = {
 // 		Position(i, i),
@@ -460,3 +510,921 @@ TEST_F(EvaluatorTest, AllBasicGatesBehavior) {
 		}
 	}
 }
+
+TEST_F(EvaluatorTest, EventDrivenChain) {
+	evaluator->setEventDriven(true);
+	Position switchPos(i, i); ++i;
+	circuit->tryInsertBlock(switchPos, Rotation::ZERO, BlockType::SWITCH);
+	std::vector<Position> chain;
+	Position previous = switchPos;
+	for (int j = 0; j < 8; ++j) {
+		Position pos(i, i); ++i;
+		circuit->tryInsertBlock(pos, Rotation::ZERO, BlockType::NOR);
+		circuit->tryCreateConnection(previous, pos);
+		chain.push_back(pos);
+		previous = pos;
+	}
+
+	evaluator->tickStep(chain.size());
+	evaluator->setState(Address(switchPos), logic_state_t::HIGH);
+	for (int j = 0; j < chain.size(); ++j) {
+		evaluator->tickStep(1);
+		// the change moves one gate down the chain per tick
+		logic_state_t expected = (j % 2) ? logic_state_t::HIGH : logic_state_t::LOW;
+		ASSERT_EQ(evaluator->getState(Address(chain[j])), expected);
+	}
+	evaluator->setState(Address(switchPos), logic_state_t::LOW);
+	evaluator->tickStep(chain.size());
+	for (int j = 0; j < chain.size(); ++j) {
+		logic_state_t expected = (j % 2) ? logic_state_t::LOW : logic_state_t::HIGH;
+		ASSERT_EQ(evaluator->getState(Address(chain[j])), expected);
+	}
+}
+
+TEST_F(EvaluatorTest, BitPackedGates) {
+	evaluator->setBitPacked(true);
+	Position in1(i, i); ++i;
+	Position in2(i, i); ++i;
+	Position andPos(i, i); ++i;
+	Position xorPos(i, i); ++i;
+	Position norPos(i, i); ++i;
+
+	circuit->tryInsertBlock(in1, Rotation::ZERO, BlockType::SWITCH);
+	circuit->tryInsertBlock(in2, Rotation::ZERO, BlockType::SWITCH);
+	circuit->tryInsertBlock(andPos, Rotation::ZERO, BlockType::AND);
+	circuit->tryInsertBlock(xorPos, Rotation::ZERO, BlockType::XOR);
+	circuit->tryInsertBlock(norPos, Rotation::ZERO, BlockType::NOR);
+	for (Position gatePos : { andPos, xorPos, norPos }) {
+		circuit->tryCreateConnection(in1, gatePos);
+		circuit->tryCreateConnection(in2, gatePos);
+	}
+
+	evaluator->setState(Address(in1), logic_state_t::HIGH);
+	evaluator->setState(Address(in2), logic_state_t::LOW);
+	evaluator->tickStep();
+	ASSERT_EQ(evaluator->getState(Address(andPos)), logic_state_t::LOW);
+	ASSERT_EQ(evaluator->getState(Address(xorPos)), logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(Address(norPos)), logic_state_t::LOW);
+
+	evaluator->setState(Address(in2), logic_state_t::HIGH);
+	evaluator->tickStep();
+	ASSERT_EQ(evaluator->getState(Address(andPos)), logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(Address(xorPos)), logic_state_t::LOW);
+
+	// switching back to the byte states keeps the simulated values
+	evaluator->setBitPacked(false);
+	ASSERT_EQ(evaluator->getState(Address(andPos)), logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(Address(in1)), logic_state_t::HIGH);
+}
+
+// Random gates reading random earlier blocks. With feedback a few of them also read later ones, and there are junctions.
+// Without feedback there are no junctions either, a junction joins its driver and readers into one net which can close
+// loops.
+static std::vector<Position> buildRandomCircuit(Circuit& circuit, std::mt19937& random, int y, int gateCount, bool feedback, std::vector<Position>& switches) {
+	const BlockType gateTypes[] = {
+		BlockType::AND, BlockType::OR, BlockType::XOR, BlockType::NAND, BlockType::NOR, BlockType::XNOR, BlockType::JUNCTION
+	};
+	const size_t gateTypeCount = feedback ? std::size(gateTypes) : std::size(gateTypes) - 1;
+	std::vector<Position> blocks;
+	CircuitEditTransaction editTransaction(circuit);
+	for (int j = 0; j < 8; ++j) {
+		switches.emplace_back(j, y);
+		circuit.tryInsertBlock(switches.back(), Rotation::ZERO, BlockType::SWITCH);
+		blocks.push_back(switches.back());
+	}
+	std::vector<Position> gates;
+	std::vector<Position> loopTargets;
+	for (int j = 0; j < gateCount; ++j) {
+		gates.emplace_back(j % 64, y + 1 + j / 64);
+		const BlockType gateType = gateTypes[random() % gateTypeCount];
+		if (gateType != BlockType::JUNCTION) loopTargets.push_back(gates.back());
+		circuit.tryInsertBlock(gates.back(), Rotation::ZERO, gateType);
+		// a junction with more than one driver is mostly UNDEFINED, and so is everything reading it
+		const int inputCount = gateType == BlockType::JUNCTION ? 1 : 1 + random() % 3;
+		for (int k = 0; k < inputCount; ++k) {
+			circuit.tryCreateConnection(blocks[random() % blocks.size()], gates.back());
+		}
+		blocks.push_back(gates.back());
+	}
+	if (feedback) {
+		// loops through gates only, a gate that starts UNDEFINED in a loop can keep it that way forever
+		for (int j = 0; j < gateCount / 64; ++j) {
+			const size_t to = random() % loopTargets.size();
+			circuit.tryCreateConnection(loopTargets[to + random() % (loopTargets.size() - to)], loopTargets[to]);
+		}
+	}
+	return gates;
+}
+
+TEST_F(EvaluatorTest, RandomCircuitTickModes) {
+	std::mt19937 random(20261017);
+	std::vector<Position> switches;
+	std::vector<Position> gates = buildRandomCircuit(*circuit, random, 0, 2048, true, switches);
+
+	// the fixture evaluator ticks every gate every tick, the others have to match it tick for tick
+	struct Mode {
+		const char* name;
+		SharedEvaluator evaluator;
+	};
+	std::vector<Mode> modes;
+	auto addMode = [&](const char* name, auto enable) {
+		SharedEvaluator modeEvaluator = backend.getEvaluator(backend.createEvaluator(circuit->getCircuitId()).value());
+		enable(*modeEvaluator);
+		modes.push_back(Mode { name, modeEvaluator });
+	};
+	addMode("event driven", [](Evaluator& e) { e.setEventDriven(true); });
+	addMode("bit packed", [](Evaluator& e) { e.setBitPacked(true); });
+	addMode("renumbered", [](Evaluator& e) { e.renumberSimulatorIds(); });
+	addMode("event driven, park", [](Evaluator& e) { e.setEventDriven(true); e.setWaitPolicy(WaitPolicy::PARK); });
+	addMode("fixed threads, spin", [](Evaluator& e) { e.setAutoThreadCount(false); e.setWaitPolicy(WaitPolicy::SPIN); });
+
+	for (int round = 0; round < 12; ++round) {
+		for (const Position& switchPos : switches) {
+			const logic_state_t state = fromBool(random() % 2);
+			evaluator->setState(Address(switchPos), state);
+			for (Mode& mode : modes) mode.evaluator->setState(Address(switchPos), state);
+		}
+		const unsigned int ticks = 1 + random() % 3;
+		evaluator->tickStep(ticks);
+		for (Mode& mode : modes) mode.evaluator->tickStep(ticks);
+		for (const Position& gate : gates) {
+			const logic_state_t expected = evaluator->getState(Address(gate));
+			for (Mode& mode : modes) {
+				ASSERT_EQ(mode.evaluator->getState(Address(gate)), expected) << mode.name << ", round " << round << ", " << gate.toString();
+			}
+		}
+	}
+
+	// without feedback loops the settled states are the states the full tick ends up with
+	SharedCircuit acyclic = backend.getCircuit(backend.createCircuit());
+	std::vector<Position> acyclicSwitches;
+	std::vector<Position> acyclicGates = buildRandomCircuit(*acyclic, random, 0, 1024, false, acyclicSwitches);
+	SharedEvaluator full = backend.getEvaluator(backend.createEvaluator(acyclic->getCircuitId()).value());
+	SharedEvaluator settle = backend.getEvaluator(backend.createEvaluator(acyclic->getCircuitId()).value());
+	settle->setSettleMode(true);
+	for (int round = 0; round < 4; ++round) {
+		for (const Position& switchPos : acyclicSwitches) {
+			const logic_state_t state = fromBool(random() % 2);
+			full->setState(Address(switchPos), state);
+			settle->setState(Address(switchPos), state);
+		}
+		full->tickStep(acyclicGates.size() + 1);
+		settle->tickStep(1);
+		for (const Position& gate : acyclicGates) {
+			ASSERT_EQ(settle->getState(Address(gate)), full->getState(Address(gate))) << "round " << round << ", " << gate.toString();
+		}
+	}
+}
+
+TEST_F(EvaluatorTest, RenumberSimulatorIds) {
+	Position in(i, i); ++i;
+	circuit->tryInsertBlock(in, Rotation::ZERO, BlockType::SWITCH);
+	std::vector<Position> gates;
+	Position previous = in;
+	for (int j = 0; j < 16; ++j) {
+		Position gatePos(i, i); ++i;
+		circuit->tryInsertBlock(gatePos, Rotation::ZERO, BlockType::NOR);
+		circuit->tryCreateConnection(previous, gatePos);
+		gates.push_back(gatePos);
+		previous = gatePos;
+	}
+	evaluator->setState(Address(in), logic_state_t::HIGH);
+	evaluator->tickStep(20);
+	evaluator->renumberSimulatorIds();
+	for (size_t j = 0; j < gates.size(); ++j) {
+		ASSERT_EQ(evaluator->getState(Address(gates[j])), j % 2 == 0 ? logic_state_t::LOW : logic_state_t::HIGH);
+	}
+
+	evaluator->setState(Address(in), logic_state_t::LOW);
+	evaluator->tickStep(20);
+	for (size_t j = 0; j < gates.size(); ++j) {
+		ASSERT_EQ(evaluator->getState(Address(gates[j])), j % 2 == 0 ? logic_state_t::HIGH : logic_state_t::LOW);
+	}
+}
+
+TEST_F(EvaluatorTest, SimulateBatch) {
+	Position in1(i, i); ++i;
+	Position in2(i, i); ++i;
+	Position xorPos(i, i); ++i;
+	circuit->tryInsertBlock(in1, Rotation::ZERO, BlockType::SWITCH);
+	circuit->tryInsertBlock(in2, Rotation::ZERO, BlockType::SWITCH);
+	circuit->tryInsertBlock(xorPos, Rotation::ZERO, BlockType::XOR);
+	circuit->tryCreateConnection(in1, xorPos);
+	circuit->tryCreateConnection(in2, xorPos);
+
+	CircuitManager& circuitManager = backend.getCircuitManager();
+	circuitManager.setupBlockData(circuit->getCircuitId());
+	CircuitBlockData* circuitBlockData = circuitManager.getCircuitBlockDataManager()->getCircuitBlockData(circuit->getCircuitId());
+	ASSERT_NE(circuitBlockData, nullptr);
+	circuitBlockData->setConnectionIdPosition(0, in1);
+	circuitBlockData->setConnectionIdPosition(1, in2);
+	circuitBlockData->setConnectionIdPosition(2, xorPos);
+
+	// more vectors than lanes so two passes are needed
+	std::vector<std::vector<logic_state_t>> inputVectors;
+	for (int j = 0; j < 100; ++j) {
+		inputVectors.push_back({ fromBool(j & 1), fromBool(j & 2) });
+	}
+	std::vector<std::vector<logic_state_t>> outputVectors = evaluator->simulateBatch({ 0, 1 }, { 2 }, inputVectors, 2);
+	ASSERT_EQ(outputVectors.size(), inputVectors.size());
+	for (int j = 0; j < 100; ++j) {
+		ASSERT_EQ(outputVectors[j].size(), 1);
+		ASSERT_EQ(outputVectors[j][0], fromBool(((j & 1) != 0) != ((j & 2) != 0)));
+	}
+
+	// the live simulation is not touched
+	ASSERT_EQ(evaluator->getState(Address(in1)), logic_state_t::LOW);
+	ASSERT_EQ(evaluator->getState(Address(in2)), logic_state_t::LOW);
+}
+
+TEST_F(EvaluatorTest, SettleMode) {
+	evaluator->setSettleMode(true);
+	Position switchPos(i, i); ++i;
+	circuit->tryInsertBlock(switchPos, Rotation::ZERO, BlockType::SWITCH);
+	std::vector<Position> chain;
+	Position previous = switchPos;
+	for (int j = 0; j < 8; ++j) {
+		Position pos(i, i); ++i;
+		circuit->tryInsertBlock(pos, Rotation::ZERO, BlockType::NOR);
+		circuit->tryCreateConnection(previous, pos);
+		chain.push_back(pos);
+		previous = pos;
+	}
+	// SR latch, the feedback loop keeps its tick of delay
+	Position setPos(i, i); ++i;
+	Position resetPos(i, i); ++i;
+	Position q(i, i); ++i;
+	Position notQ(i, i); ++i;
+	circuit->tryInsertBlock(setPos, Rotation::ZERO, BlockType::SWITCH);
+	circuit->tryInsertBlock(resetPos, Rotation::ZERO, BlockType::SWITCH);
+	circuit->tryInsertBlock(q, Rotation::ZERO, BlockType::NOR);
+	circuit->tryInsertBlock(notQ, Rotation::ZERO, BlockType::NOR);
+	circuit->tryCreateConnection(resetPos, q);
+	circuit->tryCreateConnection(notQ, q);
+	circuit->tryCreateConnection(setPos, notQ);
+	circuit->tryCreateConnection(q, notQ);
+
+	evaluator->setState(Address(switchPos), logic_state_t::HIGH);
+	evaluator->tickStep(1);
+	// the whole chain settles within one tick
+	for (int j = 0; j < chain.size(); ++j) {
+		logic_state_t expected = (j % 2) ? logic_state_t::HIGH : logic_state_t::LOW;
+		ASSERT_EQ(evaluator->getState(Address(chain[j])), expected);
+	}
+
+	evaluator->setState(Address(setPos), logic_state_t::HIGH);
+	evaluator->tickStep(4);
+	evaluator->setState(Address(setPos), logic_state_t::LOW);
+	evaluator->tickStep(4);
+	ASSERT_EQ(evaluator->getState(Address(q)), logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(Address(notQ)), logic_state_t::LOW);
+	evaluator->setState(Address(resetPos), logic_state_t::HIGH);
+	evaluator->tickStep(4);
+	evaluator->setState(Address(resetPos), logic_state_t::LOW);
+	evaluator->tickStep(4);
+	ASSERT_EQ(evaluator->getState(Address(q)), logic_state_t::LOW);
+	ASSERT_EQ(evaluator->getState(Address(notQ)), logic_state_t::HIGH);
+}
+
+TEST_F(EvaluatorTest, NativeCompiledGates) {
+	evaluator->setNativeCompiled(true);
+	Position in1(i, i); ++i;
+	Position in2(i, i); ++i;
+	Position andPos(i, i); ++i;
+	Position xorPos(i, i); ++i;
+	Position junctionPos(i, i); ++i;
+	circuit->tryInsertBlock(in1, Rotation::ZERO, BlockType::SWITCH);
+	circuit->tryInsertBlock(in2, Rotation::ZERO, BlockType::SWITCH);
+	circuit->tryInsertBlock(andPos, Rotation::ZERO, BlockType::AND);
+	circuit->tryInsertBlock(xorPos, Rotation::ZERO, BlockType::XOR);
+	circuit->tryInsertBlock(junctionPos, Rotation::ZERO, BlockType::JUNCTION);
+	for (Position gatePos : { andPos, xorPos }) {
+		circuit->tryCreateConnection(in1, gatePos);
+		circuit->tryCreateConnection(in2, gatePos);
+	}
+	circuit->tryCreateConnection(andPos, junctionPos);
+	std::vector<Position> chain;
+	Position previous = junctionPos;
+	for (int j = 0; j < 8; ++j) {
+		Position pos(i, i); ++i;
+		circuit->tryInsertBlock(pos, Rotation::ZERO, BlockType::NOR);
+		circuit->tryCreateConnection(previous, pos);
+		chain.push_back(pos);
+		previous = pos;
+	}
+
+	// the background compile would take over after a moment, the test does not wait for it
+	ASSERT_TRUE(evaluator->compileNativeTicks());
+	ASSERT_TRUE(evaluator->isNativeTickActive());
+
+	evaluator->setState(Address(in1), logic_state_t::HIGH);
+	evaluator->setState(Address(in2), logic_state_t::HIGH);
+	evaluator->tickStep(chain.size() + 1);
+	ASSERT_EQ(evaluator->getState(Address(andPos)), logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(Address(xorPos)), logic_state_t::LOW);
+	ASSERT_EQ(evaluator->getState(Address(junctionPos)), logic_state_t::HIGH);
+	for (int j = 0; j < chain.size(); ++j) {
+		logic_state_t expected = (j % 2) ? logic_state_t::HIGH : logic_state_t::LOW;
+		ASSERT_EQ(evaluator->getState(Address(chain[j])), expected);
+	}
+
+	// an edit hands the ticks back to the interpreter until the new netlist is compiled
+	Position notAnd(i, i); ++i;
+	circuit->tryInsertBlock(notAnd, Rotation::ZERO, BlockType::NOR);
+	circuit->tryCreateConnection(andPos, notAnd);
+	ASSERT_FALSE(evaluator->isNativeTickActive());
+	evaluator->setState(Address(in2), logic_state_t::LOW);
+	evaluator->tickStep(2);
+	ASSERT_EQ(evaluator->getState(Address(xorPos)), logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(Address(notAnd)), logic_state_t::HIGH);
+
+	evaluator->setNativeCompiled(false);
+	ASSERT_EQ(evaluator->getState(Address(andPos)), logic_state_t::LOW);
+	ASSERT_EQ(evaluator->getState(Address(in1)), logic_state_t::HIGH);
+}
+
+TEST_F(EvaluatorTest, EditTransaction) {
+	Position switchPos(i, i); ++i;
+	std::vector<Position> chain;
+	{
+		CircuitEditTransaction editTransaction(*circuit);
+		circuit->tryInsertBlock(switchPos, Rotation::ZERO, BlockType::SWITCH);
+		Position previous = switchPos;
+		for (int j = 0; j < 16; ++j) {
+			Position pos(i, i); ++i;
+			circuit->tryInsertBlock(pos, Rotation::ZERO, BlockType::NOR);
+			circuit->tryCreateConnection(previous, pos);
+			chain.push_back(pos);
+			previous = pos;
+		}
+		// transactions nest, the inner commit does not apply anything yet
+		evaluator->beginEditTransaction();
+		circuit->tryRemoveBlock(chain.back());
+		evaluator->commitEditTransaction();
+		chain.pop_back();
+	}
+	evaluator->setState(Address(switchPos), logic_state_t::HIGH);
+	evaluator->tickStep(20);
+	for (size_t j = 0; j < chain.size(); ++j) {
+		ASSERT_EQ(evaluator->getState(Address(chain[j])), j % 2 == 0 ? logic_state_t::LOW : logic_state_t::HIGH);
+	}
+}
+
+TEST_F(EvaluatorTest, JunctionNetworkDrivenLater) {
+	// the junctions only get an output going into them many edits after they were placed
+	std::vector<Position> junctions;
+	for (int j = 0; j < 8; ++j) {
+		Position pos(i, i); ++i;
+		circuit->tryInsertBlock(pos, Rotation::ZERO, BlockType::JUNCTION);
+		if (!junctions.empty()) circuit->tryCreateConnection(junctions.back(), pos);
+		junctions.push_back(pos);
+	}
+	Position andPos(i, i); ++i;
+	circuit->tryInsertBlock(andPos, Rotation::ZERO, BlockType::AND);
+	circuit->tryCreateConnection(junctions.back(), andPos);
+	Position switchPos(i, i); ++i;
+	circuit->tryInsertBlock(switchPos, Rotation::ZERO, BlockType::SWITCH);
+	circuit->tryCreateConnection(switchPos, junctions.front());
+	evaluator->setState(Address(switchPos), logic_state_t::HIGH);
+	evaluator->tickStep(2);
+	for (const Position& junction : junctions) {
+		ASSERT_EQ(evaluator->getState(Address(junction)), logic_state_t::HIGH);
+	}
+	ASSERT_EQ(evaluator->getState(Address(andPos)), logic_state_t::HIGH);
+
+	// splitting the network leaves the half with the and gate without a driver
+	circuit->tryRemoveConnection(junctions[3], junctions[4]);
+	evaluator->tickStep(2);
+	ASSERT_EQ(evaluator->getState(Address(junctions[3])), logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(Address(junctions[4])), logic_state_t::FLOATING);
+	ASSERT_EQ(evaluator->getState(Address(andPos)), logic_state_t::UNDEFINED);
+}
+
+TEST_F(EvaluatorTest, ConstantFolding) {
+	Position constantPos(i, i); ++i;
+	circuit->tryInsertBlock(constantPos, Rotation::ZERO, BlockType::CONSTANT);
+	Position switchPos(i, i); ++i;
+	circuit->tryInsertBlock(switchPos, Rotation::ZERO, BlockType::SWITCH);
+	// the constant holds the or gate HIGH, and the chain behind it with it
+	Position orPos(i, i); ++i;
+	circuit->tryInsertBlock(orPos, Rotation::ZERO, BlockType::OR);
+	circuit->tryCreateConnection(constantPos, orPos);
+	circuit->tryCreateConnection(switchPos, orPos);
+	std::vector<Position> chain;
+	Position previous = orPos;
+	for (int j = 0; j < 4; ++j) {
+		Position pos(i, i); ++i;
+		circuit->tryInsertBlock(pos, Rotation::ZERO, BlockType::NOR);
+		circuit->tryCreateConnection(previous, pos);
+		chain.push_back(pos);
+		previous = pos;
+	}
+	// the constant can not decide the and gate, it follows the switch
+	Position andPos(i, i); ++i;
+	circuit->tryInsertBlock(andPos, Rotation::ZERO, BlockType::AND);
+	circuit->tryCreateConnection(constantPos, andPos);
+	circuit->tryCreateConnection(switchPos, andPos);
+
+	auto checkChain = [&](logic_state_t orState) {
+		ASSERT_EQ(evaluator->getState(Address(orPos)), orState);
+		for (size_t j = 0; j < chain.size(); ++j) {
+			ASSERT_EQ(evaluator->getBoolState(Address(chain[j])), (j % 2 == 0) != toBool(orState));
+		}
+	};
+	evaluator->tickStep(chain.size() + 1);
+	checkChain(logic_state_t::HIGH);
+	// turning the optimization on folds the gates that are already there
+	ASSERT_FALSE(evaluator->isGateOptimization());
+	evaluator->setGateOptimization(true);
+	checkChain(logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(Address(andPos)), logic_state_t::LOW);
+	evaluator->setState(Address(switchPos), logic_state_t::HIGH);
+	evaluator->tickStep(1);
+	ASSERT_EQ(evaluator->getState(Address(andPos)), logic_state_t::HIGH);
+	checkChain(logic_state_t::HIGH);
+
+	// turning it off brings the folded gates back
+	evaluator->setGateOptimization(false);
+	evaluator->tickStep(chain.size() + 1);
+	checkChain(logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(Address(andPos)), logic_state_t::HIGH);
+	evaluator->setGateOptimization(true);
+
+	// without the constant the gates are ticked again
+	circuit->tryRemoveBlock(constantPos);
+	evaluator->tickStep(chain.size() + 1);
+	checkChain(logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(Address(andPos)), logic_state_t::HIGH);
+	evaluator->setState(Address(switchPos), logic_state_t::LOW);
+	evaluator->tickStep(chain.size() + 1);
+	checkChain(logic_state_t::LOW);
+	ASSERT_EQ(evaluator->getState(Address(andPos)), logic_state_t::LOW);
+
+	// the and gate goes back to reading the constant it ignored once the switch is gone
+	circuit->tryInsertBlock(constantPos, Rotation::ZERO, BlockType::CONSTANT);
+	circuit->tryCreateConnection(constantPos, andPos);
+	evaluator->tickStep(1);
+	ASSERT_EQ(evaluator->getState(Address(andPos)), logic_state_t::LOW);
+	circuit->tryRemoveBlock(switchPos);
+	evaluator->tickStep(1);
+	ASSERT_EQ(evaluator->getState(Address(andPos)), logic_state_t::HIGH);
+}
+
+TEST_F(EvaluatorTest, DuplicateGates) {
+	Position switchA(i, i); ++i;
+	Position switchB(i, i); ++i;
+	Position switchC(i, i); ++i;
+	circuit->tryInsertBlock(switchA, Rotation::ZERO, BlockType::SWITCH);
+	circuit->tryInsertBlock(switchB, Rotation::ZERO, BlockType::SWITCH);
+	circuit->tryInsertBlock(switchC, Rotation::ZERO, BlockType::SWITCH);
+	// the and gates read the same switches, so one is merged into the other
+	Position andA(i, i); ++i;
+	Position andB(i, i); ++i;
+	circuit->tryInsertBlock(andA, Rotation::ZERO, BlockType::AND);
+	circuit->tryInsertBlock(andB, Rotation::ZERO, BlockType::AND);
+	for (const Position& andPos : { andA, andB }) {
+		circuit->tryCreateConnection(switchA, andPos);
+		circuit->tryCreateConnection(switchB, andPos);
+	}
+	Position xorPos(i, i); ++i;
+	circuit->tryInsertBlock(xorPos, Rotation::ZERO, BlockType::XOR);
+	circuit->tryCreateConnection(andA, xorPos);
+	circuit->tryCreateConnection(andB, xorPos);
+	Position norPos(i, i); ++i;
+	circuit->tryInsertBlock(norPos, Rotation::ZERO, BlockType::NOR);
+	circuit->tryCreateConnection(andB, norPos);
+	evaluator->setGateOptimization(true);
+
+	evaluator->setState(Address(switchA), logic_state_t::HIGH);
+	evaluator->setState(Address(switchB), logic_state_t::HIGH);
+	evaluator->tickStep(2);
+	ASSERT_EQ(evaluator->getState(Address(andA)), logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(Address(andB)), logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(Address(xorPos)), logic_state_t::LOW);
+	ASSERT_EQ(evaluator->getState(Address(norPos)), logic_state_t::LOW);
+
+	// another input makes the gates differ again
+	circuit->tryCreateConnection(switchC, andB);
+	evaluator->tickStep(2);
+	ASSERT_EQ(evaluator->getState(Address(andA)), logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(Address(andB)), logic_state_t::LOW);
+	ASSERT_EQ(evaluator->getState(Address(xorPos)), logic_state_t::HIGH);
+	ASSERT_EQ(evaluator->getState(Address(norPos)), logic_state_t::HIGH);
+
+	circuit->tryRemoveConnection(switchC, andB);
+	evaluator->setState(Address(switchB), logic_state_t::LOW);
+	evaluator->tickStep(2);
+	ASSERT_EQ(evaluator->getState(Address(andA)), logic_state_t::LOW);
+	ASSERT_EQ(evaluator->getState(Address(andB)), logic_state_t::LOW);
+	ASSERT_EQ(evaluator->getState(Address(xorPos)), logic_state_t::LOW);
+	ASSERT_EQ(evaluator->getState(Address(norPos)), logic_state_t::HIGH);
+}
+
+TEST_F(EvaluatorTest, DuplicateGatesSplitOnNewInput) {
+	Position switchA(i, i); ++i;
+	Position switchB(i, i); ++i;
+	Position switchC(i, i); ++i;
+	std::vector<Position> switches = { switchA, switchB, switchC };
+	for (const Position& switchPos : switches) {
+		circuit->tryInsertBlock(switchPos, Rotation::ZERO, BlockType::SWITCH);
+	}
+	Position orA(i, i); ++i;
+	Position orB(i, i); ++i;
+	circuit->tryInsertBlock(orA, Rotation::ZERO, BlockType::OR);
+	circuit->tryInsertBlock(orB, Rotation::ZERO, BlockType::OR);
+	for (const Position& orPos : { orA, orB }) {
+		circuit->tryCreateConnection(switchA, orPos);
+		circuit->tryCreateConnection(switchB, orPos);
+	}
+	Position readerA(i, i); ++i;
+	Position readerB(i, i); ++i;
+	circuit->tryInsertBlock(readerA, Rotation::ZERO, BlockType::NOR);
+	circuit->tryInsertBlock(readerB, Rotation::ZERO, BlockType::NOR);
+	circuit->tryCreateConnection(orA, readerA);
+	circuit->tryCreateConnection(orB, readerB);
+	evaluator->setGateOptimization(true);
+
+	// an evaluator without the merge is what the merged one has to match
+	SharedEvaluator reference = backend.getEvaluator(backend.createEvaluator(circuit->getCircuitId()).value());
+	std::vector<Position> checked = { orA, orB, readerA, readerB };
+	auto runAndCompare = [&]() {
+		// every switch pattern, the states have to match on every tick after the first
+		for (int pattern = 0; pattern < 8; ++pattern) {
+			for (size_t j = 0; j < switches.size(); ++j) {
+				logic_state_t state = fromBool(pattern & (1 << j));
+				evaluator->setState(Address(switches[j]), state);
+				reference->setState(Address(switches[j]), state);
+			}
+			evaluator->tickStep(1);
+			reference->tickStep(1);
+			for (int tick = 0; tick < 2; ++tick) {
+				evaluator->tickStep(1);
+				reference->tickStep(1);
+				for (const Position& pos : checked) {
+					ASSERT_EQ(evaluator->getState(Address(pos)), reference->getState(Address(pos)));
+				}
+			}
+		}
+	};
+	runAndCompare();
+
+	// a new input on either copy splits them, whichever one was merged into the other
+	for (const Position& orPos : { orA, orB }) {
+		circuit->tryCreateConnection(switchC, orPos);
+		runAndCompare();
+		circuit->tryRemoveConnection(switchC, orPos);
+		runAndCompare();
+	}
+	// the same input on both merges them again
+	circuit->tryCreateConnection(switchC, orA);
+	circuit->tryCreateConnection(switchC, orB);
+	runAndCompare();
+}
+
+TEST_F(EvaluatorTest, BufferChains) {
+	Position switchPos(i, i); ++i;
+	circuit->tryInsertBlock(switchPos, Rotation::ZERO, BlockType::SWITCH);
+	// gates with one input pass it on a tick later
+	const BlockType chainTypes[] = { BlockType::OR, BlockType::AND, BlockType::XOR };
+	std::vector<Position> chain;
+	Position previous = switchPos;
+	for (int j = 0; j < 8; ++j) {
+		chain.emplace_back(i, i); ++i;
+		circuit->tryInsertBlock(chain.back(), Rotation::ZERO, chainTypes[j % 3]);
+		circuit->tryCreateConnection(previous, chain.back());
+		previous = chain.back();
+	}
+	Position readerPos(i, i); ++i;
+	circuit->tryInsertBlock(readerPos, Rotation::ZERO, BlockType::NOR);
+	circuit->tryCreateConnection(chain.back(), readerPos);
+	evaluator->setGateOptimization(true);
+
+	// an evaluator without the collapse is what the collapsed one has to match
+	SharedEvaluator reference = backend.getEvaluator(backend.createEvaluator(circuit->getCircuitId()).value());
+	auto simId = [&](const Position& pos) {
+		return evaluator->getBlockSimulatorIds(Address(), { pos }).at(0);
+	};
+	std::mt19937 random(7);
+	auto compare = [&](const std::vector<Position>& checked, int ticks) {
+		for (int tick = 0; tick <= ticks; ++tick) {
+			for (const Position& pos : checked) {
+				ASSERT_EQ(evaluator->getState(Address(pos)), reference->getState(Address(pos)));
+			}
+			logic_state_t state = fromBool(random() % 3 == 0);
+			evaluator->setState(Address(switchPos), state);
+			reference->setState(Address(switchPos), state);
+			evaluator->tickStep(1);
+			reference->tickStep(1);
+		}
+	};
+
+	// the first gate stays and the gates behind it become one buffer
+	ASSERT_NE(simId(chain[0]), simId(chain[1]));
+	for (size_t j = 1; j < chain.size(); ++j) {
+		ASSERT_EQ(simId(chain[j]), simId(chain.back()));
+	}
+	compare({ chain[0], chain.back(), readerPos }, 32);
+
+	// a reader in the middle splits the chain, the gates get back the states that were on their way through the buffer
+	Position middleReaderPos(i, i); ++i;
+	circuit->tryInsertBlock(middleReaderPos, Rotation::ZERO, BlockType::NOR);
+	circuit->tryCreateConnection(chain[4], middleReaderPos);
+	ASSERT_NE(simId(chain[4]), simId(chain.back()));
+	compare({ chain[0], chain[4], chain[5], chain.back(), readerPos, middleReaderPos }, 32);
+
+	// so does a gate that is removed, the gates behind it are folded to LOW right away instead of a tick at a time
+	circuit->tryRemoveBlock(chain[2]);
+	compare({ chain[0], chain[1] }, chain.size());
+	compare({ chain[0], chain[1], chain[3], chain[4], chain[5], chain.back(), readerPos, middleReaderPos }, 32);
+	circuit->tryInsertBlock(chain[2], Rotation::ZERO, chainTypes[2]);
+	circuit->tryCreateConnection(chain[1], chain[2]);
+	circuit->tryCreateConnection(chain[2], chain[3]);
+	circuit->tryRemoveBlock(middleReaderPos);
+	for (size_t j = 1; j < chain.size(); ++j) {
+		ASSERT_EQ(simId(chain[j]), simId(chain.back()));
+	}
+	compare({ chain[0], chain.back(), readerPos }, 32);
+
+	// without the optimization every gate of the chain is ticked again and keeps its state
+	evaluator->setGateOptimization(false);
+	std::vector<Position> checked = chain;
+	checked.push_back(readerPos);
+	compare(checked, 32);
+}
+
+TEST_F(EvaluatorTest, InverterAbsorption) {
+	Position aPos(i, i); ++i;
+	Position bPos(i, i); ++i;
+	Position cPos(i, i); ++i;
+	for (const Position& pos : { aPos, bPos, cPos }) {
+		circuit->tryInsertBlock(pos, Rotation::ZERO, BlockType::SWITCH);
+	}
+	auto insertGate = [&](BlockType type, const std::vector<Position>& inputs) {
+		Position pos(i, i); ++i;
+		circuit->tryInsertBlock(pos, Rotation::ZERO, type);
+		for (const Position& input : inputs) {
+			circuit->tryCreateConnection(input, pos);
+		}
+		return pos;
+	};
+	const Position notA = insertGate(BlockType::NOR, { aPos });
+	const Position notB = insertGate(BlockType::NAND, { bPos });
+	const Position notC = insertGate(BlockType::NOR, { cPos });
+	// every input inverted, becomes NOR(a, b)
+	const Position andPos = insertGate(BlockType::AND, { notA, notB });
+	// one input gates, become NAND(a) and XNOR(c)
+	const Position orPos = insertGate(BlockType::OR, { notA });
+	const Position xorPos = insertGate(BlockType::XOR, { notC });
+	const Position readerPos = insertGate(BlockType::NOR, { andPos });
+	evaluator->setFunctionalOptimization(true);
+
+	SharedEvaluator reference = backend.getEvaluator(backend.createEvaluator(circuit->getCircuitId()).value());
+	auto simId = [&](const Position& pos) {
+		return evaluator->getBlockSimulatorIds(Address(), { pos }).at(0);
+	};
+	std::mt19937 random(11);
+	// the paths through the inverters are a tick shorter, so the states are compared once they settled
+	auto compareSettled = [&](const std::vector<Position>& checked, int rounds) {
+		for (int round = 0; round < rounds; ++round) {
+			for (const Position& pos : { aPos, bPos, cPos }) {
+				logic_state_t state = fromBool(random() % 2 == 0);
+				evaluator->setState(Address(pos), state);
+				reference->setState(Address(pos), state);
+			}
+			evaluator->tickStep(4);
+			reference->tickStep(4);
+			for (const Position& pos : checked) {
+				ASSERT_EQ(evaluator->getState(Address(pos)), reference->getState(Address(pos))) << "round " << round;
+			}
+		}
+	};
+
+	// inverters that only fed the gate are gone, notA goes once both of its readers absorbed it
+	ASSERT_EQ(simId(notB), simId(andPos));
+	ASSERT_EQ(simId(notC), simId(xorPos));
+	ASSERT_EQ(simId(notA), simId(orPos));
+	compareSettled({ notA, andPos, orPos, xorPos, readerPos }, 16);
+
+	// the AND now reads the switches directly
+	for (const Position& pos : { aPos, bPos }) {
+		evaluator->setState(Address(pos), logic_state_t::LOW);
+	}
+	evaluator->tickStep(4);
+	ASSERT_EQ(evaluator->getState(Address(andPos)), logic_state_t::HIGH);
+	evaluator->setState(Address(aPos), logic_state_t::HIGH);
+	evaluator->tickStep(1);
+	ASSERT_EQ(evaluator->getState(Address(andPos)), logic_state_t::LOW);
+
+	// another reader keeps the inverter
+	const Position notBReaderPos = insertGate(BlockType::OR, { notB, cPos });
+	ASSERT_NE(simId(notB), simId(andPos));
+	compareSettled({ notA, notB, andPos, orPos, xorPos, readerPos, notBReaderPos }, 16);
+	circuit->tryRemoveBlock(notBReaderPos);
+	ASSERT_EQ(simId(notB), simId(andPos));
+	compareSettled({ notA, andPos, orPos, xorPos, readerPos }, 16);
+
+	// without it every gate is ticked again and keeps the timing of the reference
+	evaluator->setFunctionalOptimization(false);
+	ASSERT_NE(simId(notB), simId(andPos));
+	ASSERT_NE(simId(notC), simId(xorPos));
+	evaluator->tickStep(4);
+	const std::vector<Position> checked = { notA, notB, notC, andPos, orPos, xorPos, readerPos };
+	for (int tick = 0; tick < 32; ++tick) {
+		for (const Position& pos : checked) {
+			ASSERT_EQ(evaluator->getState(Address(pos)), reference->getState(Address(pos))) << "tick " << tick;
+		}
+		logic_state_t state = fromBool(random() % 3 == 0);
+		evaluator->setState(Address(aPos), state);
+		reference->setState(Address(aPos), state);
+		evaluator->tickStep(1);
+		reference->tickStep(1);
+	}
+}
+
+TEST_F(EvaluatorTest, Checkpoint) {
+	Position switchPos(i, i); ++i;
+	circuit->tryInsertBlock(switchPos, Rotation::ZERO, BlockType::SWITCH);
+	// a ring of three inverters that the switch knocks out of step
+	std::vector<Position> ring;
+	for (int j = 0; j < 3; ++j) {
+		ring.emplace_back(i, i); ++i;
+		circuit->tryInsertBlock(ring.back(), Rotation::ZERO, BlockType::NOR);
+	}
+	for (int j = 0; j < 3; ++j) {
+		circuit->tryCreateConnection(ring[j], ring[(j + 1) % 3]);
+	}
+	circuit->tryCreateConnection(switchPos, ring[0]);
+	// collapsed into one buffer, the states in flight are only in its delay ring
+	std::vector<Position> chain;
+	Position previous = switchPos;
+	for (int j = 0; j < 6; ++j) {
+		chain.emplace_back(i, i); ++i;
+		circuit->tryInsertBlock(chain.back(), Rotation::ZERO, BlockType::OR);
+		circuit->tryCreateConnection(previous, chain.back());
+		previous = chain.back();
+	}
+	evaluator->setGateOptimization(true);
+	ASSERT_EQ(evaluator->getBlockSimulatorIds(Address(), { chain[1] }), evaluator->getBlockSimulatorIds(Address(), { chain.back() }));
+
+	evaluator->setState(Address(switchPos), logic_state_t::HIGH);
+	evaluator->tickStep(3);
+	evaluator->setState(Address(switchPos), logic_state_t::LOW);
+	evaluator->tickStep(2);
+	evaluator->setState(Address(switchPos), logic_state_t::HIGH);
+	evaluator->tickStep(2);
+	ASSERT_EQ(evaluator->getTickCount(), 7);
+	std::vector<uint8_t> checkpoint = evaluator->getCheckpoint();
+
+	std::vector<Position> checked = ring;
+	checked.insert(checked.end(), chain.begin(), chain.end());
+	auto compare = [&](SharedEvaluator other, const std::vector<Position>& positions, int ticks) {
+		for (int tick = 0; tick < ticks; ++tick) {
+			for (const Position& pos : positions) {
+				ASSERT_EQ(other->getState(Address(pos)), evaluator->getState(Address(pos))) << "tick " << tick;
+			}
+			evaluator->tickStep();
+			other->tickStep();
+		}
+	};
+
+	// a new evaluator of the same circuit picks up exactly where the first one is
+	SharedEvaluator restored = backend.getEvaluator(backend.createEvaluator(circuit->getCircuitId()).value());
+	restored->setGateOptimization(true);
+	ASSERT_TRUE(restored->restoreCheckpoint(checkpoint));
+	ASSERT_EQ(restored->getTickCount(), 7);
+	compare(restored, checked, 10);
+	ASSERT_EQ(restored->getTickCount(), 17);
+
+	// without the collapse the layout differs, the blocks still get their states
+	SharedEvaluator unoptimized = backend.getEvaluator(backend.createEvaluator(circuit->getCircuitId()).value());
+	ASSERT_TRUE(unoptimized->restoreCheckpoint(evaluator->getCheckpoint()));
+	ASSERT_EQ(unoptimized->getTickCount(), 17);
+	compare(unoptimized, ring, 1);
+
+	// a checkpoint only loads into the circuit it was taken of, with the same connections
+	ASSERT_TRUE(circuit->tryRemoveConnection(ring[2], ring[0]));
+	ASSERT_FALSE(restored->restoreCheckpoint(checkpoint));
+	ASSERT_TRUE(circuit->tryCreateConnection(ring[2], ring[0]));
+	ASSERT_TRUE(restored->restoreCheckpoint(checkpoint));
+	ASSERT_TRUE(circuit->tryMoveBlock(ring[1], Position(i, i)));
+	ASSERT_FALSE(restored->restoreCheckpoint(checkpoint));
+	ASSERT_TRUE(circuit->tryMoveBlock(Position(i, i), ring[1]));
+	ASSERT_TRUE(restored->restoreCheckpoint(checkpoint));
+	circuit->tryInsertBlock(Position(i, i), Rotation::ZERO, BlockType::AND); ++i;
+	ASSERT_FALSE(restored->restoreCheckpoint(checkpoint));
+	checkpoint.pop_back();
+	ASSERT_FALSE(evaluator->restoreCheckpoint(checkpoint));
+}
+
+TEST_F(EvaluatorTest, CheckpointLargeCircuit) {
+	// rows of inverter rings of different lengths, so the states differ between the rows and keep changing
+	constexpr int rowCount = 256;
+	constexpr int rowLength = 256;
+	std::vector<Position> blocks;
+	{
+		CircuitEditTransaction editTransaction(*circuit);
+		for (int row = 0; row < rowCount; ++row) {
+			const int ringLength = 3 + 2 * (row % 7);
+			for (int column = 0; column < rowLength; ++column) {
+				blocks.emplace_back(column, row);
+				circuit->tryInsertBlock(blocks.back(), Rotation::ZERO, BlockType::NOR);
+				if (column > 0) circuit->tryCreateConnection(Position(column - 1, row), blocks.back());
+				if (column == ringLength - 1) circuit->tryCreateConnection(blocks.back(), Position(0, row));
+			}
+		}
+	}
+	evaluator->tickStep(100);
+
+	SharedEvaluator restored = backend.getEvaluator(backend.createEvaluator(circuit->getCircuitId()).value());
+	ASSERT_TRUE(restored->restoreCheckpoint(evaluator->getCheckpoint()));
+
+	for (int tick = 0; tick < 16; ++tick) {
+		ASSERT_EQ(
+			restored->getStatesFromSimulatorIds(restored->getBlockSimulatorIds(Address(), blocks)),
+			evaluator->getStatesFromSimulatorIds(evaluator->getBlockSimulatorIds(Address(), blocks))
+		) << "tick " << tick;
+		evaluator->tickStep();
+		restored->tickStep();
+	}
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests. Times a single edit as the circuit grows 16 times larger, which
+// should stay about flat since an edit only compiles the chunks of the gates it touches again. The times are recorded
+// as test properties (see --gtest_output=xml).
+TEST_F(EvaluatorTest, DISABLED_EditLatency) {
+	constexpr int rowLength = 256;
+	constexpr int editCount = 64;
+	constexpr int firstSize = 1024;
+	constexpr int lastSize = 16384;
+	Position switchPos(-1, -1);
+	Position probe(-1, 0);
+	circuit->tryInsertBlock(switchPos, Rotation::ZERO, BlockType::SWITCH);
+	int gateCount = 0;
+	double firstMicroseconds = 0;
+	for (int size = firstSize; size <= lastSize; size *= 2) {
+		{
+			// rows of chained AND gates
+			CircuitEditTransaction editTransaction(*circuit);
+			for (; gateCount < size; ++gateCount) {
+				Position pos(gateCount % rowLength, gateCount / rowLength);
+				circuit->tryInsertBlock(pos, Rotation::ZERO, BlockType::AND);
+				if (gateCount % rowLength != 0) circuit->tryCreateConnection(Position(pos.x - 1, pos.y), pos);
+			}
+		}
+		auto start = std::chrono::steady_clock::now();
+		for (int j = 0; j < editCount; ++j) {
+			circuit->tryInsertBlock(probe, Rotation::ZERO, BlockType::NOR);
+			circuit->tryCreateConnection(switchPos, probe);
+			circuit->tryRemoveBlock(probe);
+		}
+		double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / (editCount * 3);
+		RecordProperty("microsecondsPerEditAt" + std::to_string(size), std::to_string(microseconds));
+		if (size == firstSize) firstMicroseconds = microseconds;
+		else ASSERT_LT(microseconds, firstMicroseconds * 4) << size << " gates";
+
+		circuit->tryInsertBlock(probe, Rotation::ZERO, BlockType::NOR);
+		circuit->tryCreateConnection(switchPos, probe);
+		evaluator->tickStep(2);
+		ASSERT_EQ(evaluator->getState(Address(probe)), logic_state_t::HIGH);
+		circuit->tryRemoveBlock(probe);
+	}
+}
+
+// Benchmark, run with --gtest_also_run_disabled_tests. Times checkpoints of a large circuit, the first one after an edit
+// lays the checkpoint out and the later ones only copy the states. The times are recorded as test properties.
+TEST_F(EvaluatorTest, DISABLED_CheckpointLatency) {
+	constexpr int rowCount = 1024;
+	constexpr int rowLength = 1024;
+	constexpr int repeatCount = 8;
+	{
+		CircuitEditTransaction editTransaction(*circuit);
+		for (int row = 0; row < rowCount; ++row) {
+			for (int column = 0; column < rowLength; ++column) {
+				circuit->tryInsertBlock(Position(column, row), Rotation::ZERO, BlockType::NOR);
+				if (column > 0) circuit->tryCreateConnection(Position(column - 1, row), Position(column, row));
+			}
+			circuit->tryCreateConnection(Position(rowLength - 1, row), Position(0, row));
+		}
+	}
+	evaluator->tickStep(10);
+	SharedEvaluator restored = backend.getEvaluator(backend.createEvaluator(circuit->getCircuitId()).value());
+
+	auto milliseconds = [](auto function) {
+		const auto start = std::chrono::steady_clock::now();
+		function();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	};
+	std::vector<uint8_t> checkpoint;
+	const double firstTake = milliseconds([&]() { checkpoint = evaluator->getCheckpoint(); });
+	const double firstRestore = milliseconds([&]() { ASSERT_TRUE(restored->restoreCheckpoint(checkpoint)); });
+	const double take = milliseconds([&]() { for (int j = 0; j < repeatCount; ++j) checkpoint = evaluator->getCheckpoint(); }) / repeatCount;
+	const double restore = milliseconds([&]() { for (int j = 0; j < repeatCount; ++j) ASSERT_TRUE(restored->restoreCheckpoint(checkpoint)); }) / repeatCount;
+	RecordProperty("blocks", std::to_string(rowCount * rowLength));
+	RecordProperty("bytes", std::to_string(checkpoint.size()));
+	RecordProperty("millisecondsToTakeFirst", std::to_string(firstTake));
+	RecordProperty("millisecondsToRestoreFirst", std::to_string(firstRestore));
+	RecordProperty("millisecondsToTake", std::to_string(take));
+	RecordProperty("millisecondsToRestore", std::to_string(restore));
+	ASSERT_LT(take, firstTake / 4);
+	ASSERT_LT(restore, firstRestore / 4);
+}
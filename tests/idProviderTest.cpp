@@ -0,0 +1,82 @@
+#include "idProviderTest.h"
+
+TEST_F(IdProviderTest, HandsOutIdsInOrder) {
+	for (uint32_t id = 0; id < 200; ++id) {
+		ASSERT_EQ(idProvider.getNewId(), id);
+	}
+	ASSERT_EQ(idProvider.getLastId(), 200);
+	ASSERT_TRUE(idProvider.isIdUsed(199));
+	ASSERT_FALSE(idProvider.isIdUsed(200));
+	ASSERT_EQ(idProvider.getUsedIds().size(), 200);
+}
+
+TEST_F(IdProviderTest, WordBoundaries) {
+	// 64 ids per used word and 4096 per summary word
+	for (uint32_t id = 0; id < 8192 + 10; ++id) idProvider.getNewId();
+	for (uint32_t id : { 63u, 64u, 4095u, 4096u, 8191u }) {
+		idProvider.releaseId(id);
+		ASSERT_FALSE(idProvider.isIdUsed(id));
+	}
+	// the lowest free id first, across word and summary boundaries
+	for (uint32_t id : { 63u, 64u, 4095u, 4096u, 8191u }) {
+		ASSERT_EQ(idProvider.getNewId(), id);
+	}
+	ASSERT_EQ(idProvider.getNewId(), 8192 + 10);
+
+	// lastId itself on a word boundary starts a new word
+	IdProvider<uint32_t> exact;
+	for (uint32_t id = 0; id < 128; ++id) exact.getNewId();
+	ASSERT_EQ(exact.getNewId(), 128);
+	ASSERT_TRUE(exact.isIdUsed(128));
+	ASSERT_FALSE(exact.isIdUsed(129));
+}
+
+TEST_F(IdProviderTest, ReleaseLastId) {
+	for (uint32_t id = 0; id < 65; ++id) idProvider.getNewId();
+	idProvider.releaseId(64);
+	ASSERT_FALSE(idProvider.isIdUsed(64));
+	// releasing twice or an id that was never handed out does nothing
+	idProvider.releaseId(64);
+	idProvider.releaseId(65);
+	idProvider.releaseId(1000);
+	ASSERT_EQ(idProvider.getNewId(), 64);
+	ASSERT_EQ(idProvider.getNewId(), 65);
+	ASSERT_EQ(idProvider.getUsedIds().size(), 66);
+}
+
+TEST_F(IdProviderTest, ReallocateAfterRelease) {
+	for (uint32_t id = 0; id < 10000; ++id) idProvider.getNewId();
+	for (uint32_t id = 0; id < 10000; id += 3) idProvider.releaseId(id);
+	std::vector<uint32_t> usedIds = idProvider.getUsedIds();
+	ASSERT_EQ(usedIds.size(), 10000 - 3334);
+	for (uint32_t id : usedIds) ASSERT_NE(id % 3, 0);
+	for (uint32_t id = 0; id < 10000; id += 3) {
+		ASSERT_EQ(idProvider.getNewId(), id);
+	}
+	ASSERT_EQ(idProvider.getUsedIds().size(), 10000);
+	ASSERT_EQ(idProvider.getNewId(), 10000);
+
+	// a reset forgets the released ids
+	idProvider.releaseId(5);
+	idProvider.reset(20);
+	ASSERT_TRUE(idProvider.isIdUsed(5));
+	ASSERT_EQ(idProvider.getNewId(), 20);
+}
+
+TEST_F(IdProviderTest, PreferredId) {
+	for (uint32_t id = 0; id < 100; ++id) idProvider.getNewId();
+	idProvider.releaseId(10);
+	idProvider.releaseId(50);
+	// few ids are free, so a free preferred id is taken
+	ASSERT_EQ(idProvider.getNewId(50), 50);
+	// a used preferred id gives the lowest free one
+	ASSERT_EQ(idProvider.getNewId(70), 10);
+	// lastId skips the free ids below it
+	idProvider.releaseId(20);
+	ASSERT_EQ(idProvider.getNewId(100), 100);
+	ASSERT_FALSE(idProvider.isIdUsed(20));
+
+	// once half of the ids are free the lowest free id is handed out instead
+	for (uint32_t id = 30; id < 90; ++id) idProvider.releaseId(id);
+	ASSERT_EQ(idProvider.getNewId(80), 20);
+}
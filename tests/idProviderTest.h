@@ -0,0 +1,15 @@
+#ifndef idProviderTest_h
+#define idProviderTest_h
+
+#include <gtest/gtest.h>
+
+#include "backend/evaluator/idProvider.h"
+
+class IdProviderTest : public ::testing::Test {
+protected:
+	void SetUp() override { }
+	void TearDown() override { }
+	IdProvider<uint32_t> idProvider;
+};
+
+#endif /* idProviderTest_h */
@@ -0,0 +1,75 @@
+#include "threadPoolTest.h"
+
+#include <numeric>
+
+TEST_F(ThreadPoolTest, EveryJobRunsOncePerRound) {
+	// uneven lists whose sizes have nothing to do with the worker count, one of them empty
+	const std::vector<size_t> listSizes = { 1001, 7, 0, 333, 64 };
+	std::vector<std::atomic<uint32_t>> counts(std::accumulate(listSizes.begin(), listSizes.end(), size_t(0)));
+	std::vector<CountedJob> countedJobs;
+	countedJobs.reserve(counts.size());
+	std::vector<std::vector<ThreadPool::Job>> jobs(listSizes.size());
+	for (size_t list = 0; list < listSizes.size(); ++list) {
+		for (size_t j = 0; j < listSizes[list]; ++j) {
+			countedJobs.push_back(CountedJob { &counts[countedJobs.size()] });
+			jobs[list].push_back(ThreadPool::Job { &ThreadPoolTest::countJob, &countedJobs.back() });
+		}
+	}
+
+	ThreadPool threadPool(2);
+	uint32_t rounds = 0;
+	for (WaitPolicy waitPolicy : waitPolicies) {
+		threadPool.setWaitPolicy(waitPolicy);
+		// fewer, as many and more threads than lists, the lists without a thread are stolen
+		for (size_t threadCount : { 2, 4, 6, 1 }) {
+			threadPool.resizeThreads(threadCount);
+			for (int round = 0; round < 20; ++round, ++rounds) {
+				threadPool.resetAndLoad(jobs);
+				threadPool.waitForCompletion(round % 2 == 0);
+			}
+			for (size_t j = 0; j < counts.size(); ++j) {
+				ASSERT_EQ(counts[j].load(), rounds) << "job " << j;
+			}
+		}
+	}
+
+	uint64_t jobCount = 0;
+	for (const ThreadPool::WorkerStats& workerStats : threadPool.getWorkerStats()) jobCount += workerStats.jobCount;
+	ASSERT_GT(jobCount, 0);
+}
+
+TEST_F(ThreadPoolTest, TickBarrierWaitPolicies) {
+	constexpr uint32_t threadCount = 4;
+	constexpr uint32_t generations = 200;
+	for (WaitPolicy waitPolicy : waitPolicies) {
+		TickBarrier barrier;
+		barrier.setParticipants(threadCount);
+		std::atomic<uint32_t> arrived { 0 };
+		std::atomic<bool> early { false };
+		auto run = [&]() {
+			for (uint32_t generation = 0; generation < generations; ++generation) {
+				arrived.fetch_add(1, std::memory_order_relaxed);
+				barrier.arriveAndWait(waitPolicy, 1 << 8);
+				// nobody leaves a generation before everyone arrived at it
+				if (arrived.load(std::memory_order_relaxed) < (generation + 1) * threadCount) early = true;
+			}
+		};
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i + 1 < threadCount; ++i) threads.emplace_back(run);
+		run();
+		for (std::thread& thread : threads) thread.join();
+		ASSERT_FALSE(early) << "wait policy " << (int)waitPolicy;
+		ASSERT_EQ(arrived.load(), generations * threadCount);
+	}
+
+	// a thread that only arrives lets the waiting one through
+	for (WaitPolicy waitPolicy : waitPolicies) {
+		TickBarrier barrier;
+		barrier.setParticipants(2);
+		for (int generation = 0; generation < 100; ++generation) {
+			std::thread arriving([&]() { barrier.arrive(); });
+			barrier.arriveAndWait(waitPolicy, 1 << 8);
+			arriving.join();
+		}
+	}
+}
@@ -0,0 +1,23 @@
+#ifndef threadPoolTest_h
+#define threadPoolTest_h
+
+#include <gtest/gtest.h>
+
+#include "backend/evaluator/threadPool.h"
+
+class ThreadPoolTest : public ::testing::Test {
+protected:
+	void SetUp() override { }
+	void TearDown() override { }
+
+	struct CountedJob {
+		std::atomic<uint32_t>* count;
+	};
+	static void countJob(void* arg) {
+		static_cast<CountedJob*>(arg)->count->fetch_add(1, std::memory_order_relaxed);
+	}
+
+	static constexpr WaitPolicy waitPolicies[] = { WaitPolicy::SPIN, WaitPolicy::SPIN_THEN_PARK, WaitPolicy::PARK };
+};
+
+#endif /* threadPoolTest_h */